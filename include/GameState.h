@@ -10,20 +10,10 @@
 #include "doorlock.h"
 #include "ground_item.h"
 #include "pressure_plate.h"
+#include "encounter.h"
 
 #include <ace/managers/state.h>
 
-// Define a simple stack for Gosub
-#define SCRIPT_RETURN_STACK_SIZE 10
-typedef struct {
-    UWORD _stack[SCRIPT_RETURN_STACK_SIZE];
-    UBYTE _top;
-    BOOL _conditionMet; // Tracks if the most recent IF condition was true
-    BOOL _skippingBlock; // Tracks if we are skipping lines due to a false IF or a true IF followed by ELSE
-    UWORD _scriptProgramCounter; // Program counter for script execution
-} tScriptState;
-
-
 typedef struct _tGameState
 {
     char *m_pszMazeName;
@@ -41,11 +31,12 @@ typedef struct _tGameState
     tWallButtonList m_wallButtons; // Wall buttons in current level
     tDoorButtonList m_doorButtons; // Door buttons in current level
     tDoorLockList m_doorLocks;     // Door locks in current level
-    tScriptState _scriptState;
+    tScriptContext _scriptContexts[SCRIPT_MAX_CONTEXTS]; // Running / suspended scripts
     UBYTE m_bMapVisible;           // Full-screen map: 1 = visible
     UBYTE m_ubCurrentLevel;        // 0 = demo maze; else data/levelNN.maze
     tGroundItemList m_groundItems; // Loot on floor (cleared on LoadLevel)
     tPressurePlateList m_pressurePlates; // Step-on triggers (cleared on LoadLevel)
+    tEncounterList m_encounters;   // Dormant monster groups for ENCOUNTER events (cleared on LoadLevel)
 } tGameState;
 
 extern tGameState *g_pGameState;
@@ -56,6 +47,14 @@ extern UBYTE g_ubGameStateLoadedFromFile;
 /* Set by script EVENT_WIN; game loop transitions to win state when 1 */
 extern UBYTE g_ubRequestWin;
 
+/* Set by script EVENT_CHANGE_LEVEL; the game loop loads the level at the start of the next frame */
+typedef struct _tLevelRequest {
+    UBYTE isPending;
+    UBYTE ubLevel;
+    UBYTE ubX, ubY, ubFacing;
+} tLevelRequest;
+extern tLevelRequest g_sLevelRequest;
+
 UBYTE LoadGameState(const char* fileName);
 UBYTE SaveGameState(const char* fileName);
 void FreeGameState();
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <ace/types.h>
+
+/** Smallest block added when an arena runs out of room. */
+#define ARENA_MIN_BLOCK 1024
+
+typedef struct _arenaBlock {
+	struct _arenaBlock *next;
+	ULONG size; /* usable bytes after this header */
+	ULONG used;
+} tArenaBlock;
+
+/**
+ * Bump allocator for data that lives and dies together (one level's events and strings).
+ * Allocations are never freed one by one; arenaDestroy() releases everything.
+ * A zeroed tArena is valid and empty.
+ */
+typedef struct {
+	tArenaBlock *blocks; /* newest first */
+	ULONG allocCount;    /* arenaAlloc() calls served, for profiling */
+} tArena;
+
+/** Reserve the first block. Returns 0 if out of memory. */
+UBYTE arenaCreate(tArena *arena, ULONG size);
+
+/** Zeroed, pointer-aligned memory; adds a block when full. NULL if out of memory. */
+void *arenaAlloc(tArena *arena, ULONG size);
+
+/** Bytes handed out so far across all blocks, including alignment padding. */
+ULONG arenaUsed(const tArena *arena);
+
+void arenaDestroy(tArena *arena);
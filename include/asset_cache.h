@@ -0,0 +1,83 @@
+#pragma once
+
+#include <ace/types.h>
+#include <ace/utils/bitmap.h>
+#include <ace/utils/font.h>
+#include "wallset.h"
+#include "pak.h"
+
+/*
+ * Path-keyed cache of wallsets, bitmaps, fonts and palettes shared across
+ * levels and game states. Get returns the loaded asset with its reference
+ * count raised; Release drops it. An asset nobody references stays loaded
+ * (idle) so the next Get of the same path costs a table lookup, until it is
+ * evicted least recently used first:
+ *  - when idle assets exceed ASSET_CACHE_IDLE_BUDGET, or the chip-resident
+ *    ones (wallsets, fonts, bitmaps not loaded to fast) exceed
+ *    ASSET_CACHE_IDLE_CHIP_BUDGET,
+ *  - before a miss loads, while free memory is under ASSET_CACHE_RESERVE and,
+ *    for a chip-resident asset, free chip is under ASSET_CACHE_CHIP_RESERVE,
+ *  - before a large chip allocation, through assetCacheTrimChip(),
+ *  - when a load fails (all idle assets are dropped and the load is retried).
+ *
+ * Cached assets are shared: callers must not draw into or modify them.
+ */
+
+#define ASSET_CACHE_MAX_ENTRIES 24
+// Bytes of unreferenced assets kept around for reuse
+#define ASSET_CACHE_IDLE_BUDGET (160UL * 1024)
+// Free memory a miss tries to leave before it loads
+#define ASSET_CACHE_RESERVE (64UL * 1024)
+// Bytes of unreferenced chip-resident assets kept around for reuse
+#define ASSET_CACHE_IDLE_CHIP_BUDGET (128UL * 1024)
+// Free chip a miss on a chip-resident asset tries to leave before it loads
+#define ASSET_CACHE_CHIP_RESERVE (48UL * 1024)
+
+typedef struct _tAssetCacheStats {
+	ULONG ulHits;
+	ULONG ulMisses;
+	ULONG ulEvictions;
+	ULONG ulIdleBytes;
+	ULONG ulIdleChipBytes; // Part of ulIdleBytes that sits in chip
+	UBYTE ubEntries;
+} tAssetCacheStats;
+
+/** wallsetLoad(path), shared. NULL if it fails to load. */
+tWallset *assetWallsetGet(const char *path);
+
+/** wallsetLoadFromPak(pPak), shared under the pack's path. */
+tWallset *assetWallsetGetFromPak(const tPak *pPak, const char *pakPath);
+
+void assetWallsetRelease(tWallset *pWallset);
+
+/** bitmapCreateFromPath(path, isFast), shared. */
+tBitMap *assetBitmapGet(const char *path, UBYTE isFast);
+
+void assetBitmapRelease(tBitMap *pBitmap);
+
+/** fontCreateFromPath(path), shared. */
+tFont *assetFontGet(const char *path);
+
+void assetFontRelease(tFont *pFont);
+
+/**
+ * paletteLoadFromPath(path, pPalette, ubMaxLength) from a cached copy of the
+ * file. Entries the file does not cover are cleared. Returns 0 if the file
+ * does not exist (pPalette is left untouched).
+ */
+UBYTE assetPaletteLoad(const char *path, void *pPalette, UBYTE ubMaxLength);
+
+/** Evict idle assets, least recently used first, until free memory reaches ulFree. */
+void assetCacheTrim(ULONG ulFree);
+
+/**
+ * Evict idle chip-resident assets, least recently used first, until free chip
+ * reaches ulChipFree. Call it before a large chip allocation, asking for its
+ * size plus ASSET_CACHE_CHIP_RESERVE.
+ */
+void assetCacheTrimChip(ULONG ulChipFree);
+
+/** Free every idle asset. Referenced assets stay. */
+void assetCacheFlush(void);
+
+void assetCacheGetStats(tAssetCacheStats *pStats);
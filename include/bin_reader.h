@@ -0,0 +1,49 @@
+#pragma once
+
+#include <ace/types.h>
+#include <ace/utils/file.h>
+
+// Read-ahead for file readers: small fields come out of this buffer, so a
+// loader issues one DOS read per buffer rather than one per field.
+#define BIN_READER_BUFFER_SIZE 4096
+
+/**
+ * Sequential big-endian reader over either a file or a block of memory (a .pak
+ * chunk), so one loader body serves loose files and packs alike.
+ * File readers fill a read-ahead buffer (no larger than the file); reads of a
+ * buffer or more go straight to the destination, so bitmap planes still land
+ * in chip RAM with a single call.
+ * Reads past the end return zeroes and set isOverrun instead of failing.
+ */
+typedef struct {
+	tFile *file;        /* NULL when reading from memory */
+	const UBYTE *data;  /* the memory block, or the file's read-ahead buffer */
+	ULONG size;         /* valid bytes at data */
+	ULONG pos;          /* read position within data */
+	UBYTE *buffer;      /* owned read-ahead buffer, file readers only */
+	ULONG bufferSize;
+	ULONG fileLeft;     /* file bytes not yet pulled into the buffer */
+	UBYTE isOverrun;
+} tBinReader;
+
+/**
+ * Open path for reading; a file staged by level_prefetch.c is served from RAM instead.
+ * Returns 0 if it cannot be opened; binReaderClose() afterwards.
+ */
+UBYTE binReaderOpen(tBinReader *reader, const char *path);
+/** Close the file and free the buffer of a reader from binReaderOpen(). */
+void binReaderClose(tBinReader *reader);
+void binReaderInitMemory(tBinReader *reader, const void *data, ULONG size);
+
+/** Copy size bytes into dest; the missing tail is zeroed on a short read. Returns bytes read. */
+ULONG binRead(tBinReader *reader, void *dest, ULONG size);
+void binSkip(tBinReader *reader, ULONG size);
+/**
+ * Pointer to the next size bytes, consumed without copying. For a file reader it
+ * lives in the read-ahead buffer until the next read, and size must not exceed
+ * bufferSize. NULL (and isOverrun) if the data runs out.
+ */
+const void *binReadInPlace(tBinReader *reader, ULONG size);
+UBYTE binReadU8(tBinReader *reader);
+UWORD binReadU16Be(tBinReader *reader);
+ULONG binReadU32Be(tBinReader *reader);
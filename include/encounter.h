@@ -0,0 +1,88 @@
+#pragma once
+
+#include <ace/types.h>
+#include "monster.h"
+
+/*
+ * A level's encounter table: groups of monsters a script's ENCOUNTER event
+ * brings in at once. The groups come with the level (.lvl version 2) and
+ * their monsters are created then, dormant: stats rolled, out of the maze
+ * and out of the monster list. encounterTrigger() only appends and places
+ * them, so the frame a fight starts allocates nothing and reads no tables.
+ *
+ * A script's ADD_MONSTER events get the same treatment: one dormant monster
+ * per event in the maze, made at load by encounterAddMazeSpawns() and taken
+ * by encounterSpawn() when the event runs. An event that runs again, or one
+ * past ENCOUNTER_SPAWNS_MAX, creates its monster then, as before.
+ *
+ * Dormant monsters hold monster pool records; MONSTER_DORMANT_MAX of those
+ * are set aside for them, so a full table never starves ADD_MONSTER.
+ */
+
+#define ENCOUNTERS_MAX 16
+#define ENCOUNTER_SPAWNS_MAX 16
+
+typedef struct {
+	UBYTE id;
+	UBYTE first;    // Index of its first member in the list's spawns / pDormant
+	UBYTE count;
+	UBYTE isFired;
+} tEncounter;
+
+typedef struct {
+	UBYTE type;
+	UBYTE x;
+	UBYTE y;
+} tEncounterSpawn;
+
+typedef struct {
+	UBYTE count;
+	UBYTE memberCount;
+	tEncounter encounters[ENCOUNTERS_MAX];
+	tEncounterSpawn spawns[MONSTER_DORMANT_MAX];
+	tMonster *pDormant[MONSTER_DORMANT_MAX];  // NULL once activated or if the pool ran dry
+	UBYTE index[256];                          // Encounter id -> entry + 1, 0 if absent (so zeroed is empty)
+	UBYTE spawnCount;                          // ADD_MONSTER events with a dormant monster, in event order
+	UWORD spawnsTaken;                         // Bit i set once event spawn i has been taken
+	tEncounterSpawn eventSpawns[ENCOUNTER_SPAWNS_MAX];
+	tMonster *pEventDormant[ENCOUNTER_SPAWNS_MAX];
+} tEncounterList;
+
+/** Destroy the dormant monsters and forget every encounter. */
+void encounterListClear(tEncounterList *list);
+
+/**
+ * Add encounter id with ubCount members, pMembers holding (type, x, y) for
+ * each, and create their monsters dormant. Returns 0 if the id is taken or
+ * the table is full; members the pool cannot supply are skipped with a log.
+ */
+UBYTE encounterAdd(tEncounterList *list, UBYTE id, UBYTE ubCount, const UBYTE *pMembers);
+
+/**
+ * Move encounter id's dormant monsters into pMonsters and pMaze. Returns 0
+ * if there is no such encounter or it has already fired.
+ */
+UBYTE encounterTrigger(tEncounterList *list, tMaze *pMaze, tMonsterList *pMonsters, UBYTE id);
+
+/**
+ * Create a dormant monster for each ADD_MONSTER event in pMaze, up to
+ * ENCOUNTER_SPAWNS_MAX and the dormant records the encounters left.
+ */
+void encounterAddMazeSpawns(tEncounterList *list, const tMaze *pMaze);
+
+/**
+ * Add a monster of ubType at (x, y) to pMonsters and pMaze, as ADD_MONSTER
+ * does: the dormant one made for such an event if one is left, else a new
+ * one. Returns it, or NULL if the pool or the list is full.
+ */
+tMonster *encounterSpawn(tEncounterList *list, tMaze *pMaze, tMonsterList *pMonsters, UBYTE ubType, UBYTE x, UBYTE y);
+
+/** Bit i set when entry i has fired, bit 16 + i when event spawn i was taken; for snapshots. */
+ULONG encounterFiredMask(const tEncounterList *list);
+
+/**
+ * Make the fired state match ulFired: entries fired (and spawns taken) since
+ * are armed again with fresh dormant monsters, ones armed since lose theirs.
+ * Returns 0 if the pool could not supply every monster.
+ */
+UBYTE encounterRearm(tEncounterList *list, ULONG ulFired);
@@ -23,3 +23,6 @@ UBYTE groundItemAdd(tGroundItemList *list, UBYTE x, UBYTE y, UBYTE itemIdx, UBYT
 
 /** Remove qty from stack at cell matching itemIdx; returns 1 if something removed. */
 UBYTE groundItemRemoveAt(tGroundItemList *list, UBYTE x, UBYTE y, UBYTE itemIdx, UBYTE qty);
+
+/** Total quantity of all stacks at (x,y), capped at 255. */
+UBYTE groundItemQtyAt(const tGroundItemList *list, UBYTE x, UBYTE y);
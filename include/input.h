@@ -0,0 +1,76 @@
+#pragma once
+
+#include <ace/types.h>
+
+/*
+ * Player input as the game states see it, sampled once a frame by
+ * inputProcess() after ACE's key and mouse managers. The gameplay states
+ * read keys, mouse and fire buttons only through here, so a session can be
+ * recorded and played back frame for frame.
+ *
+ * A recording holds the random stream states (rng.h) at its start and one
+ * run per stretch of frames with the same input: only the keys in input.c's
+ * table, the mouse position, both mouse buttons and the two fire buttons.
+ * Played back from the same starting point (a new game), the session is the
+ * same down to the frame; the summary inputRecordStop() logs then compares
+ * frame times between builds.
+ */
+
+#define INPUT_RECORD_MAGIC "SMIR"
+#define INPUT_RECORD_VERSION 1
+/** Runs a recording can hold; longer sessions stop recording with a log. */
+#define INPUT_RECORD_MAX_RUNS 4096
+/** Where GAME_DEBUG builds write the session and look for one to replay. */
+#define INPUT_RECORD_PATH "session.rec"
+#define INPUT_REPLAY_PATH "replay.rec"
+
+typedef struct _tInputFrame {
+	ULONG ulKeys;      // Bit i: the i-th key of input.c's table is held
+	UWORD uwMouseX;
+	UWORD uwMouseY;
+	UBYTE ubButtons;   // INPUT_BUTTON_* held
+	UBYTE ubRepeat;    // Further frames with the same input, for runs in a recording
+} tInputFrame;
+
+#define INPUT_BUTTON_LMB 1
+#define INPUT_BUTTON_RMB 2
+#define INPUT_BUTTON_FIRE1 4
+#define INPUT_BUTTON_FIRE2 8
+
+typedef enum {
+	INPUT_LIVE,
+	INPUT_RECORDING,
+	INPUT_REPLAYING,
+} tInputMode;
+
+/** Sample this frame's input: from the managers, or the next frame of a replay. */
+void inputProcess(void);
+
+UBYTE inputKeyCheck(UBYTE ubKey);
+/** Held and not yet used since it went down, like keyUse(). */
+UBYTE inputKeyUse(UBYTE ubKey);
+/** ubButton: MOUSE_LMB or MOUSE_RMB. */
+UBYTE inputMouseCheck(UBYTE ubButton);
+UBYTE inputMouseUse(UBYTE ubButton);
+UWORD inputMouseX(void);
+UWORD inputMouseY(void);
+UBYTE inputMouseInRect(tUwRect sRect);
+/** ubJoy: JOY1 + JOY_FIRE or JOY2 + JOY_FIRE. */
+UBYTE inputJoyUse(UBYTE ubJoy);
+
+/** Record from the next frame on, keeping the random stream states. Returns 0 if out of memory. */
+UBYTE inputRecordStart(void);
+/**
+ * End a recording (written to szPath when not NULL) or a replay, and log
+ * frames, mean and worst frame time. Returns 0 if the file cannot be written.
+ */
+UBYTE inputRecordStop(const char *szPath);
+/**
+ * Load szPath, put back its random stream states and feed its frames to
+ * inputProcess() from the next frame on; live input returns after the last.
+ * Returns 0 if the file is missing or not a recording.
+ */
+UBYTE inputReplayStart(const char *szPath);
+tInputMode inputModeGet(void);
+/** Frames sampled since the recording or replay started. */
+ULONG inputFrameCount(void);
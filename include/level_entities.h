@@ -10,10 +10,13 @@ struct _tGameState;
 typedef struct _tGameState tGameState;
 
 #define LEVEL_ENTITIES_MAGIC "LVLE"
-#define LEVEL_ENTITIES_VERSION 1
+/** Newest version read; 1 lacks the encounter section. */
+#define LEVEL_ENTITIES_VERSION 2
 /** In .lvl wall/door button records: use this gfxIndex to pick first matching tile in wallset. */
 #define LEVEL_ENT_GFX_AUTO_WALL_BTN 255
 #define LEVEL_ENT_GFX_AUTO_DOOR_BTN 254
 
-/** Load level bundle (.lvl): wall buttons, door buttons, door locks, pressure plates, ground items, monster spawns. */
+/** Load level bundle (.lvl): wall buttons, door buttons, door locks, pressure plates, ground items, monster spawns, encounters. */
 UBYTE levelEntitiesLoad(tGameState *pState, const char *szPath);
+/** Same as levelEntitiesLoad() over a .lvl image in memory (a .pak chunk). */
+UBYTE levelEntitiesLoadFromMemory(tGameState *pState, const UBYTE *pData, ULONG ulSize);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <ace/types.h>
+#include "maze.h"
+
+/*
+ * Background prefetch of the levels the party is likely to enter next.
+ * levelPrefetchPlan() picks them from the EVENT_CHANGE_LEVEL targets in the
+ * current maze, then the next level in the manifest. levelPrefetchUpdate()
+ * reads their files into fast RAM one slice per call, from idle frame time.
+ * Staging is speculative: it is cancelled when free memory (or free chip, if
+ * a file had to go there) runs short, and before the asset cache evicts.
+ * On a level change the loaders (pakLoad, mazeLoad, binReaderOpen) take the
+ * staged images with levelPrefetchTake() instead of going to disk.
+ *
+ * A .pak level is staged whole. For a loose level the maze, wallset header and
+ * .lvl are staged; its bitmaps still come from disk.
+ */
+
+// Total bytes staged across all planned levels
+#define LEVEL_PREFETCH_CEILING (192UL * 1024)
+// Free memory prefetch never eats into; below it staging is cancelled
+#define LEVEL_PREFETCH_RESERVE (96UL * 1024)
+// Free chip kept when staging falls back to chip (fast RAM too short for the file)
+#define LEVEL_PREFETCH_CHIP_RESERVE (128UL * 1024)
+// Bytes read per levelPrefetchUpdate()
+#define LEVEL_PREFETCH_SLICE 2048
+#define LEVEL_PREFETCH_MAX_LEVELS 2
+#define LEVEL_PREFETCH_MAX_FILES (LEVEL_PREFETCH_MAX_LEVELS * 3)
+
+/** Re-plan after entering currentLevel; staged files of levels still in the plan are kept. */
+void levelPrefetchPlan(const tMaze *pMaze, UBYTE currentLevel);
+
+/** Read the next slice. Returns 1 if it touched the disk, 0 when there is nothing left to do. */
+UBYTE levelPrefetchUpdate(void);
+
+/**
+ * Hand over the staged image of path if it is complete. The caller owns it
+ * and frees it with memFree(data, *pSize). NULL if path is not staged.
+ */
+UBYTE *levelPrefetchTake(const char *path, ULONG *pSize);
+
+/** Drop staged files of every level but level (called as a level change starts). */
+void levelPrefetchRetain(UBYTE level);
+
+/** Stop reading and free everything staged. */
+void levelPrefetchCancel(void);
+
+/** Bytes currently allocated for staging. */
+ULONG levelPrefetchStagedBytes(void);
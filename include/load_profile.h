@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ace/types.h>
+
+/*
+ * Nested timing of level and table loads. A session (loadProfileBegin() ..
+ * loadProfileEnd()) collects markers the loaders open and close around their
+ * phases: open, read, decode, alloc, bitmap, build. loadProfileEnd() writes
+ * the tree with each phase's time to the log and appends it to
+ * LOAD_PROFILE_PATH. Times come from timerGetPrec() (CIA E-clock on Amiga).
+ *
+ * Markers are compiled in with GAME_PROFILE_LOAD (set by GAME_DEBUG builds);
+ * otherwise LOAD_PROFILE_PUSH/POP expand to nothing. Outside a session they
+ * record nothing.
+ */
+
+#define LOAD_PROFILE_MAX_MARKS 96
+#define LOAD_PROFILE_DETAIL_MAX 28
+#define LOAD_PROFILE_PATH "loadprof.txt"
+
+#ifdef GAME_PROFILE_LOAD
+/** Start a session; any previous one is discarded. */
+#define LOAD_PROFILE_BEGIN(name, detail) loadProfileBegin(name, detail)
+/** End the session and write its report to LOAD_PROFILE_PATH. */
+#define LOAD_PROFILE_END() loadProfileEnd(LOAD_PROFILE_PATH)
+/** Open a marker named label (a string literal) with an optional detail such as a path. */
+#define LOAD_PROFILE_PUSH(mark, label, detail) UBYTE mark = loadProfilePush(label, detail)
+/** Close mark and anything opened inside it that an early return left open. */
+#define LOAD_PROFILE_POP(mark) loadProfilePop(mark)
+#else
+#define LOAD_PROFILE_BEGIN(name, detail) do {} while (0)
+#define LOAD_PROFILE_END() do {} while (0)
+#define LOAD_PROFILE_PUSH(mark, label, detail) do {} while (0)
+#define LOAD_PROFILE_POP(mark) do {} while (0)
+#endif
+
+void loadProfileBegin(const char *szName, const char *szDetail);
+UBYTE loadProfilePush(const char *szLabel, const char *szDetail);
+void loadProfilePop(UBYTE ubMark);
+/** Close the session and report it; szFile NULL only logs. */
+void loadProfileEnd(const char *szFile);
+
+/** Number of markers in the last session, and one of them, for tests and tools. */
+UBYTE loadProfileMarkCount(void);
+UBYTE loadProfileMarkGet(UBYTE ubMark, const char **pLabel, UBYTE *pDepth, ULONG *pElapsed);
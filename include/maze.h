@@ -1,5 +1,6 @@
 #pragma once
 
+#include "arena.h"
 #include <ace/managers/viewport/simplebuffer.h>
 #include <ace/managers/game.h>
 #include <ace/managers/system.h>
@@ -22,6 +23,10 @@
 #define MAZE_DOOR_LOCKED 4
 #define MAZE_EVENT_TRIGGER 5
 
+// tMazeEvent::_flags
+#define MAZE_EVENT_INVALID 0x01 // Rejected by scriptVerifyMaze(); a script reaching it stops
+#define MAZE_EVENT_IN_ARENA 0x02 // Loaded: node in tMaze::_arena, payload in tMaze::_image
+
 // Door animation states
 #define DOOR_ANIM_NONE 0
 #define DOOR_ANIM_OPENING 1
@@ -45,21 +50,16 @@ typedef struct _mazeevent {
     UBYTE _x;
     UBYTE _y;
     UBYTE _eventType;
-    UBYTE _pad;       // Padding to ensure pointer is 4-byte aligned for 68020+
+    UBYTE _flags;     // MAZE_EVENT_*; also keeps the pointer 4-byte aligned for 68020+
     UBYTE* _eventData;
     UBYTE _eventDataSize;
     UBYTE _pad2[3];   // Padding to ensure pointers are 4-byte aligned for 68020+
     struct _mazeevent* _next;
     struct _mazeevent* _prev;
+    struct _scriptCondition* _condition; // Compiled EVENT_IF payload (script.c), NULL until compiled
 } tMazeEvent;
 
-typedef struct _mazeString
-{
-    UWORD _length;
-    UBYTE* _string;
-    struct _mazeString* _next;
-}
-tMazeString;
+struct _tMazeZones;
 
 typedef struct _maze
 {
@@ -71,8 +71,21 @@ typedef struct _maze
     UBYTE *_mazeCol;
     UBYTE *_mazeFloor;
     tMazeEvent *_events;
-    tMazeString* _strings;
+    tMazeEvent *_lastEvent; // Tail, so appends don't walk the list
+    // String table: the .maze string section as one blob (big-endian UWORD length, then text,
+    // per string) plus the offset of each string's text in it. A loaded maze's blob is in _image.
+    UBYTE* _stringBlob;
+    ULONG _stringBlobSize;
+    ULONG _stringBlobCapacity; // 0 while the blob is in _image (copied out on the first add)
+    ULONG* _stringOffsets;
+    UWORD _stringOffsetsCapacity;
     tDoorAnim* _doorAnims;  // List of active door animations
+    UBYTE *_monsterCount;   // Live monsters per cell, kept by monster.c
+    UBYTE _eventsVerified;  // scriptVerifyMaze() has checked the current event list
+    tArena _arena;          // Event nodes built by mazeLoad(); freed by mazeDelete()
+    UBYTE *_image;          // The .maze file as read; loaded payloads and the string blob point into it
+    ULONG _imageSize;
+    struct _tMazeZones *_zones; // Activity zones (maze_zones.c), built at level load
 } tMaze;
 
 tMaze* mazeCreateDemoData(void);
@@ -80,6 +93,8 @@ tMaze* mazeCreateDemoData(void);
 tMaze* mazeCreate(UBYTE width, UBYTE height);
 
 tMaze* mazeLoad(const char* filename);
+/** Same as mazeLoad() over a .maze image in memory (a .pak chunk); data is copied. */
+tMaze* mazeLoadFromMemory(const UBYTE* data, ULONG size);
 
 void mazeSave(tMaze* pMaze, const char* filename);
 
@@ -87,6 +102,9 @@ UBYTE mazeGetCell(tMaze* pMaze, UBYTE x, UBYTE y);
 
 void mazeSetCell(tMaze* pMaze, UBYTE x, UBYTE y, UBYTE value);
 
+/** Grid line of sight between two cells: floor, open doors and triggers let it through; walls and shut doors stop it. */
+UBYTE mazeLineOfSight(const tMaze* pMaze, UBYTE x0, UBYTE y0, UBYTE x1, UBYTE y1);
+
 void mazeDraw(tMaze* pMaze, UBYTE x, UBYTE y);
 void mazeDraw2D(tMaze* pMaze, UBYTE x, UBYTE y);
 void mazeDraw2DRange(tMaze* pMaze, UBYTE x, UBYTE y, UBYTE startX, UBYTE startY, UBYTE endX, UBYTE endY);
@@ -111,6 +129,9 @@ void mazeDelete(tMaze* maze);
 void mazeRemoveAllEvents(tMaze* maze);
 
 void mazeAddString(tMaze* maze, char* string, UWORD length);
+/** Text of string index where it lies (not NUL-terminated) and its length; NULL if there is none. */
+const char* mazeGetString(tMaze* pMaze, UWORD index, UWORD* pLength);
+/** Copy of string index, NUL-terminated and cut to bufferSize - 1 characters. */
 UBYTE mazeGetStringByIndex(tMaze* pMaze, UWORD index, char* buffer, UWORD bufferSize);
 void mazeRemoveStrings(tMaze* maze);
 
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <ace/types.h>
+#include "maze.h"
+
+/*
+ * Activity zones: the level cut into rooms so monster AI can skip the parts
+ * of it the party is nowhere near. mazeZonesBuild() flood-fills the open
+ * cells (floor, triggers) once at level load, never across a door and never
+ * out of a MAZE_ZONE_BLOCK square, so a big hall becomes several zones. A
+ * door cell joins the zones on its sides and belongs to the first of them;
+ * zones touching across a block edge are joined too. A level with more rooms
+ * than MAZE_ZONE_MAX is cut again in blocks twice the size, up to
+ * MAZE_ZONE_BLOCK_MAX; past that the last zone takes every room left over.
+ *
+ * The active zones are the party's and those joined to it, recomputed only
+ * when the party crosses into another zone. monsterListUpdate() leaves
+ * monsters elsewhere frozen; they keep the frames they missed and catch up
+ * their move cooldown on the first update after their zone wakes. Cells with
+ * no zone (a wall a script has since opened) count as active, as does
+ * everything before the zones are built.
+ */
+
+#define MAZE_ZONE_BLOCK 16
+#define MAZE_ZONE_BLOCK_MAX 64
+#define MAZE_ZONE_NONE 0xFF
+#define MAZE_ZONE_MAX 0xFE
+
+typedef struct _tMazeZones {
+	UBYTE *pCell;          // Zone of each cell, MAZE_ZONE_NONE for walls
+	UBYTE (*pLinks)[2];    // Pairs of joined zones, each pair once
+	UWORD uwLinkCount;
+	UBYTE ubCount;
+	UBYTE ubBlock;         // Block side the rooms were cut at
+	UBYTE ubPartyZone;     // Zone the active set was computed for
+	UBYTE pActive[256];    // 1 for the party's zone and its neighbours; [MAZE_ZONE_NONE] is always 1
+} tMazeZones;
+
+/** Compute the zones of pMaze (dropping any older ones). Returns 0 when out of memory. */
+UBYTE mazeZonesBuild(tMaze *pMaze);
+
+void mazeZonesDestroy(tMaze *pMaze);
+
+/** Zone of (x, y), or MAZE_ZONE_NONE. */
+UBYTE mazeZoneAt(const tMaze *pMaze, UBYTE x, UBYTE y);
+
+/** Recompute the active zones if the party at (x, y) is in another zone than last time. */
+void mazeZonesSetParty(tMaze *pMaze, UBYTE x, UBYTE y);
+
+/** Whether monsters at (x, y) are simulated. */
+UBYTE mazeZoneIsActive(const tMaze *pMaze, UBYTE x, UBYTE y);
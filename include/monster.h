@@ -9,6 +9,16 @@ typedef struct _tInventory tInventory;
 
 // Monster constants
 #define MAX_MONSTERS 64
+/** Records a level's encounters may hold dormant (encounter.h). */
+#define MONSTER_DORMANT_MAX 32
+/** Monster records preallocated: a full list, the dormant ones, and a few created before a full list refuses them. */
+#define MONSTER_POOL_SIZE (MAX_MONSTERS + MONSTER_DORMANT_MAX + 4)
+/** Monsters monsterListUpdate() brings up to date per frame (MAX_MONSTERS: every one). */
+#define MONSTER_AI_DEFAULT_BUDGET 16
+/** Awake monsters this close to the party (steps, straight line) are updated before the rest. */
+#define MONSTER_AI_NEAR 8
+/** Idle monsters further than their aggro range plus this are parked until the party comes closer. */
+#define MONSTER_AI_WAKE_MARGIN 4
 
 // Monster types
 #define MONSTER_TYPE_NORMAL 0
@@ -21,45 +31,128 @@ typedef struct _tInventory tInventory;
 #define MONSTER_STATE_FLEEING 2
 #define MONSTER_STATE_DEAD 3
 
+// monsterCombatRound() results
+#define MONSTER_COMBAT_NONE 0
+#define MONSTER_COMBAT_ROUND 1
+#define MONSTER_COMBAT_KILL 2
+
+/** The tCharacter stats a monster uses. */
+typedef struct _monsterStats
+{
+    UWORD _HP;
+    UWORD _MaxHP;
+    UBYTE _Attack;
+    UBYTE _Defense;
+    UBYTE _Level;
+} tMonsterStats;
+
+/**
+ * What the AI, combat and drawing loops read. Records live in one
+ * preallocated pool, so the loops walk a few contiguous kilobytes; the
+ * fields only read on a kill are in a parallel cold table (monsterCold()).
+ */
 typedef struct _monster
 {
-    tCharacter _base;  // Base character stats
+    tMonsterStats _base;
     UBYTE _monsterType;
     UBYTE _state;
     UBYTE _aggroRange;  // How far the monster can detect the player
     UBYTE _fleeThreshold;  // HP percentage at which monster will flee
-    UBYTE _dropTable[8];  // Items that can be dropped
-    UBYTE _dropChance[8]; // Chance for each item to drop
-    UWORD _experienceValue; // XP given when defeated
     UBYTE _partyPosX;
     UBYTE _partyPosY;
     /** Ticks until next move attempt (staggered at spawn). */
     UBYTE _moveCooldown;
+    /** 1 while counted in maze->_monsterCount (placed and alive). */
+    UBYTE _inMaze;
+    /** Order of arrival in the level's list; names the monster in save journals. */
+    UWORD _spawnId;
+    /** tMonsterList::_aiFrame of its last update; the frames since are its move cooldown owed. */
+    UWORD _aiFrame;
 } tMonster;
 
+/** A monster's fields read only when it dies. */
+typedef struct _monsterCold
+{
+    UWORD _experienceValue; // XP given when defeated
+    UBYTE _dropTable[8];  // Items that can be dropped
+    UBYTE _dropChance[8]; // Chance for each item to drop
+} tMonsterCold;
+
 typedef struct _monsterList
 {
     UBYTE _numMonsters;
     tMonster** _monsters;  // Dynamic list of monsters
+    UWORD _nextSpawnId;
+    UBYTE _aiCursor;   // Where the next round-robin pass of monsterListUpdate() starts
+    UWORD _aiFrame;    // Frames run by monsterListUpdate()
 } tMonsterList;
 
+typedef struct _monsterAiStats
+{
+    ULONG ulFrames;
+    ULONG ulUpdates;
+    ULONG ulParked;     // Summed over frames
+    ULONG ulFrozen;     // Summed over frames: awake but outside the party's zones
+    ULONG ulPrecTotal;  // timerGetPrec() ticks spent in monsterListUpdate()
+    ULONG ulPrecWorst;
+} tMonsterAiStats;
+
 // Monster creation and management
 /** Load monster stat table from data/monsters.dat (or path from game manifest). Safe to call repeatedly. */
 void monsterTableLoad(const char *szPath);
 void monsterTableClear(void);
+/** Types the loaded table defines (0 when none is loaded: the built-in normal, boss and miniboss). */
+UBYTE monsterTableCount(void);
 
+/** Takes a record from the pool (NULL when all MONSTER_POOL_SIZE are in use). */
 tMonster* monsterCreate(UBYTE monsterType);
+/** Returns the record to the pool for the next monsterCreate(); a record not in use is refused with a log. */
 void monsterDestroy(tMonster* monster);
+tMonsterCold* monsterCold(const tMonster* monster);
+/** Records taken from the pool and not yet destroyed. */
+UBYTE monsterPoolUsed(void);
 tMonsterList* monsterListCreate();
 void monsterListDestroy(tMonsterList* monsterList);
+/** Destroy every monster in the list (monsters belong to the level they were spawned in). */
+void monsterListClear(tMonsterList* monsterList);
+/** Add to the end of the list and give it the next spawn id; 0 if the list is full. */
+UBYTE monsterListAppend(tMonsterList* monsterList, tMonster* monster);
+/** Take the monster at index out of the maze and the list, and destroy it. */
+void monsterListRemove(tMonsterList* monsterList, tMaze* maze, UBYTE index);
 
 // Monster behavior
 void monsterUpdate(tMonster* monster, tMaze* maze, tCharacterParty* party, tMonsterList* allMonsters);
+/**
+ * One frame of monster AI. Awake monsters near the party are updated first,
+ * then the other awake ones round-robin, at most the budget in all; a monster
+ * skipped for some frames catches up its move cooldown when its turn comes.
+ * Idle monsters far from the party are parked and cost a distance check;
+ * monsters outside the party's activity zones (maze_zones.h) are frozen.
+ * Writes the indices of the updated monsters to pUpdated (MAX_MONSTERS
+ * entries) and returns their count.
+ */
+UBYTE monsterListUpdate(tMonsterList* list, tMaze* maze, tCharacterParty* party, UBYTE* pUpdated);
+void monsterAiSetBudget(UBYTE ubBudget);
+const tMonsterAiStats* monsterAiStatsGet(void);
+void monsterAiStatsReset(void);
 void monsterAttack(tMonster* monster, tCharacter* target);
 /** Melee strike from party member (after monster's attack). */
 void monsterTakeDamageFromCharacter(tMonster* monster, tCharacter* attacker);
 void monsterDropLoot(tMonster* monster, tInventory* pInventory);
+/**
+ * The combat step gameGsLoop() runs for each monster it updated: an aggressive
+ * monster on the party's cell strikes the first party member, who strikes back.
+ * A monster that dies is killed, drops its loot into pInventory and gives its
+ * experience to every party member; the caller then takes it off the list.
+ * Returns MONSTER_COMBAT_NONE when there was no fight.
+ */
+UBYTE monsterCombatRound(tMonster* monster, tMaze* maze, tCharacterParty* party, tInventory* pInventory);
 
 // Monster placement
 void monsterPlaceInMaze(tMaze* maze, tMonster* monster, UBYTE x, UBYTE y);
-void monsterRemoveFromMaze(tMaze* maze, tMonster* monster); 
\ No newline at end of file
+void monsterRemoveFromMaze(tMaze* maze, tMonster* monster);
+/** Mark dead and drop from the per-cell count; the corpse keeps its position. */
+/** Dead and off its cell; once loot and experience are handed out, monsterListRemove() frees the record. */
+void monsterKill(tMaze* maze, tMonster* monster);
+/** Live monsters on a cell (0 off the map). */
+UBYTE monsterCountAt(const tMaze* maze, UBYTE x, UBYTE y); 
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <ace/types.h>
+
+/*
+ * Level pack (.pak): one file holding everything LoadLevel() needs, read with
+ * one open and one sequential read. Layout (big-endian, see docs/formats/pak.md):
+ *   header  "SPAK", UWORD version, UWORD chunkCount, ULONG fileSize, ULONG reserved
+ *   TOC     chunkCount x { char tag[4], UWORD index, UWORD reserved, ULONG offset, ULONG size }
+ *   chunks  each starting on a PAK_CHUNK_ALIGN boundary
+ */
+#define PAK_VERSION 1
+#define PAK_HEADER_SIZE 16
+#define PAK_TOC_ENTRY_SIZE 16
+#define PAK_CHUNK_ALIGN 4
+
+/* Chunk tags; the chunk body is the byte-for-byte content of the loose file */
+#define PAK_TAG_MAZE "MAZE"     /* .maze */
+#define PAK_TAG_WALLSET "WALL"  /* .wll header */
+#define PAK_TAG_PLANES "PLN "   /* _N.pln, index N */
+#define PAK_TAG_MASK "MSK "     /* _N.msk, index N */
+#define PAK_TAG_ENTITIES "LVLE" /* .lvl */
+
+typedef struct {
+	UBYTE *data; /* whole file, header and TOC included */
+	ULONG size;
+	UWORD chunkCount;
+} tPak;
+
+/** Read the whole pack into memory. Returns 0 (and logs) if missing or malformed. */
+UBYTE pakLoad(tPak *pak, const char *path);
+
+/** Chunk body by tag and index, or NULL. Stays valid until pakDestroy(). */
+const UBYTE *pakFind(const tPak *pak, const char *tag, UWORD index, ULONG *size);
+
+/** True if path names a pack rather than a loose .maze. */
+UBYTE pakIsPath(const char *path);
+
+void pakDestroy(tPak *pak);
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <ace/types.h>
+#include "maze.h"
+
+/*
+ * Walking distance from the party to every cell within PARTY_FIELD_RADIUS
+ * steps, shared by all monsters. A chaser steps to the neighbour with the
+ * lowest distance, a fleeing monster to the highest, so both follow the
+ * corridors instead of the straight line and neither needs a search of its own.
+ *
+ * The field is a breadth-first search over the cells monsters can walk
+ * (floor, open doors, triggers; closed doors block), held in a fixed window
+ * around the party. partyFieldUpdate() redoes it only when the party moved or
+ * a wall-layer write touched the field, and then only over the cells within
+ * the radius, so its cost does not grow with the maze or the monster count.
+ * Cells outside read PARTY_FIELD_FAR.
+ *
+ * partyFieldSees() answers line of sight from the party for aggro. Each cell
+ * within PARTY_SIGHT_RADIUS is traced once and remembered until the party
+ * moves or a wall-layer cell in that window changes (the same hooks as the
+ * field), so the monsters near the party share the traces. Further cells are
+ * traced on every call.
+ */
+
+#define PARTY_FIELD_RADIUS 32
+#define PARTY_FIELD_SIZE (2 * PARTY_FIELD_RADIUS + 1)
+#define PARTY_FIELD_FAR 0xFF
+#define PARTY_SIGHT_RADIUS 16
+
+/** Forget the field (the level is about to change). */
+void partyFieldReset(void);
+
+/** Bring the field up to date for the party at (x, y); cheap when nothing changed. */
+void partyFieldUpdate(const tMaze *pMaze, UBYTE x, UBYTE y);
+
+/** A wall-layer cell changed (door opened or closed, wall set); rebuild if it touches the field. */
+void partyFieldCellChanged(UBYTE x, UBYTE y);
+
+/** Rebuild on the next update whatever changed (bulk grid writes, snapshots). */
+void partyFieldInvalidate(void);
+
+/** Steps from the party to (x, y), or PARTY_FIELD_FAR if unreachable within the radius. */
+UBYTE partyFieldAt(UBYTE x, UBYTE y);
+
+/** Times the field was rebuilt since the last reset. */
+ULONG partyFieldRebuilds(void);
+
+/** Whether the party at (px, py) has a line of sight to (x, y); see mazeLineOfSight(). */
+UBYTE partyFieldSees(const tMaze *pMaze, UBYTE px, UBYTE py, UBYTE x, UBYTE y);
+
+/** Lines traced by partyFieldSees() since the last reset (cache misses and cells outside the window). */
+ULONG partyFieldSightTraces(void);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <ace/types.h>
+
+/*
+ * Named random streams, one per subsystem, each with its own state: a loot
+ * roll never shifts the next monster wander, and any stream can be seeded or
+ * put back on its own. Every stream is the 31-bit LCG the game has always
+ * used. Snapshots carry all the states and the input recorder (input.h)
+ * stores them when a session starts, so a replay draws the same numbers.
+ */
+
+typedef enum {
+	RNG_AI,       // Wander order, move stagger of new monsters
+	RNG_COMBAT,   // Hit and damage rolls (none yet: combat is fixed arithmetic)
+	RNG_LOOT,     // Drop rolls
+	RNG_SCRIPT,   // ROLL_DICE
+	RNG_STREAM_COUNT
+} tRngStream;
+
+/** Advance eStream; returns its new 31-bit state. */
+ULONG rngNext(tRngStream eStream);
+
+/** Seed every stream from ulSeed, each to a different state. */
+void rngSeed(ULONG ulSeed);
+
+ULONG rngStateGet(tRngStream eStream);
+void rngStateSet(tRngStream eStream, ULONG ulState);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <ace/types.h>
+#include <ace/utils/file.h>
+
+struct _tGameState;
+
+/*
+ * What the player changed in the current level, relative to its data on
+ * disk. The mutators (script cell writes and door events, battery chargers,
+ * door locks, ground items, monster spawns, removals, deaths and encounters) append a
+ * record while recording is on; LoadLevel() turns it off around the load and
+ * clears the journal, so a fresh level starts empty.
+ *
+ * Records that overwrite the same thing are merged: a cell, event byte or lock
+ * keeps its last value, a ground stack its net quantity. A save therefore
+ * grows with the cells and entities the player touched, not with how often
+ * or with the level size. Loading a save reloads the level and replays it.
+ */
+
+#define SAVE_JOURNAL_MAX_RECORDS 512
+// Bytes per record in a save
+#define SAVE_JOURNAL_RECORD_SIZE 6
+
+typedef enum {
+	SAVE_JOURNAL_CELL,          // x, y, arg = layer, value = new byte
+	SAVE_JOURNAL_EVENT_BYTE,    // x = data offset, arg = new byte, value = event ordinal
+	SAVE_JOURNAL_DOORLOCK,      // x, y, arg = lock state
+	SAVE_JOURNAL_GROUND,        // x, y, arg = item index, value = net quantity (signed)
+	SAVE_JOURNAL_MONSTER_ADD,   // x, y, arg = monster type
+	SAVE_JOURNAL_MONSTER_KILL,  // value = spawn id
+	SAVE_JOURNAL_MONSTER_REMOVE, // value = spawn id
+	SAVE_JOURNAL_ENCOUNTER,     // arg = encounter id
+} tSaveJournalType;
+
+// Layers of SAVE_JOURNAL_CELL
+#define SAVE_JOURNAL_LAYER_WALL 0
+#define SAVE_JOURNAL_LAYER_FLOOR 1
+#define SAVE_JOURNAL_LAYER_COL 2
+
+typedef struct _tSaveJournalRecord {
+	UBYTE type;
+	UBYTE x;
+	UBYTE y;
+	UBYTE arg;
+	UWORD value;
+} tSaveJournalRecord;
+
+/** Drop every record and stop recording (a level is about to load). */
+void saveJournalReset(void);
+
+/** Start recording (the level is loaded and replayed). */
+void saveJournalStart(void);
+
+void saveJournalCell(UBYTE ubLayer, UBYTE x, UBYTE y, UBYTE ubValue);
+void saveJournalEventByte(UWORD uwOrdinal, UBYTE ubOffset, UBYTE ubValue);
+void saveJournalDoorLock(UBYTE x, UBYTE y, UBYTE ubState);
+void saveJournalGround(UBYTE x, UBYTE y, UBYTE ubItemIdx, WORD wDelta);
+void saveJournalMonsterAdd(UBYTE ubType, UBYTE x, UBYTE y);
+void saveJournalMonsterKill(UWORD uwSpawnId);
+void saveJournalMonsterRemove(UWORD uwSpawnId);
+void saveJournalEncounter(UBYTE ubId);
+
+/** Write the record count (UWORD) and the records, SAVE_JOURNAL_RECORD_SIZE bytes each. */
+void saveJournalWrite(tFile *pFile);
+
+/**
+ * Apply uwCount records in save layout to the freshly loaded level in pState;
+ * they become the journal. Returns 0 if any record does not fit the level
+ * (the rest are still applied).
+ */
+UBYTE saveJournalReplay(struct _tGameState *pState, const UBYTE *pData, UWORD uwCount);
+
+/** Make pRecords (uwCount records, any alignment) the journal without applying them; for snapshots. */
+void saveJournalRestore(const void *pRecords, UWORD uwCount);
+
+UWORD saveJournalCount(void);
+const tSaveJournalRecord *saveJournalGet(UWORD uwIndex);
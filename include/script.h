@@ -102,6 +102,8 @@ typedef enum {
 #define EVENT_ENCOUNTER 31
 #define EVENT_SOUND 32
 #define EVENT_WIN 33
+#define EVENT_WAIT 34
+#define EVENT_CHANGE_LEVEL 35
 
 #define EVENT_IF 128
 #define EVENT_ELSE 129
@@ -134,16 +136,65 @@ typedef enum {
 
 #define EVENT_BATTERY_CHARGER 221
 
+// GOSUB / IF nesting depth per script context
+#define SCRIPT_RETURN_STACK_SIZE 10
+// Scripts that can be suspended (EVENT_WAIT or out of budget) at the same time
+#define SCRIPT_MAX_CONTEXTS 8
+// Opcodes all contexts may execute per frame unless changed with scriptSetFrameBudget()
+#define SCRIPT_DEFAULT_FRAME_BUDGET 64
+
+/** Resumable VM state for one running script. */
+typedef struct _scriptContext {
+    UWORD _stack[SCRIPT_RETURN_STACK_SIZE];
+    UBYTE _top;
+    BOOL _conditionMet; // Tracks if the most recent IF condition was true
+    BOOL _skippingBlock; // Tracks if we are skipping lines due to a false IF or a true IF followed by ELSE
+    UBYTE _active;       // 1 while the script has opcodes left to run
+    UWORD _scriptProgramCounter; // Program counter for script execution
+    tMazeEvent *_pEvent; // Event at the program counter; NULL until looked up again by ordinal
+    UBYTE _anchorX;      // Cell the script belongs to; leaving it ends the script
+    UBYTE _anchorY;
+    UBYTE _waitFrames;   // Frames left before an EVENT_WAIT resumes
+    UBYTE _pad;
+    UWORD _stepsSinceYield; // Runaway guard (GOTO loops without EVENT_WAIT)
+} tScriptContext;
+
 // Function declarations
 void handleEvent(tMaze *pMaze, tMazeEvent *pEvent);
 void createEventTrigger(tMaze* pMaze, UBYTE x, UBYTE y, UBYTE eventType, UBYTE eventDataSize, UBYTE* eventData);
 /**
- * Run script opcodes starting at the given event ordinal (linked-list order).
- * Stops when the program counter leaves the current anchor cell, on EVENT_END, or on error.
- * Door/UI code still uses handleEvent() for single fire-and-forget opcodes.
+ * Start a script at the given event ordinal (linked-list order) in a free context.
+ * The first slice (up to the frame budget) runs immediately; the rest continues
+ * in scriptUpdate(). A script ends when the program counter leaves its anchor cell
+ * or on error. Door/UI code still uses handleEvent() for single fire-and-forget opcodes.
  */
 void executeScript(tMaze *pMaze, UWORD startIndex);
+/** Resume suspended scripts; call once per frame. Returns the number of opcodes executed. */
+UWORD scriptUpdate(tMaze *pMaze);
+/** Per-frame opcode budget shared by all contexts in scriptUpdate() (minimum 1). */
+void scriptSetFrameBudget(UWORD uwOpcodes);
+/** Number of scripts still running or waiting. */
+UBYTE scriptActiveCount(void);
+/** Drop every running script, e.g. before the maze they point into is freed. */
+void scriptStopAll(void);
 void updateBatteryChargers(tMaze* maze);
+/**
+ * Decode an EVENT_IF payload into pEvent->_condition (once; later calls reuse it).
+ * Returns 0 if the payload is malformed; the verifier rejects such an IF.
+ */
+UBYTE scriptCompileCondition(tMazeEvent *pEvent);
+/**
+ * Check every event once: payload sizes, cell and door coordinates, GOTO/GOSUB targets,
+ * flag selectors, IF/ELSE/ENDIF nesting and GOSUB call depth against SCRIPT_RETURN_STACK_SIZE
+ * (recursive GOSUBs are rejected), IF conditions.
+ * Bad events get MAZE_EVENT_INVALID. mazeLoad() runs this; executeScript() re-runs it after
+ * the event list changed. Returns the number of rejected events.
+ */
+UWORD scriptVerifyMaze(tMaze *pMaze);
+/** Free a compiled condition; maze.c calls this when an event is removed. */
+void scriptConditionFree(tMazeEvent *pEvent);
 
 // Called by script to show a message in the game UI (implemented in game.c)
-void gameDisplayMessage(const char* szMessage);
\ No newline at end of file
+void gameDisplayMessage(const char* szMessage);
+// Same for text that is not NUL-terminated, such as a maze string in place
+void gameDisplayText(const char* pText, UWORD uwLength);
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ace/types.h>
+#include "bin_reader.h"
+
+/*
+ * SLZ1: byte-aligned LZ77 in the LZ4 mould, picked for a short 68020 decode
+ * loop (no bit reader, big-endian offsets, copies are plain byte moves).
+ *
+ * Stream: sequences of
+ *   token   high nibble = literal count, low nibble = match length - SLZ_MIN_MATCH
+ *           (15 in either means "add following bytes until one is below 255")
+ *   literals
+ *   offset  UWORD big-endian, 1..65535 back from the write position
+ *   [match length extension]
+ * The last sequence carries literals only and ends exactly at the raw size.
+ *
+ * Container (a whole compressed file, e.g. a .maze): "SLZ1", ULONG rawSize,
+ * ULONG packedSize, stream. Compressed bitmaps keep the ACE bitmap header, set
+ * SLZ_BITMAP_FLAG in its flags byte and store each plane as ULONG packedSize +
+ * stream, so every plane decodes straight into its own chip RAM buffer.
+ * Encoder: tools/smite_editor/src/formats.cpp. Format notes: docs/formats/slz.md
+ */
+#define SLZ_MAGIC "SLZ1"
+#define SLZ_HEADER_SIZE 12
+#define SLZ_MIN_MATCH 3
+#define SLZ_BITMAP_FLAG 0x80
+
+/** True if data starts with an SLZ1 container header. */
+UBYTE slzIsPacked(const UBYTE *data, ULONG size);
+/** Unpacked size from a container header. */
+ULONG slzRawSize(const UBYTE *data);
+
+/** Decode a stream held in memory. Returns 1 if it produced exactly rawSize bytes and used all of srcSize. */
+UBYTE slzDecode(const UBYTE *src, ULONG srcSize, UBYTE *dest, ULONG rawSize);
+
+/**
+ * Decode packedSize stream bytes from reader into dest, pulling input through
+ * the reader's read-ahead buffer so a file never has to be held whole. Matches copy from dest itself,
+ * so it may be chip RAM. Returns 1 if exactly rawSize bytes came out.
+ */
+UBYTE slzDecodeStream(tBinReader *reader, ULONG packedSize, UBYTE *dest, ULONG rawSize);
+
+/** Unpack a whole container into dest (slzRawSize() bytes). */
+UBYTE slzUnpack(const UBYTE *data, ULONG size, UBYTE *dest);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <ace/types.h>
+
+struct _tGameState;
+
+/*
+ * In-memory copy of the whole game state for quick-save / quick-load (and a
+ * known starting point for tests). The buffer is allocated outside play and
+ * grown with snapshotReserve() as levels load; snapshotTake() and
+ * snapshotRestore() only copy.
+ *
+ * Plain-data regions go across with one copy each: flags, script contexts,
+ * ground items and pressure plates, inventory, the maze grids, and the part
+ * of the .maze image holding the event payloads. Monsters, party members and
+ * the door lock / button states are copied per entry; the journal of level
+ * changes and the random stream states (rng.h) come along too. Encounters
+ * keep only whether they fired: ones fired since are armed again with fresh
+ * dormant monsters.
+ *
+ * The event list is taken as it stands: a snapshot is restored onto the same
+ * level, reloading it first if the party has moved on. Door animations in
+ * flight are dropped (doors snap to their state).
+ */
+
+// Room over snapshotSizeOf() at level load for what play adds: journal records, monsters
+#define SNAPSHOT_HEADROOM (2UL * 1024)
+
+typedef struct _tSnapshot {
+	UBYTE *pData;
+	ULONG ulCapacity;
+	ULONG ulSize;    // Bytes used by the last snapshotTake(); 0 when empty
+} tSnapshot;
+
+/** Allocate the buffer. Returns 0 if out of memory. */
+UBYTE snapshotCreate(tSnapshot *pSnapshot, ULONG ulCapacity);
+/** Grow the buffer to at least ulCapacity, keeping the snapshot in it. Returns 0 (and keeps the old buffer) if out of memory. */
+UBYTE snapshotReserve(tSnapshot *pSnapshot, ULONG ulCapacity);
+void snapshotDestroy(tSnapshot *pSnapshot);
+
+/** Bytes a snapshot of pState needs. */
+ULONG snapshotSizeOf(const struct _tGameState *pState);
+
+/** Copy pState in. Returns 0 (and leaves the old snapshot) if it does not fit. */
+UBYTE snapshotTake(tSnapshot *pSnapshot, const struct _tGameState *pState);
+
+/**
+ * Put pState back as it was at snapshotTake(). Reloads the level first if
+ * pState is on another one. Returns 0 if the snapshot is empty or does not
+ * match the level's layout.
+ */
+UBYTE snapshotRestore(const tSnapshot *pSnapshot, struct _tGameState *pState);
@@ -9,6 +9,7 @@
 #include <ace/managers/ptplayer.h>
 #include <ace/utils/palette.h>
 #include <fade.h>
+#include "pak.h"
 
 #ifndef AMIGA
 #include "amiTypes.h"
@@ -51,6 +52,8 @@ typedef struct _wallset
 
 
 tWallset* wallsetLoad(const char* filename);
+/** Wallset header and its _N.pln / _N.msk bitmaps from a level pack. */
+tWallset* wallsetLoadFromPak(const tPak* pPak);
 void wallsetSave(tWallset* pWallset, const char* filename);
 void wallsetDestroy(tWallset* pWallset);
 
@@ -3,6 +3,7 @@
 
 #include "uigfx.h"
 #include "gfx_util.h"
+#include "asset_cache.h"
 
 
 tUigfxSprite* s_uiSprites;
@@ -13,7 +14,7 @@ void LoadUIGraphics(const char* sFilename)
     systemUse();
     // load the bitmap.
     char* bitmapFile = replace_extension(sFilename, ".bm");
-    s_pBitmap = bitmapCreateFromPath(bitmapFile,FALSE);
+    s_pBitmap = assetBitmapGet(bitmapFile,FALSE);
     char* maskFile = replace_extension(sFilename, ".msk");
            
     memFree(bitmapFile,strlen(bitmapFile)+1);
@@ -29,5 +30,5 @@ void DrawUIGfx(tBitMap* pDest, tUigfxSprite* pSprite, UWORD uwX, UWORD uwY)
 void DestroyUIGraphics(void)
 {
     if (s_pBitmap != NULL)
-        bitmapDestroy(s_pBitmap);
+        assetBitmapRelease(s_pBitmap);
 }
\ No newline at end of file
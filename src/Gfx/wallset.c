@@ -1,23 +1,15 @@
 #include "wallset.h"
 #include <ace/utils/file.h>
 #include <ace/managers/memory.h>
+#include <ace/managers/log.h>
 #include <ace/utils/bitmap.h>
 #include "gfx_util.h"
+#include "bin_reader.h"
+#include "slz.h"
+#include "load_profile.h"
 #include <ace/utils/disk_file.h>
 #include <string.h>
 
-static UWORD readU16Be(tFile *pFile)
-{
-	UBYTE b[2];
-	fileRead(pFile, b, 2);
-	return ((UWORD)b[0] << 8) | (UWORD)b[1];
-}
-
-static WORD readI16Be(tFile *pFile)
-{
-	return (WORD)readU16Be(pFile);
-}
-
 static void writeU16Be(tFile *pFile, UWORD v)
 {
 	UBYTE b[2];
@@ -26,90 +18,91 @@ static void writeU16Be(tFile *pFile, UWORD v)
 	fileWrite(pFile, b, 2);
 }
 
-tWallset *wallsetLoad(const char *fileName)
+// ACE bitmap file header: the version this loader reads and the interleaved flag
+#define WALLSET_BITMAP_VERSION 0
+#define WALLSET_BITMAP_INTERLEAVED 1
+
+static tBitMap *wallsetBitmapLoad(const char *path);
+
+// Parses the .wll header; bitmaps are attached by the caller
+static tWallset *wallsetLoadFrom(tBinReader *reader)
 {
-	tFile *pFile = diskFileOpen(fileName, DISK_FILE_MODE_READ, 1);
-	if (pFile)
-	{
-		systemUse();
-		UWORD totalTilesetCount = 0;
-		UBYTE paletteSize = 0;
-		UBYTE *palette = 0;
-		tWallGfx **tileset = 0;
-		UBYTE header[3];
-		fileRead(pFile, header, 3);
-
-		fileRead(pFile, &paletteSize, 1);
-		palette = (UBYTE *)memAllocFastClear(paletteSize * 3);
-		fileRead(pFile, palette, paletteSize * 3);
-
-		totalTilesetCount = readU16Be(pFile);
-		UBYTE tilesetCount = 0;
-		fileRead(pFile, &tilesetCount, 1);
-
-		tWallGfx *tilesetData = (tWallGfx *)memAllocFastClear(sizeof(tWallGfx) * totalTilesetCount);
-		tileset = (tWallGfx **)memAllocFastClear(sizeof(tWallGfx *) * totalTilesetCount);
-		UBYTE *tilesPerGroup = NULL;
-		if (tilesetCount > 0)
-			tilesPerGroup = (UBYTE *)memAllocFastClear(tilesetCount);
-
-		for (int i = 0; i < totalTilesetCount; i++) {
-			tileset[i] = &tilesetData[i];
-		}
+	UBYTE header[3];
+	binRead(reader, header, 3);
+
+	UBYTE paletteSize = binReadU8(reader);
+	UBYTE *palette = (UBYTE *)memAllocFastClear(paletteSize * 3);
+	binRead(reader, palette, paletteSize * 3);
 
-		int i = 0;
-		for (int ts = 0; ts < tilesetCount; ts++)
+	UWORD totalTilesetCount = binReadU16Be(reader);
+	UBYTE tilesetCount = binReadU8(reader);
+
+	tWallGfx *tilesetData = (tWallGfx *)memAllocFastClear(sizeof(tWallGfx) * totalTilesetCount);
+	tWallGfx **tileset = (tWallGfx **)memAllocFastClear(sizeof(tWallGfx *) * totalTilesetCount);
+	UBYTE *tilesPerGroup = NULL;
+	if (tilesetCount > 0)
+		tilesPerGroup = (UBYTE *)memAllocFastClear(tilesetCount);
+
+	for (int i = 0; i < totalTilesetCount; i++) {
+		tileset[i] = &tilesetData[i];
+	}
+
+	int i = 0;
+	for (int ts = 0; ts < tilesetCount; ts++)
+	{
+		UBYTE wallsetCount = binReadU8(reader);
+		if (tilesPerGroup)
+			tilesPerGroup[ts] = wallsetCount;
+		for (int ws = 0; ws < wallsetCount && i < totalTilesetCount; ws++)
 		{
-			UBYTE wallsetCount = 0;
-			fileRead(pFile, &wallsetCount, 1);
-			if (tilesPerGroup)
-				tilesPerGroup[ts] = wallsetCount;
-			for (int ws = 0; ws < wallsetCount; ws++)
-			{
-				BYTE location[2] = {0};
-				WORD screen[2] = {0};
-				UWORD width = 0;
-				UWORD height = 0;
-				UWORD x = 0;
-				UWORD y = 0;
-				UBYTE type = 0;
-				UBYTE setIndex = 0;
-
-				fileRead(pFile, &type, 1);
-				fileRead(pFile, &setIndex, 1);
-				fileRead(pFile, location, 2);
-				screen[0] = readI16Be(pFile);
-				screen[1] = readI16Be(pFile);
-				x = readU16Be(pFile);
-				y = readU16Be(pFile);
-				width = readU16Be(pFile);
-				height = readU16Be(pFile);
-
-				tileset[i]->_location[0] = location[0];
-				tileset[i]->_location[1] = location[1];
-				tileset[i]->_screen[0] = screen[0];
-				tileset[i]->_screen[1] = screen[1];
-				tileset[i]->_x = x;
-				tileset[i]->_y = y;
-				tileset[i]->_width = width;
-				tileset[i]->_height = height;
-				tileset[i]->_type = type;
-				tileset[i]->_setIndex = setIndex;
-
-				i++;
-			}
+			BYTE location[2] = {0};
+			UBYTE type = binReadU8(reader);
+			UBYTE setIndex = binReadU8(reader);
+			binRead(reader, location, 2);
+
+			tileset[i]->_location[0] = location[0];
+			tileset[i]->_location[1] = location[1];
+			tileset[i]->_screen[0] = (WORD)binReadU16Be(reader);
+			tileset[i]->_screen[1] = (WORD)binReadU16Be(reader);
+			tileset[i]->_x = binReadU16Be(reader);
+			tileset[i]->_y = binReadU16Be(reader);
+			tileset[i]->_width = binReadU16Be(reader);
+			tileset[i]->_height = binReadU16Be(reader);
+			tileset[i]->_type = type;
+			tileset[i]->_setIndex = setIndex;
+
+			i++;
 		}
+	}
+
+	tWallset *pWallset = (tWallset *)memAllocFastClear(sizeof(tWallset));
+	pWallset->_paletteSize = paletteSize;
+	pWallset->_palette = palette;
+	pWallset->_tilesetCount = totalTilesetCount;
+	pWallset->_gfxCount = tilesetCount;
+	pWallset->_tileset = tileset;
+	pWallset->_gfx = (tBitMap**)memAllocFastClear(sizeof(tBitMap*)*tilesetCount);
+	pWallset->_mask = (tBitMap**)memAllocFastClear(sizeof(tBitMap*)*tilesetCount);
+	pWallset->_tilesPerGroup = tilesPerGroup;
+	memcpy(pWallset->_header, header, 3);
+	return pWallset;
+}
 
-		tWallset *pWallset = (tWallset *)memAllocFastClear(sizeof(tWallset));
-		pWallset->_paletteSize = paletteSize;
-		pWallset->_palette = palette;
-		pWallset->_tilesetCount = totalTilesetCount;
-		pWallset->_gfxCount = tilesetCount;
-		pWallset->_tileset = tileset;
-		pWallset->_gfx = (tBitMap**)memAllocFastClear(sizeof(tBitMap*)*tilesetCount);
-		pWallset->_mask = (tBitMap**)memAllocFastClear(sizeof(tBitMap*)*tilesetCount);
-		pWallset->_tilesPerGroup = tilesPerGroup;
-		memcpy(pWallset->_header, header, 3);
+tWallset *wallsetLoad(const char *fileName)
+{
+	LOAD_PROFILE_PUSH(loadMark, "wallsetLoad", fileName);
+	tBinReader reader;
+	LOAD_PROFILE_PUSH(openMark, "open", NULL);
+	UBYTE isOpen = binReaderOpen(&reader, fileName);
+	LOAD_PROFILE_POP(openMark);
+	if (isOpen)
+	{
+		systemUse();
+		LOAD_PROFILE_PUSH(headerMark, "header", NULL);
+		tWallset *pWallset = wallsetLoadFrom(&reader);
+		binReaderClose(&reader);
+		LOAD_PROFILE_POP(headerMark);
+		UBYTE tilesetCount = (UBYTE)pWallset->_gfxCount;
 
 		const char* lastDot = fileName;
 		for(const char* p = fileName; *p; p++) {
@@ -148,16 +141,140 @@ tWallset *wallsetLoad(const char *fileName)
 			gfxPath[baseLen + 1 + numLen + 4] = '\0';
 			maskPath[baseLen + 1 + numLen + 4] = '\0';
 
-			pWallset->_gfx[ts] = bitmapCreateFromPath(gfxPath, 0);
-			pWallset->_mask[ts] = bitmapCreateFromPath(maskPath, 0);
+			pWallset->_gfx[ts] = wallsetBitmapLoad(gfxPath);
+			pWallset->_mask[ts] = wallsetBitmapLoad(maskPath);
 		}
 
 		systemUnuse();
+		LOAD_PROFILE_POP(loadMark);
 		return pWallset;
 	}
+	LOAD_PROFILE_POP(loadMark);
 	return 0;
 }
 
+// ACE bitmap file (.pln/.msk) to a chip RAM bitmap. Header: width, height, depth,
+// version, flags, pad; rows are byte-packed, planes one after another unless the
+// interleaved flag is set, in which case the bitmap is created interleaved too and
+// each row holds every plane's row in turn. With SLZ_BITMAP_FLAG each plane is an
+// SLZ1 stream that decodes straight into the bitmap.
+static tBitMap *wallsetBitmapRead(tBinReader *reader)
+{
+	UBYTE header[8];
+	if (binRead(reader, header, 8) != 8)
+		return NULL;
+	UWORD width = ((UWORD)header[0] << 8) | header[1];
+	UWORD height = ((UWORD)header[2] << 8) | header[3];
+	UBYTE depth = header[4];
+	UBYTE version = header[5];
+	UBYTE flags = header[6];
+	UBYTE isInterleaved = flags & WALLSET_BITMAP_INTERLEAVED;
+	UBYTE isPacked = (flags & SLZ_BITMAP_FLAG) != 0;
+	if (depth == 0 || depth > 8)
+		return NULL;
+	if (version != WALLSET_BITMAP_VERSION) {
+		logWrite("ERR: bitmap version %u not supported\n", (unsigned)version);
+		return NULL;
+	}
+	if (isPacked && isInterleaved) {
+		// Packed planes need the planar layout; the encoder never writes these
+		logWrite("ERR: packed interleaved bitmap not supported\n");
+		return NULL;
+	}
+	LOAD_PROFILE_PUSH(allocMark, "alloc", NULL);
+	tBitMap *pBitMap = bitmapCreate(width, height, depth, isInterleaved ? BMF_INTERLEAVED : 0);
+	LOAD_PROFILE_POP(allocMark);
+	if (!pBitMap)
+		return NULL;
+	UWORD fileBpr = (width + 7) / 8;
+	UBYTE ok = 1;
+	LOAD_PROFILE_PUSH(pixelMark, isPacked ? "decode" : "read", NULL);
+	if (fileBpr == bitmapGetByteWidth(pBitMap)) {
+		// Layout matches the file: one read for an interleaved bitmap, one read or decode per plane otherwise
+		ULONG planeSize = (ULONG)fileBpr * height;
+		if (isInterleaved) {
+			binRead(reader, pBitMap->Planes[0], planeSize * depth);
+		}
+		else {
+			for (UBYTE p = 0; p < depth && ok; p++) {
+				if (isPacked)
+					ok = slzDecodeStream(reader, binReadU32Be(reader), pBitMap->Planes[p], planeSize);
+				else
+					binRead(reader, pBitMap->Planes[p], planeSize);
+			}
+		}
+	}
+	else if (!isPacked) {
+		// Word-aligned bitmap rows: row by row, rows outer when interleaved, planes outer otherwise
+		UWORD outer = isInterleaved ? height : depth;
+		UWORD inner = isInterleaved ? depth : height;
+		for (UWORD o = 0; o < outer; o++) {
+			for (UWORD i = 0; i < inner; i++) {
+				UBYTE plane = (UBYTE)(isInterleaved ? i : o);
+				UWORD row = isInterleaved ? o : i;
+				binRead(reader, pBitMap->Planes[plane] + (ULONG)row * pBitMap->BytesPerRow, fileBpr);
+			}
+		}
+	}
+	else {
+		// Packed planes need the file's row pitch; the encoder never writes these
+		ok = 0;
+	}
+	LOAD_PROFILE_POP(pixelMark);
+	if (!ok || reader->isOverrun) {
+		bitmapDestroy(pBitMap);
+		return NULL;
+	}
+	return pBitMap;
+}
+
+static tBitMap *wallsetBitmapLoad(const char *path)
+{
+	LOAD_PROFILE_PUSH(bitmapMark, "bitmap", path);
+	tBinReader reader;
+	tBitMap *pBitMap = NULL;
+	if (binReaderOpen(&reader, path)) {
+		pBitMap = wallsetBitmapRead(&reader);
+		binReaderClose(&reader);
+	}
+	LOAD_PROFILE_POP(bitmapMark);
+	return pBitMap;
+}
+
+static tBitMap *wallsetBitmapFromChunk(const UBYTE *data, ULONG size)
+{
+	if (!data)
+		return NULL;
+	LOAD_PROFILE_PUSH(bitmapMark, "bitmap", NULL);
+	tBinReader reader;
+	binReaderInitMemory(&reader, data, size);
+	tBitMap *pBitMap = wallsetBitmapRead(&reader);
+	LOAD_PROFILE_POP(bitmapMark);
+	return pBitMap;
+}
+
+tWallset *wallsetLoadFromPak(const tPak *pPak)
+{
+	ULONG size;
+	const UBYTE *data = pakFind(pPak, PAK_TAG_WALLSET, 0, &size);
+	if (!data)
+		return 0;
+	LOAD_PROFILE_PUSH(loadMark, "wallsetLoadFromPak", NULL);
+	systemUse();
+	tBinReader reader;
+	binReaderInitMemory(&reader, data, size);
+	tWallset *pWallset = wallsetLoadFrom(&reader);
+	for (UWORD ts = 0; ts < pWallset->_gfxCount; ts++) {
+		data = pakFind(pPak, PAK_TAG_PLANES, ts, &size);
+		pWallset->_gfx[ts] = wallsetBitmapFromChunk(data, size);
+		data = pakFind(pPak, PAK_TAG_MASK, ts, &size);
+		pWallset->_mask[ts] = wallsetBitmapFromChunk(data, size);
+	}
+	systemUnuse();
+	LOAD_PROFILE_POP(loadMark);
+	return pWallset;
+}
+
 void wallsetSave(tWallset *pWallset, const char *fileName)
 {
 	if (!pWallset || !fileName || !pWallset->_tilesPerGroup)
@@ -8,6 +8,7 @@
 #include "wallbutton.h"
 #include "doorbutton.h"
 #include "wall_interactable_placeholder.h"
+#include "asset_cache.h"
 
 #include <ace/managers/blit.h>
 #include <string.h>
@@ -600,8 +601,9 @@ void drawView(tGameState *pGameState, tBitMap *pCurrentBuffer)
         UBYTE cx = slotCx[i];
         UBYTE cy = slotCy[i];
 
+        // The per-cell count answers "nobody here" without walking the list
         tMonsterList *ml = pGameState->m_pMonsterList;
-        if (ml)
+        if (ml && monsterCountAt(pMaze, cx, cy))
         {
             for (UBYTE mi = 0; mi < ml->_numMonsters; mi++)
             {
@@ -629,6 +631,8 @@ void drawFullScreenMap(tGameState *pGameState, tBitMap *pCurrentBuffer)
 
     if (g_pMazeBitmap == NULL)
     {
+        // Chip that grows with the level: make room among idle assets first
+        assetCacheTrimChip(ASSET_CACHE_CHIP_RESERVE + (ULONG)(pMaze->_width * 5 + 15) / 16 * 2 * pMaze->_height * 5 * 3);
         g_pMazeBitmap = bitmapCreate(pMaze->_width * 5, pMaze->_height * 5, 3, BMF_CLEAR);
         for (int y = 0; y < pMaze->_height; y++)
         {
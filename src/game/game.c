@@ -8,6 +8,7 @@
 #include <ace/utils/palette.h>
 #include <ace/utils/extview.h>
 #include <ace/managers/bob.h>
+#include <ace/managers/timer.h>
 
 #include "GameState.h"
 #include "ground_item.h"
@@ -24,6 +25,10 @@
 #include "pressure_plate.h"
 #include "wallset.h"
 #include "game_manifest.h"
+#include "level_prefetch.h"
+#include "asset_cache.h"
+#include "snapshot.h"
+#include "input.h"
 
 #include "game_ui.h"
 #include "game_ui_regions.h"
@@ -31,19 +36,8 @@
 #include "item.h"
 #include "text_render.h"
 #include <string.h>
-ULONG seed = 1;
 #define SOFFX 5
 UBYTE s_lastMoveResult = 0;
-ULONG rand()
-{
-    seed = (seed * 1103515245 + 12345) & 0x7fffffff;
-    return seed;
-}
-
-void srand(ULONG new_seed)
-{
-    seed = new_seed;
-}
 
 tScreen *pScreen = NULL;
 tWallset *pWallset = NULL;
@@ -69,6 +63,8 @@ static UBYTE s_ubTextRendererInitialized = 0;
 
 // Battery hover display and message system
 static UBYTE s_ubBatteryHovered = 0;
+// Quick-save slot (F6 save, F7 load); allocated with the game state so saving never allocates
+static tSnapshot s_sQuickSave;
 static UBYTE s_ubLastBatteryLevel = 255;  // Track last battery level to update text when it changes
 
 // Message types
@@ -113,11 +109,12 @@ static void clearViewportMessage(void) {
 
 /**
  * @brief Add a message to the message queue (keeps last 2 messages)
- * @param szMessage Message text
+ * @param pText Message text (need not be NUL-terminated)
+ * @param uwLength Length of pText
  * @param eType Message type (MESSAGE_TYPE_SMALL or MESSAGE_TYPE_VIEWPORT)
  * @param ubColor Color for viewport messages (ignored for small messages)
  */
-static void addMessage(const char *szMessage, eMessageType eType, UBYTE ubColor) {
+static void addMessageText(const char *pText, UWORD uwLength, eMessageType eType, UBYTE ubColor) {
     // For small messages, color is ignored (determined at draw time)
     if (!s_ubTextRendererInitialized || !s_pTextRenderer) return;
     
@@ -136,8 +133,10 @@ static void addMessage(const char *szMessage, eMessageType eType, UBYTE ubColor)
             s_pViewportMultiColorText = NULL;
         }
         
-        strncpy(s_szViewportMessage, szMessage, 511);
-        s_szViewportMessage[511] = '\0';
+        if (uwLength > 511)
+            uwLength = 511;
+        memcpy(s_szViewportMessage, pText, uwLength);
+        s_szViewportMessage[uwLength] = '\0';
         
         // Create multi-color text (handles both single-color and multi-color)
         // Max width 220px for wrapping
@@ -183,14 +182,16 @@ static void addMessage(const char *szMessage, eMessageType eType, UBYTE ubColor)
     }
     
     // Add new message
-    strncpy(s_szMessages[s_ubMessageCount], szMessage, 127);
-    s_szMessages[s_ubMessageCount][127] = '\0';
+    if (uwLength > 127)
+        uwLength = 127;
+    memcpy(s_szMessages[s_ubMessageCount], pText, uwLength);
+    s_szMessages[s_ubMessageCount][uwLength] = '\0';
     s_eMessageTypes[s_ubMessageCount] = eType;
     
     // Check if message has color markup
     UBYTE ubHasColorMarkup = 0;
-    UWORD uwMsgLen = strlen(szMessage);
-    for (UWORD i = 0; i < uwMsgLen - 3; i++) {
+    const char *szMessage = s_szMessages[s_ubMessageCount];
+    for (UWORD i = 0; i + 3 < uwLength; i++) {
         if (szMessage[i] == '{' && szMessage[i+1] == 'c' && szMessage[i+2] == ':') {
             ubHasColorMarkup = 1;
             break;
@@ -213,12 +214,22 @@ static void addMessage(const char *szMessage, eMessageType eType, UBYTE ubColor)
     s_ubMessageCount++;
 }
 
+static void addMessage(const char *szMessage, eMessageType eType, UBYTE ubColor) {
+    addMessageText(szMessage, (UWORD)strlen(szMessage), eType, ubColor);
+}
+
 void gameDisplayMessage(const char* szMessage)
 {
     if (szMessage)
         addMessage(szMessage, MESSAGE_TYPE_SMALL, 1);
 }
 
+void gameDisplayText(const char* pText, UWORD uwLength)
+{
+    if (pText)
+        addMessageText(pText, uwLength, MESSAGE_TYPE_SMALL, 1);
+}
+
 void handleEquipmentClicked(WORD slotID)
 {
     if (slotID >= 0 && slotID < 4 && g_pGameState && g_pGameState->m_pInventory) {
@@ -599,7 +610,7 @@ void cbGameOnPressed(Region *pRegion, UBYTE ubLeft, UBYTE ubRight)
         if (ubLeft)
         {
             tViewportPick pick;
-            viewportPickAtScreen(g_pGameState, mouseGetX(MOUSE_PORT_1), mouseGetY(MOUSE_PORT_1), &pick);
+            viewportPickAtScreen(g_pGameState, inputMouseX(), inputMouseY(), &pick);
             if (pick.kind == VIEWPORT_PICK_DOOR_AHEAD)
                 handleDoorClick(pick.cellX, pick.cellY);
             else if (pick.kind == VIEWPORT_PICK_WALL_BUTTON || pick.kind == VIEWPORT_PICK_DOOR_BUTTON)
@@ -647,7 +658,7 @@ static void gameReloadPalette(void)
         const char *plt = gameManifestGet()->uiPalettePath;
         if (!plt || !plt[0])
             plt = "data/playfield.plt";
-        paletteLoadFromPath(plt, pScr->_pFade->pPaletteRef, 32);
+        assetPaletteLoad(plt, pScr->_pFade->pPaletteRef, 32);
     }
 
 #ifdef ACE_USE_AGA_FEATURES
@@ -677,6 +688,43 @@ static void fadeCompleteReloadPalette(void)
     ScreenFadeFromBlack(NULL, 7, 0);
 }
 
+// The quick-save slot grows with the level, sized as it loads so F6 rarely allocates
+static void gameQuickSaveReserve(void)
+{
+    if (!snapshotReserve(&s_sQuickSave, snapshotSizeOf(g_pGameState) + SNAPSHOT_HEADROOM))
+        logWrite("game: no memory for the quick-save slot\n");
+}
+
+// EVENT_CHANGE_LEVEL, behind a fade; a level that fails to load falls back to the one left
+static void fadeCompleteChangeLevel(void)
+{
+    tLevelRequest sRequest = g_sLevelRequest;
+    UBYTE ubFrom = g_pGameState->m_ubCurrentLevel;
+    g_sLevelRequest.isPending = 0;
+    systemUse();
+    UBYTE ubEntered = LoadLevel((BYTE)sRequest.ubLevel);
+    if (!ubEntered) {
+        logWrite("Level %u failed to load, returning to %u\n", (unsigned)sRequest.ubLevel, (unsigned)ubFrom);
+        if (!LoadLevel((BYTE)ubFrom)) {
+            systemUnuse();
+            fadeCompleteNoBat();
+            return;
+        }
+    }
+    gameQuickSaveReserve();
+    systemUnuse();
+    pWallset = g_pGameState->m_pCurrentWallset;
+    if (ubEntered) {
+        g_pGameState->m_pCurrentParty->_PartyX = sRequest.ubX;
+        g_pGameState->m_pCurrentParty->_PartyY = sRequest.ubY;
+        g_pGameState->m_pCurrentParty->_PartyFacing = sRequest.ubFacing;
+    }
+    drawView(g_pGameState, pScreen->_pBfr->pBack);
+    drawView(g_pGameState, pScreen->_pBfr->pFront);
+    gameReloadPalette();
+    ScreenFadeFromBlack(NULL, 7, fadeInComplete);
+}
+
 static void gameGsCreate(void)
 {
     systemUse();
@@ -685,6 +733,11 @@ static void gameGsCreate(void)
         pScreen = ScreenGetActive();
         pWallset = g_pGameState->m_pCurrentWallset;
     } else {
+#ifdef GAME_DEBUG
+        // Before anything draws a random number: replay a waiting session, else record this one
+        if (!inputReplayStart(INPUT_REPLAY_PATH))
+            inputRecordStart();
+#endif
         if (!InitNewGame()) {
             systemUnuse();
             return;
@@ -708,7 +761,7 @@ static void gameGsCreate(void)
         const char *plt = gameManifestGet()->uiPalettePath;
         if (!plt || !plt[0])
             plt = "data/playfield.plt";
-        paletteLoadFromPath(plt, pScreen->_pFade->pPaletteRef, 32);
+        assetPaletteLoad(plt, pScreen->_pFade->pPaletteRef, 32);
     }
 
     // Load wallset palette into colors 32-63 to avoid conflict with UI colors (0-31)
@@ -791,13 +844,15 @@ static void gameGsCreate(void)
     spriteSetOddColourPaletteBank(4);   // Channel 1 uses colors 64-79
 #endif
     
+    gameQuickSaveReserve();
+
     pMod = ptplayerModCreateFromPath("data/suspense.mod");
     ptplayerLoadMod(pMod, NULL, 0);
     ptplayerSetMasterVolume(64);
     ptplayerEnableMusic(1);
     
     // Initialize text renderer (if font file exists)
-    s_pTestFont = fontCreateFromPath("data/font.fnt");
+    s_pTestFont = assetFontGet("data/font.fnt");
     if (s_pTestFont) {
         s_pTextRenderer = textRendererCreate(s_pTestFont);
         if (s_pTextRenderer) {
@@ -805,11 +860,11 @@ static void gameGsCreate(void)
         }
     }
     
-    tBitMap *pPlayfield = bitmapCreateFromPath("data/playfield.bm", 0);
+    tBitMap *pPlayfield = assetBitmapGet("data/playfield.bm", 0);
     blitCopyAligned(pPlayfield, 0, 0, pScreen->_pBfr->pBack, 0, 0, 320, 256);
     // ScreenUpdate();
     blitCopyAligned(pPlayfield, 0, 0, pScreen->_pBfr->pFront, 0, 0, 320, 256);
-    bitmapDestroy(pPlayfield);
+    assetBitmapRelease(pPlayfield);
     // do an initial render to both front and back.
     drawView(g_pGameState, pScreen->_pBfr->pBack);
     drawView(g_pGameState, pScreen->_pBfr->pFront);
@@ -836,10 +891,40 @@ static void gameGsLoop(void)
             stateChange(g_pStateMachineGame, &g_sStateWin);
             return;
         }
-        if (keyUse(KEY_F9)) {
+        if (g_sLevelRequest.isPending) {
+            g_ubGameActive = 0;
+            ScreenFadeToBlack(NULL, 7, fadeCompleteChangeLevel);
+            return;
+        }
+        if (inputKeyUse(KEY_F9)) {
             statePush(g_pStateMachineGame, &g_sStatePaused);
             return;
         }
+        if (inputKeyUse(KEY_F6)) {
+            // Past the headroom (a long journal) the slot grows here
+            if (snapshotReserve(&s_sQuickSave, snapshotSizeOf(g_pGameState)) && snapshotTake(&s_sQuickSave, g_pGameState))
+                addMessage("Quick-saved.", MESSAGE_TYPE_SMALL, 1);
+            else
+                addMessage("Quick-save failed.", MESSAGE_TYPE_SMALL, 1);
+        }
+        if (inputKeyUse(KEY_F7)) {
+            // Same level: a few copies. Another level is reloaded first, which needs the OS
+            UBYTE ubLevel = g_pGameState->m_ubCurrentLevel;
+            systemUse();
+            UBYTE ubRestored = snapshotRestore(&s_sQuickSave, g_pGameState);
+            systemUnuse();
+            if (ubRestored) {
+                pWallset = g_pGameState->m_pCurrentWallset;
+                if (g_pGameState->m_ubCurrentLevel != ubLevel) {
+                    gameReloadPalette();
+                    gameQuickSaveReserve();
+                }
+                g_ubRedrawRequire = 2;
+                addMessage("Quick-loaded.", MESSAGE_TYPE_SMALL, 1);
+            }
+            else
+                addMessage("No quick-save to load.", MESSAGE_TYPE_SMALL, 1);
+        }
         gameUIUpdate();
 
         if (g_pGameState->m_pCurrentParty->_BatteryLevel <= 0)
@@ -857,44 +942,52 @@ static void gameGsLoop(void)
             g_ubRedrawRequire = 2;
         }
         
+        // Resume scripts suspended by EVENT_WAIT or the per-frame opcode budget
+        if (scriptUpdate(g_pGameState->m_pCurrentMaze)) {
+            g_ubRedrawRequire = 2;
+        }
+        
         // Update battery chargers (slowly recharge over time)
         updateBatteryChargers(g_pGameState->m_pCurrentMaze);
         
         // Check if standing on event triggers (e.g., battery chargers)
         updateStandingOnEventTrigger();
 
-        // Update monsters
-        for (UBYTE i = 0; i < g_pGameState->m_pMonsterList->_numMonsters; i++) {
-            tMonster* monster = g_pGameState->m_pMonsterList->_monsters[i];
-            if (monster && monster->_state != MONSTER_STATE_DEAD) {
-                // Update monster state
-                monsterUpdate(monster, g_pGameState->m_pCurrentMaze, g_pGameState->m_pCurrentParty,
-                    g_pGameState->m_pMonsterList);
-
-                // Check for combat
-                if (monster->_state == MONSTER_STATE_AGGRESSIVE) {
-                    // If monster is in same cell as party, initiate combat
-                    if (monster->_partyPosX == g_pGameState->m_pCurrentParty->_PartyX &&
-                        monster->_partyPosY == g_pGameState->m_pCurrentParty->_PartyY) {
-                        if (g_pGameState->m_pCurrentParty->_numCharacters > 0) {
-                            tCharacter* hero = g_pGameState->m_pCurrentParty->_characters[0];
-                            monsterAttack(monster, hero);
-                            if (hero->_HP > 0 && monster->_state != MONSTER_STATE_DEAD)
-                                monsterTakeDamageFromCharacter(monster, hero);
-                            if (monster->_base._HP == 0) {
-                                monster->_state = MONSTER_STATE_DEAD;
-                                monsterDropLoot(monster, g_pGameState->m_pInventory);
-                                for (UBYTE j = 0; j < g_pGameState->m_pCurrentParty->_numCharacters; j++) {
-                                    if (g_pGameState->m_pCurrentParty->_characters[j])
-                                        g_pGameState->m_pCurrentParty->_characters[j]->_Experience += monster->_experienceValue;
-                                }
-                            }
-                        }
-                    }
+        // Update monsters: those near the party, then a round-robin slice of the rest
+        UBYTE pUpdated[MAX_MONSTERS];
+        UBYTE ubUpdated = monsterListUpdate(g_pGameState->m_pMonsterList, g_pGameState->m_pCurrentMaze,
+            g_pGameState->m_pCurrentParty, pUpdated);
+#ifdef GAME_DEBUG
+        const tMonsterAiStats *pAiStats = monsterAiStatsGet();
+        if (pAiStats->ulFrames >= 256) {
+            char szAvg[32], szWorst[32];
+            timerFormatPrec(szAvg, pAiStats->ulPrecTotal / pAiStats->ulFrames);
+            timerFormatPrec(szWorst, pAiStats->ulPrecWorst);
+            logWrite("Monster AI: %s/frame (worst %s), %lu updates, %lu parked, %lu frozen per 256 frames\n",
+                szAvg, szWorst, pAiStats->ulUpdates, pAiStats->ulParked, pAiStats->ulFrozen);
+            monsterAiStatsReset();
+        }
+#endif
+        // Combat needs a monster on the party's cell; the count rules it out for the whole slice at once
+        UBYTE ubAtParty = monsterCountAt(g_pGameState->m_pCurrentMaze, g_pGameState->m_pCurrentParty->_PartyX,
+            g_pGameState->m_pCurrentParty->_PartyY);
+        for (UBYTE u = 0; ubAtParty && u < ubUpdated; u++) {
+            UBYTE ubIndex = pUpdated[u];
+            if (monsterCombatRound(g_pGameState->m_pMonsterList->_monsters[ubIndex], g_pGameState->m_pCurrentMaze,
+                    g_pGameState->m_pCurrentParty, g_pGameState->m_pInventory) == MONSTER_COMBAT_KILL) {
+                // Back to the pool for the next spawn; later monsters in the slice move down a slot
+                monsterListRemove(g_pGameState->m_pMonsterList, g_pGameState->m_pCurrentMaze, ubIndex);
+                for (UBYTE v = (UBYTE)(u + 1); v < ubUpdated; v++) {
+                    if (pUpdated[v] > ubIndex)
+                        pUpdated[v]--;
                 }
             }
         }
 
+        // Nothing to draw this frame: spend it reading a slice of the likely next level
+        if (!g_ubRedrawRequire)
+            levelPrefetchUpdate();
+
         if (g_ubRedrawRequire)
         {
             if (g_pGameState->m_bMapVisible)
@@ -1121,14 +1214,12 @@ static void gameGsLoop(void)
             }
         }
         
-        // Process mouse multiple times per frame for better responsiveness
-        mouseProcess();
-      //  mouseProcess();
+        // Input is sampled once a frame (inputProcess()), so a replay sees what the recording did
         
         // Check if a movement button is still pressed (repeat-while-held, like EOB/DM)
-        if (s_ubPressedMovementButton != 0 && mouseCheck(MOUSE_PORT_1, MOUSE_LMB)) {
-            UWORD uwMouseX = mouseGetX(MOUSE_PORT_1);
-            UWORD uwMouseY = mouseGetY(MOUSE_PORT_1);
+        if (s_ubPressedMovementButton != 0 && inputMouseCheck(MOUSE_LMB)) {
+            UWORD uwMouseX = inputMouseX();
+            UWORD uwMouseY = inputMouseY();
             UBYTE ubOverButton = 0;
             
             // Check if mouse is still over the pressed button (using known button coordinates)
@@ -1170,9 +1261,9 @@ static void gameGsLoop(void)
         }
         
         // Check if a turn button is still pressed (repeat-while-held)
-        if (s_ubPressedTurnButton != 0 && mouseCheck(MOUSE_PORT_1, MOUSE_LMB)) {
-            UWORD uwMouseX = mouseGetX(MOUSE_PORT_1);
-            UWORD uwMouseY = mouseGetY(MOUSE_PORT_1);
+        if (s_ubPressedTurnButton != 0 && inputMouseCheck(MOUSE_LMB)) {
+            UWORD uwMouseX = inputMouseX();
+            UWORD uwMouseY = inputMouseY();
             UBYTE ubOverButton = 0;
             
             // Check if mouse is still over the pressed button
@@ -1201,17 +1292,17 @@ static void gameGsLoop(void)
             }
         }
         
-        if (keyCheck(KEY_ESCAPE))
+        if (inputKeyCheck(KEY_ESCAPE))
             gameExit();
  // F - Log memory usage
  
- if (keyCheck(KEY_F)) {
+ if (inputKeyCheck(KEY_F)) {
          logWrite("[MEM] Chip free: %lu, Fast free: %lu, Any free: %lu\n",
              memGetFreeChipSize(), memGetFastSize(), memGetFreeSize());
          }
         // P - Fade out, reload palette, fade in
         static UBYTE s_ubPPressed = 0;
-        if (keyCheck(KEY_P)) {
+        if (inputKeyCheck(KEY_P)) {
             if (!s_ubPPressed) {
                 tScreen *pScr = ScreenGetActive();
                 if (pScr && pScr->_pFade->eState == FADE_STATE_IDLE) {
@@ -1223,28 +1314,28 @@ static void gameGsLoop(void)
             s_ubPPressed = 0;
         }
 
-        if (keyCheck(KEY_W) || keyCheck(KEY_UP))
+        if (inputKeyCheck(KEY_W) || inputKeyCheck(KEY_UP))
         {
             MoveForwards();
         }
-        if (keyCheck(KEY_S) || keyCheck(KEY_DOWN))
+        if (inputKeyCheck(KEY_S) || inputKeyCheck(KEY_DOWN))
         {
             MoveBackwards();
         }
-        if (keyCheck(KEY_A) || keyCheck(KEY_LEFT))
+        if (inputKeyCheck(KEY_A) || inputKeyCheck(KEY_LEFT))
         {
             MoveLeft();
         }
-        if (keyCheck(KEY_D) || keyCheck(KEY_RIGHT))
+        if (inputKeyCheck(KEY_D) || inputKeyCheck(KEY_RIGHT))
         {
             MoveRight();
         }
 
-        if (keyCheck(KEY_Q) || keyCheck(KEY_HELP))
+        if (inputKeyCheck(KEY_Q) || inputKeyCheck(KEY_HELP))
         {
             TurnLeft();
         }
-        if (keyCheck(KEY_E) || keyCheck(KEY_DEL))
+        if (inputKeyCheck(KEY_E) || inputKeyCheck(KEY_DEL))
         {
             TurnRight();
         }
@@ -1254,7 +1345,7 @@ static void gameGsLoop(void)
         static UBYTE s_ubF2Pressed = 0;
         
         // F1 - Test small message (appears in bottom text field)
-        if (keyCheck(KEY_F1)) {
+        if (inputKeyCheck(KEY_F1)) {
             if (!s_ubF1Pressed) {
                 s_ubF1Pressed = 1;
                 if (s_ubTextRendererInitialized) {
@@ -1266,7 +1357,7 @@ static void gameGsLoop(void)
         }
         
         // F2 - Test viewport message (appears in center of 3D viewport)
-        if (keyCheck(KEY_F2)) {
+        if (inputKeyCheck(KEY_F2)) {
             if (!s_ubF2Pressed) {
                 s_ubF2Pressed = 1;
                 if (s_ubTextRendererInitialized) {
@@ -1279,7 +1370,7 @@ static void gameGsLoop(void)
         
         // F3 - Test multi-color viewport message
         static UBYTE s_ubF3Pressed = 0;
-        if (keyCheck(KEY_F3)) {
+        if (inputKeyCheck(KEY_F3)) {
             if (!s_ubF3Pressed) {
                 s_ubF3Pressed = 1;
                 if (s_ubTextRendererInitialized) {
@@ -1293,7 +1384,7 @@ static void gameGsLoop(void)
         
         // F4 - Test rainbow message (all 32 colors)
         static UBYTE s_ubF4Pressed = 0;
-        if (keyCheck(KEY_F4)) {
+        if (inputKeyCheck(KEY_F4)) {
             if (!s_ubF4Pressed) {
                 s_ubF4Pressed = 1;
                 if (s_ubTextRendererInitialized) {
@@ -1312,7 +1403,7 @@ static void gameGsLoop(void)
         
         // F5 - Test multi-color damage message
         static UBYTE s_ubF5Pressed = 0;
-        if (keyCheck(KEY_F5)) {
+        if (inputKeyCheck(KEY_F5)) {
             if (!s_ubF5Pressed) {
                 s_ubF5Pressed = 1;
                 if (s_ubTextRendererInitialized) {
@@ -1358,12 +1449,16 @@ static void gameGsDestroy(void)
         s_pTextRenderer = NULL;
     }
     if (s_pTestFont) {
-        fontDestroy(s_pTestFont);
+        assetFontRelease(s_pTestFont);
         s_pTestFont = NULL;
     }
     s_ubTextRendererInitialized = 0;
     
     gameUIDestroy();
+    snapshotDestroy(&s_sQuickSave);
+#ifdef GAME_DEBUG
+    inputRecordStop(INPUT_RECORD_PATH);
+#endif
     FreeGameState();
     systemUnuse();
 }
@@ -12,6 +12,7 @@
 #include <ace/managers/mouse.h>
 #include "screen.h"
 #include "mouse_pointer.h"
+#include "asset_cache.h"
 
 static tScreen *g_pMainScreen;
 
@@ -23,8 +24,8 @@ static void gameOverGsCreate(void)
 
 	g_pMainScreen = ScreenGetActive();
 	// UWORD pPaletteRef[256];
-	paletteLoadFromPath("data/NoBattery.plt", g_pMainScreen->_pFade->pPaletteRef, 255);
-	tBitMap *pLogo = bitmapCreateFromPath("data/NoBattery.bm", 0);
+	assetPaletteLoad("data/NoBattery.plt", g_pMainScreen->_pFade->pPaletteRef, 255);
+	tBitMap *pLogo = assetBitmapGet("data/NoBattery.bm", 0);
 	blitCopy(
 		pLogo, 0, 0, g_pMainScreen->_pBfr->pBack,
 		0, 0,
@@ -35,7 +36,7 @@ static void gameOverGsCreate(void)
 		0, 0,
 		320, 256, MINTERM_COOKIE);
 
-	bitmapDestroy(pLogo);
+	assetBitmapRelease(pLogo);
 
 	ScreenFadeFromBlack(NULL, 7, 0);
 
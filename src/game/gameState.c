@@ -13,38 +13,48 @@
 #include "game_manifest.h"
 #include "level_entities.h"
 #include "monster.h"
+#include "pak.h"
+#include "bin_reader.h"
+#include "level_prefetch.h"
+#include "asset_cache.h"
+#include "load_profile.h"
+#include "save_journal.h"
+#include "party_field.h"
+#include "maze_zones.h"
 #include <ace/managers/memory.h>
 #include <ace/utils/file.h>
 #include <ace/utils/disk_file.h>
+#include <ace/managers/timer.h>
+#include <ace/managers/log.h>
 
 tGameState *g_pGameState = NULL;
 UBYTE g_ubGameStateLoadedFromFile = 0;
 UBYTE g_ubRequestWin = 0;
+tLevelRequest g_sLevelRequest;
 
-#define SAVE_VERSION 2
+// 3: level changes as a save_journal.c record list after the flags
+#define SAVE_VERSION 3
+// 2: local flags after the global ones
+#define SAVE_VERSION_LOCAL_FLAGS 2
 #define SAVE_VERSION_LEGACY 1
 
 UBYTE LoadGameState(const char* fileName)
 {
-    tFile* pFile = diskFileOpen(fileName, DISK_FILE_MODE_READ, 1);
-    if (!pFile) return 0;
-    UBYTE ver = 0;
-    fileRead(pFile, &ver, 1);
-    if (ver != SAVE_VERSION && ver != SAVE_VERSION_LEGACY) { fileClose(pFile); return 0; }
-    UBYTE levelId = 0;
-    UBYTE partyX = 0, partyY = 0, partyFacing = 0, battery = 0;
-    fileRead(pFile, &levelId, 1);
-    fileRead(pFile, &partyX, 1);
-    fileRead(pFile, &partyY, 1);
-    fileRead(pFile, &partyFacing, 1);
-    fileRead(pFile, &battery, 1);
-    UBYTE invCount = 0;
-    fileRead(pFile, &invCount, 1);
+    tBinReader reader;
+    if (!binReaderOpen(&reader, fileName)) return 0;
+    UBYTE ver = binReadU8(&reader);
+    if (ver < SAVE_VERSION_LEGACY || ver > SAVE_VERSION) { binReaderClose(&reader); return 0; }
+    UBYTE levelId = binReadU8(&reader);
+    UBYTE partyX = binReadU8(&reader);
+    UBYTE partyY = binReadU8(&reader);
+    UBYTE partyFacing = binReadU8(&reader);
+    UBYTE battery = binReadU8(&reader);
+    UBYTE invCount = binReadU8(&reader);
     if (invCount > INVENTORY_MAX_ITEMS) invCount = INVENTORY_MAX_ITEMS;
     g_pGameState = (tGameState*)memAllocFastClear(sizeof(tGameState));
     g_pGameState->m_pCurrentParty = characterPartyCreate();
     if (!g_pGameState->m_pCurrentParty) {
-        fileClose(pFile);
+        binReaderClose(&reader);
         memFree(g_pGameState, sizeof(tGameState));
         g_pGameState = NULL;
         return 0;
@@ -62,22 +72,35 @@ UBYTE LoadGameState(const char* fileName)
     loadItems((char *)gameManifestGet()->itemsPath);
     monsterTableLoad((char *)gameManifestGet()->monstersPath);
     for (UBYTE i = 0; i < invCount; i++) {
-        UBYTE itemIdx = 0, qty = 0;
-        fileRead(pFile, &itemIdx, 1);
-        fileRead(pFile, &qty, 1);
+        UBYTE itemIdx = binReadU8(&reader);
+        UBYTE qty = binReadU8(&reader);
         inventoryAddItem(g_pGameState->m_pInventory, itemIdx, qty);
     }
-    fileRead(pFile, g_pGameState->m_bGlobalFlags, 256);
-    if (ver >= SAVE_VERSION)
-        fileRead(pFile, g_pGameState->m_bLocalFlags, 256);
-    fileClose(pFile);
+    binRead(&reader, g_pGameState->m_bGlobalFlags, 256);
+    if (ver >= SAVE_VERSION_LOCAL_FLAGS)
+        binRead(&reader, g_pGameState->m_bLocalFlags, 256);
+    UWORD journalCount = ver >= SAVE_VERSION ? binReadU16Be(&reader) : 0;
+    if (journalCount > SAVE_JOURNAL_MAX_RECORDS) journalCount = SAVE_JOURNAL_MAX_RECORDS;
+    ULONG journalSize = (ULONG)journalCount * SAVE_JOURNAL_RECORD_SIZE;
+    UBYTE* journal = journalSize ? (UBYTE*)memAllocFast(journalSize) : NULL;
+    if (journal)
+        binRead(&reader, journal, journalSize);
+    else if (journalSize)
+        logWrite("LoadGameState: no memory for %u journal records, level starts unchanged\n", (unsigned)journalCount);
+    binReaderClose(&reader);
 
     characterPartyEnsureDefaultHero(g_pGameState->m_pCurrentParty);
 
     if (!LoadLevel((BYTE)levelId)) {
+        if (journal) memFree(journal, journalSize);
         FreeGameState();
         return 0;
     }
+    // The level is as shipped; put back what the player changed in it
+    if (journal) {
+        saveJournalReplay(g_pGameState, journal, journalCount);
+        memFree(journal, journalSize);
+    }
     g_ubGameStateLoadedFromFile = 1;
     return 1;
 }
@@ -105,12 +128,16 @@ UBYTE SaveGameState(const char* fileName)
     }
     fileWrite(pFile, g_pGameState->m_bGlobalFlags, 256);
     fileWrite(pFile, g_pGameState->m_bLocalFlags, 256);
+    saveJournalWrite(pFile);
     fileClose(pFile);
     return 1;
 }
 void FreeGameState()
 {
     if (!g_pGameState) return;
+    levelPrefetchCancel();
+    saveJournalReset();
+    partyFieldReset();
     if (g_pGameState->m_pCurrentMaze)
     {
         mazeDelete(g_pGameState->m_pCurrentMaze);
@@ -118,7 +145,7 @@ void FreeGameState()
     }
     if (g_pGameState->m_pCurrentWallset)
     {
-        wallsetDestroy(g_pGameState->m_pCurrentWallset);
+        assetWallsetRelease(g_pGameState->m_pCurrentWallset);
         g_pGameState->m_pCurrentWallset = NULL;
     }
     if (g_pGameState->m_pCurrentParty)
@@ -126,6 +153,7 @@ void FreeGameState()
         characterPartyDestroy(g_pGameState->m_pCurrentParty);
         g_pGameState->m_pCurrentParty = NULL;
     }
+    encounterListClear(&g_pGameState->m_encounters);
     if (g_pGameState->m_pMonsterList)
     {
         monsterListDestroy(g_pGameState->m_pMonsterList);
@@ -163,19 +191,51 @@ UBYTE InitNewGame()
     doorButtonListCreate(&g_pGameState->m_doorButtons);
     doorLockListCreate(&g_pGameState->m_doorLocks);
     
+    LOAD_PROFILE_BEGIN("InitNewGame", NULL);
     gameManifestEnsureLoaded("data/game.smt");
     loadItems((char *)gameManifestGet()->itemsPath);
     monsterTableLoad((char *)gameManifestGet()->monstersPath);
+    LOAD_PROFILE_END();
 
     characterPartyEnsureDefaultHero(g_pGameState->m_pCurrentParty);
 
     return 1;
 }
 
-UBYTE LoadLevel(BYTE level)
+// Everything for one level out of a single .pak: one open, one read, no seeks
+static UBYTE loadLevelFromPak(UBYTE level, const char *pakPath)
+{
+    tPak pak;
+    if (!pakLoad(&pak, pakPath))
+        return 0;
+    ULONG size;
+    const UBYTE *chunk = pakFind(&pak, PAK_TAG_MAZE, 0, &size);
+    g_pGameState->m_pCurrentMaze = mazeLoadFromMemory(chunk, size);
+    if (!g_pGameState->m_pCurrentMaze) {
+        logWrite("LoadLevel: %s lacks a valid maze chunk\n", pakPath);
+        pakDestroy(&pak);
+        return 0;
+    }
+    g_pGameState->m_pCurrentWallset = assetWallsetGetFromPak(&pak, pakPath);
+    if (!g_pGameState->m_pCurrentWallset) {
+        logWrite("LoadLevel: %s lacks a wallset chunk\n", pakPath);
+        mazeDelete(g_pGameState->m_pCurrentMaze);
+        g_pGameState->m_pCurrentMaze = NULL;
+        pakDestroy(&pak);
+        return 0;
+    }
+    chunk = pakFind(&pak, PAK_TAG_ENTITIES, 0, &size);
+    if (chunk)
+        levelEntitiesLoadFromMemory(g_pGameState, chunk, size);
+    pakDestroy(&pak);
+    g_pGameState->m_ubCurrentLevel = level;
+    return 1;
+}
+
+static UBYTE loadLevelContent(BYTE level)
 {
-    if (!g_pGameState) return 0;
     const tGameManifest *man = gameManifestGet();
+    LOAD_PROFILE_PUSH(clearMark, "clear", NULL);
     groundItemListClear(&g_pGameState->m_groundItems);
     pressurePlateListClear(&g_pGameState->m_pressurePlates);
     wallButtonListDestroy(&g_pGameState->m_wallButtons);
@@ -184,18 +244,27 @@ UBYTE LoadLevel(BYTE level)
     wallButtonListCreate(&g_pGameState->m_wallButtons);
     doorButtonListCreate(&g_pGameState->m_doorButtons);
     doorLockListCreate(&g_pGameState->m_doorLocks);
+    scriptStopAll();
+    saveJournalReset();
+    partyFieldReset();
+    // Monsters are counted in the maze they were placed in; drop them with it
+    monsterListClear(g_pGameState->m_pMonsterList);
+    encounterListClear(&g_pGameState->m_encounters);
     if (g_pGameState->m_pCurrentMaze) {
         mazeDelete(g_pGameState->m_pCurrentMaze);
         g_pGameState->m_pCurrentMaze = NULL;
     }
     if (g_pGameState->m_pCurrentWallset) {
-        wallsetDestroy(g_pGameState->m_pCurrentWallset);
+        assetWallsetRelease(g_pGameState->m_pCurrentWallset);
         g_pGameState->m_pCurrentWallset = NULL;
     }
+    LOAD_PROFILE_POP(clearMark);
 
     UBYTE ul = (UBYTE)level;
     if (ul < man->levelCount) {
         const tGameLevelEntry *e = &man->levels[ul];
+        if (pakIsPath(e->mazePath))
+            return loadLevelFromPak(ul, e->mazePath);
         if (ul == 0 && e->mazePath[0] == '\0')
             g_pGameState->m_pCurrentMaze = mazeCreateDemoData();
         else
@@ -203,7 +272,7 @@ UBYTE LoadLevel(BYTE level)
         if (!g_pGameState->m_pCurrentMaze)
             return 0;
         const char *wsPath = e->wallsetPath[0] ? e->wallsetPath : "data/factory2/factory2.wll";
-        g_pGameState->m_pCurrentWallset = wallsetLoad(wsPath);
+        g_pGameState->m_pCurrentWallset = assetWallsetGet(wsPath);
         if (!g_pGameState->m_pCurrentWallset) {
             mazeDelete(g_pGameState->m_pCurrentMaze);
             g_pGameState->m_pCurrentMaze = NULL;
@@ -223,7 +292,7 @@ UBYTE LoadLevel(BYTE level)
         path[12] = '.'; path[13] = 'm'; path[14] = 'a'; path[15] = 'z'; path[16] = 'e'; path[17] = '\0';
         g_pGameState->m_pCurrentMaze = mazeLoad(path);
         if (g_pGameState->m_pCurrentMaze) {
-            g_pGameState->m_pCurrentWallset = wallsetLoad("data/factory2/factory2.wll");
+            g_pGameState->m_pCurrentWallset = assetWallsetGet("data/factory2/factory2.wll");
             if (!g_pGameState->m_pCurrentWallset) {
                 mazeDelete(g_pGameState->m_pCurrentMaze);
                 g_pGameState->m_pCurrentMaze = NULL;
@@ -235,6 +304,30 @@ UBYTE LoadLevel(BYTE level)
     }
 }
 
+UBYTE LoadLevel(BYTE level)
+{
+    if (!g_pGameState) return 0;
+    ULONG start = timerGetPrec();
+    LOAD_PROFILE_BEGIN("LoadLevel", (UBYTE)level < gameManifestGet()->levelCount
+        ? gameManifestGet()->levels[(UBYTE)level].mazePath : NULL);
+    // Free staging for other levels before this one's memory is needed
+    levelPrefetchRetain((UBYTE)level);
+    UBYTE ok = loadLevelContent(level);
+    if (ok) {
+        encounterAddMazeSpawns(&g_pGameState->m_encounters, g_pGameState->m_pCurrentMaze);
+        mazeZonesBuild(g_pGameState->m_pCurrentMaze);
+        saveJournalStart();
+        levelPrefetchPlan(g_pGameState->m_pCurrentMaze, (UBYTE)level);
+    }
+    else
+        levelPrefetchCancel();
+    LOAD_PROFILE_END();
+    char elapsed[32];
+    timerFormatPrec(elapsed, timerGetDelta(start, timerGetPrec()));
+    logWrite("LoadLevel(%d): %s in %s\n", (int)level, ok ? "loaded" : "failed", elapsed);
+    return ok;
+}
+
 UBYTE mazeMove(tMaze* pMaze, tCharacterParty* pParty, UBYTE direction)
 {
     UBYTE x = pParty->_PartyX;
@@ -12,6 +12,7 @@
 #include <ace/managers/mouse.h>
 #include "screen.h"
 #include "mouse_pointer.h"
+#include "asset_cache.h"
 
 static tScreen *g_pMainScreen;
 
@@ -23,9 +24,9 @@ static void winGsCreate(void)
 
 	g_pMainScreen = ScreenGetActive();
 	// UWORD pPaletteRef[256];
-	paletteLoadFromPath("data/Win.plt", g_pMainScreen->_pFade->pPaletteRef, 255);
+	assetPaletteLoad("data/Win.plt", g_pMainScreen->_pFade->pPaletteRef, 255);
 	
-	tBitMap *pLogo = bitmapCreateFromPath("data/Win_i.bm", 0);
+	tBitMap *pLogo = assetBitmapGet("data/Win_i.bm", 0);
 	
 	blitCopy(
 		pLogo, 0, 0, g_pMainScreen->_pBfr->pBack,
@@ -37,7 +38,7 @@ static void winGsCreate(void)
 		0, 0,
 		320, 256, MINTERM_COOKIE);
 
-	bitmapDestroy(pLogo);
+	assetBitmapRelease(pLogo);
 
 	ScreenFadeFromBlack(NULL, 7, 0);
 
@@ -1,6 +1,5 @@
 #include "game_manifest.h"
-#include <ace/utils/disk_file.h>
-#include <ace/utils/file.h>
+#include "bin_reader.h"
 #include <ace/managers/log.h>
 #include <string.h>
 
@@ -29,47 +28,46 @@ UBYTE gameManifestLoad(tGameManifest *p, const char *szPath)
 	if (!p)
 		return 0;
 	gameManifestSetDefaults(p);
-	tFile *f = diskFileOpen(szPath, DISK_FILE_MODE_READ, 1);
-	if (!f) {
+	tBinReader r;
+	if (!binReaderOpen(&r, szPath)) {
 		logWrite("gameManifest: '%s' not found, using defaults\n", szPath);
 		return 0;
 	}
 	char magic[4];
-	fileRead(f, magic, 4);
+	binRead(&r, magic, 4);
 	if (magic[0] != 'S' || magic[1] != 'M' || magic[2] != 'T' || magic[3] != 'E') {
-		fileClose(f);
+		binReaderClose(&r);
 		logWrite("gameManifest: bad magic\n");
 		return 0;
 	}
-	UBYTE ver = 0;
-	fileRead(f, &ver, 1);
+	UBYTE ver = binReadU8(&r);
 	if (ver != 1) {
-		fileClose(f);
+		binReaderClose(&r);
 		logWrite("gameManifest: unsupported version %u\n", (unsigned)ver);
 		return 0;
 	}
-	fileRead(f, &p->startLevel, 1);
-	fileRead(f, &p->levelCount, 1);
+	p->startLevel = binReadU8(&r);
+	p->levelCount = binReadU8(&r);
 	if (p->levelCount == 0 || p->levelCount > GAME_MANIFEST_MAX_LEVELS) {
-		fileClose(f);
+		binReaderClose(&r);
 		gameManifestSetDefaults(p);
 		return 0;
 	}
-	fileRead(f, p->itemsPath, GAME_MANIFEST_PATH_MAX);
+	binRead(&r, p->itemsPath, GAME_MANIFEST_PATH_MAX);
 	p->itemsPath[GAME_MANIFEST_PATH_MAX - 1] = '\0';
-	fileRead(f, p->monstersPath, GAME_MANIFEST_PATH_MAX);
+	binRead(&r, p->monstersPath, GAME_MANIFEST_PATH_MAX);
 	p->monstersPath[GAME_MANIFEST_PATH_MAX - 1] = '\0';
-	fileRead(f, p->uiPalettePath, GAME_MANIFEST_PATH_MAX);
+	binRead(&r, p->uiPalettePath, GAME_MANIFEST_PATH_MAX);
 	p->uiPalettePath[GAME_MANIFEST_PATH_MAX - 1] = '\0';
 	for (UBYTE i = 0; i < p->levelCount; i++) {
-		fileRead(f, p->levels[i].mazePath, GAME_MANIFEST_PATH_MAX);
+		binRead(&r, p->levels[i].mazePath, GAME_MANIFEST_PATH_MAX);
 		p->levels[i].mazePath[GAME_MANIFEST_PATH_MAX - 1] = '\0';
-		fileRead(f, p->levels[i].wallsetPath, GAME_MANIFEST_PATH_MAX);
+		binRead(&r, p->levels[i].wallsetPath, GAME_MANIFEST_PATH_MAX);
 		p->levels[i].wallsetPath[GAME_MANIFEST_PATH_MAX - 1] = '\0';
-		fileRead(f, p->levels[i].entitiesPath, GAME_MANIFEST_PATH_MAX);
+		binRead(&r, p->levels[i].entitiesPath, GAME_MANIFEST_PATH_MAX);
 		p->levels[i].entitiesPath[GAME_MANIFEST_PATH_MAX - 1] = '\0';
 	}
-	fileClose(f);
+	binReaderClose(&r);
 	p->formatVersion = ver;
 	logWrite("gameManifest: loaded %u levels from %s\n", (unsigned)p->levelCount, szPath);
 	return 1;
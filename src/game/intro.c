@@ -12,6 +12,7 @@
 #include <ace/managers/ptplayer.h>
 
 #include "screen.h"
+#include "asset_cache.h"
 //tState g_sStateLogo;
 //tState g_sStateIntro;
 
@@ -21,8 +22,8 @@ systemUse();
 	logBlockBegin("introGsCreate()");
 	tScreen* pScreen = ScreenGetActive();
   //UWORD pPaletteRef[256];
-	paletteLoadFromPath("data/jamelogo.plt", pScreen->_pFade->pPaletteRef, 255);
-	tBitMap *pLogo = bitmapCreateFromPath("data/jamelogo.bm", 0);
+	assetPaletteLoad("data/jamelogo.plt", pScreen->_pFade->pPaletteRef, 255);
+	tBitMap *pLogo = assetBitmapGet("data/jamelogo.bm", 0);
   	blitCopy(
 		pLogo, 0, 0, pScreen->_pBfr->pBack,
 		0,0,
@@ -37,7 +38,7 @@ systemUse();
   
 	systemUnuse();
   ScreenFadeFromBlack(NULL, 7, 0);
-  bitmapDestroy(pLogo);
+  assetBitmapRelease(pLogo);
   timerCreate();
 }
 
@@ -46,8 +47,8 @@ static void logoGsCreate(void)
   systemUse();
   logBlockBegin("logoGsCreate()");
   tScreen* pScreen = ScreenGetActive();
-  paletteLoadFromPath("data/playfield.plt", pScreen->_pFade->pPaletteRef, 255);
-	tBitMap *pLogo = bitmapCreateFromPath("data/dt.bm", 0);
+  assetPaletteLoad("data/playfield.plt", pScreen->_pFade->pPaletteRef, 255);
+	tBitMap *pLogo = assetBitmapGet("data/dt.bm", 0);
   	blitCopy(
 		pLogo, 0, 0, pScreen->_pBfr->pBack,
 		0,0,
@@ -60,7 +61,7 @@ static void logoGsCreate(void)
 	);
   
   ScreenFadeFromBlack(NULL, 7, 0); // 7 is the speed of the fade
-  bitmapDestroy(pLogo);
+  assetBitmapRelease(pLogo);
   systemUnuse();
   timerCreate();
 }
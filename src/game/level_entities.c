@@ -7,7 +7,8 @@
 #include "pressure_plate.h"
 #include "monster.h"
 #include "wallset.h"
-#include <ace/utils/disk_file.h>
+#include "bin_reader.h"
+#include "load_profile.h"
 #include <ace/utils/file.h>
 #include <ace/managers/log.h>
 #include <string.h>
@@ -36,50 +37,38 @@ static UBYTE levelEntResolveDoorGfx(tWallset *ws, UBYTE gfxIndex)
 	return 0;
 }
 
-UBYTE levelEntitiesLoad(tGameState *pState, const char *szPath)
+static UBYTE levelEntitiesLoadFrom(tGameState *pState, tBinReader *f, const char *szPath)
 {
-	if (!pState || !szPath || !szPath[0])
-		return 1;
-	tFile *f = diskFileOpen(szPath, DISK_FILE_MODE_READ, 1);
-	if (!f) {
-		logWrite("levelEntities: '%s' not found (optional)\n", szPath);
-		return 1;
-	}
 	char magic[4];
-	fileRead(f, magic, 4);
+	binRead(f, magic, 4);
 	if (magic[0] != 'L' || magic[1] != 'V' || magic[2] != 'L' || magic[3] != 'E') {
-		fileClose(f);
 		logWrite("levelEntities: bad magic in %s\n", szPath);
 		return 0;
 	}
 	UBYTE ver = 0;
-	fileRead(f, &ver, 1);
-	if (ver != LEVEL_ENTITIES_VERSION) {
-		fileClose(f);
+	binRead(f, &ver, 1);
+	if (ver < 1 || ver > LEVEL_ENTITIES_VERSION) {
 		logWrite("levelEntities: bad version %u\n", (unsigned)ver);
 		return 0;
 	}
 
 	UBYTE nWall = 0;
-	fileRead(f, &nWall, 1);
+	binRead(f, &nWall, 1);
 	for (UBYTE i = 0; i < nWall; i++) {
 		UBYTE x, y, wallSide, type, gfxIndex, eventType, esz;
-		fileRead(f, &x, 1);
-		fileRead(f, &y, 1);
-		fileRead(f, &wallSide, 1);
-		fileRead(f, &type, 1);
-		fileRead(f, &gfxIndex, 1);
-		fileRead(f, &eventType, 1);
-		fileRead(f, &esz, 1);
+		binRead(f, &x, 1);
+		binRead(f, &y, 1);
+		binRead(f, &wallSide, 1);
+		binRead(f, &type, 1);
+		binRead(f, &gfxIndex, 1);
+		binRead(f, &eventType, 1);
+		binRead(f, &esz, 1);
 		UBYTE buf[WALL_BTN_EVENT_MAX];
 		if (esz > WALL_BTN_EVENT_MAX) {
-			for (UBYTE k = 0; k < esz; k++) {
-				UBYTE b;
-				fileRead(f, &b, 1);
-			}
+			binSkip(f, esz);
 			esz = 0;
-		} else 		if (esz > 0) {
-			fileRead(f, buf, esz);
+		} else if (esz > 0) {
+			binRead(f, buf, esz);
 		}
 		gfxIndex = levelEntResolveWallGfx(pState->m_pCurrentWallset, gfxIndex);
 		tWallButton *wb = wallButtonCreateWithPayload(x, y, wallSide, type, gfxIndex, eventType, esz, esz ? buf : NULL);
@@ -88,16 +77,16 @@ UBYTE levelEntitiesLoad(tGameState *pState, const char *szPath)
 	}
 
 	UBYTE nDoor = 0;
-	fileRead(f, &nDoor, 1);
+	binRead(f, &nDoor, 1);
 	for (UBYTE i = 0; i < nDoor; i++) {
 		UBYTE x, y, wallSide, type, gfxIndex, tx, ty;
-		fileRead(f, &x, 1);
-		fileRead(f, &y, 1);
-		fileRead(f, &wallSide, 1);
-		fileRead(f, &type, 1);
-		fileRead(f, &gfxIndex, 1);
-		fileRead(f, &tx, 1);
-		fileRead(f, &ty, 1);
+		binRead(f, &x, 1);
+		binRead(f, &y, 1);
+		binRead(f, &wallSide, 1);
+		binRead(f, &type, 1);
+		binRead(f, &gfxIndex, 1);
+		binRead(f, &tx, 1);
+		binRead(f, &ty, 1);
 		gfxIndex = levelEntResolveDoorGfx(pState->m_pCurrentWallset, gfxIndex);
 		tDoorButton *db = doorButtonCreate(x, y, wallSide, type, gfxIndex, tx, ty);
 		if (db)
@@ -105,14 +94,14 @@ UBYTE levelEntitiesLoad(tGameState *pState, const char *szPath)
 	}
 
 	UBYTE nLock = 0;
-	fileRead(f, &nLock, 1);
+	binRead(f, &nLock, 1);
 	for (UBYTE i = 0; i < nLock; i++) {
 		UBYTE doorX, doorY, type, keyId, code;
-		fileRead(f, &doorX, 1);
-		fileRead(f, &doorY, 1);
-		fileRead(f, &type, 1);
-		fileRead(f, &keyId, 1);
-		fileRead(f, &code, 1);
+		binRead(f, &doorX, 1);
+		binRead(f, &doorY, 1);
+		binRead(f, &type, 1);
+		binRead(f, &keyId, 1);
+		binRead(f, &code, 1);
 		tDoorLock *lk = doorLockCreate(doorX, doorY, type, keyId);
 		if (lk) {
 			lk->_code = code;
@@ -121,50 +110,47 @@ UBYTE levelEntitiesLoad(tGameState *pState, const char *szPath)
 	}
 
 	UBYTE nPlate = 0;
-	fileRead(f, &nPlate, 1);
+	binRead(f, &nPlate, 1);
 	for (UBYTE i = 0; i < nPlate; i++) {
 		UBYTE x, y, eventType, dataSize;
-		fileRead(f, &x, 1);
-		fileRead(f, &y, 1);
-		fileRead(f, &eventType, 1);
-		fileRead(f, &dataSize, 1);
+		binRead(f, &x, 1);
+		binRead(f, &y, 1);
+		binRead(f, &eventType, 1);
+		binRead(f, &dataSize, 1);
 		UBYTE pdata[PRESSURE_PLATE_DATA_MAX];
 		if (dataSize > PRESSURE_PLATE_DATA_MAX) {
-			for (UBYTE k = 0; k < dataSize; k++) {
-				UBYTE b;
-				fileRead(f, &b, 1);
-			}
+			binSkip(f, dataSize);
 			continue;
 		}
 		if (dataSize > 0)
-			fileRead(f, pdata, dataSize);
+			binRead(f, pdata, dataSize);
 		pressurePlateAdd(&pState->m_pressurePlates, x, y, eventType, dataSize, pdata);
 	}
 
 	UBYTE nGround = 0;
-	fileRead(f, &nGround, 1);
+	binRead(f, &nGround, 1);
 	for (UBYTE i = 0; i < nGround; i++) {
 		UBYTE x, y, itemIdx, qty;
-		fileRead(f, &x, 1);
-		fileRead(f, &y, 1);
-		fileRead(f, &itemIdx, 1);
-		fileRead(f, &qty, 1);
+		binRead(f, &x, 1);
+		binRead(f, &y, 1);
+		binRead(f, &itemIdx, 1);
+		binRead(f, &qty, 1);
 		groundItemAdd(&pState->m_groundItems, x, y, itemIdx, qty);
 	}
 
 	UBYTE nMon = 0;
-	fileRead(f, &nMon, 1);
+	binRead(f, &nMon, 1);
 	logWrite("levelEntities: spawning %u monster(s)\n", (unsigned)nMon);
 	for (UBYTE i = 0; i < nMon; i++) {
 		UBYTE typeId, mx, my;
-		fileRead(f, &typeId, 1);
-		fileRead(f, &mx, 1);
-		fileRead(f, &my, 1);
+		binRead(f, &typeId, 1);
+		binRead(f, &mx, 1);
+		binRead(f, &my, 1);
 		if (pState->m_pMonsterList && pState->m_pMonsterList->_numMonsters < MAX_MONSTERS) {
 			tMonster *m = monsterCreate(typeId);
 			if (m) {
 				monsterPlaceInMaze(pState->m_pCurrentMaze, m, mx, my);
-				pState->m_pMonsterList->_monsters[pState->m_pMonsterList->_numMonsters++] = m;
+				monsterListAppend(pState->m_pMonsterList, m);
 				logWrite("levelEntities: placed type=%u at maze (%u,%u) idx=%u\n", (unsigned)typeId,
 					(unsigned)mx, (unsigned)my,
 					(unsigned)(pState->m_pMonsterList->_numMonsters - 1));
@@ -178,7 +164,65 @@ UBYTE levelEntitiesLoad(tGameState *pState, const char *szPath)
 		}
 	}
 
-	fileClose(f);
+	// Version 2: encounter groups, created dormant now so triggering one is cheap
+	UBYTE nEnc = 0;
+	if (ver >= 2)
+		binRead(f, &nEnc, 1);
+	for (UBYTE i = 0; i < nEnc && !f->isOverrun; i++) {
+		UBYTE id = 0, nMember = 0;
+		binRead(f, &id, 1);
+		binRead(f, &nMember, 1);
+		UBYTE members[3 * MONSTER_DORMANT_MAX];
+		if (nMember > MONSTER_DORMANT_MAX) {
+			logWrite("levelEntities: encounter %u has %u members, max %u\n", (unsigned)id,
+				(unsigned)nMember, (unsigned)MONSTER_DORMANT_MAX);
+			binSkip(f, 3 * (ULONG)nMember);
+			continue;
+		}
+		binRead(f, members, 3 * (ULONG)nMember);
+		if (!f->isOverrun)
+			encounterAdd(&pState->m_encounters, id, nMember, members);
+	}
+	if (nEnc)
+		logWrite("levelEntities: %u encounter(s), %u dormant monster(s)\n",
+			(unsigned)pState->m_encounters.count, (unsigned)pState->m_encounters.memberCount);
+
+	if (f->isOverrun)
+		logWrite("levelEntities: %s is truncated\n", szPath);
 	logWrite("levelEntities: loaded %s\n", szPath);
 	return 1;
 }
+
+UBYTE levelEntitiesLoad(tGameState *pState, const char *szPath)
+{
+	if (!pState || !szPath || !szPath[0])
+		return 1;
+	LOAD_PROFILE_PUSH(loadMark, "levelEntitiesLoad", szPath);
+	tBinReader reader;
+	LOAD_PROFILE_PUSH(openMark, "open", NULL);
+	UBYTE isOpen = binReaderOpen(&reader, szPath);
+	LOAD_PROFILE_POP(openMark);
+	UBYTE ok = 1;
+	if (isOpen) {
+		LOAD_PROFILE_PUSH(buildMark, "build", NULL);
+		ok = levelEntitiesLoadFrom(pState, &reader, szPath);
+		binReaderClose(&reader);
+		LOAD_PROFILE_POP(buildMark);
+	}
+	else
+		logWrite("levelEntities: '%s' not found (optional)\n", szPath);
+	LOAD_PROFILE_POP(loadMark);
+	return ok;
+}
+
+UBYTE levelEntitiesLoadFromMemory(tGameState *pState, const UBYTE *pData, ULONG ulSize)
+{
+	if (!pState || !pData)
+		return 1;
+	LOAD_PROFILE_PUSH(loadMark, "levelEntitiesLoadFromMemory", NULL);
+	tBinReader reader;
+	binReaderInitMemory(&reader, pData, ulSize);
+	UBYTE ok = levelEntitiesLoadFrom(pState, &reader, "pak chunk");
+	LOAD_PROFILE_POP(loadMark);
+	return ok;
+}
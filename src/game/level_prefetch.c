@@ -0,0 +1,257 @@
+#include "level_prefetch.h"
+#include "game_manifest.h"
+#include "script.h"
+#include "pak.h"
+#include <ace/managers/memory.h>
+#include <ace/managers/log.h>
+#include <ace/utils/disk_file.h>
+#include <string.h>
+
+typedef enum {
+	PREFETCH_PENDING,
+	PREFETCH_READING,
+	PREFETCH_READY,
+	PREFETCH_SKIPPED, // missing, over the ceiling, or taken
+} tPrefetchState;
+
+typedef struct {
+	char path[GAME_MANIFEST_PATH_MAX];
+	UBYTE level;
+	UBYTE state;
+	UBYTE *data;
+	ULONG size;
+	ULONG filled;
+	UBYTE inChip; // Fast was too short when it was allocated
+} tPrefetchFile;
+
+static tPrefetchFile s_files[LEVEL_PREFETCH_MAX_FILES];
+static UBYTE s_fileCount;
+static tFile *s_pReading; // open handle of the one file in PREFETCH_READING
+static ULONG s_stagedBytes;
+static ULONG s_chipBytes; // Part of s_stagedBytes that may sit in chip
+
+static void prefetchDrop(tPrefetchFile *f)
+{
+	if (f->state == PREFETCH_READING && s_pReading) {
+		fileClose(s_pReading);
+		s_pReading = NULL;
+	}
+	if (f->data) {
+		memFree(f->data, f->size);
+		s_stagedBytes -= f->size;
+		if (f->inChip)
+			s_chipBytes -= f->size;
+	}
+	f->data = NULL;
+	f->state = PREFETCH_SKIPPED;
+}
+
+static void prefetchAddPath(tPrefetchFile *plan, UBYTE *count, UBYTE level, const char *path)
+{
+	if (!path[0] || *count >= LEVEL_PREFETCH_MAX_FILES)
+		return;
+	for (UBYTE i = 0; i < *count; i++)
+		if (strcmp(plan[i].path, path) == 0)
+			return;
+	tPrefetchFile *f = &plan[(*count)++];
+	memset(f, 0, sizeof(*f));
+	strncpy(f->path, path, GAME_MANIFEST_PATH_MAX - 1);
+	f->level = level;
+	f->state = PREFETCH_PENDING;
+}
+
+// The files loadLevelContent() opens for this manifest level
+static void prefetchAddLevel(tPrefetchFile *plan, UBYTE *count, UBYTE level)
+{
+	const tGameManifest *man = gameManifestGet();
+	if (level >= man->levelCount)
+		return;
+	const tGameLevelEntry *e = &man->levels[level];
+	prefetchAddPath(plan, count, level, e->mazePath);
+	if (pakIsPath(e->mazePath))
+		return;
+	prefetchAddPath(plan, count, level, e->wallsetPath[0] ? e->wallsetPath : "data/factory2/factory2.wll");
+	prefetchAddPath(plan, count, level, e->entitiesPath);
+}
+
+void levelPrefetchPlan(const tMaze *pMaze, UBYTE currentLevel)
+{
+	UBYTE levels[LEVEL_PREFETCH_MAX_LEVELS];
+	UBYTE levelCount = 0;
+	// Exits scripted in this maze first, in event order; then the next level in the manifest
+	for (const tMazeEvent *e = pMaze ? pMaze->_events : NULL; e && levelCount < LEVEL_PREFETCH_MAX_LEVELS; e = e->_next) {
+		if (e->_eventType != EVENT_CHANGE_LEVEL || e->_eventDataSize < 1 || e->_eventData[0] == currentLevel)
+			continue;
+		UBYTE i = 0;
+		while (i < levelCount && levels[i] != e->_eventData[0])
+			i++;
+		if (i == levelCount)
+			levels[levelCount++] = e->_eventData[0];
+	}
+	if (levelCount < LEVEL_PREFETCH_MAX_LEVELS && currentLevel + 1 < gameManifestGet()->levelCount) {
+		UBYTE i = 0;
+		while (i < levelCount && levels[i] != currentLevel + 1)
+			i++;
+		if (i == levelCount)
+			levels[levelCount++] = currentLevel + 1;
+	}
+
+	tPrefetchFile plan[LEVEL_PREFETCH_MAX_FILES];
+	UBYTE count = 0;
+	for (UBYTE i = 0; i < levelCount; i++)
+		prefetchAddLevel(plan, &count, levels[i]);
+
+	// Carry over what is already staged (or being read) for files still in the plan
+	for (UBYTE i = 0; i < count; i++) {
+		for (UBYTE j = 0; j < s_fileCount; j++) {
+			tPrefetchFile *old = &s_files[j];
+			if ((old->state == PREFETCH_READY || old->state == PREFETCH_READING) && strcmp(old->path, plan[i].path) == 0) {
+				plan[i].state = old->state;
+				plan[i].data = old->data;
+				plan[i].size = old->size;
+				plan[i].filled = old->filled;
+				plan[i].inChip = old->inChip;
+				old->data = NULL;
+				old->state = PREFETCH_PENDING;
+				break;
+			}
+		}
+	}
+	for (UBYTE j = 0; j < s_fileCount; j++) {
+		if (s_files[j].data || s_files[j].state == PREFETCH_READING)
+			prefetchDrop(&s_files[j]);
+	}
+	memcpy(s_files, plan, sizeof(tPrefetchFile) * count);
+	s_fileCount = count;
+	for (UBYTE i = 0; i < count; i++)
+		logWrite("prefetch: planned level %u '%s'\n", (unsigned)s_files[i].level, s_files[i].path);
+}
+
+// memAllocFast() falls back to chip once fast is used up, so chip must have room then too
+static UBYTE prefetchHasRoom(ULONG size, UBYTE *pInChip)
+{
+	ULONG freeAll = memGetFreeSize();
+	ULONG freeChip = memGetFreeChipSize();
+	*pInChip = freeAll < freeChip || freeAll - freeChip < size;
+	if (freeAll < size + LEVEL_PREFETCH_RESERVE)
+		return 0;
+	return !*pInChip || freeChip >= size + LEVEL_PREFETCH_CHIP_RESERVE;
+}
+
+// Open the file and reserve its staging memory; leaves it PREFETCH_SKIPPED if either fails
+static void prefetchStart(tPrefetchFile *f)
+{
+	f->state = PREFETCH_SKIPPED;
+	// Interruptible: the file stays open over gameplay frames, and each read slice takes the OS itself
+	tFile *file = diskFileOpen(f->path, DISK_FILE_MODE_READ, 0);
+	if (!file)
+		return;
+	fileSeek(file, 0, FILE_SEEK_END);
+	ULONG size = fileGetPos(file);
+	fileSeek(file, 0, FILE_SEEK_SET);
+	if (!size || s_stagedBytes + size > LEVEL_PREFETCH_CEILING) {
+		fileClose(file);
+		logWrite("prefetch: '%s' (%lu bytes) does not fit the ceiling\n", f->path, (unsigned long)size);
+		return;
+	}
+	UBYTE inChip;
+	if (!prefetchHasRoom(size, &inChip) || !(f->data = (UBYTE *)memAllocFast(size))) {
+		fileClose(file);
+		logWrite("prefetch: memory tight, cancelled\n");
+		levelPrefetchCancel();
+		return;
+	}
+	s_stagedBytes += size;
+	if (inChip)
+		s_chipBytes += size;
+	f->inChip = inChip;
+	f->size = size;
+	f->filled = 0;
+	f->state = PREFETCH_READING;
+	s_pReading = file;
+}
+
+UBYTE levelPrefetchUpdate(void)
+{
+	// Finish the open file before starting another
+	tPrefetchFile *f = NULL;
+	for (UBYTE i = 0; i < s_fileCount && !f; i++) {
+		if (s_files[i].state == PREFETCH_READING)
+			f = &s_files[i];
+	}
+	for (UBYTE i = 0; i < s_fileCount && !f; i++) {
+		if (s_files[i].state == PREFETCH_PENDING)
+			f = &s_files[i];
+	}
+	if (!f)
+		return 0;
+	if (f->state == PREFETCH_PENDING) {
+		prefetchStart(f);
+		return 1;
+	}
+	if (memGetFreeSize() < LEVEL_PREFETCH_RESERVE || (s_chipBytes && memGetFreeChipSize() < LEVEL_PREFETCH_CHIP_RESERVE)) {
+		logWrite("prefetch: memory tight, cancelled\n");
+		levelPrefetchCancel();
+		return 1;
+	}
+	ULONG step = f->size - f->filled;
+	if (step > LEVEL_PREFETCH_SLICE)
+		step = LEVEL_PREFETCH_SLICE;
+	if (fileRead(s_pReading, f->data + f->filled, step) != step) {
+		logWrite("prefetch: '%s' truncated\n", f->path);
+		prefetchDrop(f);
+		return 1;
+	}
+	f->filled += step;
+	if (f->filled == f->size) {
+		fileClose(s_pReading);
+		s_pReading = NULL;
+		f->state = PREFETCH_READY;
+	}
+	return 1;
+}
+
+UBYTE *levelPrefetchTake(const char *path, ULONG *pSize)
+{
+	for (UBYTE i = 0; i < s_fileCount; i++) {
+		tPrefetchFile *f = &s_files[i];
+		if (f->state == PREFETCH_READY && strcmp(f->path, path) == 0) {
+			UBYTE *data = f->data;
+			*pSize = f->size;
+			s_stagedBytes -= f->size;
+			if (f->inChip)
+				s_chipBytes -= f->size;
+			f->data = NULL;
+			f->state = PREFETCH_SKIPPED;
+			return data;
+		}
+	}
+	return NULL;
+}
+
+void levelPrefetchRetain(UBYTE level)
+{
+	// Keep whatever the target level opens, including a wallset staged under another level
+	tPrefetchFile keep[LEVEL_PREFETCH_MAX_FILES];
+	UBYTE keepCount = 0;
+	prefetchAddLevel(keep, &keepCount, level);
+	for (UBYTE i = 0; i < s_fileCount; i++) {
+		UBYTE k = 0;
+		while (k < keepCount && strcmp(keep[k].path, s_files[i].path) != 0)
+			k++;
+		if (k == keepCount)
+			prefetchDrop(&s_files[i]);
+	}
+}
+
+void levelPrefetchCancel(void)
+{
+	for (UBYTE i = 0; i < s_fileCount; i++)
+		prefetchDrop(&s_files[i]);
+	s_fileCount = 0;
+}
+
+ULONG levelPrefetchStagedBytes(void)
+{
+	return s_stagedBytes;
+}
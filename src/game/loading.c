@@ -1,10 +1,13 @@
 #include "GameState.h"
 #include "smite.h"
+#include "asset_cache.h"
 #include <ace/managers/timer.h>
 
 #define LOADING_STUB_DELAY 100
 
 static void loadingGsCreate(void) {
+	// The menus are gone; drop what they left idle before the level takes chip
+	assetCacheFlush();
 	timerCreate();
 }
 
@@ -1,5 +1,6 @@
 #include "smite.h"
 #include "screen.h"
+#include "input.h"
 
 #include <ace/managers/key.h>
 #include <ace/managers/joy.h>
@@ -11,11 +12,11 @@ static void pausedGsDestroy(void) {}
 
 static void pausedGsLoop(void)
 {
-	if (keyUse(KEY_F9) || keyUse(KEY_ESCAPE))
+	if (inputKeyUse(KEY_F9) || inputKeyUse(KEY_ESCAPE))
 		statePop(g_pStateMachineGame);
-	if (joyUse(JOY1 + JOY_FIRE) || joyUse(JOY2 + JOY_FIRE))
+	if (inputJoyUse(JOY1 + JOY_FIRE) || inputJoyUse(JOY2 + JOY_FIRE))
 		statePop(g_pStateMachineGame);
-	if (mouseUse(MOUSE_PORT_1, MOUSE_LMB))
+	if (inputMouseUse(MOUSE_LMB))
 		statePop(g_pStateMachineGame);
 	ScreenUpdate();
 }
@@ -0,0 +1,279 @@
+#include "save_journal.h"
+#include "GameState.h"
+#include "party_field.h"
+#include <ace/managers/memory.h>
+#include <ace/managers/log.h>
+#include <string.h>
+
+static tSaveJournalRecord s_records[SAVE_JOURNAL_MAX_RECORDS];
+static UWORD s_count;
+static UBYTE s_isRecording;
+static UBYTE s_isFullLogged;
+
+void saveJournalReset(void)
+{
+	s_count = 0;
+	s_isRecording = 0;
+	s_isFullLogged = 0;
+}
+
+void saveJournalStart(void)
+{
+	s_isRecording = 1;
+}
+
+static tSaveJournalRecord *saveJournalFind(UBYTE type, UBYTE x, UBYTE y, UBYTE arg, UWORD value)
+{
+	for (UWORD i = 0; i < s_count; i++) {
+		tSaveJournalRecord *r = &s_records[i];
+		if (r->type == type && r->x == x && r->y == y && r->arg == arg && r->value == value)
+			return r;
+	}
+	return NULL;
+}
+
+static void saveJournalAppend(UBYTE type, UBYTE x, UBYTE y, UBYTE arg, UWORD value)
+{
+	if (s_count >= SAVE_JOURNAL_MAX_RECORDS) {
+		if (!s_isFullLogged)
+			logWrite("ERR: save journal full, later level changes will not be saved\n");
+		s_isFullLogged = 1;
+		return;
+	}
+	tSaveJournalRecord *r = &s_records[s_count++];
+	r->type = type;
+	r->x = x;
+	r->y = y;
+	r->arg = arg;
+	r->value = value;
+}
+
+static void saveJournalDrop(tSaveJournalRecord *r)
+{
+	// Monster records refer to earlier spawn records, so keep the order
+	memmove(r, r + 1, (size_t)(s_count - (r - s_records) - 1) * sizeof(*r));
+	s_count--;
+}
+
+void saveJournalCell(UBYTE ubLayer, UBYTE x, UBYTE y, UBYTE ubValue)
+{
+	if (!s_isRecording)
+		return;
+	for (UWORD i = 0; i < s_count; i++) {
+		tSaveJournalRecord *r = &s_records[i];
+		if (r->type == SAVE_JOURNAL_CELL && r->arg == ubLayer && r->x == x && r->y == y) {
+			r->value = ubValue;
+			return;
+		}
+	}
+	saveJournalAppend(SAVE_JOURNAL_CELL, x, y, ubLayer, ubValue);
+}
+
+void saveJournalEventByte(UWORD uwOrdinal, UBYTE ubOffset, UBYTE ubValue)
+{
+	if (!s_isRecording || uwOrdinal == 0xFFFF)
+		return;
+	for (UWORD i = 0; i < s_count; i++) {
+		tSaveJournalRecord *r = &s_records[i];
+		if (r->type == SAVE_JOURNAL_EVENT_BYTE && r->value == uwOrdinal && r->x == ubOffset) {
+			r->arg = ubValue;
+			return;
+		}
+	}
+	saveJournalAppend(SAVE_JOURNAL_EVENT_BYTE, ubOffset, 0, ubValue, uwOrdinal);
+}
+
+void saveJournalDoorLock(UBYTE x, UBYTE y, UBYTE ubState)
+{
+	if (!s_isRecording)
+		return;
+	for (UWORD i = 0; i < s_count; i++) {
+		tSaveJournalRecord *r = &s_records[i];
+		if (r->type == SAVE_JOURNAL_DOORLOCK && r->x == x && r->y == y) {
+			r->arg = ubState;
+			return;
+		}
+	}
+	saveJournalAppend(SAVE_JOURNAL_DOORLOCK, x, y, ubState, 0);
+}
+
+void saveJournalGround(UBYTE x, UBYTE y, UBYTE ubItemIdx, WORD wDelta)
+{
+	if (!s_isRecording || !wDelta)
+		return;
+	for (UWORD i = 0; i < s_count; i++) {
+		tSaveJournalRecord *r = &s_records[i];
+		if (r->type == SAVE_JOURNAL_GROUND && r->x == x && r->y == y && r->arg == ubItemIdx) {
+			r->value = (UWORD)((WORD)r->value + wDelta);
+			if (!r->value)
+				saveJournalDrop(r);
+			return;
+		}
+	}
+	saveJournalAppend(SAVE_JOURNAL_GROUND, x, y, ubItemIdx, (UWORD)wDelta);
+}
+
+void saveJournalMonsterAdd(UBYTE ubType, UBYTE x, UBYTE y)
+{
+	if (s_isRecording)
+		saveJournalAppend(SAVE_JOURNAL_MONSTER_ADD, x, y, ubType, 0);
+}
+
+void saveJournalMonsterKill(UWORD uwSpawnId)
+{
+	if (s_isRecording && !saveJournalFind(SAVE_JOURNAL_MONSTER_KILL, 0, 0, 0, uwSpawnId))
+		saveJournalAppend(SAVE_JOURNAL_MONSTER_KILL, 0, 0, 0, uwSpawnId);
+}
+
+void saveJournalMonsterRemove(UWORD uwSpawnId)
+{
+	if (s_isRecording)
+		saveJournalAppend(SAVE_JOURNAL_MONSTER_REMOVE, 0, 0, 0, uwSpawnId);
+}
+
+void saveJournalEncounter(UBYTE ubId)
+{
+	// An encounter fires once, so it is never recorded twice
+	if (s_isRecording)
+		saveJournalAppend(SAVE_JOURNAL_ENCOUNTER, 0, 0, ubId, 0);
+}
+
+void saveJournalWrite(tFile *pFile)
+{
+	UBYTE count[2] = {(UBYTE)(s_count >> 8), (UBYTE)s_count};
+	fileWrite(pFile, count, 2);
+	if (!s_count)
+		return;
+	// One write for the lot rather than one per record
+	ULONG size = (ULONG)s_count * SAVE_JOURNAL_RECORD_SIZE;
+	UBYTE *data = (UBYTE *)memAllocFast(size);
+	if (!data) {
+		logWrite("ERR: no memory to write the save journal (%lu bytes)\n", (unsigned long)size);
+		return;
+	}
+	UBYTE *p = data;
+	for (UWORD i = 0; i < s_count; i++, p += SAVE_JOURNAL_RECORD_SIZE) {
+		const tSaveJournalRecord *r = &s_records[i];
+		p[0] = r->type;
+		p[1] = r->x;
+		p[2] = r->y;
+		p[3] = r->arg;
+		p[4] = (UBYTE)(r->value >> 8);
+		p[5] = (UBYTE)r->value;
+	}
+	fileWrite(pFile, data, size);
+	memFree(data, size);
+}
+
+static tMonster *saveJournalMonster(tMonsterList *pList, UWORD uwSpawnId, UBYTE *pIndex)
+{
+	for (UBYTE i = 0; i < pList->_numMonsters; i++) {
+		if (pList->_monsters[i]->_spawnId == uwSpawnId) {
+			*pIndex = i;
+			return pList->_monsters[i];
+		}
+	}
+	return NULL;
+}
+
+static UBYTE saveJournalApply(tGameState *pState, const tSaveJournalRecord *r)
+{
+	tMaze *pMaze = pState->m_pCurrentMaze;
+	switch (r->type) {
+		case SAVE_JOURNAL_CELL: {
+			if (r->x >= pMaze->_width || r->y >= pMaze->_height)
+				return 0;
+			UWORD idx = r->x + r->y * pMaze->_width;
+			if (r->arg == SAVE_JOURNAL_LAYER_WALL) {
+				pMaze->_mazeData[idx] = (UBYTE)r->value;
+				partyFieldCellChanged(r->x, r->y);
+			}
+			else if (r->arg == SAVE_JOURNAL_LAYER_FLOOR)
+				pMaze->_mazeFloor[idx] = (UBYTE)r->value;
+			else if (r->arg == SAVE_JOURNAL_LAYER_COL)
+				pMaze->_mazeCol[idx] = (UBYTE)r->value;
+			else
+				return 0;
+			return 1;
+		}
+		case SAVE_JOURNAL_EVENT_BYTE: {
+			tMazeEvent *pEvent = mazeEventAtOrdinal(pMaze, r->value);
+			if (!pEvent || r->x >= pEvent->_eventDataSize)
+				return 0;
+			pEvent->_eventData[r->x] = r->arg;
+			return 1;
+		}
+		case SAVE_JOURNAL_DOORLOCK: {
+			tDoorLock *pLock = doorLockFindAt(&pState->m_doorLocks, r->x, r->y);
+			if (!pLock)
+				return 0;
+			pLock->_state = r->arg;
+			return 1;
+		}
+		case SAVE_JOURNAL_GROUND: {
+			WORD delta = (WORD)r->value;
+			if (delta > 0)
+				return groundItemAdd(&pState->m_groundItems, r->x, r->y, r->arg, (UBYTE)delta);
+			return groundItemRemoveAt(&pState->m_groundItems, r->x, r->y, r->arg, (UBYTE)-delta);
+		}
+		case SAVE_JOURNAL_MONSTER_ADD:
+			return encounterSpawn(&pState->m_encounters, pMaze, pState->m_pMonsterList, r->arg, r->x, r->y) ? 1 : 0;
+		case SAVE_JOURNAL_ENCOUNTER:
+			return encounterTrigger(&pState->m_encounters, pMaze, pState->m_pMonsterList, r->arg);
+		case SAVE_JOURNAL_MONSTER_KILL:
+		case SAVE_JOURNAL_MONSTER_REMOVE: {
+			UBYTE index;
+			tMonster *pMonster = saveJournalMonster(pState->m_pMonsterList, r->value, &index);
+			if (!pMonster)
+				return 0;
+			// A kill hands the record back to the pool, as in play
+			if (r->type == SAVE_JOURNAL_MONSTER_KILL)
+				monsterKill(pMaze, pMonster);
+			monsterListRemove(pState->m_pMonsterList, pMaze, index);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+UBYTE saveJournalReplay(tGameState *pState, const UBYTE *pData, UWORD uwCount)
+{
+	saveJournalReset();
+	if (uwCount > SAVE_JOURNAL_MAX_RECORDS)
+		uwCount = SAVE_JOURNAL_MAX_RECORDS;
+	UWORD rejected = 0;
+	for (UWORD i = 0; i < uwCount; i++, pData += SAVE_JOURNAL_RECORD_SIZE) {
+		tSaveJournalRecord *r = &s_records[s_count++];
+		r->type = pData[0];
+		r->x = pData[1];
+		r->y = pData[2];
+		r->arg = pData[3];
+		r->value = (UWORD)((pData[4] << 8) | pData[5]);
+		if (!saveJournalApply(pState, r))
+			rejected++;
+	}
+	if (rejected)
+		logWrite("ERR: save journal: %u of %u records do not fit the level\n",
+			(unsigned)rejected, (unsigned)uwCount);
+	saveJournalStart();
+	return rejected ? 0 : 1;
+}
+
+void saveJournalRestore(const void *pRecords, UWORD uwCount)
+{
+	if (uwCount > SAVE_JOURNAL_MAX_RECORDS)
+		uwCount = SAVE_JOURNAL_MAX_RECORDS;
+	memcpy(s_records, pRecords, (ULONG)uwCount * sizeof(tSaveJournalRecord));
+	s_count = uwCount;
+	s_isFullLogged = 0;
+}
+
+UWORD saveJournalCount(void)
+{
+	return s_count;
+}
+
+const tSaveJournalRecord *saveJournalGet(UWORD uwIndex)
+{
+	return uwIndex < s_count ? &s_records[uwIndex] : NULL;
+}
@@ -0,0 +1,301 @@
+#include "snapshot.h"
+#include "GameState.h"
+#include "save_journal.h"
+#include "party_field.h"
+#include "rng.h"
+#include <ace/managers/memory.h>
+#include <ace/managers/log.h>
+#include <string.h>
+
+typedef struct {
+	UBYTE level;
+	UBYTE width;
+	UBYTE height;
+	UBYTE numCharacters;
+	UBYTE numMonsters;
+	UBYTE numLocks;
+	UBYTE numWallButtons;
+	UBYTE numDoorButtons;
+	UBYTE mapVisible;
+	UWORD nextSpawnId;
+	UWORD eventCount;
+	UWORD journalCount;
+	UWORD looseEventBytes; // Payloads of events not in the image, in list order
+	ULONG imageSpan;       // Bytes of the .maze image's event section copied
+	ULONG rngState[RNG_STREAM_COUNT];
+	ULONG encountersFired; // Encounters fired and ADD_MONSTER spawns taken
+} tSnapshotHeader;
+
+// Both sides walk the buffer through one of these, so take and restore cannot drift apart
+typedef struct {
+	UBYTE *p;
+} tSnapshotCursor;
+
+static void snapshotPut(tSnapshotCursor *c, const void *src, ULONG size)
+{
+	memcpy(c->p, src, size);
+	c->p += size;
+}
+
+static void snapshotGet(tSnapshotCursor *c, void *dst, ULONG size)
+{
+	memcpy(dst, c->p, size);
+	c->p += size;
+}
+
+// The grids lead the .maze image, but tMaze copied them out at load and they go across from there
+static ULONG snapshotImageStart(const tMaze *pMaze)
+{
+	return 2 + 3 * (ULONG)pMaze->_width * pMaze->_height;
+}
+
+// The image from the event section up to the string section: every loaded event payload
+static ULONG snapshotImageSpan(const tMaze *pMaze)
+{
+	if (!pMaze->_image)
+		return 0;
+	ULONG end = pMaze->_imageSize;
+	if (!pMaze->_stringBlobCapacity && pMaze->_stringBlob)
+		end = (ULONG)(pMaze->_stringBlob - pMaze->_image);
+	ULONG start = snapshotImageStart(pMaze);
+	return end > start ? end - start : 0;
+}
+
+static UWORD snapshotLooseEventBytes(const tMaze *pMaze)
+{
+	UWORD bytes = 0;
+	for (const tMazeEvent *e = pMaze->_events; e; e = e->_next) {
+		if (!(e->_flags & MAZE_EVENT_IN_ARENA))
+			bytes += e->_eventDataSize;
+	}
+	return bytes;
+}
+
+static void snapshotFillHeader(tSnapshotHeader *h, const tGameState *pState)
+{
+	const tMaze *pMaze = pState->m_pCurrentMaze;
+	memset(h, 0, sizeof(*h));
+	h->level = pState->m_ubCurrentLevel;
+	h->width = pMaze->_width;
+	h->height = pMaze->_height;
+	h->numCharacters = pState->m_pCurrentParty->_numCharacters;
+	h->numMonsters = pState->m_pMonsterList->_numMonsters;
+	h->nextSpawnId = pState->m_pMonsterList->_nextSpawnId;
+	h->numLocks = pState->m_doorLocks._numLocks;
+	h->numWallButtons = pState->m_wallButtons._numButtons;
+	h->numDoorButtons = pState->m_doorButtons._numButtons;
+	h->mapVisible = pState->m_bMapVisible;
+	h->eventCount = pMaze->_eventCount;
+	h->journalCount = saveJournalCount();
+	h->looseEventBytes = snapshotLooseEventBytes(pMaze);
+	h->imageSpan = snapshotImageSpan(pMaze);
+	for (UBYTE i = 0; i < RNG_STREAM_COUNT; i++)
+		h->rngState[i] = rngStateGet((tRngStream)i);
+	h->encountersFired = encounterFiredMask(&pState->m_encounters);
+}
+
+static ULONG snapshotSizeOfHeader(const tSnapshotHeader *h)
+{
+	ULONG cells = (ULONG)h->width * h->height;
+	return sizeof(tSnapshotHeader)
+		+ 2 * 256 // global and local flags
+		+ sizeof(((tGameState *)0)->_scriptContexts)
+		+ sizeof(tGroundItemList) + sizeof(tPressurePlateList)
+		+ sizeof(tCharacterParty) + (ULONG)h->numCharacters * sizeof(tCharacter)
+		+ sizeof(tInventory)
+		+ 4 * cells // walls, colours, floors, monster counts
+		+ h->imageSpan + h->looseEventBytes
+		+ (ULONG)h->numMonsters * (sizeof(tMonster) + sizeof(tMonsterCold))
+		+ h->numLocks + h->numWallButtons + h->numDoorButtons
+		+ (ULONG)h->journalCount * sizeof(tSaveJournalRecord);
+}
+
+UBYTE snapshotCreate(tSnapshot *pSnapshot, ULONG ulCapacity)
+{
+	pSnapshot->ulSize = 0;
+	pSnapshot->pData = (UBYTE *)memAllocFast(ulCapacity);
+	pSnapshot->ulCapacity = pSnapshot->pData ? ulCapacity : 0;
+	return pSnapshot->pData ? 1 : 0;
+}
+
+UBYTE snapshotReserve(tSnapshot *pSnapshot, ULONG ulCapacity)
+{
+	if (ulCapacity <= pSnapshot->ulCapacity)
+		return 1;
+	UBYTE *pData = (UBYTE *)memAllocFast(ulCapacity);
+	if (!pData)
+		return 0;
+	if (pSnapshot->ulSize)
+		memcpy(pData, pSnapshot->pData, pSnapshot->ulSize);
+	if (pSnapshot->pData)
+		memFree(pSnapshot->pData, pSnapshot->ulCapacity);
+	pSnapshot->pData = pData;
+	pSnapshot->ulCapacity = ulCapacity;
+	return 1;
+}
+
+void snapshotDestroy(tSnapshot *pSnapshot)
+{
+	if (pSnapshot->pData)
+		memFree(pSnapshot->pData, pSnapshot->ulCapacity);
+	pSnapshot->pData = NULL;
+	pSnapshot->ulCapacity = 0;
+	pSnapshot->ulSize = 0;
+}
+
+ULONG snapshotSizeOf(const tGameState *pState)
+{
+	if (!pState || !pState->m_pCurrentMaze)
+		return 0;
+	tSnapshotHeader h;
+	snapshotFillHeader(&h, pState);
+	return snapshotSizeOfHeader(&h);
+}
+
+UBYTE snapshotTake(tSnapshot *pSnapshot, const tGameState *pState)
+{
+	if (!pState || !pState->m_pCurrentMaze || !pSnapshot->pData)
+		return 0;
+	tSnapshotHeader h;
+	snapshotFillHeader(&h, pState);
+	ULONG size = snapshotSizeOfHeader(&h);
+	if (size > pSnapshot->ulCapacity) {
+		logWrite("snapshot: needs %lu bytes, buffer has %lu\n", (unsigned long)size,
+			(unsigned long)pSnapshot->ulCapacity);
+		return 0;
+	}
+	const tMaze *pMaze = pState->m_pCurrentMaze;
+	ULONG cells = (ULONG)h.width * h.height;
+	tSnapshotCursor c = {pSnapshot->pData};
+	snapshotPut(&c, &h, sizeof(h));
+	// m_bGlobalFlags and m_bLocalFlags are adjacent
+	snapshotPut(&c, pState->m_bGlobalFlags, 2 * 256);
+	snapshotPut(&c, pState->_scriptContexts, sizeof(pState->_scriptContexts));
+	snapshotPut(&c, &pState->m_groundItems, sizeof(tGroundItemList));
+	snapshotPut(&c, &pState->m_pressurePlates, sizeof(tPressurePlateList));
+	snapshotPut(&c, pState->m_pCurrentParty, sizeof(tCharacterParty));
+	for (UBYTE i = 0; i < h.numCharacters; i++)
+		snapshotPut(&c, pState->m_pCurrentParty->_characters[i], sizeof(tCharacter));
+	snapshotPut(&c, pState->m_pInventory, sizeof(tInventory));
+
+	snapshotPut(&c, pMaze->_mazeData, cells);
+	snapshotPut(&c, pMaze->_mazeCol, cells);
+	snapshotPut(&c, pMaze->_mazeFloor, cells);
+	snapshotPut(&c, pMaze->_monsterCount, cells);
+	if (h.imageSpan)
+		snapshotPut(&c, pMaze->_image + snapshotImageStart(pMaze), h.imageSpan);
+	for (const tMazeEvent *e = pMaze->_events; e && h.looseEventBytes; e = e->_next) {
+		if (!(e->_flags & MAZE_EVENT_IN_ARENA))
+			snapshotPut(&c, e->_eventData, e->_eventDataSize);
+	}
+
+	for (UBYTE i = 0; i < h.numMonsters; i++) {
+		snapshotPut(&c, pState->m_pMonsterList->_monsters[i], sizeof(tMonster));
+		snapshotPut(&c, monsterCold(pState->m_pMonsterList->_monsters[i]), sizeof(tMonsterCold));
+	}
+	for (const tDoorLock *l = pState->m_doorLocks._locks; l; l = l->_next)
+		*c.p++ = l->_state;
+	for (const tWallButton *b = pState->m_wallButtons._buttons; b; b = b->_next)
+		*c.p++ = b->_state;
+	for (const tDoorButton *b = pState->m_doorButtons._buttons; b; b = b->_next)
+		*c.p++ = b->_state;
+	if (h.journalCount)
+		snapshotPut(&c, saveJournalGet(0), (ULONG)h.journalCount * sizeof(tSaveJournalRecord));
+
+	pSnapshot->ulSize = size;
+	return 1;
+}
+
+// Make the monster list hold count monsters; their contents are overwritten after
+static UBYTE snapshotResizeMonsters(tGameState *pState, UBYTE count)
+{
+	tMonsterList *pList = pState->m_pMonsterList;
+	while (pList->_numMonsters > count) {
+		monsterDestroy(pList->_monsters[--pList->_numMonsters]);
+		pList->_monsters[pList->_numMonsters] = NULL;
+	}
+	while (pList->_numMonsters < count) {
+		// Any type will do: the record is overwritten and the random streams restored
+		tMonster *pMonster = monsterCreate(MONSTER_TYPE_NORMAL);
+		if (!pMonster)
+			return 0;
+		pList->_monsters[pList->_numMonsters++] = pMonster;
+	}
+	return 1;
+}
+
+UBYTE snapshotRestore(const tSnapshot *pSnapshot, tGameState *pState)
+{
+	if (!pState || !pSnapshot->ulSize)
+		return 0;
+	tSnapshotHeader h;
+	tSnapshotCursor c = {pSnapshot->pData};
+	snapshotGet(&c, &h, sizeof(h));
+	if ((!pState->m_pCurrentMaze || pState->m_ubCurrentLevel != h.level) && !LoadLevel((BYTE)h.level))
+		return 0;
+
+	tMaze *pMaze = pState->m_pCurrentMaze;
+	tCharacterParty *pParty = pState->m_pCurrentParty;
+	if (pMaze->_width != h.width || pMaze->_height != h.height || pMaze->_eventCount != h.eventCount
+		|| snapshotImageSpan(pMaze) != h.imageSpan || snapshotLooseEventBytes(pMaze) != h.looseEventBytes
+		|| pParty->_numCharacters != h.numCharacters || pState->m_doorLocks._numLocks != h.numLocks
+		|| pState->m_wallButtons._numButtons != h.numWallButtons
+		|| pState->m_doorButtons._numButtons != h.numDoorButtons) {
+		logWrite("snapshot: level %u no longer matches the snapshot\n", (unsigned)h.level);
+		return 0;
+	}
+	if (!snapshotResizeMonsters(pState, h.numMonsters)) {
+		logWrite("snapshot: out of memory for %u monsters\n", (unsigned)h.numMonsters);
+		return 0;
+	}
+	ULONG cells = (ULONG)h.width * h.height;
+	snapshotGet(&c, pState->m_bGlobalFlags, 2 * 256);
+	snapshotGet(&c, pState->_scriptContexts, sizeof(pState->_scriptContexts));
+	// Event pointers may be from another load of the level; the ordinals are what counts
+	for (UBYTE i = 0; i < SCRIPT_MAX_CONTEXTS; i++)
+		pState->_scriptContexts[i]._pEvent = NULL;
+	snapshotGet(&c, &pState->m_groundItems, sizeof(tGroundItemList));
+	snapshotGet(&c, &pState->m_pressurePlates, sizeof(tPressurePlateList));
+	tCharacter **ppCharacters = pParty->_characters;
+	snapshotGet(&c, pParty, sizeof(tCharacterParty));
+	pParty->_characters = ppCharacters;
+	for (UBYTE i = 0; i < h.numCharacters; i++)
+		snapshotGet(&c, pParty->_characters[i], sizeof(tCharacter));
+	snapshotGet(&c, pState->m_pInventory, sizeof(tInventory));
+	pState->m_bMapVisible = h.mapVisible;
+
+	snapshotGet(&c, pMaze->_mazeData, cells);
+	snapshotGet(&c, pMaze->_mazeCol, cells);
+	snapshotGet(&c, pMaze->_mazeFloor, cells);
+	snapshotGet(&c, pMaze->_monsterCount, cells);
+	if (h.imageSpan)
+		snapshotGet(&c, pMaze->_image + snapshotImageStart(pMaze), h.imageSpan);
+	for (tMazeEvent *e = pMaze->_events; e && h.looseEventBytes; e = e->_next) {
+		if (!(e->_flags & MAZE_EVENT_IN_ARENA))
+			snapshotGet(&c, e->_eventData, e->_eventDataSize);
+	}
+	while (pMaze->_doorAnims)
+		doorAnimRemove(pMaze, pMaze->_doorAnims);
+	partyFieldInvalidate();
+
+	for (UBYTE i = 0; i < h.numMonsters; i++) {
+		snapshotGet(&c, pState->m_pMonsterList->_monsters[i], sizeof(tMonster));
+		snapshotGet(&c, monsterCold(pState->m_pMonsterList->_monsters[i]), sizeof(tMonsterCold));
+		// The scheduler's frame count ran on since the snapshot; owe nothing for it
+		pState->m_pMonsterList->_monsters[i]->_aiFrame = pState->m_pMonsterList->_aiFrame;
+	}
+	pState->m_pMonsterList->_nextSpawnId = h.nextSpawnId;
+	if (!encounterRearm(&pState->m_encounters, h.encountersFired))
+		logWrite("snapshot: some encounter monsters could not be rearmed\n");
+	for (tDoorLock *l = pState->m_doorLocks._locks; l; l = l->_next)
+		l->_state = *c.p++;
+	for (tWallButton *b = pState->m_wallButtons._buttons; b; b = b->_next)
+		b->_state = *c.p++;
+	for (tDoorButton *b = pState->m_doorButtons._buttons; b; b = b->_next)
+		b->_state = *c.p++;
+	saveJournalRestore(c.p, h.journalCount);
+
+	for (UBYTE i = 0; i < RNG_STREAM_COUNT; i++)
+		rngStateSet((tRngStream)i, h.rngState[i]);
+	return 1;
+}
@@ -14,6 +14,7 @@
 #include "screen.h"
 #include "mouse_pointer.h"
 #include "layer.h"
+#include "asset_cache.h"
 
 #define BUTTON_WIDTH 68
 #define BUTTON_HEIGHT 12
@@ -108,8 +109,8 @@ static void titleGsCreate(void)
 
 	g_pMainScreen = ScreenGetActive();
 	// UWORD pPaletteRef[256];
-	paletteLoadFromPath("data/title.plt", g_pMainScreen->_pFade->pPaletteRef, 255);
-	tBitMap *pLogo = bitmapCreateFromPath("data/title.bm", 0);
+	assetPaletteLoad("data/title.plt", g_pMainScreen->_pFade->pPaletteRef, 255);
+	tBitMap *pLogo = assetBitmapGet("data/title.bm", 0);
 	blitCopy(
 		pLogo, 0, 0, g_pMainScreen->_pBfr->pBack,
 		0, 0,
@@ -120,12 +121,12 @@ static void titleGsCreate(void)
 		0, 0,
 		320, 256, MINTERM_COOKIE);
 
-	bitmapDestroy(pLogo);
+	assetBitmapRelease(pLogo);
 
 	ScreenFadeFromBlack(NULL, 7, 0);
 	
 
-	g_pMenuItems = bitmapCreateFromPath("data/MenuItems.bm", 0);
+	g_pMenuItems = assetBitmapGet("data/MenuItems.bm", 0);
 
 	s_menuLayer = layerCreate();
 	Region newGameButton = {
@@ -182,7 +183,7 @@ static void titleGsLoop(void)
 
 static void titleGsDestroy(void)
 {
-	bitmapDestroy(g_pMenuItems);
+	assetBitmapRelease(g_pMenuItems);
 	layerRemoveRegion(s_menuLayer, newGameRegionId);
 	layerRemoveRegion(s_menuLayer, loadGameRegionId);
 	layerRemoveRegion(s_menuLayer, exitGameRegionId);
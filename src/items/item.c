@@ -1,4 +1,6 @@
 #include "item.h"
+#include "bin_reader.h"
+#include "load_profile.h"
 #include <ace/managers/memory.h>
 #include <ace/managers/system.h>
 #include <ace/managers/log.h>
@@ -61,61 +63,66 @@ static void createFallbackItems(void)
     if (s_vecItems[1].pszName) { s_vecItems[1].pszName[0] = 'P'; s_vecItems[1].pszName[1] = 'o'; s_vecItems[1].pszName[2] = 't'; s_vecItems[1].pszName[3] = 'i'; s_vecItems[1].pszName[4] = 'o'; s_vecItems[1].pszName[5] = 'n'; }
 }
 
-void loadItems(const char* filename)
+static void itemsRead(const char* filename)
 {
     itemSystemInit();
-    tFile* pFile = diskFileOpen(filename, DISK_FILE_MODE_READ, 1);
-    if (!pFile) {
+    tBinReader reader;
+    LOAD_PROFILE_PUSH(openMark, "open", NULL);
+    UBYTE isOpen = binReaderOpen(&reader, filename);
+    LOAD_PROFILE_POP(openMark);
+    if (!isOpen) {
         logWrite("Items: file not found, using fallback items\n");
         createFallbackItems();
         return;
     }
-    UBYTE count = 0;
-    fileRead(pFile, &count, 1);
+    UBYTE count = binReadU8(&reader);
     if (count == 0 || count > 128) {
-        fileClose(pFile);
+        binReaderClose(&reader);
         createFallbackItems();
         return;
     }
     s_vecItems = (tItem*)memAllocFastClear(sizeof(tItem) * count);
     if (!s_vecItems) {
-        fileClose(pFile);
+        binReaderClose(&reader);
         s_ubItemCount = 0;
         return;
     }
     s_ubItemCount = count;
     for (UBYTE i = 0; i < count; i++) {
         tItem* p = &s_vecItems[i];
-        fileRead(pFile, &p->ubType, 1);
-        fileRead(pFile, &p->ubSubType, 1);
-        fileRead(pFile, &p->ubFlags, 1);
-        fileRead(pFile, &p->ubModifierType, 1);
-        fileRead(pFile, &p->ubModifier, 1);
-        fileRead(pFile, &p->ubValue, 1);
-        fileRead(pFile, &p->ubWeight, 1);
-        fileRead(pFile, &p->ubIcon, 1);
-        fileRead(pFile, &p->ubUsageType, 1);
-        fileRead(pFile, &p->ubKeyId, 1);
-        fileRead(pFile, &p->ubEquipSlot, 1);
-        UBYTE nameLen = 0;
-        fileRead(pFile, &nameLen, 1);
+        p->ubType = binReadU8(&reader);
+        p->ubSubType = binReadU8(&reader);
+        p->ubFlags = binReadU8(&reader);
+        p->ubModifierType = binReadU8(&reader);
+        p->ubModifier = binReadU8(&reader);
+        p->ubValue = binReadU8(&reader);
+        p->ubWeight = binReadU8(&reader);
+        p->ubIcon = binReadU8(&reader);
+        p->ubUsageType = binReadU8(&reader);
+        p->ubKeyId = binReadU8(&reader);
+        p->ubEquipSlot = binReadU8(&reader);
+        UBYTE nameLen = binReadU8(&reader);
         p->pszName = NULL;
-        if (nameLen > 0 && nameLen < 64) {
+        if (nameLen > 0 && nameLen < 64)
             p->pszName = (char*)memAllocFastClear(nameLen + 1);
-            if (p->pszName) {
-                fileRead(pFile, p->pszName, nameLen);
-                p->pszName[nameLen] = '\0';
-            } else {
-                for (UBYTE k = 0; k < nameLen; k++) { UBYTE b; fileRead(pFile, &b, 1); }
-            }
-        } else if (nameLen > 0) {
-            for (UBYTE k = 0; k < nameLen; k++) { UBYTE b; fileRead(pFile, &b, 1); }
+        if (p->pszName) {
+            binRead(&reader, p->pszName, nameLen);
+            p->pszName[nameLen] = '\0';
+        } else {
+            binSkip(&reader, nameLen);
         }
     }
-    fileClose(pFile);
+    binReaderClose(&reader);
     logWrite("Items: loaded %d items from %s\n", (int)s_ubItemCount, filename);
 }
 
+void loadItems(const char* filename)
+{
+    LOAD_PROFILE_PUSH(loadMark, "loadItems", filename);
+    itemsRead(filename);
+    LOAD_PROFILE_POP(loadMark);
+}
+
 void saveItems(const char* filename)
 {
     if (!filename || !s_vecItems || s_ubItemCount == 0)
@@ -1,17 +1,18 @@
 #include "maze.h"
 #include "script.h"
+#include "bin_reader.h"
+#include "slz.h"
+#include "level_prefetch.h"
+#include "load_profile.h"
+#include "party_field.h"
+#include "maze_zones.h"
 
 #include <ace/managers/memory.h>
 #include <ace/managers/system.h>
 #include <ace/utils/file.h>
 #include <ace/utils/disk_file.h>
 
-static UWORD mazeReadU16Be(tFile *pFile)
-{
-	UBYTE b[2];
-	fileRead(pFile, b, 2);
-	return ((UWORD)b[0] << 8) | (UWORD)b[1];
-}
+static tMaze* mazeLoadChunk(const UBYTE* data, ULONG size);
 
 static void mazeWriteU16Be(tFile *pFile, UWORD v)
 {
@@ -112,62 +113,169 @@ tMaze* mazeCreate(UBYTE width, UBYTE height)
     pMaze->_mazeData = (UBYTE*)memAllocFastClear(sizeof(UBYTE) * width * height);
     pMaze->_mazeCol = (UBYTE*)memAllocFastClear(sizeof(UBYTE) * width * height);
     pMaze->_mazeFloor = (UBYTE*)memAllocFastClear(sizeof(UBYTE) * width * height);
+    pMaze->_monsterCount = (UBYTE*)memAllocFastClear(sizeof(UBYTE) * width * height);
     pMaze->_eventCount =0;
     pMaze->_events = 0;
    
     return pMaze;
 }
 
+// Builds the maze from a whole .maze file image in one pass. The maze takes
+// ownership of image: payloads and strings point into it rather than being copied.
+static tMaze* mazeLoadImage(UBYTE* image, ULONG size, const char* name)
+{
+    if (slzIsPacked(image, size)) {
+        // SLZ1-packed .maze: swap the packed image for the unpacked one
+        LOAD_PROFILE_PUSH(unpackMark, "decode", "slz");
+        ULONG rawSize = slzRawSize(image);
+        UBYTE* raw = (UBYTE*)memAllocFast(rawSize);
+        UBYTE ok = raw && slzUnpack(image, size, raw);
+        memFree(image, size);
+        LOAD_PROFILE_POP(unpackMark);
+        if (!ok) {
+            if (raw)
+                memFree(raw, rawSize);
+            logWrite("mazeLoad: %s fails to unpack\n", name);
+            return 0;
+        }
+        image = raw;
+        size = rawSize;
+    }
+    LOAD_PROFILE_PUSH(buildMark, "build", name);
+    tBinReader reader;
+    binReaderInitMemory(&reader, image, size);
+    UBYTE width = binReadU8(&reader);
+    UBYTE height = binReadU8(&reader);
+    tMaze* pMaze = mazeCreate(width, height);
+    pMaze->_image = image;
+    pMaze->_imageSize = size;
+    binRead(&reader, pMaze->_mazeData, width * height);
+    binRead(&reader, pMaze->_mazeCol, width * height);
+    binRead(&reader, pMaze->_mazeFloor, width * height);
+    UWORD eventCount = binReadU16Be(&reader);
+
+    // Event nodes go in the level arena, sized for them up front
+    if (!arenaCreate(&pMaze->_arena, eventCount * sizeof(tMazeEvent))) {
+        mazeDelete(pMaze);
+        return 0;
+    }
+    for (int i = 0; i < eventCount; i++) {
+        UBYTE header[4]; // x, y, type, payload size
+        binRead(&reader, header, 4);
+        UBYTE* payload = (UBYTE*)binReadInPlace(&reader, header[3]);
+        if (reader.isOverrun)
+            break;
+        tMazeEvent* event = (tMazeEvent*)arenaAlloc(&pMaze->_arena, sizeof(tMazeEvent));
+        if (!event)
+            break;
+        event->_x = header[0];
+        event->_y = header[1];
+        event->_eventType = header[2];
+        event->_eventDataSize = header[3];
+        event->_eventData = header[3] ? payload : NULL;
+        event->_flags = MAZE_EVENT_IN_ARENA;
+        mazeAppendEvent(pMaze, event);
+    }
+    // The string section stays where it is in the image; only the offsets are built
+    UWORD stringCount = binReadU16Be(&reader);
+    if (stringCount && !reader.isOverrun) {
+        pMaze->_stringOffsets = (ULONG*)memAllocFast(stringCount * sizeof(ULONG));
+        if (!pMaze->_stringOffsets) {
+            mazeDelete(pMaze);
+            return 0;
+        }
+        pMaze->_stringOffsetsCapacity = stringCount;
+        pMaze->_stringBlob = image + reader.pos;
+    }
+    for (int i = 0; i < stringCount && !reader.isOverrun; i++) {
+        UWORD length = binReadU16Be(&reader);
+        const UBYTE* text = binReadInPlace(&reader, length);
+        if (reader.isOverrun)
+            break;
+        pMaze->_stringOffsets[i] = (ULONG)(text - pMaze->_stringBlob);
+        pMaze->_stringBlobSize = pMaze->_stringOffsets[i] + length;
+        pMaze->_stringCount++;
+    }
+    if (reader.isOverrun)
+        logWrite("mazeLoad: %s is truncated\n", name);
+    LOAD_PROFILE_POP(buildMark);
+    LOAD_PROFILE_PUSH(verifyMark, "verify", NULL);
+    UWORD rejected = scriptVerifyMaze(pMaze);
+    LOAD_PROFILE_POP(verifyMark);
+    if (rejected)
+        logWrite("mazeLoad: %s has %u invalid script event(s)\n", name, (unsigned)rejected);
+    return pMaze;
+}
+
 tMaze* mazeLoad(const char* filename)
 {
-    
+    LOAD_PROFILE_PUSH(loadMark, "mazeLoad", filename);
+    tMaze* pMaze = 0;
+    ULONG stagedSize;
+    UBYTE* staged = levelPrefetchTake(filename, &stagedSize);
+    if (staged) {
+        pMaze = mazeLoadImage(staged, stagedSize, filename);
+        LOAD_PROFILE_POP(loadMark);
+        return pMaze;
+    }
+    LOAD_PROFILE_PUSH(openMark, "open", NULL);
     tFile* pFile = diskFileOpen(filename, DISK_FILE_MODE_READ, 1);
-    if (pFile)
-    {
-        UBYTE width = 0;
-        UBYTE height = 0;
-        UWORD eventCount = 0;
-        UWORD stringCount = 0;
-        fileRead(pFile, &width, 1);
-        fileRead(pFile, &height, 1);
-        tMaze* pMaze = mazeCreate(width, height);
-        fileRead(pFile, pMaze->_mazeData, width * height);
-        fileRead(pFile, pMaze->_mazeCol, width * height);
-        fileRead(pFile, pMaze->_mazeFloor, width * height);
-        eventCount = mazeReadU16Be(pFile);
-        
-        for (int i = 0; i < eventCount; i++) {
-            UBYTE x = 0;
-            UBYTE y = 0;
-            UBYTE eventType = 0;
-            UBYTE eventDataSize = 0;
-            UBYTE* eventData = NULL;
-            fileRead(pFile, &x, 1);
-            fileRead(pFile, &y, 1);
-            fileRead(pFile, &eventType, 1);
-            fileRead(pFile, &eventDataSize, 1);
-            if (eventDataSize > 0) {
-                eventData = (UBYTE*)memAllocFastClear(eventDataSize);
-                fileRead(pFile, eventData, eventDataSize);
-            }
-            tMazeEvent* event = mazeEventCreate(x, y, eventType, eventDataSize, eventData);
-            mazeAppendEvent(pMaze, event);
+    LOAD_PROFILE_POP(openMark);
+    if (pFile) {
+        // One allocation and one read for the whole file
+        fileSeek(pFile, 0, FILE_SEEK_END);
+        ULONG size = fileGetPos(pFile);
+        fileSeek(pFile, 0, FILE_SEEK_SET);
+        UBYTE* image = size ? (UBYTE*)memAllocFast(size) : 0;
+        if (image) {
+            LOAD_PROFILE_PUSH(readMark, "read", NULL);
+            ULONG got = fileRead(pFile, image, size);
+            fileClose(pFile);
+            LOAD_PROFILE_POP(readMark);
+            pMaze = mazeLoadImage(image, got, filename);
         }
-        stringCount = mazeReadU16Be(pFile);
-        for (int i = 0; i < stringCount; i++) {
-            UWORD length = 0;
-            UBYTE* string = 0;
-            length = mazeReadU16Be(pFile);
-            string = (UBYTE*)memAllocFastClear(length);
-            fileRead(pFile, string, length);
-            //tMazeString* mazeString = mazeStringCreate(length, string);
-            mazeAddString(pMaze, string, length);
-            memFree(string, length);
+        else {
+            fileClose(pFile);
+            logWrite("mazeLoad: can't buffer %s (%lu bytes)\n", filename, (unsigned long)size);
         }
-        fileClose(pFile);
-        return pMaze;
     }
-    return 0;
+    LOAD_PROFILE_POP(loadMark);
+    return pMaze;
+}
+
+tMaze* mazeLoadFromMemory(const UBYTE* data, ULONG size)
+{
+    if (!data || !size)
+        return 0;
+    LOAD_PROFILE_PUSH(loadMark, "mazeLoadFromMemory", NULL);
+    tMaze* pMaze = mazeLoadChunk(data, size);
+    LOAD_PROFILE_POP(loadMark);
+    return pMaze;
+}
+
+static tMaze* mazeLoadChunk(const UBYTE* data, ULONG size)
+{
+    // The source (a .pak buffer) goes away after loading, so the maze keeps its own copy
+    if (slzIsPacked(data, size)) {
+        ULONG rawSize = slzRawSize(data);
+        UBYTE* raw = (UBYTE*)memAllocFast(rawSize);
+        if (!raw)
+            return 0;
+        LOAD_PROFILE_PUSH(unpackMark, "decode", "slz");
+        UBYTE ok = slzUnpack(data, size, raw);
+        LOAD_PROFILE_POP(unpackMark);
+        if (!ok) {
+            memFree(raw, rawSize);
+            logWrite("mazeLoad: pak chunk fails to unpack\n");
+            return 0;
+        }
+        return mazeLoadImage(raw, rawSize, "pak chunk");
+    }
+    UBYTE* image = (UBYTE*)memAllocFast(size);
+    if (!image)
+        return 0;
+    memcpy(image, data, size);
+    return mazeLoadImage(image, size, "pak chunk");
 }
 
 void mazeSave(tMaze* pMaze, const char* sFilename)
@@ -192,12 +300,9 @@ void mazeSave(tMaze* pMaze, const char* sFilename)
             event = event->_next;   
         }
         mazeWriteU16Be(pFile, pMaze->_stringCount);
-        tMazeString* mazeString = pMaze->_strings;
-        while (mazeString != NULL) {
-            mazeWriteU16Be(pFile, mazeString->_length);
-            fileWrite(pFile, mazeString->_string, mazeString->_length);
-            mazeString = mazeString->_next;
-        }
+        // The blob is already the file's string section
+        if (pMaze->_stringBlobSize)
+            fileWrite(pFile, pMaze->_stringBlob, pMaze->_stringBlobSize);
         fileClose(pFile);
     }
 }
@@ -214,20 +319,57 @@ void mazeSetCell(tMaze* pMaze, UBYTE x, UBYTE y, UBYTE value)
     if (!pMaze || x >= pMaze->_width || y >= pMaze->_height)
         return;
     pMaze->_mazeData[x + y * pMaze->_width] = value;
+    partyFieldCellChanged(x, y);
+}
+
+static UBYTE mazeSeeThrough(const tMaze* pMaze, WORD x, WORD y)
+{
+    UBYTE c = pMaze->_mazeData[x + y * pMaze->_width];
+    return c == MAZE_FLOOR || c == MAZE_DOOR_OPEN || c == MAZE_EVENT_TRIGGER;
+}
+
+UBYTE mazeLineOfSight(const tMaze* pMaze, UBYTE x0, UBYTE y0, UBYTE x1, UBYTE y1)
+{
+    if (!pMaze || x0 >= pMaze->_width || y0 >= pMaze->_height || x1 >= pMaze->_width || y1 >= pMaze->_height)
+        return 0;
+    // Bresenham from cell to cell; the end cells themselves never block
+    WORD dx = (WORD)x1 - x0, dy = (WORD)y1 - y0;
+    WORD sx = dx < 0 ? -1 : 1, sy = dy < 0 ? -1 : 1;
+    if (dx < 0) dx = (WORD)-dx;
+    if (dy < 0) dy = (WORD)-dy;
+    WORD err = (WORD)(dx - dy);
+    WORD x = x0, y = y0;
+    while (x != x1 || y != y1) {
+        WORD e2 = (WORD)(2 * err);
+        UBYTE stepX = e2 > -dy, stepY = e2 < dx;
+        // A diagonal step does not squeeze between two solid corners
+        if (stepX && stepY && !mazeSeeThrough(pMaze, (WORD)(x + sx), y) && !mazeSeeThrough(pMaze, x, (WORD)(y + sy)))
+            return 0;
+        if (stepX) {
+            err = (WORD)(err - dy);
+            x = (WORD)(x + sx);
+        }
+        if (stepY) {
+            err = (WORD)(err + dx);
+            y = (WORD)(y + sy);
+        }
+        if ((x != x1 || y != y1) && !mazeSeeThrough(pMaze, x, y))
+            return 0;
+    }
+    return 1;
 }
 
 void mazeAppendEvent(tMaze* pMaze, tMazeEvent* newEvent) {
-    if (pMaze->_events == NULL) {
+    newEvent->_prev = pMaze->_lastEvent;
+    newEvent->_next = NULL;
+    if (pMaze->_lastEvent == NULL) {
         pMaze->_events = newEvent;
     } else {
-        tMazeEvent* lastEvent = pMaze->_events;
-        while (lastEvent->_next != NULL) {
-            lastEvent = lastEvent->_next;
-        }
-        lastEvent->_next = newEvent;
-        newEvent->_prev = lastEvent;
+        pMaze->_lastEvent->_next = newEvent;
     }
+    pMaze->_lastEvent = newEvent;
     pMaze->_eventCount++;
+    pMaze->_eventsVerified = 0;
 }
 
 tMazeEvent* mazeEventCreate(UBYTE x, UBYTE y, UBYTE eventType, UBYTE eventDataSize, UBYTE* eventData) {
@@ -237,10 +379,8 @@ tMazeEvent* mazeEventCreate(UBYTE x, UBYTE y, UBYTE eventType, UBYTE eventDataSi
     event->_eventType = eventType;
     event->_eventDataSize = eventDataSize;
     if (eventDataSize > 0 && eventData) {
-        event->_eventData = (UBYTE*) memAllocFastClear(eventDataSize * sizeof(UBYTE));
-        for (int i = 0; i < eventDataSize; i++) {
-            event->_eventData[i] = eventData[i];
-        }
+        event->_eventData = (UBYTE*) memAllocFast(eventDataSize * sizeof(UBYTE));
+        memcpy(event->_eventData, eventData, eventDataSize);
     } else {
         event->_eventData = NULL;
     }
@@ -250,19 +390,30 @@ tMazeEvent* mazeEventCreate(UBYTE x, UBYTE y, UBYTE eventType, UBYTE eventDataSi
 }
 
 void mazeRemoveEvent(tMaze* pMaze, tMazeEvent* event) {
+    // Events built for a single handleEvent() call were never appended; just free them
+    UBYTE attached = pMaze->_events == event || event->_prev != NULL;
     if (pMaze->_events == event) {
         pMaze->_events = event->_next;
     }
+    if (pMaze->_lastEvent == event) {
+        pMaze->_lastEvent = event->_prev;
+    }
     if (event->_prev != NULL) {
         event->_prev->_next = event->_next;
     }
     if (event->_next != NULL) {
         event->_next->_prev = event->_prev;
     }
-    if (event->_eventData)
-        memFree(event->_eventData, event->_eventDataSize);
-    memFree(event, sizeof(tMazeEvent));
-    pMaze->_eventCount--;
+    scriptConditionFree(event);
+    if (!(event->_flags & MAZE_EVENT_IN_ARENA)) {
+        if (event->_eventData)
+            memFree(event->_eventData, event->_eventDataSize);
+        memFree(event, sizeof(tMazeEvent));
+    }
+    if (attached) {
+        pMaze->_eventCount--;
+        pMaze->_eventsVerified = 0;
+    }
 }
 
 void mazeIterateEvents(tMaze* pMaze, void (*callback)(tMazeEvent*)) {
@@ -307,23 +458,37 @@ void mazeRemoveAllEvents(tMaze* pMaze) {
     tMazeEvent* currentEvent = pMaze->_events;
     while (currentEvent != NULL) {
         tMazeEvent* nextEvent = currentEvent->_next;
-        if (currentEvent->_eventData)
-            memFree(currentEvent->_eventData, currentEvent->_eventDataSize);
-        memFree(currentEvent, sizeof(tMazeEvent));
+        scriptConditionFree(currentEvent);
+        if (!(currentEvent->_flags & MAZE_EVENT_IN_ARENA)) {
+            if (currentEvent->_eventData)
+                memFree(currentEvent->_eventData, currentEvent->_eventDataSize);
+            memFree(currentEvent, sizeof(tMazeEvent));
+        }
         currentEvent = nextEvent;
     }
     pMaze->_events = NULL;
+    pMaze->_lastEvent = NULL;
     pMaze->_eventCount = 0;
+    pMaze->_eventsVerified = 0;
 }
 
 void mazeDelete(tMaze* pMaze) {
     // Remove all events
    mazeRemoveAllEvents(pMaze);
+    mazeRemoveStrings(pMaze);
+    while (pMaze->_doorAnims)
+        doorAnimRemove(pMaze, pMaze->_doorAnims);
+    // Loaded events and strings were only unlinked above; release their storage at once
+    arenaDestroy(&pMaze->_arena);
+    if (pMaze->_image)
+        memFree(pMaze->_image, pMaze->_imageSize);
+    mazeZonesDestroy(pMaze);
     
     // Free pMaze data
     memFree(pMaze->_mazeData, sizeof(UBYTE) * pMaze->_width * pMaze->_height);
     memFree(pMaze->_mazeCol,sizeof(UBYTE) * pMaze->_width * pMaze->_height);
     memFree(pMaze->_mazeFloor,sizeof(UBYTE) * pMaze->_width * pMaze->_height);
+    memFree(pMaze->_monsterCount,sizeof(UBYTE) * pMaze->_width * pMaze->_height);
     
     // Free pMaze struct
     memFree(pMaze, sizeof(tMaze));
@@ -333,55 +498,62 @@ void mazeAddString(tMaze* pMaze, char* string, UWORD length)
 {
     if (pMaze==NULL) return;
 
-    if (pMaze->_strings==NULL)
+    if (pMaze->_stringCount == pMaze->_stringOffsetsCapacity)
     {
-        pMaze->_strings=(tMazeString*)memAllocFastClear(sizeof(tMazeString));
-        pMaze->_strings->_string=(UBYTE*)memAllocFastClear(length);
-        pMaze->_strings->_length=length;
-        for (int i=0;i<length;i++)
-        {
-            pMaze->_strings->_string[i]=string[i];
-        }
-        pMaze->_strings->_next=NULL;
-        
+        UWORD capacity = pMaze->_stringOffsetsCapacity ? pMaze->_stringOffsetsCapacity * 2 : 16;
+        ULONG* offsets = (ULONG*)memAllocFast(capacity * sizeof(ULONG));
+        if (!offsets) return;
+        if (pMaze->_stringCount)
+            memcpy(offsets, pMaze->_stringOffsets, pMaze->_stringCount * sizeof(ULONG));
+        if (pMaze->_stringOffsets)
+            memFree(pMaze->_stringOffsets, pMaze->_stringOffsetsCapacity * sizeof(ULONG));
+        pMaze->_stringOffsets = offsets;
+        pMaze->_stringOffsetsCapacity = capacity;
     }
-    else
+    ULONG needed = pMaze->_stringBlobSize + 2 + length;
+    if (needed > pMaze->_stringBlobCapacity)
     {
-        tMazeString* lastString=pMaze->_strings;
-        while (lastString->_next!=NULL)
-        {
-            lastString=lastString->_next;
-        }
-        lastString->_next=(tMazeString*)memAllocFastClear(sizeof(tMazeString));
-        lastString->_next->_string=(UBYTE*)memAllocFastClear(length);
-        lastString->_next->_length=length;
-        for (int i=0;i<length;i++)
-        {
-            lastString->_next->_string[i]=string[i];
-        }
-        lastString->_next->_next=NULL;
-        
+        // Grows geometrically; a blob still in the loaded image is copied out here
+        ULONG capacity = pMaze->_stringBlobCapacity * 2;
+        if (capacity < needed) capacity = needed;
+        if (capacity < 256) capacity = 256;
+        UBYTE* blob = (UBYTE*)memAllocFast(capacity);
+        if (!blob) return;
+        if (pMaze->_stringBlobSize)
+            memcpy(blob, pMaze->_stringBlob, pMaze->_stringBlobSize);
+        if (pMaze->_stringBlobCapacity)
+            memFree(pMaze->_stringBlob, pMaze->_stringBlobCapacity);
+        pMaze->_stringBlob = blob;
+        pMaze->_stringBlobCapacity = capacity;
     }
+    UBYTE* at = pMaze->_stringBlob + pMaze->_stringBlobSize;
+    at[0] = (UBYTE)(length >> 8);
+    at[1] = (UBYTE)length;
+    memcpy(at + 2, string, length);
+    pMaze->_stringOffsets[pMaze->_stringCount++] = pMaze->_stringBlobSize + 2;
+    pMaze->_stringBlobSize = needed;
+}
 
-    pMaze->_stringCount++;
-
-
+const char* mazeGetString(tMaze* pMaze, UWORD index, UWORD* pLength)
+{
+    if (!pMaze || index >= pMaze->_stringCount)
+        return NULL;
+    const UBYTE* text = pMaze->_stringBlob + pMaze->_stringOffsets[index];
+    *pLength = (UWORD)((text[-2] << 8) | text[-1]);
+    return (const char*)text;
 }
 
 UBYTE mazeGetStringByIndex(tMaze* pMaze, UWORD index, char* buffer, UWORD bufferSize)
 {
-    if (!pMaze || !buffer || bufferSize == 0)
+    if (!buffer || bufferSize == 0)
         return 0;
-    tMazeString* s = pMaze->_strings;
-    for (UWORD i = 0; i < index && s != NULL; i++)
-        s = s->_next;
-    if (s == NULL)
+    UWORD copyLen;
+    const char* text = mazeGetString(pMaze, index, &copyLen);
+    if (text == NULL)
         return 0;
-    UWORD copyLen = s->_length;
     if (copyLen >= bufferSize)
         copyLen = bufferSize - 1;
-    for (UWORD i = 0; i < copyLen; i++)
-        buffer[i] = (char)s->_string[i];
+    memcpy(buffer, text, copyLen);
     buffer[copyLen] = '\0';
     return 1;
 }
@@ -389,11 +561,14 @@ UBYTE mazeGetStringByIndex(tMaze* pMaze, UWORD index, char* buffer, UWORD buffer
 void mazeRemoveStrings(tMaze* pMaze)
 {
     if (pMaze==NULL) return;
-    while (pMaze->_strings != NULL)
-    {
-        tMazeString* nextString=pMaze->_strings->_next;
-        memFree(pMaze->_strings->_string,pMaze->_strings->_length);
-        memFree(pMaze->_strings,sizeof(tMazeString));
-        pMaze->_strings=nextString;
-    }
+    if (pMaze->_stringBlobCapacity)
+        memFree(pMaze->_stringBlob, pMaze->_stringBlobCapacity);
+    if (pMaze->_stringOffsets)
+        memFree(pMaze->_stringOffsets, pMaze->_stringOffsetsCapacity * sizeof(ULONG));
+    pMaze->_stringBlob = NULL;
+    pMaze->_stringBlobSize = 0;
+    pMaze->_stringBlobCapacity = 0;
+    pMaze->_stringOffsets = NULL;
+    pMaze->_stringOffsetsCapacity = 0;
+    pMaze->_stringCount=0;
 }
\ No newline at end of file
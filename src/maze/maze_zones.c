@@ -0,0 +1,235 @@
+#include "maze_zones.h"
+#include <ace/managers/memory.h>
+#include <ace/managers/log.h>
+#include <string.h>
+
+// Zone pairs are deduplicated in a bit matrix while building
+#define MAZE_ZONE_LINK_BYTES ((MAZE_ZONE_MAX * MAZE_ZONE_MAX + 7) / 8)
+
+static UBYTE mazeZoneOpen(UBYTE c)
+{
+	return c == MAZE_FLOOR || c == MAZE_EVENT_TRIGGER;
+}
+
+static UBYTE mazeZoneDoor(UBYTE c)
+{
+	return c == MAZE_DOOR || c == MAZE_DOOR_OPEN || c == MAZE_DOOR_LOCKED;
+}
+
+static void mazeZoneLink(UBYTE *pPairs, UBYTE a, UBYTE b)
+{
+	if (a == b || a == MAZE_ZONE_NONE || b == MAZE_ZONE_NONE)
+		return;
+	if (a > b) {
+		UBYTE t = a;
+		a = b;
+		b = t;
+	}
+	UWORD bit = (UWORD)a * MAZE_ZONE_MAX + b;
+	pPairs[bit >> 3] |= (UBYTE)(1 << (bit & 7));
+}
+
+// Breadth-first over the open cells of one ubBlock square, from (x, y); pQueue holds a block
+static void mazeZoneFill(tMaze *pMaze, UBYTE *pCell, UWORD *pQueue, UBYTE ubBlock, UBYTE x, UBYTE y, UBYTE id)
+{
+	static const BYTE s_dx[4] = {0, 1, 0, -1};
+	static const BYTE s_dy[4] = {-1, 0, 1, 0};
+	UWORD uwQueued = 0;
+	UBYTE bx = (UBYTE)(x / ubBlock), by = (UBYTE)(y / ubBlock);
+	UWORD start = (UWORD)y * pMaze->_width + x;
+	pCell[start] = id;
+	pQueue[uwQueued++] = start;
+	for (UWORD head = 0; head < uwQueued; head++) {
+		UBYTE cx = (UBYTE)(pQueue[head] % pMaze->_width);
+		UBYTE cy = (UBYTE)(pQueue[head] / pMaze->_width);
+		for (UBYTE k = 0; k < 4; k++) {
+			WORD nx = (WORD)(cx + s_dx[k]), ny = (WORD)(cy + s_dy[k]);
+			if (nx < 0 || ny < 0 || nx >= pMaze->_width || ny >= pMaze->_height
+				|| nx / ubBlock != bx || ny / ubBlock != by)
+				continue;
+			UWORD n = (UWORD)ny * pMaze->_width + (UWORD)nx;
+			if (pCell[n] != MAZE_ZONE_NONE || !mazeZoneOpen(pMaze->_mazeData[n]))
+				continue;
+			pCell[n] = id;
+			pQueue[uwQueued++] = n;
+		}
+	}
+}
+
+void mazeZonesDestroy(tMaze *pMaze)
+{
+	tMazeZones *pZones = pMaze ? pMaze->_zones : NULL;
+	if (!pZones)
+		return;
+	memFree(pZones->pCell, (ULONG)pMaze->_width * pMaze->_height);
+	if (pZones->uwLinkCount)
+		memFree(pZones->pLinks, (ULONG)pZones->uwLinkCount * 2);
+	memFree(pZones, sizeof(tMazeZones));
+	pMaze->_zones = NULL;
+}
+
+UBYTE mazeZonesBuild(tMaze *pMaze)
+{
+	if (!pMaze)
+		return 0;
+	mazeZonesDestroy(pMaze);
+	UWORD w = pMaze->_width, h = pMaze->_height;
+	ULONG cells = (ULONG)w * h;
+	tMazeZones *pZones = (tMazeZones *)memAllocFastClear(sizeof(tMazeZones));
+	UBYTE *pPairs = (UBYTE *)memAllocFastClear(MAZE_ZONE_LINK_BYTES);
+	if (pZones)
+		pZones->pCell = (UBYTE *)memAllocFast(cells);
+	if (!pZones || !pZones->pCell || !pPairs) {
+		if (pZones && pZones->pCell)
+			memFree(pZones->pCell, cells);
+		if (pZones)
+			memFree(pZones, sizeof(tMazeZones));
+		if (pPairs)
+			memFree(pPairs, MAZE_ZONE_LINK_BYTES);
+		logWrite("mazeZonesBuild: out of memory\n");
+		return 0;
+	}
+	UBYTE *pCell = pZones->pCell;
+
+	// Rooms, cut at block edges. Too many for the ids: cut coarser blocks and start over
+	UBYTE ubBlock = MAZE_ZONE_BLOCK;
+	UBYTE isOverflow;
+	UBYTE isShared = 0;
+	do {
+		ULONG ulQueueSize = (ULONG)ubBlock * ubBlock * sizeof(UWORD);
+		UWORD *pQueue = (UWORD *)memAllocFast(ulQueueSize);
+		if (!pQueue) {
+			logWrite("mazeZonesBuild: out of memory\n");
+			memFree(pPairs, MAZE_ZONE_LINK_BYTES);
+			memFree(pCell, cells);
+			memFree(pZones, sizeof(tMazeZones));
+			return 0;
+		}
+		memset(pCell, MAZE_ZONE_NONE, cells);
+		pZones->ubCount = 0;
+		isOverflow = 0;
+		for (UWORD y = 0; y < h; y++) {
+			for (UWORD x = 0; x < w; x++) {
+				UWORD i = (UWORD)(y * w + x);
+				if (pCell[i] != MAZE_ZONE_NONE || !mazeZoneOpen(pMaze->_mazeData[i]))
+					continue;
+				if (pZones->ubCount == MAZE_ZONE_MAX && ubBlock < MAZE_ZONE_BLOCK_MAX) {
+					isOverflow = 1;
+					y = h;
+					break;
+				}
+				// At the largest block the rooms past the last id share it
+				UBYTE id = (UBYTE)(MAZE_ZONE_MAX - 1);
+				if (pZones->ubCount < MAZE_ZONE_MAX)
+					id = pZones->ubCount++;
+				else if (!isShared) {
+					isShared = 1;
+					logWrite("mazeZonesBuild: more than %u rooms, the rest share the last zone\n", (unsigned)MAZE_ZONE_MAX);
+				}
+				mazeZoneFill(pMaze, pCell, pQueue, ubBlock, (UBYTE)x, (UBYTE)y, id);
+			}
+		}
+		memFree(pQueue, ulQueueSize);
+		if (isOverflow)
+			ubBlock = (UBYTE)(ubBlock * 2);
+	} while (isOverflow);
+	pZones->ubBlock = ubBlock;
+
+	// Doors join the rooms around them; rooms meet at block edges
+	for (UWORD y = 0; y < h; y++) {
+		for (UWORD x = 0; x < w; x++) {
+			UWORD i = (UWORD)(y * w + x);
+			UBYTE c = pMaze->_mazeData[i];
+			if (mazeZoneDoor(c)) {
+				UBYTE pSides[4] = {
+					y > 0 ? pCell[i - w] : MAZE_ZONE_NONE,
+					x + 1 < w ? pCell[i + 1] : MAZE_ZONE_NONE,
+					y + 1 < h ? pCell[i + w] : MAZE_ZONE_NONE,
+					x > 0 ? pCell[i - 1] : MAZE_ZONE_NONE
+				};
+				// A door already passed lends its zone, so double doors chain
+				for (UBYTE a = 0; a < 4; a++) {
+					if (pCell[i] == MAZE_ZONE_NONE)
+						pCell[i] = pSides[a];
+					for (UBYTE b = (UBYTE)(a + 1); b < 4; b++)
+						mazeZoneLink(pPairs, pSides[a], pSides[b]);
+				}
+			}
+			else if (mazeZoneOpen(c)) {
+				if (x + 1 < w && mazeZoneOpen(pMaze->_mazeData[i + 1]))
+					mazeZoneLink(pPairs, pCell[i], pCell[i + 1]);
+				if (y + 1 < h && mazeZoneOpen(pMaze->_mazeData[i + w]))
+					mazeZoneLink(pPairs, pCell[i], pCell[i + w]);
+			}
+		}
+	}
+
+	UWORD uwLinks = 0;
+	for (UWORD i = 0; i < MAZE_ZONE_LINK_BYTES; i++)
+		for (UBYTE v = pPairs[i]; v; v &= (UBYTE)(v - 1))
+			uwLinks++;
+	if (uwLinks) {
+		pZones->pLinks = (UBYTE(*)[2])memAllocFast((ULONG)uwLinks * 2);
+		if (!pZones->pLinks) {
+			logWrite("mazeZonesBuild: no memory for %u links, zones act alone\n", (unsigned)uwLinks);
+			uwLinks = 0;
+		}
+	}
+	for (UWORD a = 0; a < pZones->ubCount && pZones->uwLinkCount < uwLinks; a++) {
+		for (UWORD b = (UWORD)(a + 1); b < pZones->ubCount; b++) {
+			UWORD bit = (UWORD)(a * MAZE_ZONE_MAX + b);
+			if (pPairs[bit >> 3] & (1 << (bit & 7))) {
+				pZones->pLinks[pZones->uwLinkCount][0] = (UBYTE)a;
+				pZones->pLinks[pZones->uwLinkCount][1] = (UBYTE)b;
+				pZones->uwLinkCount++;
+			}
+		}
+	}
+	memFree(pPairs, MAZE_ZONE_LINK_BYTES);
+
+	// Everything runs until the party is first placed
+	memset(pZones->pActive, 1, sizeof(pZones->pActive));
+	pZones->ubPartyZone = MAZE_ZONE_NONE;
+	pMaze->_zones = pZones;
+	logWrite("mazeZonesBuild: %u zones in %u-cell blocks, %u links\n", (unsigned)pZones->ubCount,
+		(unsigned)ubBlock, (unsigned)pZones->uwLinkCount);
+	return 1;
+}
+
+UBYTE mazeZoneAt(const tMaze *pMaze, UBYTE x, UBYTE y)
+{
+	if (!pMaze || !pMaze->_zones || x >= pMaze->_width || y >= pMaze->_height)
+		return MAZE_ZONE_NONE;
+	return pMaze->_zones->pCell[(UWORD)y * pMaze->_width + x];
+}
+
+void mazeZonesSetParty(tMaze *pMaze, UBYTE x, UBYTE y)
+{
+	tMazeZones *pZones = pMaze ? pMaze->_zones : NULL;
+	if (!pZones)
+		return;
+	UBYTE zone = mazeZoneAt(pMaze, x, y);
+	if (zone == pZones->ubPartyZone)
+		return;
+	pZones->ubPartyZone = zone;
+	if (zone == MAZE_ZONE_NONE) {
+		memset(pZones->pActive, 1, sizeof(pZones->pActive));
+		return;
+	}
+	memset(pZones->pActive, 0, sizeof(pZones->pActive));
+	pZones->pActive[MAZE_ZONE_NONE] = 1;
+	pZones->pActive[zone] = 1;
+	for (UWORD i = 0; i < pZones->uwLinkCount; i++) {
+		if (pZones->pLinks[i][0] == zone)
+			pZones->pActive[pZones->pLinks[i][1]] = 1;
+		else if (pZones->pLinks[i][1] == zone)
+			pZones->pActive[pZones->pLinks[i][0]] = 1;
+	}
+}
+
+UBYTE mazeZoneIsActive(const tMaze *pMaze, UBYTE x, UBYTE y)
+{
+	if (!pMaze || !pMaze->_zones)
+		return 1;
+	return pMaze->_zones->pActive[mazeZoneAt(pMaze, x, y)];
+}
@@ -0,0 +1,66 @@
+#include "arena.h"
+#include <ace/managers/memory.h>
+#include <ace/managers/log.h>
+
+// Pointer alignment: 4 bytes on the Amiga, which is what the 68020+ wants for longword access
+#define ARENA_ALIGN(n) (((n) + sizeof(void *) - 1) & ~(ULONG)(sizeof(void *) - 1))
+
+static tArenaBlock *arenaAddBlock(tArena *arena, ULONG size)
+{
+	size = ARENA_ALIGN(size);
+	tArenaBlock *block = (tArenaBlock *)memAllocFastClear(sizeof(tArenaBlock) + size);
+	if (!block) {
+		logWrite("arena: out of memory for %lu byte block\n", (unsigned long)size);
+		return NULL;
+	}
+	block->size = size;
+	block->next = arena->blocks;
+	arena->blocks = block;
+	return block;
+}
+
+UBYTE arenaCreate(tArena *arena, ULONG size)
+{
+	arena->blocks = NULL;
+	arena->allocCount = 0;
+	return arenaAddBlock(arena, size ? size : ARENA_MIN_BLOCK) != NULL;
+}
+
+void *arenaAlloc(tArena *arena, ULONG size)
+{
+	size = ARENA_ALIGN(size);
+	tArenaBlock *block = arena->blocks;
+	if (!block || block->used + size > block->size) {
+		// Grow geometrically so a badly sized first block costs a few extra blocks, not hundreds
+		ULONG grow = block ? block->size : ARENA_MIN_BLOCK;
+		if (grow < ARENA_MIN_BLOCK)
+			grow = ARENA_MIN_BLOCK;
+		block = arenaAddBlock(arena, size > grow ? size : grow);
+		if (!block)
+			return NULL;
+	}
+	void *p = (UBYTE *)(block + 1) + block->used;
+	block->used += size;
+	arena->allocCount++;
+	return p;
+}
+
+ULONG arenaUsed(const tArena *arena)
+{
+	ULONG used = 0;
+	for (const tArenaBlock *block = arena->blocks; block; block = block->next)
+		used += block->used;
+	return used;
+}
+
+void arenaDestroy(tArena *arena)
+{
+	tArenaBlock *block = arena->blocks;
+	while (block) {
+		tArenaBlock *next = block->next;
+		memFree(block, sizeof(tArenaBlock) + block->size);
+		block = next;
+	}
+	arena->blocks = NULL;
+	arena->allocCount = 0;
+}
@@ -0,0 +1,327 @@
+#include "asset_cache.h"
+#include "game_manifest.h"
+#include "load_profile.h"
+#include "level_prefetch.h"
+#include <ace/managers/memory.h>
+#include <ace/managers/log.h>
+#include <ace/utils/palette.h>
+#include <ace/utils/disk_file.h>
+#include <string.h>
+
+#ifdef ACE_USE_AGA_FEATURES
+#define ASSET_PALETTE_ENTRY sizeof(ULONG)
+#else
+#define ASSET_PALETTE_ENTRY sizeof(UWORD)
+#endif
+#define ASSET_PALETTE_BYTES (256 * ASSET_PALETTE_ENTRY)
+
+typedef enum {
+	ASSET_NONE,
+	ASSET_WALLSET,
+	ASSET_BITMAP,
+	ASSET_FONT,
+	ASSET_PALETTE,
+} tAssetType;
+
+typedef struct {
+	char path[GAME_MANIFEST_PATH_MAX];
+	UBYTE type;
+	UBYTE flags; // isFast for bitmaps
+	UWORD refs;
+	ULONG lastUse;
+	ULONG size;
+	ULONG chipSize; // Part of size in chip memory
+	void *data;
+} tAssetEntry;
+
+static tAssetEntry s_entries[ASSET_CACHE_MAX_ENTRIES];
+static ULONG s_clock;
+static tAssetCacheStats s_stats;
+
+static ULONG assetBitmapBytes(const tBitMap *bm)
+{
+	return bm ? (ULONG)bitmapGetByteWidth(bm) * bm->Rows * bm->Depth : 0;
+}
+
+static ULONG assetWallsetGfxBytes(const tWallset *ws)
+{
+	ULONG size = 0;
+	for (UWORD i = 0; i < ws->_gfxCount; i++)
+		size += assetBitmapBytes(ws->_gfx[i]) + assetBitmapBytes(ws->_mask[i]);
+	return size;
+}
+
+static ULONG assetWallsetBytes(const tWallset *ws)
+{
+	return sizeof(tWallset) + ws->_tilesetCount * (sizeof(tWallGfx) + sizeof(tWallGfx *))
+		+ assetWallsetGfxBytes(ws);
+}
+
+// Wallset and font bitmaps are created in chip; plain bitmaps unless loaded to fast
+static ULONG assetChipBytes(UBYTE type, UBYTE flags, const void *data)
+{
+	switch (type) {
+		case ASSET_WALLSET: return assetWallsetGfxBytes((const tWallset *)data);
+		case ASSET_BITMAP: return flags ? 0 : assetBitmapBytes((const tBitMap *)data);
+		case ASSET_FONT: return assetBitmapBytes(((const tFont *)data)->pRawData);
+	}
+	return 0;
+}
+
+static UBYTE assetIsChip(UBYTE type, UBYTE flags)
+{
+	return type == ASSET_WALLSET || type == ASSET_FONT || (type == ASSET_BITMAP && !flags);
+}
+
+static void assetDestroy(UBYTE type, void *data)
+{
+	switch (type) {
+		case ASSET_WALLSET: wallsetDestroy((tWallset *)data); break;
+		case ASSET_BITMAP: bitmapDestroy((tBitMap *)data); break;
+		case ASSET_FONT: fontDestroy((tFont *)data); break;
+		case ASSET_PALETTE: memFree(data, ASSET_PALETTE_BYTES); break;
+	}
+}
+
+static void assetEvict(tAssetEntry *e)
+{
+	logWrite("asset: evicting '%s' (%lu bytes)\n", e->path, (unsigned long)e->size);
+	assetDestroy(e->type, e->data);
+	s_stats.ulIdleBytes -= e->size;
+	s_stats.ulIdleChipBytes -= e->chipSize;
+	s_stats.ulEvictions++;
+	s_stats.ubEntries--;
+	e->type = ASSET_NONE;
+	e->data = NULL;
+}
+
+// isChip: only assets holding chip memory
+static tAssetEntry *assetOldestIdle(UBYTE isChip)
+{
+	tAssetEntry *oldest = NULL;
+	for (UBYTE i = 0; i < ASSET_CACHE_MAX_ENTRIES; i++) {
+		tAssetEntry *e = &s_entries[i];
+		if (e->type != ASSET_NONE && !e->refs && (!isChip || e->chipSize)
+			&& (!oldest || e->lastUse < oldest->lastUse))
+			oldest = e;
+	}
+	return oldest;
+}
+
+static void assetTrimIdle(void)
+{
+	tAssetEntry *e;
+	while (s_stats.ulIdleBytes > ASSET_CACHE_IDLE_BUDGET && (e = assetOldestIdle(0)))
+		assetEvict(e);
+	while (s_stats.ulIdleChipBytes > ASSET_CACHE_IDLE_CHIP_BUDGET && (e = assetOldestIdle(1)))
+		assetEvict(e);
+}
+
+static tAssetEntry *assetFind(UBYTE type, const char *path, UBYTE flags)
+{
+	for (UBYTE i = 0; i < ASSET_CACHE_MAX_ENTRIES; i++) {
+		tAssetEntry *e = &s_entries[i];
+		if (e->type == type && e->flags == flags && strcmp(e->path, path) == 0)
+			return e;
+	}
+	return NULL;
+}
+
+static tAssetEntry *assetFindData(UBYTE type, const void *data)
+{
+	for (UBYTE i = 0; i < ASSET_CACHE_MAX_ENTRIES; i++) {
+		if (s_entries[i].type == type && s_entries[i].data == data)
+			return &s_entries[i];
+	}
+	return NULL;
+}
+
+static void *assetLoad(UBYTE type, const char *path, UBYTE flags, const tPak *pPak)
+{
+	switch (type) {
+		case ASSET_WALLSET:
+			return pPak ? wallsetLoadFromPak(pPak) : wallsetLoad(path);
+		case ASSET_BITMAP: {
+			LOAD_PROFILE_PUSH(bitmapMark, "bitmap", path);
+			tBitMap *bitmap = bitmapCreateFromPath(path, flags);
+			LOAD_PROFILE_POP(bitmapMark);
+			return bitmap;
+		}
+		case ASSET_FONT:
+			return fontCreateFromPath(path);
+		case ASSET_PALETTE: {
+			if (!diskFileExists(path))
+				return NULL;
+			void *palette = memAllocFastClear(ASSET_PALETTE_BYTES);
+			if (palette)
+				paletteLoadFromPath(path, palette, 255);
+			return palette;
+		}
+	}
+	return NULL;
+}
+
+static ULONG assetBytes(UBYTE type, const void *data)
+{
+	switch (type) {
+		case ASSET_WALLSET: return assetWallsetBytes((const tWallset *)data);
+		case ASSET_BITMAP: return assetBitmapBytes((const tBitMap *)data);
+		case ASSET_FONT: return assetBitmapBytes(((const tFont *)data)->pRawData);
+		case ASSET_PALETTE: return ASSET_PALETTE_BYTES;
+	}
+	return 0;
+}
+
+// Hit: take a reference. Miss: load (making room first), then record it if a slot is free.
+static void *assetGet(UBYTE type, const char *path, UBYTE flags, const tPak *pPak, UBYTE takeRef)
+{
+	if (!path || !path[0] || strlen(path) >= GAME_MANIFEST_PATH_MAX)
+		return assetLoad(type, path, flags, pPak);
+	s_clock++;
+	tAssetEntry *e = assetFind(type, path, flags);
+	if (e) {
+		if (takeRef && !e->refs++) {
+			s_stats.ulIdleBytes -= e->size;
+			s_stats.ulIdleChipBytes -= e->chipSize;
+		}
+		e->lastUse = s_clock;
+		s_stats.ulHits++;
+		return e->data;
+	}
+	s_stats.ulMisses++;
+	assetCacheTrim(ASSET_CACHE_RESERVE);
+	if (assetIsChip(type, flags))
+		assetCacheTrimChip(ASSET_CACHE_CHIP_RESERVE);
+	void *data = assetLoad(type, path, flags, pPak);
+	if (!data && s_stats.ulIdleBytes) {
+		assetCacheFlush();
+		data = assetLoad(type, path, flags, pPak);
+	}
+	if (!data)
+		return NULL;
+
+	for (UBYTE i = 0; i < ASSET_CACHE_MAX_ENTRIES && !e; i++) {
+		if (s_entries[i].type == ASSET_NONE)
+			e = &s_entries[i];
+	}
+	if (!e && (e = assetOldestIdle(0)))
+		assetEvict(e);
+	if (!e) {
+		// Every slot is referenced: hand it out uncached, Release destroys it
+		logWrite("asset: table full, '%s' not cached\n", path);
+		return data;
+	}
+	strcpy(e->path, path);
+	e->type = type;
+	e->flags = flags;
+	e->refs = takeRef;
+	e->lastUse = s_clock;
+	e->size = assetBytes(type, data);
+	e->chipSize = assetChipBytes(type, flags, data);
+	e->data = data;
+	s_stats.ubEntries++;
+	if (!takeRef) {
+		s_stats.ulIdleBytes += e->size;
+		s_stats.ulIdleChipBytes += e->chipSize;
+		assetTrimIdle();
+	}
+	return data;
+}
+
+static void assetRelease(UBYTE type, void *data)
+{
+	if (!data)
+		return;
+	tAssetEntry *e = assetFindData(type, data);
+	if (!e) {
+		assetDestroy(type, data);
+		return;
+	}
+	if (!e->refs) {
+		logWrite("ERR: asset '%s' released more often than taken\n", e->path);
+		return;
+	}
+	if (--e->refs)
+		return;
+	s_stats.ulIdleBytes += e->size;
+	s_stats.ulIdleChipBytes += e->chipSize;
+	assetTrimIdle();
+}
+
+tWallset *assetWallsetGet(const char *path)
+{
+	return (tWallset *)assetGet(ASSET_WALLSET, path, 0, NULL, 1);
+}
+
+tWallset *assetWallsetGetFromPak(const tPak *pPak, const char *pakPath)
+{
+	return (tWallset *)assetGet(ASSET_WALLSET, pakPath, 0, pPak, 1);
+}
+
+void assetWallsetRelease(tWallset *pWallset)
+{
+	assetRelease(ASSET_WALLSET, pWallset);
+}
+
+tBitMap *assetBitmapGet(const char *path, UBYTE isFast)
+{
+	return (tBitMap *)assetGet(ASSET_BITMAP, path, isFast, NULL, 1);
+}
+
+void assetBitmapRelease(tBitMap *pBitmap)
+{
+	assetRelease(ASSET_BITMAP, pBitmap);
+}
+
+tFont *assetFontGet(const char *path)
+{
+	return (tFont *)assetGet(ASSET_FONT, path, 0, NULL, 1);
+}
+
+void assetFontRelease(tFont *pFont)
+{
+	assetRelease(ASSET_FONT, pFont);
+}
+
+UBYTE assetPaletteLoad(const char *path, void *pPalette, UBYTE ubMaxLength)
+{
+	// Palettes are copied out, so the cached copy is never referenced
+	void *cached = assetGet(ASSET_PALETTE, path, 0, NULL, 0);
+	if (!cached)
+		return 0;
+	memcpy(pPalette, cached, ubMaxLength * ASSET_PALETTE_ENTRY);
+	if (!assetFindData(ASSET_PALETTE, cached))
+		memFree(cached, ASSET_PALETTE_BYTES);
+	return 1;
+}
+
+void assetCacheTrim(ULONG ulFree)
+{
+	tAssetEntry *e;
+	// Staged levels are a guess; give them up before assets that are known to be wanted again
+	if (memGetFreeSize() < ulFree && levelPrefetchStagedBytes())
+		levelPrefetchCancel();
+	while (memGetFreeSize() < ulFree && (e = assetOldestIdle(0)))
+		assetEvict(e);
+}
+
+void assetCacheTrimChip(ULONG ulChipFree)
+{
+	tAssetEntry *e;
+	if (memGetFreeChipSize() < ulChipFree && levelPrefetchStagedBytes())
+		levelPrefetchCancel();
+	while (memGetFreeChipSize() < ulChipFree && (e = assetOldestIdle(1)))
+		assetEvict(e);
+}
+
+void assetCacheFlush(void)
+{
+	tAssetEntry *e;
+	while ((e = assetOldestIdle(0)))
+		assetEvict(e);
+}
+
+void assetCacheGetStats(tAssetCacheStats *pStats)
+{
+	*pStats = s_stats;
+}
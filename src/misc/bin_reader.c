@@ -0,0 +1,167 @@
+#include "bin_reader.h"
+#include "level_prefetch.h"
+#include <ace/managers/memory.h>
+#include <ace/utils/disk_file.h>
+#include <string.h>
+
+UBYTE binReaderOpen(tBinReader *reader, const char *path)
+{
+	binReaderInitMemory(reader, NULL, 0);
+	// Prefetched during play: read from RAM, and free the image on close
+	ULONG stagedSize;
+	UBYTE *staged = levelPrefetchTake(path, &stagedSize);
+	if (staged) {
+		binReaderInitMemory(reader, staged, stagedSize);
+		reader->buffer = staged;
+		reader->bufferSize = stagedSize;
+		return 1;
+	}
+	tFile *file = diskFileOpen(path, DISK_FILE_MODE_READ, 1);
+	if (!file)
+		return 0;
+	fileSeek(file, 0, FILE_SEEK_END);
+	ULONG fileSize = fileGetPos(file);
+	fileSeek(file, 0, FILE_SEEK_SET);
+	// A small file fits whole: its first refill is the only read
+	ULONG bufferSize = fileSize < BIN_READER_BUFFER_SIZE ? fileSize : BIN_READER_BUFFER_SIZE;
+	if (bufferSize) {
+		reader->buffer = (UBYTE *)memAllocFast(bufferSize);
+		if (!reader->buffer) {
+			fileClose(file);
+			return 0;
+		}
+	}
+	reader->file = file;
+	reader->data = reader->buffer;
+	reader->bufferSize = bufferSize;
+	reader->fileLeft = fileSize;
+	return 1;
+}
+
+void binReaderClose(tBinReader *reader)
+{
+	if (reader->buffer)
+		memFree(reader->buffer, reader->bufferSize);
+	if (reader->file)
+		fileClose(reader->file);
+	reader->buffer = NULL;
+	reader->file = NULL;
+	reader->data = NULL;
+	reader->size = reader->pos = 0;
+}
+
+void binReaderInitMemory(tBinReader *reader, const void *data, ULONG size)
+{
+	reader->file = NULL;
+	reader->data = (const UBYTE *)data;
+	reader->size = size;
+	reader->pos = 0;
+	reader->buffer = NULL;
+	reader->bufferSize = 0;
+	reader->fileLeft = 0;
+	reader->isOverrun = 0;
+}
+
+// Keep the unread tail of the buffer, then top it up from the file
+static void binRefill(tBinReader *reader)
+{
+	ULONG keep = reader->size - reader->pos;
+	memmove(reader->buffer, reader->buffer + reader->pos, keep);
+	ULONG want = reader->bufferSize - keep;
+	if (want > reader->fileLeft)
+		want = reader->fileLeft;
+	ULONG got = want ? fileRead(reader->file, reader->buffer + keep, want) : 0;
+	reader->fileLeft = got == want ? reader->fileLeft - got : 0;
+	reader->pos = 0;
+	reader->size = keep + got;
+}
+
+ULONG binRead(tBinReader *reader, void *dest, ULONG size)
+{
+	UBYTE *out = (UBYTE *)dest;
+	ULONG got = 0;
+	while (got < size) {
+		ULONG avail = reader->size - reader->pos;
+		if (avail) {
+			ULONG step = size - got < avail ? size - got : avail;
+			memcpy(out + got, reader->data + reader->pos, step);
+			reader->pos += step;
+			got += step;
+			continue;
+		}
+		if (!reader->file || !reader->fileLeft)
+			break;
+		ULONG rest = size - got;
+		if (rest >= reader->bufferSize) {
+			// Bigger than the buffer: straight into dest (e.g. a chip RAM plane)
+			ULONG want = rest < reader->fileLeft ? rest : reader->fileLeft;
+			ULONG direct = fileRead(reader->file, out + got, want);
+			reader->fileLeft = direct == want ? reader->fileLeft - direct : 0;
+			got += direct;
+			if (direct != want)
+				break;
+		}
+		else {
+			binRefill(reader);
+		}
+	}
+	if (got < size) {
+		memset(out + got, 0, size - got);
+		reader->isOverrun = 1;
+	}
+	return got;
+}
+
+void binSkip(tBinReader *reader, ULONG size)
+{
+	ULONG avail = reader->size - reader->pos;
+	ULONG step = size < avail ? size : avail;
+	reader->pos += step;
+	size -= step;
+	if (!size)
+		return;
+	if (!reader->file || size > reader->fileLeft) {
+		reader->pos = reader->size;
+		reader->fileLeft = 0;
+		reader->isOverrun = 1;
+		return;
+	}
+	fileSeek(reader->file, (LONG)size, FILE_SEEK_CURRENT);
+	reader->fileLeft -= size;
+}
+
+const void *binReadInPlace(tBinReader *reader, ULONG size)
+{
+	if (reader->file && size > reader->size - reader->pos && size <= reader->bufferSize)
+		binRefill(reader);
+	if (size > reader->size - reader->pos) {
+		reader->isOverrun = 1;
+		return NULL;
+	}
+	const UBYTE *at = reader->data + reader->pos;
+	reader->pos += size;
+	return at;
+}
+
+UBYTE binReadU8(tBinReader *reader)
+{
+	if (reader->pos < reader->size)
+		return reader->data[reader->pos++];
+	UBYTE b;
+	binRead(reader, &b, 1);
+	return b;
+}
+
+UWORD binReadU16Be(tBinReader *reader)
+{
+	UBYTE b[2];
+	binRead(reader, b, 2);
+	return ((UWORD)b[0] << 8) | (UWORD)b[1];
+}
+
+ULONG binReadU32Be(tBinReader *reader)
+{
+	UBYTE b[4];
+	binRead(reader, b, 4);
+	return ((ULONG)b[0] << 24) | ((ULONG)b[1] << 16) | ((ULONG)b[2] << 8) | (ULONG)b[3];
+}
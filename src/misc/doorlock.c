@@ -1,6 +1,7 @@
 #include "doorlock.h"
 #include "inventory.h"
 #include "item.h"
+#include "save_journal.h"
 #include <ace/managers/memory.h>
 #include <ace/managers/log.h>
 
@@ -155,6 +156,7 @@ void doorLockLock(tDoorLock* pLock)
     if (pLock && pLock->_state != DOORLOCK_STATE_BROKEN)
     {
         pLock->_state = DOORLOCK_STATE_LOCKED;
+        saveJournalDoorLock(pLock->_doorX, pLock->_doorY, pLock->_state);
     }
 }
 
@@ -163,6 +165,7 @@ void doorLockUnlock(tDoorLock* pLock)
     if (pLock)
     {
         pLock->_state = DOORLOCK_STATE_UNLOCKED;
+        saveJournalDoorLock(pLock->_doorX, pLock->_doorY, pLock->_state);
     }
 }
 
@@ -0,0 +1,185 @@
+#include "encounter.h"
+#include "script.h"
+#include <ace/managers/log.h>
+#include <string.h>
+
+static void encounterDropDormant(tEncounterList *list, const tEncounter *e)
+{
+	for (UBYTE i = e->first; i < e->first + e->count; i++) {
+		if (list->pDormant[i]) {
+			monsterDestroy(list->pDormant[i]);
+			list->pDormant[i] = NULL;
+		}
+	}
+}
+
+// Returns 0 if the pool could not supply every member
+static UBYTE encounterArm(tEncounterList *list, tEncounter *e)
+{
+	UBYTE ok = 1;
+	for (UBYTE i = e->first; i < e->first + e->count; i++) {
+		if (list->pDormant[i])
+			continue;
+		list->pDormant[i] = monsterCreate(list->spawns[i].type);
+		if (!list->pDormant[i]) {
+			logWrite("encounter %u: no monster record for member %u\n", (unsigned)e->id,
+				(unsigned)(i - e->first));
+			ok = 0;
+		}
+	}
+	e->isFired = 0;
+	return ok;
+}
+
+// Returns 0 if the pool could not supply the monster
+static UBYTE encounterArmSpawn(tEncounterList *list, UBYTE i)
+{
+	list->spawnsTaken &= (UWORD)~(1 << i);
+	if (!list->pEventDormant[i])
+		list->pEventDormant[i] = monsterCreate(list->eventSpawns[i].type);
+	return list->pEventDormant[i] ? 1 : 0;
+}
+
+static void encounterDropSpawn(tEncounterList *list, UBYTE i)
+{
+	list->spawnsTaken |= (UWORD)(1 << i);
+	if (list->pEventDormant[i]) {
+		monsterDestroy(list->pEventDormant[i]);
+		list->pEventDormant[i] = NULL;
+	}
+}
+
+void encounterListClear(tEncounterList *list)
+{
+	if (!list)
+		return;
+	for (UBYTE i = 0; i < list->count; i++)
+		encounterDropDormant(list, &list->encounters[i]);
+	for (UBYTE i = 0; i < list->spawnCount; i++)
+		encounterDropSpawn(list, i);
+	memset(list, 0, sizeof(*list));
+}
+
+UBYTE encounterAdd(tEncounterList *list, UBYTE id, UBYTE ubCount, const UBYTE *pMembers)
+{
+	if (!list || list->index[id] || list->count >= ENCOUNTERS_MAX
+		|| ubCount > MONSTER_DORMANT_MAX - list->memberCount - list->spawnCount) {
+		logWrite("encounterAdd: cannot add encounter %u (%u members)\n", (unsigned)id, (unsigned)ubCount);
+		return 0;
+	}
+	tEncounter *e = &list->encounters[list->count];
+	e->id = id;
+	e->first = list->memberCount;
+	e->count = ubCount;
+	for (UBYTE i = 0; i < ubCount; i++, pMembers += 3) {
+		tEncounterSpawn *s = &list->spawns[e->first + i];
+		s->type = pMembers[0];
+		s->x = pMembers[1];
+		s->y = pMembers[2];
+	}
+	list->memberCount = (UBYTE)(list->memberCount + ubCount);
+	list->index[id] = ++list->count;
+	encounterArm(list, e);
+	return 1;
+}
+
+UBYTE encounterTrigger(tEncounterList *list, tMaze *pMaze, tMonsterList *pMonsters, UBYTE id)
+{
+	if (!list || !list->index[id])
+		return 0;
+	tEncounter *e = &list->encounters[list->index[id] - 1];
+	if (e->isFired)
+		return 0;
+	e->isFired = 1;
+	for (UBYTE i = e->first; i < e->first + e->count; i++) {
+		tMonster *m = list->pDormant[i];
+		if (!m)
+			continue;
+		list->pDormant[i] = NULL;
+		if (!monsterListAppend(pMonsters, m)) {
+			logWrite("encounter %u: monster list full, member %u dropped\n", (unsigned)id,
+				(unsigned)(i - e->first));
+			monsterDestroy(m);
+			continue;
+		}
+		monsterPlaceInMaze(pMaze, m, list->spawns[i].x, list->spawns[i].y);
+	}
+	return 1;
+}
+
+void encounterAddMazeSpawns(tEncounterList *list, const tMaze *pMaze)
+{
+	if (!list || !pMaze)
+		return;
+	for (const tMazeEvent *e = pMaze->_events; e; e = e->_next) {
+		if (e->_eventType != EVENT_ADDMONSTER || e->_eventDataSize < 3 || (e->_flags & MAZE_EVENT_INVALID))
+			continue;
+		if (list->spawnCount == ENCOUNTER_SPAWNS_MAX
+			|| list->memberCount + list->spawnCount == MONSTER_DORMANT_MAX) {
+			logWrite("encounter: no dormant monster for ADD_MONSTER at (%u,%u), made when it runs\n",
+				(unsigned)e->_x, (unsigned)e->_y);
+			continue;
+		}
+		UBYTE i = list->spawnCount++;
+		list->eventSpawns[i].type = e->_eventData[0];
+		list->eventSpawns[i].x = e->_eventData[1];
+		list->eventSpawns[i].y = e->_eventData[2];
+		encounterArmSpawn(list, i);
+	}
+}
+
+tMonster *encounterSpawn(tEncounterList *list, tMaze *pMaze, tMonsterList *pMonsters, UBYTE ubType, UBYTE x, UBYTE y)
+{
+	tMonster *m = NULL;
+	for (UBYTE i = 0; list && i < list->spawnCount; i++) {
+		const tEncounterSpawn *s = &list->eventSpawns[i];
+		if (!(list->spawnsTaken & (1 << i)) && s->type == ubType && s->x == x && s->y == y) {
+			list->spawnsTaken |= (UWORD)(1 << i);
+			m = list->pEventDormant[i];
+			list->pEventDormant[i] = NULL;
+			if (m)
+				break;
+		}
+	}
+	if (!m)
+		m = monsterCreate(ubType);
+	if (!m)
+		return NULL;
+	if (!monsterListAppend(pMonsters, m)) {
+		monsterDestroy(m);
+		return NULL;
+	}
+	monsterPlaceInMaze(pMaze, m, x, y);
+	return m;
+}
+
+ULONG encounterFiredMask(const tEncounterList *list)
+{
+	ULONG mask = (ULONG)list->spawnsTaken << 16;
+	for (UBYTE i = 0; i < list->count; i++) {
+		if (list->encounters[i].isFired)
+			mask |= (ULONG)1 << i;
+	}
+	return mask;
+}
+
+UBYTE encounterRearm(tEncounterList *list, ULONG ulFired)
+{
+	UBYTE ok = 1;
+	for (UBYTE i = 0; i < list->count; i++) {
+		tEncounter *e = &list->encounters[i];
+		if (ulFired & ((ULONG)1 << i)) {
+			encounterDropDormant(list, e);
+			e->isFired = 1;
+		}
+		else if (!encounterArm(list, e))
+			ok = 0;
+	}
+	for (UBYTE i = 0; i < list->spawnCount; i++) {
+		if (ulFired & ((ULONG)1 << (16 + i)))
+			encounterDropSpawn(list, i);
+		else if (!encounterArmSpawn(list, i))
+			ok = 0;
+	}
+	return ok;
+}
@@ -1,4 +1,5 @@
 #include "ground_item.h"
+#include "save_journal.h"
 #include <string.h>
 
 void groundItemListClear(tGroundItemList *list)
@@ -13,6 +14,7 @@ UBYTE groundItemAdd(tGroundItemList *list, UBYTE x, UBYTE y, UBYTE itemIdx, UBYT
 {
 	if (!list || qty == 0 || list->count >= GROUND_ITEMS_MAX)
 		return 0;
+	saveJournalGround(x, y, itemIdx, qty);
 	for (UBYTE i = 0; i < list->count; i++) {
 		if (list->items[i].x == x && list->items[i].y == y && list->items[i].itemIdx == itemIdx) {
 			list->items[i].qty += qty;
@@ -37,8 +39,10 @@ UBYTE groundItemRemoveAt(tGroundItemList *list, UBYTE x, UBYTE y, UBYTE itemIdx,
 			continue;
 		if (list->items[i].qty > qty) {
 			list->items[i].qty -= qty;
+			saveJournalGround(x, y, itemIdx, -(WORD)qty);
 			return 1;
 		}
+		saveJournalGround(x, y, itemIdx, -(WORD)list->items[i].qty);
 		for (UBYTE j = i; j < list->count - 1; j++)
 			list->items[j] = list->items[j + 1];
 		list->count--;
@@ -46,3 +50,15 @@ UBYTE groundItemRemoveAt(tGroundItemList *list, UBYTE x, UBYTE y, UBYTE itemIdx,
 	}
 	return 0;
 }
+
+UBYTE groundItemQtyAt(const tGroundItemList *list, UBYTE x, UBYTE y)
+{
+	if (!list)
+		return 0;
+	UWORD total = 0;
+	for (UBYTE i = 0; i < list->count; i++) {
+		if (list->items[i].x == x && list->items[i].y == y)
+			total += list->items[i].qty;
+	}
+	return total > 255 ? 255 : (UBYTE)total;
+}
@@ -0,0 +1,354 @@
+#include "input.h"
+#include "rng.h"
+#include "bin_reader.h"
+#include <ace/managers/key.h>
+#include <ace/managers/mouse.h>
+#include <ace/managers/joy.h>
+#include <ace/managers/memory.h>
+#include <ace/managers/timer.h>
+#include <ace/managers/log.h>
+#include <ace/utils/disk_file.h>
+#include <string.h>
+
+// Keys the game states read; others read as up. At most 32
+static const UBYTE s_pKeys[] = {
+	KEY_ESCAPE, KEY_F, KEY_P, KEY_W, KEY_UP, KEY_S, KEY_DOWN, KEY_A, KEY_LEFT,
+	KEY_D, KEY_RIGHT, KEY_Q, KEY_HELP, KEY_E, KEY_DEL,
+	KEY_F1, KEY_F2, KEY_F3, KEY_F4, KEY_F5, KEY_F6, KEY_F7, KEY_F9,
+};
+#define INPUT_KEY_COUNT (sizeof(s_pKeys) / sizeof(s_pKeys[0]))
+
+// Bytes per run in a file: keys, x, y, buttons, repeat
+#define INPUT_RUN_SIZE 10
+// Runs written per fileWrite()
+#define INPUT_WRITE_BATCH 64
+
+static tInputFrame s_sFrame;
+static ULONG s_ulUsedKeys;     // Held keys already taken by inputKeyUse()
+static UBYTE s_ubUsedButtons;
+
+static tInputMode s_eMode = INPUT_LIVE;
+static tInputFrame *s_pRuns;
+static UWORD s_uwRunCapacity;
+static UWORD s_uwRunCount;
+static UWORD s_uwRunPos;       // Replay: run being played
+static UBYTE s_ubRunFrame;     // Replay: frames of it played
+static UBYTE s_isFullLogged;
+static ULONG s_pRngStart[RNG_STREAM_COUNT];
+static ULONG s_ulFrames;
+static ULONG s_ulPrecLast;
+static ULONG s_ulPrecTotal;
+static ULONG s_ulPrecWorst;
+
+static ULONG inputKeyBit(UBYTE ubKey)
+{
+	for (UBYTE i = 0; i < INPUT_KEY_COUNT; i++) {
+		if (s_pKeys[i] == ubKey)
+			return 1UL << i;
+	}
+	return 0;
+}
+
+static UBYTE inputMouseBit(UBYTE ubButton)
+{
+	if (ubButton == MOUSE_LMB)
+		return INPUT_BUTTON_LMB;
+	return ubButton == MOUSE_RMB ? INPUT_BUTTON_RMB : 0;
+}
+
+static void inputSampleLive(tInputFrame *pFrame)
+{
+	pFrame->ulKeys = 0;
+	for (UBYTE i = 0; i < INPUT_KEY_COUNT; i++) {
+		if (keyCheck(s_pKeys[i]))
+			pFrame->ulKeys |= 1UL << i;
+	}
+	pFrame->uwMouseX = mouseGetX(MOUSE_PORT_1);
+	pFrame->uwMouseY = mouseGetY(MOUSE_PORT_1);
+	pFrame->ubButtons = 0;
+	if (mouseCheck(MOUSE_PORT_1, MOUSE_LMB))
+		pFrame->ubButtons |= INPUT_BUTTON_LMB;
+	if (mouseCheck(MOUSE_PORT_1, MOUSE_RMB))
+		pFrame->ubButtons |= INPUT_BUTTON_RMB;
+	if (joyCheck(JOY1 + JOY_FIRE))
+		pFrame->ubButtons |= INPUT_BUTTON_FIRE1;
+	if (joyCheck(JOY2 + JOY_FIRE))
+		pFrame->ubButtons |= INPUT_BUTTON_FIRE2;
+	pFrame->ubRepeat = 0;
+}
+
+static UBYTE inputSameFrame(const tInputFrame *a, const tInputFrame *b)
+{
+	return a->ulKeys == b->ulKeys && a->uwMouseX == b->uwMouseX && a->uwMouseY == b->uwMouseY
+		&& a->ubButtons == b->ubButtons;
+}
+
+static void inputRecordFrame(const tInputFrame *pFrame)
+{
+	tInputFrame *pLast = s_uwRunCount ? &s_pRuns[s_uwRunCount - 1] : NULL;
+	if (pLast && pLast->ubRepeat < 255 && inputSameFrame(pLast, pFrame)) {
+		pLast->ubRepeat++;
+		return;
+	}
+	if (s_uwRunCount >= s_uwRunCapacity) {
+		if (!s_isFullLogged)
+			logWrite("ERR: input record full after %lu frames, the rest is not recorded\n",
+				(unsigned long)s_ulFrames);
+		s_isFullLogged = 1;
+		return;
+	}
+	s_pRuns[s_uwRunCount++] = *pFrame;
+}
+
+// Returns 0 once every run has been played
+static UBYTE inputReplayFrame(tInputFrame *pFrame)
+{
+	if (s_uwRunPos >= s_uwRunCount)
+		return 0;
+	*pFrame = s_pRuns[s_uwRunPos];
+	if (s_ubRunFrame++ == pFrame->ubRepeat) {
+		s_uwRunPos++;
+		s_ubRunFrame = 0;
+	}
+	return 1;
+}
+
+void inputProcess(void)
+{
+	tInputFrame sNext;
+	if (s_eMode == INPUT_REPLAYING && !inputReplayFrame(&sNext))
+		inputRecordStop(NULL);
+	if (s_eMode != INPUT_REPLAYING)
+		inputSampleLive(&sNext);
+	if (s_eMode == INPUT_RECORDING)
+		inputRecordFrame(&sNext);
+
+	// A released key or button can be used again
+	s_ulUsedKeys &= sNext.ulKeys;
+	s_ubUsedButtons &= sNext.ubButtons;
+	s_sFrame = sNext;
+
+	if (s_eMode != INPUT_LIVE) {
+		ULONG ulNow = timerGetPrec();
+		if (s_ulFrames) {
+			ULONG ulDelta = timerGetDelta(s_ulPrecLast, ulNow);
+			s_ulPrecTotal += ulDelta;
+			if (ulDelta > s_ulPrecWorst)
+				s_ulPrecWorst = ulDelta;
+		}
+		s_ulPrecLast = ulNow;
+		s_ulFrames++;
+	}
+}
+
+UBYTE inputKeyCheck(UBYTE ubKey)
+{
+	return (s_sFrame.ulKeys & inputKeyBit(ubKey)) ? 1 : 0;
+}
+
+UBYTE inputKeyUse(UBYTE ubKey)
+{
+	ULONG ulBit = inputKeyBit(ubKey);
+	if (!(s_sFrame.ulKeys & ulBit) || (s_ulUsedKeys & ulBit))
+		return 0;
+	s_ulUsedKeys |= ulBit;
+	return 1;
+}
+
+UBYTE inputMouseCheck(UBYTE ubButton)
+{
+	return (s_sFrame.ubButtons & inputMouseBit(ubButton)) ? 1 : 0;
+}
+
+UBYTE inputMouseUse(UBYTE ubButton)
+{
+	UBYTE ubBit = inputMouseBit(ubButton);
+	if (!(s_sFrame.ubButtons & ubBit) || (s_ubUsedButtons & ubBit))
+		return 0;
+	s_ubUsedButtons |= ubBit;
+	return 1;
+}
+
+UWORD inputMouseX(void)
+{
+	return s_sFrame.uwMouseX;
+}
+
+UWORD inputMouseY(void)
+{
+	return s_sFrame.uwMouseY;
+}
+
+UBYTE inputMouseInRect(tUwRect sRect)
+{
+	return s_sFrame.uwMouseX >= sRect.uwX && s_sFrame.uwMouseX < sRect.uwX + sRect.uwWidth
+		&& s_sFrame.uwMouseY >= sRect.uwY && s_sFrame.uwMouseY < sRect.uwY + sRect.uwHeight;
+}
+
+UBYTE inputJoyUse(UBYTE ubJoy)
+{
+	UBYTE ubBit = ubJoy == JOY1 + JOY_FIRE ? INPUT_BUTTON_FIRE1
+		: ubJoy == JOY2 + JOY_FIRE ? INPUT_BUTTON_FIRE2 : 0;
+	if (!(s_sFrame.ubButtons & ubBit) || (s_ubUsedButtons & ubBit))
+		return 0;
+	s_ubUsedButtons |= ubBit;
+	return 1;
+}
+
+static void inputSessionBegin(tInputMode eMode)
+{
+	s_eMode = eMode;
+	s_uwRunPos = 0;
+	s_ubRunFrame = 0;
+	s_isFullLogged = 0;
+	s_ulFrames = 0;
+	s_ulPrecTotal = 0;
+	s_ulPrecWorst = 0;
+}
+
+static void inputFreeRuns(void)
+{
+	if (s_pRuns)
+		memFree(s_pRuns, (ULONG)s_uwRunCapacity * sizeof(tInputFrame));
+	s_pRuns = NULL;
+	s_uwRunCapacity = 0;
+	s_uwRunCount = 0;
+}
+
+UBYTE inputRecordStart(void)
+{
+	inputRecordStop(NULL);
+	s_pRuns = (tInputFrame *)memAllocFast((ULONG)INPUT_RECORD_MAX_RUNS * sizeof(tInputFrame));
+	if (!s_pRuns) {
+		logWrite("ERR: no memory to record input\n");
+		return 0;
+	}
+	s_uwRunCapacity = INPUT_RECORD_MAX_RUNS;
+	for (UBYTE i = 0; i < RNG_STREAM_COUNT; i++)
+		s_pRngStart[i] = rngStateGet((tRngStream)i);
+	inputSessionBegin(INPUT_RECORDING);
+	logWrite("Recording input\n");
+	return 1;
+}
+
+static void inputPutLong(UBYTE *p, ULONG ul)
+{
+	p[0] = (UBYTE)(ul >> 24);
+	p[1] = (UBYTE)(ul >> 16);
+	p[2] = (UBYTE)(ul >> 8);
+	p[3] = (UBYTE)ul;
+}
+
+static UBYTE inputWrite(const char *szPath)
+{
+	tFile *pFile = diskFileOpen(szPath, DISK_FILE_MODE_WRITE, 1);
+	if (!pFile) {
+		logWrite("ERR: cannot write input record %s\n", szPath);
+		return 0;
+	}
+	UBYTE pBuf[INPUT_WRITE_BATCH * INPUT_RUN_SIZE];
+	UBYTE *p = pBuf;
+	memcpy(p, INPUT_RECORD_MAGIC, 4);
+	p[4] = INPUT_RECORD_VERSION;
+	p[5] = RNG_STREAM_COUNT;
+	p += 6;
+	for (UBYTE i = 0; i < RNG_STREAM_COUNT; i++, p += 4)
+		inputPutLong(p, s_pRngStart[i]);
+	p[0] = (UBYTE)(s_uwRunCount >> 8);
+	p[1] = (UBYTE)s_uwRunCount;
+	p += 2;
+	fileWrite(pFile, pBuf, (ULONG)(p - pBuf));
+	for (UWORD i = 0; i < s_uwRunCount;) {
+		p = pBuf;
+		for (UBYTE n = 0; n < INPUT_WRITE_BATCH && i < s_uwRunCount; n++, i++, p += INPUT_RUN_SIZE) {
+			const tInputFrame *r = &s_pRuns[i];
+			inputPutLong(p, r->ulKeys);
+			p[4] = (UBYTE)(r->uwMouseX >> 8);
+			p[5] = (UBYTE)r->uwMouseX;
+			p[6] = (UBYTE)(r->uwMouseY >> 8);
+			p[7] = (UBYTE)r->uwMouseY;
+			p[8] = r->ubButtons;
+			p[9] = r->ubRepeat;
+		}
+		fileWrite(pFile, pBuf, (ULONG)(p - pBuf));
+	}
+	fileClose(pFile);
+	return 1;
+}
+
+UBYTE inputRecordStop(const char *szPath)
+{
+	if (s_eMode == INPUT_LIVE)
+		return 1;
+	char szMean[32], szWorst[32];
+	ULONG ulTimed = s_ulFrames > 1 ? s_ulFrames - 1 : 1;
+	timerFormatPrec(szMean, s_ulPrecTotal / ulTimed);
+	timerFormatPrec(szWorst, s_ulPrecWorst);
+	logWrite("Input %s: %lu frames, %s mean, %s worst\n",
+		s_eMode == INPUT_RECORDING ? "record" : "replay", (unsigned long)s_ulFrames, szMean, szWorst);
+	UBYTE ok = 1;
+	if (s_eMode == INPUT_RECORDING && szPath)
+		ok = inputWrite(szPath);
+	inputFreeRuns();
+	s_eMode = INPUT_LIVE;
+	return ok;
+}
+
+UBYTE inputReplayStart(const char *szPath)
+{
+	inputRecordStop(NULL);
+	tBinReader sReader;
+	if (!binReaderOpen(&sReader, szPath))
+		return 0;
+	char pMagic[4];
+	binRead(&sReader, pMagic, 4);
+	UBYTE ubVersion = binReadU8(&sReader);
+	UBYTE ubStreams = binReadU8(&sReader);
+	if (memcmp(pMagic, INPUT_RECORD_MAGIC, 4) || ubVersion != INPUT_RECORD_VERSION
+		|| ubStreams != RNG_STREAM_COUNT) {
+		logWrite("ERR: %s is not an input record this build can play\n", szPath);
+		binReaderClose(&sReader);
+		return 0;
+	}
+	for (UBYTE i = 0; i < RNG_STREAM_COUNT; i++)
+		s_pRngStart[i] = binReadU32Be(&sReader);
+	UWORD uwRuns = binReadU16Be(&sReader);
+	if (uwRuns > INPUT_RECORD_MAX_RUNS
+		|| (uwRuns && !(s_pRuns = (tInputFrame *)memAllocFast((ULONG)uwRuns * sizeof(tInputFrame))))) {
+		logWrite("ERR: cannot load %u input runs from %s\n", (unsigned)uwRuns, szPath);
+		binReaderClose(&sReader);
+		return 0;
+	}
+	s_uwRunCapacity = uwRuns;
+	for (UWORD i = 0; i < uwRuns; i++) {
+		tInputFrame *r = &s_pRuns[i];
+		r->ulKeys = binReadU32Be(&sReader);
+		r->uwMouseX = binReadU16Be(&sReader);
+		r->uwMouseY = binReadU16Be(&sReader);
+		r->ubButtons = binReadU8(&sReader);
+		r->ubRepeat = binReadU8(&sReader);
+	}
+	UBYTE isOverrun = sReader.isOverrun;
+	binReaderClose(&sReader);
+	if (isOverrun) {
+		logWrite("ERR: input record %s is truncated\n", szPath);
+		inputFreeRuns();
+		return 0;
+	}
+	s_uwRunCount = uwRuns;
+	for (UBYTE i = 0; i < RNG_STREAM_COUNT; i++)
+		rngStateSet((tRngStream)i, s_pRngStart[i]);
+	inputSessionBegin(INPUT_REPLAYING);
+	logWrite("Replaying %u input runs from %s\n", (unsigned)uwRuns, szPath);
+	return 1;
+}
+
+tInputMode inputModeGet(void)
+{
+	return s_eMode;
+}
+
+ULONG inputFrameCount(void)
+{
+	return s_ulFrames;
+}
@@ -5,6 +5,7 @@
 #include <ace/managers/mouse.h>
 
 #include "mouse_pointer.h"
+#include "input.h"
 #include "screen.h"
 
 #define REGION_HASH_SIZE 32
@@ -62,20 +63,20 @@ void layerUpdate(Layer* pLayer)
 
     if (
         !pLayer->ubIsEnabled ||
-        (!pLayer->ubUpdateOutsideBounds && !mouseInRect(MOUSE_PORT_1, pLayer->bounds)))
+        (!pLayer->ubUpdateOutsideBounds && !inputMouseInRect(pLayer->bounds)))
     {
         return;
     }
 
     // Cache all mouse state at the start
-    UBYTE ubMousePressedLeft = mouseCheck(MOUSE_PORT_1, MOUSE_LMB);
-    UBYTE ubMousePressedRight = mouseCheck(MOUSE_PORT_1, MOUSE_RMB);
+    UBYTE ubMousePressedLeft = inputMouseCheck(MOUSE_LMB);
+    UBYTE ubMousePressedRight = inputMouseCheck(MOUSE_RMB);
     UBYTE ubMousePressed = ubMousePressedLeft || ubMousePressedRight;
     mouse_pointer_t mousePointerId = MOUSE_POINTER;
     
     // Cache mouse position
-    UWORD uwMouseX = mouseGetX(MOUSE_PORT_1);
-    UWORD uwMouseY = mouseGetY(MOUSE_PORT_1);
+    UWORD uwMouseX = inputMouseX();
+    UWORD uwMouseY = inputMouseY();
 
     // Update bounds if dirty
     if (pLayer->ubBoundsDirty)
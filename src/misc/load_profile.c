@@ -0,0 +1,117 @@
+#include "load_profile.h"
+#include <ace/managers/log.h>
+#include <ace/managers/system.h>
+#include <ace/managers/timer.h>
+#include <ace/utils/disk_file.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+	const char *label;
+	char detail[LOAD_PROFILE_DETAIL_MAX];
+	UBYTE depth;
+	UBYTE isOpen;
+	ULONG start;
+	ULONG elapsed;
+} tLoadMark;
+
+static tLoadMark s_marks[LOAD_PROFILE_MAX_MARKS];
+static UBYTE s_markCount;
+static UBYTE s_depth;
+static UBYTE s_isActive;
+
+static UBYTE loadProfileOpen(const char *label, const char *detail)
+{
+	tLoadMark *m = &s_marks[s_markCount];
+	m->label = label;
+	m->detail[0] = '\0';
+	if (detail) {
+		// Keep the tail of long paths: the file name is the useful part
+		size_t len = strlen(detail);
+		if (len >= LOAD_PROFILE_DETAIL_MAX)
+			detail += len - (LOAD_PROFILE_DETAIL_MAX - 1);
+		strcpy(m->detail, detail);
+	}
+	m->depth = s_depth++;
+	m->isOpen = 1;
+	m->elapsed = 0;
+	m->start = timerGetPrec();
+	return s_markCount++;
+}
+
+void loadProfileBegin(const char *szName, const char *szDetail)
+{
+	s_markCount = 0;
+	s_depth = 0;
+	s_isActive = 1;
+	loadProfileOpen(szName, szDetail);
+}
+
+UBYTE loadProfilePush(const char *szLabel, const char *szDetail)
+{
+	if (!s_isActive || s_markCount >= LOAD_PROFILE_MAX_MARKS)
+		return 0xFF;
+	return loadProfileOpen(szLabel, szDetail);
+}
+
+void loadProfilePop(UBYTE ubMark)
+{
+	if (!s_isActive || ubMark >= s_markCount)
+		return;
+	ULONG now = timerGetPrec();
+	for (UBYTE i = ubMark; i < s_markCount; i++) {
+		if (s_marks[i].isOpen) {
+			s_marks[i].elapsed = timerGetDelta(s_marks[i].start, now);
+			s_marks[i].isOpen = 0;
+		}
+	}
+	s_depth = s_marks[ubMark].depth;
+}
+
+void loadProfileEnd(const char *szFile)
+{
+	if (!s_isActive)
+		return;
+	loadProfilePop(0);
+	s_isActive = 0;
+	ULONG total = s_marks[0].elapsed ? s_marks[0].elapsed : 1;
+
+	systemUse();
+	tFile *pFile = szFile ? diskFileOpen(szFile, DISK_FILE_MODE_APPEND, 1) : NULL;
+	for (UBYTE i = 0; i < s_markCount; i++) {
+		const tLoadMark *m = &s_marks[i];
+		char time[24];
+		char line[24 + 2 * 16 + LOAD_PROFILE_DETAIL_MAX + 48];
+		timerFormatPrec(time, m->elapsed);
+		UBYTE indent = m->depth < 16 ? m->depth : 16;
+		// Percent of the session without 64-bit maths on the 68k
+		ULONG percent = m->elapsed < 0xFFFFFFFFUL / 100 ? m->elapsed * 100 / total : m->elapsed / (total / 100);
+		sprintf(line, "%*s%s%s%s  %s  %lu%%\n", indent * 2, "", m->label, m->detail[0] ? " " : "",
+			m->detail, time, (unsigned long)percent);
+		logWrite("%s", line);
+		if (pFile)
+			fileWrite(pFile, line, strlen(line));
+	}
+	if (s_markCount >= LOAD_PROFILE_MAX_MARKS)
+		logWrite("load profile: marker table full, later phases not shown\n");
+	if (pFile) {
+		fileWrite(pFile, "\n", 1);
+		fileClose(pFile);
+	}
+	systemUnuse();
+}
+
+UBYTE loadProfileMarkCount(void)
+{
+	return s_markCount;
+}
+
+UBYTE loadProfileMarkGet(UBYTE ubMark, const char **pLabel, UBYTE *pDepth, ULONG *pElapsed)
+{
+	if (ubMark >= s_markCount)
+		return 0;
+	*pLabel = s_marks[ubMark].label;
+	*pDepth = s_marks[ubMark].depth;
+	*pElapsed = s_marks[ubMark].elapsed;
+	return 1;
+}
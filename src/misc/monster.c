@@ -3,8 +3,13 @@
 #include <ace/managers/memory.h>
 #include <ace/managers/system.h>
 #include <ace/managers/log.h>
-#include <ace/utils/disk_file.h>
-#include <ace/utils/file.h>
+#include "bin_reader.h"
+#include "load_profile.h"
+#include "save_journal.h"
+#include "party_field.h"
+#include "maze_zones.h"
+#include "rng.h"
+#include <ace/managers/timer.h>
 #include <string.h>
 
 #define MONSTER_DEF_MAX 64
@@ -26,18 +31,15 @@ typedef struct {
 static tMonsterDef s_defs[MONSTER_DEF_MAX];
 static UBYTE s_defCount;
 
-// Simple random number generator (LCG)
-static ULONG s_randSeed = 1;
-static UBYTE simpleRand(void)
+// Drop rolls, 0-99
+static UBYTE monsterLootRoll(void)
 {
-	s_randSeed = (s_randSeed * 1103515245 + 12345) & 0x7fffffff;
-	return (UBYTE)(s_randSeed % 100);
+	return (UBYTE)(rngNext(RNG_LOOT) % 100);
 }
 
-static UBYTE simpleRandByte(void)
+static UBYTE monsterAiRand(void)
 {
-	s_randSeed = (s_randSeed * 1103515245 + 12345) & 0x7fffffff;
-	return (UBYTE)s_randSeed;
+	return (UBYTE)rngNext(RNG_AI);
 }
 
 static UBYTE monsterManhattan(UBYTE ax, UBYTE ay, UBYTE bx, UBYTE by)
@@ -66,24 +68,21 @@ static UBYTE monsterCellWalkable(const tMaze *maze, UBYTE x, UBYTE y)
 	}
 }
 
-static UBYTE monsterCellBlockedByOther(const tMonsterList *list, UBYTE x, UBYTE y,
-	const tMonster *self)
+/** Move a monster and keep maze->_monsterCount in step (only while it is counted). */
+static void monsterSetPos(tMaze *maze, tMonster *self, UBYTE x, UBYTE y)
 {
-	if (!list)
-		return 0;
-	for (UBYTE i = 0; i < list->_numMonsters; ++i) {
-		tMonster *o = list->_monsters[i];
-		if (!o || o == self || o->_state == MONSTER_STATE_DEAD)
-			continue;
-		if (o->_partyPosX == x && o->_partyPosY == y)
-			return 1;
+	if (self->_inMaze) {
+		UWORD from = (UWORD)self->_partyPosY * maze->_width + self->_partyPosX;
+		if (maze->_monsterCount[from])
+			maze->_monsterCount[from]--;
+		maze->_monsterCount[(UWORD)y * maze->_width + x]++;
 	}
-	return 0;
+	self->_partyPosX = x;
+	self->_partyPosY = y;
 }
 
 /** One step in map space; party tile is allowed (for melee). */
-static UBYTE monsterTryStepDir(tMaze *maze, tMonster *self, const tMonsterList *list,
-	BYTE sdx, BYTE sdy)
+static UBYTE monsterTryStepDir(tMaze *maze, tMonster *self, BYTE sdx, BYTE sdy)
 {
 	WORD nx = (WORD)self->_partyPosX + (WORD)sdx;
 	WORD ny = (WORD)self->_partyPosY + (WORD)sdy;
@@ -95,24 +94,24 @@ static UBYTE monsterTryStepDir(tMaze *maze, tMonster *self, const tMonsterList *
 	UBYTE uy = (UBYTE)ny;
 	if (!monsterCellWalkable(maze, ux, uy))
 		return 0;
-	if (monsterCellBlockedByOther(list, ux, uy, self))
+	// self is never on the target cell, so any count there is another monster
+	if (maze->_monsterCount[(UWORD)uy * maze->_width + ux])
 		return 0;
-	self->_partyPosX = ux;
-	self->_partyPosY = uy;
+	monsterSetPos(maze, self, ux, uy);
 	return 1;
 }
 
 static void monsterShuffle4(UBYTE *order)
 {
 	for (UBYTE i = 3; i > 0; --i) {
-		UBYTE j = (UBYTE)(simpleRandByte() % (i + 1));
+		UBYTE j = (UBYTE)(monsterAiRand() % (i + 1));
 		UBYTE t = order[i];
 		order[i] = order[j];
 		order[j] = t;
 	}
 }
 
-static void monsterWander(tMaze *maze, tMonster *self, const tMonsterList *list)
+static void monsterWander(tMaze *maze, tMonster *self)
 {
 	static const BYTE s_dx[4] = {0, 1, 0, -1};
 	static const BYTE s_dy[4] = {-1, 0, 1, 0};
@@ -120,13 +119,13 @@ static void monsterWander(tMaze *maze, tMonster *self, const tMonsterList *list)
 	monsterShuffle4(order);
 	for (UBYTE k = 0; k < 4; ++k) {
 		UBYTE oi = order[k];
-		if (monsterTryStepDir(maze, self, list, s_dx[oi], s_dy[oi]))
+		if (monsterTryStepDir(maze, self, s_dx[oi], s_dy[oi]))
 			return;
 	}
 }
 
-static void monsterMoveChase(tMaze *maze, tMonster *self, const tMonsterList *list,
-	tCharacterParty *party)
+/** Greedy by straight-line distance; for monsters outside the party field. */
+static void monsterMoveChaseGreedy(tMaze *maze, tMonster *self, tCharacterParty *party)
 {
 	WORD mdx = (WORD)party->_PartyX - (WORD)self->_partyPosX;
 	WORD mdy = (WORD)party->_PartyY - (WORD)self->_partyPosY;
@@ -136,14 +135,14 @@ static void monsterMoveChase(tMaze *maze, tMonster *self, const tMonsterList *li
 	WORD adx = mdx < 0 ? (WORD)-mdx : mdx;
 	WORD ady = mdy < 0 ? (WORD)-mdy : mdy;
 	if (adx >= ady) {
-		if (mdx != 0 && monsterTryStepDir(maze, self, list, (BYTE)(mdx > 0 ? 1 : -1), 0))
+		if (mdx != 0 && monsterTryStepDir(maze, self, (BYTE)(mdx > 0 ? 1 : -1), 0))
 			return;
-		if (mdy != 0 && monsterTryStepDir(maze, self, list, 0, (BYTE)(mdy > 0 ? 1 : -1)))
+		if (mdy != 0 && monsterTryStepDir(maze, self, 0, (BYTE)(mdy > 0 ? 1 : -1)))
 			return;
 	} else {
-		if (mdy != 0 && monsterTryStepDir(maze, self, list, 0, (BYTE)(mdy > 0 ? 1 : -1)))
+		if (mdy != 0 && monsterTryStepDir(maze, self, 0, (BYTE)(mdy > 0 ? 1 : -1)))
 			return;
-		if (mdx != 0 && monsterTryStepDir(maze, self, list, (BYTE)(mdx > 0 ? 1 : -1), 0))
+		if (mdx != 0 && monsterTryStepDir(maze, self, (BYTE)(mdx > 0 ? 1 : -1), 0))
 			return;
 	}
 
@@ -157,19 +156,17 @@ static void monsterMoveChase(tMaze *maze, tMonster *self, const tMonsterList *li
 		UBYTE oi = order[k];
 		UBYTE sx = self->_partyPosX;
 		UBYTE sy = self->_partyPosY;
-		if (!monsterTryStepDir(maze, self, list, s_dx[oi], s_dy[oi]))
+		if (!monsterTryStepDir(maze, self, s_dx[oi], s_dy[oi]))
 			continue;
 		if (monsterManhattan(self->_partyPosX, self->_partyPosY,
 				party->_PartyX, party->_PartyY) < start)
 			return;
-		self->_partyPosX = sx;
-		self->_partyPosY = sy;
+		monsterSetPos(maze, self, sx, sy);
 	}
-	monsterWander(maze, self, list);
+	monsterWander(maze, self);
 }
 
-static void monsterMoveFlee(tMaze *maze, tMonster *self, const tMonsterList *list,
-	tCharacterParty *party)
+static void monsterMoveFleeGreedy(tMaze *maze, tMonster *self, tCharacterParty *party)
 {
 	UBYTE start = monsterManhattan(self->_partyPosX, self->_partyPosY,
 		party->_PartyX, party->_PartyY);
@@ -181,22 +178,96 @@ static void monsterMoveFlee(tMaze *maze, tMonster *self, const tMonsterList *lis
 		UBYTE oi = order[k];
 		UBYTE sx = self->_partyPosX;
 		UBYTE sy = self->_partyPosY;
-		if (!monsterTryStepDir(maze, self, list, s_dx[oi], s_dy[oi]))
+		if (!monsterTryStepDir(maze, self, s_dx[oi], s_dy[oi]))
 			continue;
 		if (monsterManhattan(self->_partyPosX, self->_partyPosY,
 				party->_PartyX, party->_PartyY) > start)
 			return;
-		self->_partyPosX = sx;
-		self->_partyPosY = sy;
+		monsterSetPos(maze, self, sx, sy);
 	}
-	monsterWander(maze, self, list);
+	monsterWander(maze, self);
 }
 
-static UWORD readU16Be(tFile *f)
+/**
+ * Step down the party field (chasing) or up it (fleeing), best neighbour
+ * first; equal ones in random order. 0 if no neighbour improves or all that
+ * do are taken, and the monster waits.
+ */
+static UBYTE monsterStepField(tMaze *maze, tMonster *self, UBYTE isFlee)
 {
-	UBYTE b[2];
-	fileRead(f, b, 2);
-	return ((UWORD)b[0] << 8) | (UWORD)b[1];
+	static const BYTE s_dx[4] = {0, 1, 0, -1};
+	static const BYTE s_dy[4] = {-1, 0, 1, 0};
+	UBYTE here = partyFieldAt(self->_partyPosX, self->_partyPosY);
+	UBYTE order[4] = {0, 1, 2, 3};
+	UBYTE dir[4];
+	UBYTE dist[4];
+	UBYTE count = 0;
+	monsterShuffle4(order);
+	for (UBYTE k = 0; k < 4; ++k) {
+		UBYTE oi = order[k];
+		UBYTE d = partyFieldAt((UBYTE)(self->_partyPosX + s_dx[oi]), (UBYTE)(self->_partyPosY + s_dy[oi]));
+		if (isFlee ? d <= here : d >= here)
+			continue;
+		// Insertion sort keeps the shuffled order among equals
+		UBYTE j = count++;
+		while (j > 0 && (isFlee ? d > dist[j - 1] : d < dist[j - 1])) {
+			dist[j] = dist[j - 1];
+			dir[j] = dir[j - 1];
+			--j;
+		}
+		dist[j] = d;
+		dir[j] = oi;
+	}
+	for (UBYTE k = 0; k < count; ++k) {
+		if (monsterTryStepDir(maze, self, s_dx[dir[k]], s_dy[dir[k]]))
+			return 1;
+	}
+	return 0;
+}
+
+static void monsterMoveChase(tMaze *maze, tMonster *self, tCharacterParty *party)
+{
+	UBYTE here = partyFieldAt(self->_partyPosX, self->_partyPosY);
+	if (here == PARTY_FIELD_FAR)
+		monsterMoveChaseGreedy(maze, self, party);
+	else if (here)
+		monsterStepField(maze, self, 0);
+}
+
+static void monsterMoveFlee(tMaze *maze, tMonster *self, tCharacterParty *party)
+{
+	if (partyFieldAt(self->_partyPosX, self->_partyPosY) == PARTY_FIELD_FAR)
+		monsterMoveFleeGreedy(maze, self, party);
+	else
+		monsterStepField(maze, self, 1);
+}
+
+// Every monster record, hot and cold halves at the same index; free ones chained through s_poolNext
+#define MONSTER_POOL_END 0xFF
+#define MONSTER_POOL_TAKEN 0xFE  // s_poolNext of a record handed out
+static tMonster s_pool[MONSTER_POOL_SIZE];
+static tMonsterCold s_poolCold[MONSTER_POOL_SIZE];
+static UBYTE s_poolNext[MONSTER_POOL_SIZE];
+static UBYTE s_poolFree = MONSTER_POOL_END;
+static UBYTE s_poolUsed;
+static UBYTE s_poolFresh;  // Records from here on were never handed out
+
+static tMonster *monsterPoolTake(void)
+{
+	UBYTE slot;
+	if (s_poolFree != MONSTER_POOL_END) {
+		slot = s_poolFree;
+		s_poolFree = s_poolNext[slot];
+	} else if (s_poolFresh < MONSTER_POOL_SIZE) {
+		slot = s_poolFresh++;
+	} else {
+		return NULL;
+	}
+	s_poolNext[slot] = MONSTER_POOL_TAKEN;
+	s_poolUsed++;
+	memset(&s_pool[slot], 0, sizeof(tMonster));
+	memset(&s_poolCold[slot], 0, sizeof(tMonsterCold));
+	return &s_pool[slot];
 }
 
 static void monsterApplyDef(tMonster *m, UBYTE typeId, const tMonsterDef *d)
@@ -208,12 +279,13 @@ static void monsterApplyDef(tMonster *m, UBYTE typeId, const tMonsterDef *d)
 	m->_base._HP = d->uwMaxHP;
 	m->_base._Attack = d->ubAttack;
 	m->_base._Defense = d->ubDefense;
-	m->_experienceValue = d->uwExperience;
 	m->_aggroRange = d->ubAggroRange;
 	m->_fleeThreshold = d->ubFleeThreshold;
+	tMonsterCold *cold = monsterCold(m);
+	cold->_experienceValue = d->uwExperience;
 	for (int i = 0; i < 8; i++) {
-		m->_dropTable[i] = d->dropTable[i];
-		m->_dropChance[i] = d->dropChance[i];
+		cold->_dropTable[i] = d->dropTable[i];
+		cold->_dropChance[i] = d->dropChance[i];
 	}
 }
 
@@ -252,73 +324,69 @@ void monsterTableClear(void)
 	memset(s_defs, 0, sizeof(s_defs));
 }
 
-void monsterTableLoad(const char *szPath)
+UBYTE monsterTableCount(void)
+{
+	return s_defCount;
+}
+
+static void monsterTableRead(const char *szPath)
 {
 	monsterTableClear();
 	if (!szPath || !szPath[0]) {
 		monsterTableSetBuiltins();
 		return;
 	}
-	tFile *f = diskFileOpen(szPath, DISK_FILE_MODE_READ, 1);
-	if (!f) {
+	tBinReader r;
+	LOAD_PROFILE_PUSH(openMark, "open", NULL);
+	UBYTE isOpen = binReaderOpen(&r, szPath);
+	LOAD_PROFILE_POP(openMark);
+	if (!isOpen) {
 		logWrite("monsters: '%s' not found, using built-in table\n", szPath);
 		monsterTableSetBuiltins();
 		return;
 	}
 	char magic[4];
-	fileRead(f, magic, 4);
-	if (magic[0] != 'M' || magic[1] != 'O' || magic[2] != 'N' || magic[3] != 'S') {
-		fileClose(f);
-		monsterTableSetBuiltins();
-		return;
-	}
-	UBYTE ver = 0;
-	fileRead(f, &ver, 1);
-	if (ver != 1) {
-		fileClose(f);
-		monsterTableSetBuiltins();
-		return;
-	}
-	UBYTE count = 0;
-	fileRead(f, &count, 1);
-	if (count == 0 || count > MONSTER_DEF_MAX) {
-		fileClose(f);
+	binRead(&r, magic, 4);
+	UBYTE ver = binReadU8(&r);
+	UBYTE count = binReadU8(&r);
+	if (magic[0] != 'M' || magic[1] != 'O' || magic[2] != 'N' || magic[3] != 'S'
+		|| ver != 1 || count == 0 || count > MONSTER_DEF_MAX) {
+		binReaderClose(&r);
 		monsterTableSetBuiltins();
 		return;
 	}
 	for (UBYTE i = 0; i < count; i++) {
 		tMonsterDef *d = &s_defs[i];
-		fileRead(f, &d->ubLevel, 1);
-		d->uwMaxHP = readU16Be(f);
-		d->ubAttack = 0;
-		d->ubDefense = 0;
-		fileRead(f, &d->ubAttack, 1);
-		fileRead(f, &d->ubDefense, 1);
-		d->uwExperience = readU16Be(f);
-		fileRead(f, &d->ubAggroRange, 1);
-		fileRead(f, &d->ubFleeThreshold, 1);
-		fileRead(f, d->dropTable, 8);
-		fileRead(f, d->dropChance, 8);
-		UBYTE nlen = 0;
-		fileRead(f, &nlen, 1);
-		for (UBYTE k = 0; k < nlen; k++) {
-			UBYTE b;
-			fileRead(f, &b, 1);
-		}
+		d->ubLevel = binReadU8(&r);
+		d->uwMaxHP = binReadU16Be(&r);
+		d->ubAttack = binReadU8(&r);
+		d->ubDefense = binReadU8(&r);
+		d->uwExperience = binReadU16Be(&r);
+		d->ubAggroRange = binReadU8(&r);
+		d->ubFleeThreshold = binReadU8(&r);
+		binRead(&r, d->dropTable, 8);
+		binRead(&r, d->dropChance, 8);
+		binSkip(&r, binReadU8(&r)); /* name: editor only */
 	}
 	s_defCount = count;
-	fileClose(f);
+	binReaderClose(&r);
 	logWrite("monsters: loaded %u from %s\n", (unsigned)s_defCount, szPath);
 }
 
+void monsterTableLoad(const char *szPath)
+{
+	LOAD_PROFILE_PUSH(loadMark, "monsterTableLoad", szPath);
+	monsterTableRead(szPath);
+	LOAD_PROFILE_POP(loadMark);
+}
+
 static void monsterCreateLegacySwitch(tMonster *monster, UBYTE monsterType)
 {
 	monster->_monsterType = monsterType;
 	monster->_state = MONSTER_STATE_IDLE;
 	monster->_aggroRange = 5;
 	monster->_fleeThreshold = 20;
-	memset(monster->_dropTable, 0, 8);
-	memset(monster->_dropChance, 0, 8);
+	tMonsterCold *cold = monsterCold(monster);
 	switch (monsterType)
 	{
 	case MONSTER_TYPE_NORMAL:
@@ -327,7 +395,7 @@ static void monsterCreateLegacySwitch(tMonster *monster, UBYTE monsterType)
 		monster->_base._HP = monster->_base._MaxHP;
 		monster->_base._Attack = 5;
 		monster->_base._Defense = 3;
-		monster->_experienceValue = 10;
+		cold->_experienceValue = 10;
 		break;
 	case MONSTER_TYPE_MINIBOSS:
 		monster->_base._Level = 3;
@@ -335,7 +403,7 @@ static void monsterCreateLegacySwitch(tMonster *monster, UBYTE monsterType)
 		monster->_base._HP = monster->_base._MaxHP;
 		monster->_base._Attack = 10;
 		monster->_base._Defense = 8;
-		monster->_experienceValue = 50;
+		cold->_experienceValue = 50;
 		break;
 	case MONSTER_TYPE_BOSS:
 		monster->_base._Level = 5;
@@ -343,7 +411,7 @@ static void monsterCreateLegacySwitch(tMonster *monster, UBYTE monsterType)
 		monster->_base._HP = monster->_base._MaxHP;
 		monster->_base._Attack = 15;
 		monster->_base._Defense = 12;
-		monster->_experienceValue = 200;
+		cold->_experienceValue = 200;
 		break;
 	default:
 		monster->_base._Level = 1;
@@ -351,25 +419,27 @@ static void monsterCreateLegacySwitch(tMonster *monster, UBYTE monsterType)
 		monster->_base._HP = 20;
 		monster->_base._Attack = 5;
 		monster->_base._Defense = 3;
-		monster->_experienceValue = 10;
+		cold->_experienceValue = 10;
 		break;
 	}
 }
 
 tMonster* monsterCreate(UBYTE monsterType)
 {
-	tMonster* monster = (tMonster*)memAllocFastClear(sizeof(tMonster));
-	if (!monster)
+	tMonster* monster = monsterPoolTake();
+	if (!monster) {
+		logWrite("monsterCreate: pool of %u is exhausted\n", (unsigned)MONSTER_POOL_SIZE);
 		return NULL;
+	}
 	if (s_defCount > 0 && monsterType < s_defCount) {
 		monsterApplyDef(monster, monsterType, &s_defs[monsterType]);
-		monster->_moveCooldown = (UBYTE)(1 + (simpleRandByte() % 24));
+		monster->_moveCooldown = (UBYTE)(1 + (monsterAiRand() % 24));
 		logWrite("monsterCreate: type=%u (table) hp=%u/%u\n", (unsigned)monsterType,
 			(unsigned)monster->_base._HP, (unsigned)monster->_base._MaxHP);
 		return monster;
 	}
 	monsterCreateLegacySwitch(monster, monsterType);
-	monster->_moveCooldown = (UBYTE)(1 + (simpleRandByte() % 24));
+	monster->_moveCooldown = (UBYTE)(1 + (monsterAiRand() % 24));
 	logWrite("monsterCreate: type=%u (legacy) hp=%u/%u\n", (unsigned)monsterType,
 		(unsigned)monster->_base._HP, (unsigned)monster->_base._MaxHP);
 	return monster;
@@ -377,10 +447,28 @@ tMonster* monsterCreate(UBYTE monsterType)
 
 void monsterDestroy(tMonster* monster)
 {
-    if (monster)
-    {
-        memFree(monster, sizeof(tMonster));
+    if (!monster)
+        return;
+    // A second destroy would chain the record into the free list twice
+    if (monster < s_pool || monster >= s_pool + MONSTER_POOL_SIZE
+        || s_poolNext[monster - s_pool] != MONSTER_POOL_TAKEN) {
+        logWrite("ERR: monsterDestroy: %p is not a monster in use\n", (void *)monster);
+        return;
     }
+    UBYTE slot = (UBYTE)(monster - s_pool);
+    s_poolNext[slot] = s_poolFree;
+    s_poolFree = slot;
+    s_poolUsed--;
+}
+
+tMonsterCold* monsterCold(const tMonster* monster)
+{
+    return &s_poolCold[monster - s_pool];
+}
+
+UBYTE monsterPoolUsed(void)
+{
+    return s_poolUsed;
 }
 
 tMonsterList* monsterListCreate()
@@ -406,15 +494,56 @@ void monsterListDestroy(tMonsterList* list)
     }
 }
 
-void monsterUpdate(tMonster *monster, tMaze *maze, tCharacterParty *party, tMonsterList *allMonsters)
+void monsterListClear(tMonsterList* list)
+{
+    if (!list)
+        return;
+    for (UBYTE i = 0; i < list->_numMonsters; i++)
+    {
+        monsterDestroy(list->_monsters[i]);
+        list->_monsters[i] = NULL;
+    }
+    list->_numMonsters = 0;
+    list->_nextSpawnId = 0;
+    list->_aiCursor = 0;
+}
+
+UBYTE monsterListAppend(tMonsterList* list, tMonster* monster)
+{
+    if (!list || !monster || list->_numMonsters >= MAX_MONSTERS)
+        return 0;
+    monster->_spawnId = list->_nextSpawnId++;
+    monster->_aiFrame = list->_aiFrame;
+    list->_monsters[list->_numMonsters++] = monster;
+    return 1;
+}
+
+void monsterListRemove(tMonsterList* list, tMaze* maze, UBYTE index)
+{
+    if (!list || index >= list->_numMonsters)
+        return;
+    monsterRemoveFromMaze(maze, list->_monsters[index]);
+    monsterDestroy(list->_monsters[index]);
+    for (UBYTE j = index; j < list->_numMonsters - 1; j++)
+        list->_monsters[j] = list->_monsters[j + 1];
+    list->_monsters[--list->_numMonsters] = NULL;
+    if (list->_aiCursor > index)
+        list->_aiCursor--;
+}
+
+/** One update covering ubTicks frames of move cooldown (more than 1 when the scheduler skipped it). */
+static void monsterUpdateTicks(tMonster *monster, tMaze *maze, tCharacterParty *party,
+	tMonsterList *allMonsters, UBYTE ubTicks)
 {
 	if (!monster || monster->_state == MONSTER_STATE_DEAD)
 		return;
 	if (!party)
 		return;
 
-	if (monster->_moveCooldown > 0)
-		monster->_moveCooldown--;
+	if (monster->_moveCooldown > ubTicks)
+		monster->_moveCooldown = (UBYTE)(monster->_moveCooldown - ubTicks);
+	else
+		monster->_moveCooldown = 0;
 
 	WORD dx = (WORD)monster->_partyPosX - (WORD)party->_PartyX;
 	WORD dy = (WORD)monster->_partyPosY - (WORD)party->_PartyY;
@@ -423,7 +552,9 @@ void monsterUpdate(tMonster *monster, tMaze *maze, tCharacterParty *party, tMons
 	UBYTE distance = (UBYTE)(adx + ady);
 
 	if (monster->_state == MONSTER_STATE_IDLE) {
-		if (distance <= monster->_aggroRange)
+		// In range is not enough: the party has to be in sight, not behind a wall
+		if (distance <= monster->_aggroRange
+			&& (!maze || partyFieldSees(maze, party->_PartyX, party->_PartyY, monster->_partyPosX, monster->_partyPosY)))
 			monster->_state = MONSTER_STATE_AGGRESSIVE;
 	} else if (monster->_state == MONSTER_STATE_AGGRESSIVE) {
 		UBYTE hpPercent = (monster->_base._HP * 100) / monster->_base._MaxHP;
@@ -438,28 +569,122 @@ void monsterUpdate(tMonster *monster, tMaze *maze, tCharacterParty *party, tMons
 
 	if (maze && allMonsters && monster->_moveCooldown == 0) {
 		monster->_moveCooldown = MONSTER_MOVE_PERIOD;
+		if (monster->_state != MONSTER_STATE_IDLE)
+			partyFieldUpdate(maze, party->_PartyX, party->_PartyY);
 		switch (monster->_state) {
 		case MONSTER_STATE_IDLE:
 			if (distance > monster->_aggroRange)
-				monsterWander(maze, monster, allMonsters);
+				monsterWander(maze, monster);
 			break;
 		case MONSTER_STATE_AGGRESSIVE:
-			monsterMoveChase(maze, monster, allMonsters, party);
+			monsterMoveChase(maze, monster, party);
 			break;
 		case MONSTER_STATE_FLEEING:
-			monsterMoveFlee(maze, monster, allMonsters, party);
+			monsterMoveFlee(maze, monster, party);
 			break;
 		default:
 			break;
 		}
 	}
 
+#ifdef GAME_DEBUG_AI
 	logWrite(
 		"monster tick: type=%u pos=(%u,%u) party=(%u,%u) dist=%u state=%u hp=%u/%u aggro=%u\n",
 		(unsigned)monster->_monsterType, (unsigned)monster->_partyPosX,
 		(unsigned)monster->_partyPosY, (unsigned)party->_PartyX, (unsigned)party->_PartyY,
 		(unsigned)distance, (unsigned)monster->_state, (unsigned)monster->_base._HP,
 		(unsigned)monster->_base._MaxHP, (unsigned)monster->_aggroRange);
+#endif
+}
+
+void monsterUpdate(tMonster *monster, tMaze *maze, tCharacterParty *party, tMonsterList *allMonsters)
+{
+	monsterUpdateTicks(monster, maze, party, allMonsters, 1);
+}
+
+static UBYTE s_aiBudget = MONSTER_AI_DEFAULT_BUDGET;
+static tMonsterAiStats s_aiStats;
+
+void monsterAiSetBudget(UBYTE ubBudget)
+{
+	s_aiBudget = ubBudget ? ubBudget : 1;
+}
+
+const tMonsterAiStats *monsterAiStatsGet(void)
+{
+	return &s_aiStats;
+}
+
+void monsterAiStatsReset(void)
+{
+	memset(&s_aiStats, 0, sizeof(s_aiStats));
+}
+
+static void monsterAiRun(tMonsterList *list, tMaze *maze, tCharacterParty *party, UBYTE index)
+{
+	tMonster *m = list->_monsters[index];
+	UWORD elapsed = (UWORD)(list->_aiFrame - m->_aiFrame);
+	m->_aiFrame = list->_aiFrame;
+	monsterUpdateTicks(m, maze, party, list, (UBYTE)(elapsed > 255 ? 255 : elapsed));
+}
+
+UBYTE monsterListUpdate(tMonsterList *list, tMaze *maze, tCharacterParty *party, UBYTE *pUpdated)
+{
+	if (!list || !party || !list->_numMonsters)
+		return 0;
+	ULONG start = timerGetPrec();
+	list->_aiFrame++;
+	mazeZonesSetParty(maze, party->_PartyX, party->_PartyY);
+	UBYTE count = 0;
+	UBYTE parked = 0;
+	UBYTE frozen = 0;
+	// Awake monsters near the party first, every frame while the budget lasts
+	for (UBYTE i = 0; i < list->_numMonsters; i++) {
+		tMonster *m = list->_monsters[i];
+		if (!m || m->_state == MONSTER_STATE_DEAD)
+			continue;
+		// Out of the party's zones: not stamped, so it catches up when its zone wakes
+		if (!mazeZoneIsActive(maze, m->_partyPosX, m->_partyPosY)) {
+			frozen++;
+			continue;
+		}
+		WORD dx = (WORD)m->_partyPosX - (WORD)party->_PartyX;
+		WORD dy = (WORD)m->_partyPosY - (WORD)party->_PartyY;
+		UWORD distance = (UWORD)((dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy));
+		if (m->_state == MONSTER_STATE_IDLE && distance > m->_aggroRange + MONSTER_AI_WAKE_MARGIN) {
+			// Parked: stamped as if updated, so it owes no frames and the pass below skips it
+			m->_aiFrame = list->_aiFrame;
+			parked++;
+			continue;
+		}
+		if (distance <= MONSTER_AI_NEAR && count < s_aiBudget) {
+			monsterAiRun(list, maze, party, i);
+			pUpdated[count++] = i;
+		}
+	}
+	// Then the awake ones not yet run, round-robin from where the last frame stopped
+	UBYTE n = list->_numMonsters;
+	UBYTE i = (UBYTE)(list->_aiCursor < n ? list->_aiCursor : 0);
+	for (UBYTE k = 0; k < n && count < s_aiBudget; k++) {
+		tMonster *m = list->_monsters[i];
+		if (m && m->_state != MONSTER_STATE_DEAD && m->_aiFrame != list->_aiFrame
+			&& mazeZoneIsActive(maze, m->_partyPosX, m->_partyPosY)) {
+			monsterAiRun(list, maze, party, i);
+			pUpdated[count++] = i;
+			list->_aiCursor = (UBYTE)(i + 1);
+		}
+		if (++i == n)
+			i = 0;
+	}
+	ULONG elapsed = timerGetDelta(start, timerGetPrec());
+	s_aiStats.ulFrames++;
+	s_aiStats.ulUpdates += count;
+	s_aiStats.ulParked += parked;
+	s_aiStats.ulFrozen += frozen;
+	s_aiStats.ulPrecTotal += elapsed;
+	if (elapsed > s_aiStats.ulPrecWorst)
+		s_aiStats.ulPrecWorst = elapsed;
+	return count;
 }
 
 void monsterAttack(tMonster* monster, tCharacter* target)
@@ -512,29 +737,59 @@ void monsterDropLoot(tMonster* monster, tInventory* pInventory)
     if (!monster || monster->_state != MONSTER_STATE_DEAD || !pInventory)
         return;
 
+    const tMonsterCold *cold = monsterCold(monster);
     // Roll for each possible drop
     for (UBYTE i = 0; i < 8; i++)
     {
-        if (monster->_dropTable[i] != 0)  // If there's an item in this slot
+        if (cold->_dropTable[i] != 0)  // If there's an item in this slot
         {
-            UBYTE roll = simpleRand();  // Roll 0-99
-            if (roll < monster->_dropChance[i])
+            UBYTE roll = monsterLootRoll();
+            if (roll < cold->_dropChance[i])
             {
                 // Item dropped! Add to inventory
-                inventoryAddItem(pInventory, monster->_dropTable[i], 1);
+                inventoryAddItem(pInventory, cold->_dropTable[i], 1);
             }
         }
     }
 }
+UBYTE monsterCombatRound(tMonster* monster, tMaze* maze, tCharacterParty* party, tInventory* pInventory)
+{
+    if (!monster || !party || !party->_numCharacters || monster->_state != MONSTER_STATE_AGGRESSIVE)
+        return MONSTER_COMBAT_NONE;
+    if (monster->_partyPosX != party->_PartyX || monster->_partyPosY != party->_PartyY)
+        return MONSTER_COMBAT_NONE;
+    tCharacter* hero = party->_characters[0];
+    monsterAttack(monster, hero);
+    if (hero->_HP > 0 && monster->_state != MONSTER_STATE_DEAD)
+        monsterTakeDamageFromCharacter(monster, hero);
+    if (monster->_base._HP != 0)
+        return MONSTER_COMBAT_ROUND;
+    monsterKill(maze, monster);
+    monsterDropLoot(monster, pInventory);
+    for (UBYTE j = 0; j < party->_numCharacters; j++) {
+        if (party->_characters[j])
+            party->_characters[j]->_Experience += monsterCold(monster)->_experienceValue;
+    }
+    return MONSTER_COMBAT_KILL;
+}
 
 void monsterPlaceInMaze(tMaze* maze, tMonster* monster, UBYTE x, UBYTE y)
 {
     if (!maze || !monster)
         return;
 
+    if (monster->_inMaze) {
+        if (x < maze->_width && y < maze->_height)
+            monsterSetPos(maze, monster, x, y);
+        return;
+    }
     // Set monster position
     monster->_partyPosX = x;
     monster->_partyPosY = y;
+    if (x < maze->_width && y < maze->_height && monster->_state != MONSTER_STATE_DEAD) {
+        maze->_monsterCount[(UWORD)y * maze->_width + x]++;
+        monster->_inMaze = 1;
+    }
 }
 
 void monsterRemoveFromMaze(tMaze* maze, tMonster* monster)
@@ -542,7 +797,35 @@ void monsterRemoveFromMaze(tMaze* maze, tMonster* monster)
     if (!maze || !monster)
         return;
 
+    if (monster->_inMaze) {
+        UWORD idx = (UWORD)monster->_partyPosY * maze->_width + monster->_partyPosX;
+        if (maze->_monsterCount[idx])
+            maze->_monsterCount[idx]--;
+        monster->_inMaze = 0;
+    }
     // Clear monster position
     monster->_partyPosX = 0;
     monster->_partyPosY = 0;
-} 
\ No newline at end of file
+} 
+
+void monsterKill(tMaze* maze, tMonster* monster)
+{
+    if (!monster)
+        return;
+    if (monster->_state != MONSTER_STATE_DEAD)
+        saveJournalMonsterKill(monster->_spawnId);
+    monster->_state = MONSTER_STATE_DEAD;
+    if (maze && monster->_inMaze) {
+        UWORD idx = (UWORD)monster->_partyPosY * maze->_width + monster->_partyPosX;
+        if (maze->_monsterCount[idx])
+            maze->_monsterCount[idx]--;
+        monster->_inMaze = 0;
+    }
+}
+
+UBYTE monsterCountAt(const tMaze* maze, UBYTE x, UBYTE y)
+{
+    if (!maze || x >= maze->_width || y >= maze->_height)
+        return 0;
+    return maze->_monsterCount[(UWORD)y * maze->_width + x];
+}
@@ -7,6 +7,7 @@
 #include <ace/managers/mouse.h>
 
 #include "screen.h"
+#include "input.h"
 
 static tBitMap *pointers_low_[MOUSE_MAX_COUNT];
 static tBitMap *pointers_high_[MOUSE_MAX_COUNT];
@@ -78,10 +79,10 @@ void mouse_pointer_switch(mouse_pointer_t new_pointer)
 
 void mouse_pointer_update(void)
 {
-    current_pointer0_->wX = mouseGetX(MOUSE_PORT_1);
-    current_pointer0_->wY = mouseGetY(MOUSE_PORT_1);
-    current_pointer1_->wX = mouseGetX(MOUSE_PORT_1);
-    current_pointer1_->wY = mouseGetY(MOUSE_PORT_1);
+    current_pointer0_->wX = inputMouseX();
+    current_pointer0_->wY = inputMouseY();
+    current_pointer1_->wX = inputMouseX();
+    current_pointer1_->wY = inputMouseY();
     spriteRequestMetadataUpdate(current_pointer0_);
     spriteRequestMetadataUpdate(current_pointer1_);
 
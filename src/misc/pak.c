@@ -0,0 +1,136 @@
+#include "pak.h"
+#include "level_prefetch.h"
+#include "load_profile.h"
+#include <ace/managers/memory.h>
+#include <ace/managers/log.h>
+#include <ace/utils/file.h>
+#include <ace/utils/disk_file.h>
+#include <string.h>
+
+static ULONG pakU32(const UBYTE *p)
+{
+	return ((ULONG)p[0] << 24) | ((ULONG)p[1] << 16) | ((ULONG)p[2] << 8) | (ULONG)p[3];
+}
+
+static UWORD pakU16(const UBYTE *p)
+{
+	return ((UWORD)p[0] << 8) | (UWORD)p[1];
+}
+
+// Check the TOC of a whole pack image and adopt it; frees data if it is malformed
+static UBYTE pakAdopt(tPak *pak, UBYTE *data, ULONG size, const char *path)
+{
+	UWORD chunkCount = pakU16(data + 6);
+	const UBYTE *toc = data + PAK_HEADER_SIZE;
+	for (UWORD i = 0; i < chunkCount; i++, toc += PAK_TOC_ENTRY_SIZE) {
+		ULONG offset = pakU32(toc + 8);
+		ULONG chunkSize = pakU32(toc + 12);
+		if (offset > size || chunkSize > size - offset) {
+			memFree(data, size);
+			logWrite("pak: %s chunk %u out of range\n", path, (unsigned)i);
+			return 0;
+		}
+	}
+	pak->data = data;
+	pak->size = size;
+	pak->chunkCount = chunkCount;
+	return 1;
+}
+
+static UBYTE pakRead(tPak *pak, const char *path)
+{
+	pak->data = NULL;
+	pak->size = 0;
+	pak->chunkCount = 0;
+	ULONG stagedSize;
+	UBYTE *staged = levelPrefetchTake(path, &stagedSize);
+	if (staged) {
+		if (stagedSize >= PAK_HEADER_SIZE && memcmp(staged, "SPAK", 4) == 0 && pakU16(staged + 4) == PAK_VERSION
+			&& pakU32(staged + 8) == stagedSize
+			&& stagedSize >= PAK_HEADER_SIZE + (ULONG)pakU16(staged + 6) * PAK_TOC_ENTRY_SIZE)
+			return pakAdopt(pak, staged, stagedSize, path);
+		memFree(staged, stagedSize);
+		logWrite("pak: prefetched %s is not a version %u pack\n", path, (unsigned)PAK_VERSION);
+		return 0;
+	}
+	LOAD_PROFILE_PUSH(openMark, "open", NULL);
+	tFile *file = diskFileOpen(path, DISK_FILE_MODE_READ, 1);
+	LOAD_PROFILE_POP(openMark);
+	if (!file) {
+		logWrite("pak: '%s' not found\n", path);
+		return 0;
+	}
+	UBYTE header[PAK_HEADER_SIZE];
+	if (fileRead(file, header, PAK_HEADER_SIZE) != PAK_HEADER_SIZE
+		|| memcmp(header, "SPAK", 4) != 0 || pakU16(header + 4) != PAK_VERSION) {
+		fileClose(file);
+		logWrite("pak: %s is not a version %u pack\n", path, (unsigned)PAK_VERSION);
+		return 0;
+	}
+	UWORD chunkCount = pakU16(header + 6);
+	ULONG size = pakU32(header + 8);
+	if (size < PAK_HEADER_SIZE + (ULONG)chunkCount * PAK_TOC_ENTRY_SIZE) {
+		fileClose(file);
+		logWrite("pak: %s header claims %lu bytes\n", path, (unsigned long)size);
+		return 0;
+	}
+	// The header carries the file size, so the rest comes in with a single read
+	UBYTE *data = (UBYTE *)memAllocFast(size);
+	if (!data) {
+		fileClose(file);
+		logWrite("pak: out of memory for %s (%lu bytes)\n", path, (unsigned long)size);
+		return 0;
+	}
+	memcpy(data, header, PAK_HEADER_SIZE);
+	LOAD_PROFILE_PUSH(readMark, "read", NULL);
+	ULONG got = fileRead(file, data + PAK_HEADER_SIZE, size - PAK_HEADER_SIZE);
+	fileClose(file);
+	LOAD_PROFILE_POP(readMark);
+	if (got != size - PAK_HEADER_SIZE) {
+		memFree(data, size);
+		logWrite("pak: %s truncated\n", path);
+		return 0;
+	}
+	return pakAdopt(pak, data, size, path);
+}
+
+UBYTE pakLoad(tPak *pak, const char *path)
+{
+	LOAD_PROFILE_PUSH(loadMark, "pakLoad", path);
+	UBYTE ok = pakRead(pak, path);
+	LOAD_PROFILE_POP(loadMark);
+	return ok;
+}
+
+const UBYTE *pakFind(const tPak *pak, const char *tag, UWORD index, ULONG *size)
+{
+	const UBYTE *toc = pak->data + PAK_HEADER_SIZE;
+	for (UWORD i = 0; i < pak->chunkCount; i++, toc += PAK_TOC_ENTRY_SIZE) {
+		if (memcmp(toc, tag, 4) == 0 && pakU16(toc + 4) == index) {
+			if (size)
+				*size = pakU32(toc + 12);
+			return pak->data + pakU32(toc + 8);
+		}
+	}
+	if (size)
+		*size = 0;
+	return NULL;
+}
+
+UBYTE pakIsPath(const char *path)
+{
+	ULONG len = strlen(path);
+	if (len < 4)
+		return 0;
+	const char *ext = path + len - 4;
+	return ext[0] == '.' && (ext[1] | 0x20) == 'p' && (ext[2] | 0x20) == 'a' && (ext[3] | 0x20) == 'k';
+}
+
+void pakDestroy(tPak *pak)
+{
+	if (pak->data)
+		memFree(pak->data, pak->size);
+	pak->data = NULL;
+	pak->size = 0;
+	pak->chunkCount = 0;
+}
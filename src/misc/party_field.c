@@ -0,0 +1,173 @@
+#include "party_field.h"
+#include <string.h>
+
+// A BFS from the centre never leaves the diamond of its radius
+#define PARTY_FIELD_MAX_CELLS (2 * PARTY_FIELD_RADIUS * PARTY_FIELD_RADIUS + 2 * PARTY_FIELD_RADIUS + 1)
+
+// Steps + 1 for each window cell; 0 is not reached, so the zeroed array starts empty
+static UBYTE s_dist[PARTY_FIELD_SIZE * PARTY_FIELD_SIZE];
+// Window index of every cell reached, in BFS order; clearing walks it instead of the window
+static UWORD s_queue[PARTY_FIELD_MAX_CELLS];
+static UWORD s_queued;
+static const tMaze *s_pMaze;
+static WORD s_originX;   // Maze position of window cell (0, 0)
+static WORD s_originY;
+static UBYTE s_partyX;
+static UBYTE s_partyY;
+static UBYTE s_isBuilt;
+static UBYTE s_isDirty;
+static ULONG s_rebuilds;
+
+// Line of sight from the party for each cell of a smaller window, traced when first asked
+#define PARTY_SIGHT_SIZE (2 * PARTY_SIGHT_RADIUS + 1)
+#define PARTY_SIGHT_UNKNOWN 0
+#define PARTY_SIGHT_SEEN 1
+#define PARTY_SIGHT_HIDDEN 2
+static UBYTE s_sight[PARTY_SIGHT_SIZE * PARTY_SIGHT_SIZE];
+static const tMaze *s_pSightMaze;
+static UBYTE s_sightX;
+static UBYTE s_sightY;
+static UBYTE s_isSightStale = 1;
+static ULONG s_sightTraces;
+
+static UBYTE partyFieldWalkable(const tMaze *pMaze, WORD x, WORD y)
+{
+	if (x < 0 || y < 0 || x >= pMaze->_width || y >= pMaze->_height)
+		return 0;
+	UBYTE c = pMaze->_mazeData[(UWORD)y * pMaze->_width + x];
+	return c == MAZE_FLOOR || c == MAZE_DOOR_OPEN || c == MAZE_EVENT_TRIGGER;
+}
+
+static void partyFieldClear(void)
+{
+	for (UWORD i = 0; i < s_queued; i++)
+		s_dist[s_queue[i]] = 0;
+	s_queued = 0;
+}
+
+void partyFieldReset(void)
+{
+	partyFieldClear();
+	s_pMaze = NULL;
+	s_isBuilt = 0;
+	s_isDirty = 0;
+	s_rebuilds = 0;
+	s_pSightMaze = NULL;
+	s_isSightStale = 1;
+	s_sightTraces = 0;
+}
+
+static void partyFieldBuild(const tMaze *pMaze, UBYTE x, UBYTE y)
+{
+	static const BYTE s_dx[4] = {0, 1, 0, -1};
+	static const BYTE s_dy[4] = {-1, 0, 1, 0};
+	partyFieldClear();
+	s_pMaze = pMaze;
+	s_partyX = x;
+	s_partyY = y;
+	s_originX = (WORD)x - PARTY_FIELD_RADIUS;
+	s_originY = (WORD)y - PARTY_FIELD_RADIUS;
+	s_isBuilt = 1;
+	s_isDirty = 0;
+	s_rebuilds++;
+
+	// The party's own cell is the source even if something stands in it
+	UWORD centre = PARTY_FIELD_RADIUS * PARTY_FIELD_SIZE + PARTY_FIELD_RADIUS;
+	s_dist[centre] = 1;
+	s_queue[s_queued++] = centre;
+	for (UWORD head = 0; head < s_queued; head++) {
+		UWORD w = s_queue[head];
+		UBYTE d = s_dist[w];
+		if (d > PARTY_FIELD_RADIUS)
+			continue;
+		WORD wx = (WORD)(w % PARTY_FIELD_SIZE);
+		WORD wy = (WORD)(w / PARTY_FIELD_SIZE);
+		for (UBYTE k = 0; k < 4; k++) {
+			WORD nx = (WORD)(wx + s_dx[k]);
+			WORD ny = (WORD)(wy + s_dy[k]);
+			UWORD n = (UWORD)(ny * PARTY_FIELD_SIZE + nx);
+			if (s_dist[n]
+				|| !partyFieldWalkable(pMaze, (WORD)(s_originX + nx), (WORD)(s_originY + ny)))
+				continue;
+			s_dist[n] = (UBYTE)(d + 1);
+			s_queue[s_queued++] = n;
+		}
+	}
+}
+
+void partyFieldUpdate(const tMaze *pMaze, UBYTE x, UBYTE y)
+{
+	if (!pMaze)
+		return;
+	if (!s_isBuilt || s_isDirty || pMaze != s_pMaze || x != s_partyX || y != s_partyY)
+		partyFieldBuild(pMaze, x, y);
+}
+
+void partyFieldCellChanged(UBYTE x, UBYTE y)
+{
+	// Any wall-layer change in the sight window may open or close a line
+	WORD sx = (WORD)x - s_sightX;
+	WORD sy = (WORD)y - s_sightY;
+	if (sx >= -PARTY_SIGHT_RADIUS && sx <= PARTY_SIGHT_RADIUS && sy >= -PARTY_SIGHT_RADIUS && sy <= PARTY_SIGHT_RADIUS)
+		s_isSightStale = 1;
+	if (!s_isBuilt || s_isDirty)
+		return;
+	// A cell joins or leaves the field only next to a cell already in it
+	static const BYTE s_dx[5] = {0, 0, 1, 0, -1};
+	static const BYTE s_dy[5] = {0, -1, 0, 1, 0};
+	for (UBYTE k = 0; k < 5; k++) {
+		if (partyFieldAt((UBYTE)(x + s_dx[k]), (UBYTE)(y + s_dy[k])) != PARTY_FIELD_FAR) {
+			s_isDirty = 1;
+			return;
+		}
+	}
+}
+
+void partyFieldInvalidate(void)
+{
+	s_isDirty = 1;
+	s_isSightStale = 1;
+}
+
+UBYTE partyFieldAt(UBYTE x, UBYTE y)
+{
+	WORD wx = (WORD)x - s_originX;
+	WORD wy = (WORD)y - s_originY;
+	if (!s_isBuilt || wx < 0 || wy < 0 || wx >= PARTY_FIELD_SIZE || wy >= PARTY_FIELD_SIZE)
+		return PARTY_FIELD_FAR;
+	UBYTE d = s_dist[wy * PARTY_FIELD_SIZE + wx];
+	return d ? (UBYTE)(d - 1) : PARTY_FIELD_FAR;
+}
+
+ULONG partyFieldRebuilds(void)
+{
+	return s_rebuilds;
+}
+
+UBYTE partyFieldSees(const tMaze *pMaze, UBYTE px, UBYTE py, UBYTE x, UBYTE y)
+{
+	WORD wx = (WORD)x - px + PARTY_SIGHT_RADIUS;
+	WORD wy = (WORD)y - py + PARTY_SIGHT_RADIUS;
+	if (wx < 0 || wy < 0 || wx >= PARTY_SIGHT_SIZE || wy >= PARTY_SIGHT_SIZE) {
+		s_sightTraces++;
+		return mazeLineOfSight(pMaze, px, py, x, y);
+	}
+	if (s_isSightStale || pMaze != s_pSightMaze || px != s_sightX || py != s_sightY) {
+		memset(s_sight, PARTY_SIGHT_UNKNOWN, sizeof(s_sight));
+		s_pSightMaze = pMaze;
+		s_sightX = px;
+		s_sightY = py;
+		s_isSightStale = 0;
+	}
+	UBYTE *pCell = &s_sight[wy * PARTY_SIGHT_SIZE + wx];
+	if (*pCell == PARTY_SIGHT_UNKNOWN) {
+		*pCell = mazeLineOfSight(pMaze, px, py, x, y) ? PARTY_SIGHT_SEEN : PARTY_SIGHT_HIDDEN;
+		s_sightTraces++;
+	}
+	return *pCell == PARTY_SIGHT_SEEN;
+}
+
+ULONG partyFieldSightTraces(void)
+{
+	return s_sightTraces;
+}
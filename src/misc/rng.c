@@ -0,0 +1,34 @@
+#include "rng.h"
+
+// Streams seeded alike still start far apart in the sequence
+#define RNG_STATE_OF(seed, stream) (((ULONG)(seed) + (ULONG)(stream) * 0x2545F491UL) & 0x7fffffffUL)
+
+static ULONG s_state[RNG_STREAM_COUNT] = {
+	RNG_STATE_OF(1, RNG_AI),
+	RNG_STATE_OF(1, RNG_COMBAT),
+	RNG_STATE_OF(1, RNG_LOOT),
+	RNG_STATE_OF(1, RNG_SCRIPT),
+};
+
+ULONG rngNext(tRngStream eStream)
+{
+	ULONG *pState = &s_state[eStream];
+	*pState = (*pState * 1103515245 + 12345) & 0x7fffffff;
+	return *pState;
+}
+
+void rngSeed(ULONG ulSeed)
+{
+	for (UBYTE i = 0; i < RNG_STREAM_COUNT; i++)
+		s_state[i] = RNG_STATE_OF(ulSeed, i);
+}
+
+ULONG rngStateGet(tRngStream eStream)
+{
+	return s_state[eStream];
+}
+
+void rngStateSet(tRngStream eStream, ULONG ulState)
+{
+	s_state[eStream] = ulState & 0x7fffffff;
+}
@@ -2,6 +2,9 @@
 #include "GameState.h"
 #include "maze.h"
 #include "inventory.h"
+#include "save_journal.h"
+#include "party_field.h"
+#include "rng.h"
 #include <ace/managers/memory.h>
 #include <string.h>
 
@@ -12,6 +15,7 @@ typedef enum {
     SCRIPT_RESULT_GOSUB,
     SCRIPT_RESULT_RETURN,
     SCRIPT_RESULT_END,
+    SCRIPT_RESULT_YIELD,
     SCRIPT_RESULT_ERROR
 } tScriptResult;
 
@@ -21,6 +25,12 @@ typedef struct {
     tScriptError error;
 } tScriptExecutionResult;
 
+// Upper bound on opcodes between two EVENT_WAITs; stops GOTO loops from running forever
+#define SCRIPT_MAX_STEPS 1024
+
+static UWORD s_uwFrameBudget = SCRIPT_DEFAULT_FRAME_BUDGET;
+static UBYTE s_ubNextContext = 0;
+
 // Stack frame for nested constructs
 typedef struct {
     UBYTE type;  // IF=1, GOSUB=2
@@ -29,158 +39,243 @@ typedef struct {
 } tStackFrame;
 
 // Forward declarations
-tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent);
-BOOL evaluateCondition(tMaze *pMaze, UBYTE *conditionData, UBYTE dataSize);
-BOOL validateEventData(tMazeEvent *pEvent, tMaze *pMaze);
-void pushStackFrame(UBYTE type, UWORD address, BOOL conditionMet);
-tStackFrame popStackFrame();
-BOOL isStackEmpty();
-
-// Condition evaluation function
-BOOL evaluateCondition(tMaze *pMaze, UBYTE *conditionData, UBYTE dataSize)
-{
-    if (!conditionData || dataSize < 3) {
-        logWrite("Invalid condition data\n");
-        return FALSE;
+tScriptExecutionResult executeEvent(tScriptContext *pCtx, tMaze *pMaze, tMazeEvent *pEvent);
+BOOL pushStackFrame(tScriptContext *pCtx, UBYTE type, UWORD address, BOOL conditionMet);
+tStackFrame popStackFrame(tScriptContext *pCtx);
+BOOL isStackEmpty(tScriptContext *pCtx);
+
+// One comparison in a compiled IF condition
+typedef struct _scriptCondTerm {
+    UBYTE _compare;  // EVENT_EQUAL / EVENT_GREATER / EVENT_LESS / EVENT_NOT_EQUAL
+    UBYTE _operand;  // EVENT_LEVEL_FLAG, EVENT_PARTY_ON_POS, ...
+    UBYTE _args[3];
+    UBYTE _next;     // EVENT_AND / EVENT_OR joining the rest of the condition, 0 on the last term
+} tScriptCondTerm;
+
+// IF payload decoded once; _termCount 0 marks a payload that failed to compile (always FALSE)
+typedef struct _scriptCondition {
+    UBYTE _termCount;
+    UBYTE _pad;
+    tScriptCondTerm _terms[];
+} tScriptCondition;
+
+// Operand bytes following each condition operand (EVENT_PARTY_VISIBLE..EVENT_WALL_NUMBER), 0xFF = unsupported
+static const UBYTE s_pOperandArgs[] = {
+    0,    // PARTY_VISIBLE
+    2,    // ROLL_DICE: sides, value
+    1,    // HAS_CLASS: class
+    1,    // HAS_RACE: race
+    0xFF, // TRIGGER_FLAG
+    2,    // POINTER_ITEM: item, quantity
+    1,    // WALL_SIDE: direction
+    1,    // PARTY_DIRECTION: direction
+    0xFF, // ELSE_GOTO
+    2,    // LEVEL_FLAG: flag, value
+    2,    // GLOBAL_FLAG: flag, value
+    2,    // PARTY_ON_POS: x, y
+    3,    // MONSTERS_ON_POS: x, y, count
+    3,    // ITEMS_ON_POS: x, y, quantity
+    3,    // WALL_NUMBER: x, y, wall
+};
+
+static UBYTE scriptRollDice(UBYTE ubSides)
+{
+    return (UBYTE)(1 + (rngNext(RNG_SCRIPT) >> 8) % (ubSides ? ubSides : 1));
+}
+
+// Walk the payload once; returns the term count or 0 if it is malformed
+static UBYTE scriptParseCondition(const UBYTE *pData, UBYTE ubSize, tScriptCondTerm *pOut)
+{
+    UBYTE ubTerms = 0;
+    UBYTE i = 0;
+    while (1) {
+        if (i + 2 > ubSize)
+            return 0;
+        UBYTE ubCompare = pData[i];
+        UBYTE ubOperand = pData[i + 1];
+        if (ubCompare < EVENT_GREATER || ubCompare > EVENT_EQUAL)
+            return 0;
+        if (ubOperand < EVENT_PARTY_VISIBLE || ubOperand > EVENT_WALL_NUMBER)
+            return 0;
+        UBYTE ubArgs = s_pOperandArgs[ubOperand - EVENT_PARTY_VISIBLE];
+        if (ubArgs == 0xFF || i + 2 + ubArgs > ubSize)
+            return 0;
+        if (pOut) {
+            tScriptCondTerm *pTerm = &pOut[ubTerms];
+            pTerm->_compare = ubCompare;
+            pTerm->_operand = ubOperand;
+            memset(pTerm->_args, 0, sizeof(pTerm->_args));
+            memcpy(pTerm->_args, &pData[i + 2], ubArgs);
+            pTerm->_next = 0;
+        }
+        ubTerms++;
+        i += 2 + ubArgs;
+        if (i == ubSize)
+            return ubTerms;
+        if (pData[i] != EVENT_AND && pData[i] != EVENT_OR)
+            return 0;
+        if (pOut)
+            pOut[ubTerms - 1]._next = pData[i];
+        i++;
     }
-    
-    UBYTE conditionType = conditionData[0];
-    UBYTE operandType = conditionData[1];
-    UBYTE operandValue = conditionData[2];
-    BOOL result = FALSE;
-    
-    switch (conditionType) {
-        case EVENT_EQUAL:
-            switch (operandType) {
-                case EVENT_LEVEL_FLAG:
-                    if (operandValue < 256) {
-                        result = (g_pGameState->m_bLocalFlags[operandValue] == conditionData[3]);
-                    }
-                    break;
-                case EVENT_GLOBAL_FLAG:
-                    if (operandValue < 256) {
-                        result = (g_pGameState->m_bGlobalFlags[operandValue] == conditionData[3]);
-                    }
-                    break;
-                case EVENT_PARTY_ON_POS:
-                    result = (g_pGameState->m_pCurrentParty->_PartyX == operandValue && 
-                             g_pGameState->m_pCurrentParty->_PartyY == conditionData[3]);
-                    break;
-                case EVENT_PARTY_DIRECTION:
-                    result = (g_pGameState->m_pCurrentParty->_PartyFacing == operandValue);
-                    break;
-                case EVENT_HAS_CLASS:
-                    if (g_pGameState->m_pCurrentParty) {
-                        for (UBYTE i = 0; i < g_pGameState->m_pCurrentParty->_numCharacters; i++) {
-                            if (g_pGameState->m_pCurrentParty->_characters[i] &&
-                                g_pGameState->m_pCurrentParty->_characters[i]->_Class == operandValue) {
-                                result = TRUE;
-                                break;
-                            }
-                        }
-                    }
-                    break;
-                case EVENT_HAS_RACE:
-                    if (g_pGameState->m_pCurrentParty) {
-                        for (UBYTE i = 0; i < g_pGameState->m_pCurrentParty->_numCharacters; i++) {
-                            if (g_pGameState->m_pCurrentParty->_characters[i] &&
-                                g_pGameState->m_pCurrentParty->_characters[i]->_Race == operandValue) {
-                                result = TRUE;
-                                break;
-                            }
-                        }
-                    }
-                    break;
-            }
+}
+
+UBYTE scriptCompileCondition(tMazeEvent *pEvent)
+{
+    if (pEvent->_condition)
+        return pEvent->_condition->_termCount != 0;
+    UBYTE ubTerms = 0;
+    if (pEvent->_eventData)
+        ubTerms = scriptParseCondition(pEvent->_eventData, pEvent->_eventDataSize, NULL);
+    tScriptCondition *pCond = (tScriptCondition*)memAllocFastClear(
+        sizeof(tScriptCondition) + ubTerms * sizeof(tScriptCondTerm));
+    if (!pCond)
+        return 0;
+    if (ubTerms)
+        pCond->_termCount = scriptParseCondition(pEvent->_eventData, pEvent->_eventDataSize, pCond->_terms);
+    else
+        logWrite("IF at (%d,%d): malformed condition (%d bytes), always FALSE\n",
+            pEvent->_x, pEvent->_y, pEvent->_eventDataSize);
+    pEvent->_condition = pCond;
+    return ubTerms != 0;
+}
+
+void scriptConditionFree(tMazeEvent *pEvent)
+{
+    if (!pEvent->_condition)
+        return;
+    memFree(pEvent->_condition,
+        sizeof(tScriptCondition) + pEvent->_condition->_termCount * sizeof(tScriptCondTerm));
+    pEvent->_condition = NULL;
+}
+
+static BOOL scriptCompare(UBYTE ubCompare, UBYTE ubLhs, UBYTE ubRhs)
+{
+    switch (ubCompare) {
+        case EVENT_GREATER: return ubLhs > ubRhs;
+        case EVENT_LESS: return ubLhs < ubRhs;
+        case EVENT_NOT_EQUAL: return ubLhs != ubRhs;
+        default: return ubLhs == ubRhs;
+    }
+}
+
+static UBYTE scriptPartyHas(UBYTE ubRace, UBYTE ubId)
+{
+    tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+    if (!pParty)
+        return 0;
+    for (UBYTE i = 0; i < pParty->_numCharacters; i++) {
+        tCharacter *pChar = pParty->_characters[i];
+        if (pChar && (ubRace ? pChar->_Race : pChar->_Class) == ubId)
+            return 1;
+    }
+    return 0;
+}
+
+static BOOL evaluateTerm(tMaze *pMaze, const tScriptCondTerm *pTerm)
+{
+    const UBYTE *a = pTerm->_args;
+    tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+    UBYTE ubLhs = 0;
+    UBYTE ubRhs = 1;
+    switch (pTerm->_operand) {
+        case EVENT_PARTY_VISIBLE:
+            ubLhs = 1;
             break;
-            
-        case EVENT_GREATER:
-            switch (operandType) {
-                case EVENT_LEVEL_FLAG:
-                    if (operandValue < 256) {
-                        result = (g_pGameState->m_bLocalFlags[operandValue] > conditionData[3]);
-                    }
-                    break;
-                case EVENT_GLOBAL_FLAG:
-                    if (operandValue < 256) {
-                        result = (g_pGameState->m_bGlobalFlags[operandValue] > conditionData[3]);
-                    }
-                    break;
-            }
+        case EVENT_ROLL_DICE:
+            ubLhs = scriptRollDice(a[0]);
+            ubRhs = a[1];
             break;
-            
-        case EVENT_LESS:
-            switch (operandType) {
-                case EVENT_LEVEL_FLAG:
-                    if (operandValue < 256) {
-                        result = (g_pGameState->m_bLocalFlags[operandValue] < conditionData[3]);
-                    }
-                    break;
-                case EVENT_GLOBAL_FLAG:
-                    if (operandValue < 256) {
-                        result = (g_pGameState->m_bGlobalFlags[operandValue] < conditionData[3]);
-                    }
-                    break;
-            }
+        case EVENT_HAS_CLASS:
+            ubLhs = scriptPartyHas(0, a[0]);
             break;
-            
-        case EVENT_NOT_EQUAL:
-            switch (operandType) {
-                case EVENT_LEVEL_FLAG:
-                    if (operandValue < 256) {
-                        result = (g_pGameState->m_bLocalFlags[operandValue] != conditionData[3]);
-                    }
-                    break;
-                case EVENT_GLOBAL_FLAG:
-                    if (operandValue < 256) {
-                        result = (g_pGameState->m_bGlobalFlags[operandValue] != conditionData[3]);
-                    }
-                    break;
-            }
+        case EVENT_HAS_RACE:
+            ubLhs = scriptPartyHas(1, a[0]);
+            break;
+        case EVENT_POINTER_ITEM:
+            // No cursor item in this engine: the party inventory stands in for it
+            ubLhs = g_pGameState->m_pInventory ?
+                inventoryGetItemCount(g_pGameState->m_pInventory, a[0]) : 0;
+            ubRhs = a[1];
+            break;
+        case EVENT_WALL_SIDE:
+        case EVENT_PARTY_DIRECTION:
+            if (!pParty)
+                return FALSE;
+            ubLhs = pParty->_PartyFacing;
+            ubRhs = a[0];
+            break;
+        case EVENT_LEVEL_FLAG:
+            ubLhs = g_pGameState->m_bLocalFlags[a[0]];
+            ubRhs = a[1];
+            break;
+        case EVENT_GLOBAL_FLAG:
+            ubLhs = g_pGameState->m_bGlobalFlags[a[0]];
+            ubRhs = a[1];
+            break;
+        case EVENT_PARTY_ON_POS:
+            if (!pParty)
+                return FALSE;
+            // Both coordinates must satisfy the comparison; <> means "not on this cell"
+            if (pTerm->_compare == EVENT_NOT_EQUAL)
+                return pParty->_PartyX != a[0] || pParty->_PartyY != a[1];
+            return scriptCompare(pTerm->_compare, pParty->_PartyX, a[0]) &&
+                scriptCompare(pTerm->_compare, pParty->_PartyY, a[1]);
+        case EVENT_MONSTERS_ON_POS:
+            ubLhs = monsterCountAt(pMaze, a[0], a[1]);
+            ubRhs = a[2];
+            break;
+        case EVENT_ITEMS_ON_POS:
+            ubLhs = groundItemQtyAt(&g_pGameState->m_groundItems, a[0], a[1]);
+            ubRhs = a[2];
+            break;
+        case EVENT_WALL_NUMBER:
+            if (a[0] >= pMaze->_width || a[1] >= pMaze->_height)
+                return FALSE;
+            ubLhs = pMaze->_mazeData[a[0] + a[1] * pMaze->_width];
+            ubRhs = a[2];
             break;
     }
-    
-    // Handle logical operators if more data available
-    if (dataSize > 4) {
-        UBYTE logicalOp = conditionData[4];
-        BOOL nextResult = evaluateCondition(pMaze, &conditionData[5], dataSize - 5);
-        
-        switch (logicalOp) {
-            case EVENT_AND:
-                result = result && nextResult;
-                break;
-            case EVENT_OR:
-                result = result || nextResult;
-                break;
-        }
+    return scriptCompare(pTerm->_compare, ubLhs, ubRhs);
+}
+
+// Terms group to the right ("A AND B OR C" is A AND (B OR C)), so a left-to-right
+// walk can stop at the first term that decides the rest.
+static BOOL evaluateCondition(tMaze *pMaze, const tScriptCondition *pCond)
+{
+    for (UBYTE i = 0; i < pCond->_termCount; i++) {
+        const tScriptCondTerm *pTerm = &pCond->_terms[i];
+        BOOL result = evaluateTerm(pMaze, pTerm);
+        if (pTerm->_next == 0)
+            return result;
+        if (pTerm->_next == EVENT_AND && !result)
+            return FALSE;
+        if (pTerm->_next == EVENT_OR && result)
+            return TRUE;
     }
-    
-    
-    return result;
+    return FALSE;
 }
 
-// Stack management functions
-void pushStackFrame(UBYTE type, UWORD address, BOOL conditionMet)
+// Stack management functions; FALSE when the stack is full and nothing was pushed
+BOOL pushStackFrame(tScriptContext *pCtx, UBYTE type, UWORD address, BOOL conditionMet)
 {
-    if (g_pGameState->_scriptState._top < SCRIPT_RETURN_STACK_SIZE) {
-        tStackFrame frame;
-        frame.type = type;
-        frame.address = address;
-        frame.conditionMet = conditionMet;
-        
-        // Store as packed data in the stack
-        g_pGameState->_scriptState._stack[g_pGameState->_scriptState._top] = 
-            (type << 14) | (conditionMet ? 0x2000 : 0) | (address & 0x1FFF);
-        g_pGameState->_scriptState._top++;
+    if (pCtx->_top >= SCRIPT_RETURN_STACK_SIZE) {
+        logWrite("Script stack overflow at ordinal %u\n", (unsigned)pCtx->_scriptProgramCounter);
+        return FALSE;
     }
+    // Store as packed data in the stack
+    pCtx->_stack[pCtx->_top] = 
+        (type << 14) | (conditionMet ? 0x2000 : 0) | (address & 0x1FFF);
+    pCtx->_top++;
+    return TRUE;
 }
 
-tStackFrame popStackFrame()
+tStackFrame popStackFrame(tScriptContext *pCtx)
 {
     tStackFrame frame = {0, 0, FALSE};
-    if (g_pGameState->_scriptState._top > 0) {
-        g_pGameState->_scriptState._top--;
-        UWORD packed = g_pGameState->_scriptState._stack[g_pGameState->_scriptState._top];
+    if (pCtx->_top > 0) {
+        pCtx->_top--;
+        UWORD packed = pCtx->_stack[pCtx->_top];
         frame.type = (packed >> 14) & 0x3;
         frame.conditionMet = (packed & 0x2000) != 0;
         frame.address = packed & 0x1FFF;
@@ -188,97 +283,287 @@ tStackFrame popStackFrame()
     return frame;
 }
 
-BOOL isStackEmpty()
+BOOL isStackEmpty(tScriptContext *pCtx)
 {
-    return g_pGameState->_scriptState._top == 0;
+    return pCtx->_top == 0;
 }
 
-// Event data validation
-BOOL validateEventData(tMazeEvent *pEvent, tMaze *pMaze)
+// Smallest payload each opcode reads; the handlers rely on the verifier for this
+static UBYTE scriptMinPayload(UBYTE ubType)
 {
-    switch (pEvent->_eventType) {
+    switch (ubType) {
+        case EVENT_SETWALL:
+        case EVENT_SETFLOOR:
+        case EVENT_SETCOL:
+        case EVENT_SHOWMESSAGE:
+        case EVENT_GIVEITEM:
+        case EVENT_TAKEITEM:
+        case EVENT_ADDXP:
+        case EVENT_DAMAGE:
+        case EVENT_SOUND:
+        case EVENT_ENCOUNTER:
+        case EVENT_GOTO:
+        case EVENT_GOSUB:
+            return 1;
+        case EVENT_SETWALLCOL:
         case EVENT_TELEPORT:
+        case EVENT_SETFLAG:
+        case EVENT_CLEARFLAG:
+        case EVENT_REMOVEMONSTER:
+        case EVENT_TURN:
+            return 2;
         case EVENT_ADDMONSTER:
-            return pEvent->_eventDataSize >= 2;
+        case EVENT_CHANGE_LEVEL:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+// Checks that only need the event itself and the maze size
+static BOOL scriptCheckEvent(tMaze *pMaze, tMazeEvent *pEvent)
+{
+    const UBYTE *pData = pEvent->_eventData;
+    if (pEvent->_x >= pMaze->_width || pEvent->_y >= pMaze->_height) {
+        logWrite("Event type %d outside the maze at (%d,%d)\n", pEvent->_eventType, pEvent->_x, pEvent->_y);
+        return FALSE;
+    }
+    if (pEvent->_eventDataSize < scriptMinPayload(pEvent->_eventType) || (pEvent->_eventDataSize && !pData)) {
+        logWrite("Event type %d at (%d,%d): payload too short (%d bytes)\n",
+            pEvent->_eventType, pEvent->_x, pEvent->_y, pEvent->_eventDataSize);
+        return FALSE;
+    }
+    switch (pEvent->_eventType) {
         case EVENT_OPENDOOR:
-            // Can work with size 0/1 (uses event position) or size >= 2 (uses data)
+            // Size 0/1 uses the event cell, size >= 2 the cell in the payload
+            if (pEvent->_eventDataSize >= 2 && (pData[0] >= pMaze->_width || pData[1] >= pMaze->_height)) {
+                logWrite("Invalid door coordinates (%d,%d)\n", pData[0], pData[1]);
+                return FALSE;
+            }
             return TRUE;
-        case EVENT_SETWALL:
-        case EVENT_SETFLOOR:
-        case EVENT_SETCOL:
         case EVENT_SETFLAG:
         case EVENT_CLEARFLAG:
-            return pEvent->_eventDataSize >= 1;
+            // 0 = local, 1 = global; the index is a UBYTE so it always fits the 256-entry tables
+            if (pData[0] > 1) {
+                logWrite("Event type %d at (%d,%d): bad flag table %d\n",
+                    pEvent->_eventType, pEvent->_x, pEvent->_y, pData[0]);
+                return FALSE;
+            }
+            return TRUE;
         case EVENT_GOTO:
         case EVENT_GOSUB:
-            return pEvent->_eventDataSize >= 1 && pEvent->_eventData[0] < pMaze->_eventCount;
+            if (pData[0] >= pMaze->_eventCount) {
+                logWrite("Event type %d at (%d,%d): jump target %d out of range\n",
+                    pEvent->_eventType, pEvent->_x, pEvent->_y, pData[0]);
+                return FALSE;
+            }
+            return TRUE;
+        case EVENT_IF:
+            return scriptCompileCondition(pEvent);
         default:
-            return TRUE; // Assume valid for unspecified events
+            return TRUE;
     }
 }
 
+#define SCRIPT_CALL_BAD 0xFF
+
+// Per GOSUB target ordinal: the event there (NULL if nothing calls it) and the stack frames a call
+// needs until its RETURN, SCRIPT_CALL_BAD when the calls recurse or need more than the stack holds
+static tMazeEvent *s_pCallTarget[256];
+static UBYTE s_pCallNeed[256];
+
+// IFs and nested GOSUBs from pStart to the end of its anchor run, with the callee needs known so far.
+// GOTOs are not followed; pushStackFrame() still stops a script that overflows through one.
+static UBYTE scriptCallScan(tMaze *pMaze, tMazeEvent *pStart)
+{
+    UWORD uwDepth = 0;
+    UWORD uwNeed = 0;
+    for (tMazeEvent *pEvent = pStart; pEvent && pEvent->_x == pStart->_x && pEvent->_y == pStart->_y;
+        pEvent = pEvent->_next) {
+        UWORD uwHere = 0;
+        if (pEvent->_eventType == EVENT_IF)
+            uwHere = ++uwDepth;
+        else if (pEvent->_eventType == EVENT_ENDIF && uwDepth)
+            uwDepth--;
+        else if (pEvent->_eventType == EVENT_RETURN && !uwDepth)
+            break;
+        else if (pEvent->_eventType == EVENT_GOSUB && pEvent->_eventDataSize && pEvent->_eventData
+            && pEvent->_eventData[0] < pMaze->_eventCount) {
+            UBYTE ubSub = s_pCallNeed[pEvent->_eventData[0]];
+            if (ubSub == SCRIPT_CALL_BAD)
+                return SCRIPT_CALL_BAD;
+            uwHere = (UWORD)(uwDepth + 1 + ubSub);
+        }
+        if (uwHere > uwNeed)
+            uwNeed = uwHere;
+    }
+    return uwNeed > SCRIPT_RETURN_STACK_SIZE ? SCRIPT_CALL_BAD : (UBYTE)uwNeed;
+}
+
+// Needs only grow, so rescanning every target until none changes settles them; a recursive
+// chain grows on every pass until it passes the stack size and turns SCRIPT_CALL_BAD
+static void scriptCallDepths(tMaze *pMaze)
+{
+    memset(s_pCallTarget, 0, sizeof(s_pCallTarget));
+    memset(s_pCallNeed, 0, sizeof(s_pCallNeed));
+    for (tMazeEvent *pEvent = pMaze->_events; pEvent; pEvent = pEvent->_next) {
+        if (pEvent->_eventType == EVENT_GOSUB && pEvent->_eventDataSize && pEvent->_eventData
+            && pEvent->_eventData[0] < pMaze->_eventCount)
+            s_pCallTarget[pEvent->_eventData[0]] = pEvent;  // Marked; the target event is found below
+    }
+    UWORD uwOrdinal = 0;
+    for (tMazeEvent *pEvent = pMaze->_events; pEvent && uwOrdinal < 256; pEvent = pEvent->_next, uwOrdinal++) {
+        if (s_pCallTarget[uwOrdinal])
+            s_pCallTarget[uwOrdinal] = pEvent;
+    }
+    UBYTE isChanged;
+    do {
+        isChanged = 0;
+        for (UWORD t = 256; t-- > 0;) {
+            if (!s_pCallTarget[t] || s_pCallNeed[t] == SCRIPT_CALL_BAD)
+                continue;
+            UBYTE ubNeed = scriptCallScan(pMaze, s_pCallTarget[t]);
+            if (ubNeed != s_pCallNeed[t]) {
+                s_pCallNeed[t] = ubNeed;
+                isChanged = 1;
+            }
+        }
+    } while (isChanged);
+}
+
+UWORD scriptVerifyMaze(tMaze *pMaze)
+{
+    UWORD uwRejected = 0;
+    UBYTE ubDepth = 0;
+    scriptCallDepths(pMaze);
+    tMazeEvent *pPrev = NULL;
+    for (tMazeEvent *pEvent = pMaze->_events; pEvent; pPrev = pEvent, pEvent = pEvent->_next) {
+        // A script never runs past its anchor cell, so IF nesting is per run of same-cell events
+        if (pPrev && (pPrev->_x != pEvent->_x || pPrev->_y != pEvent->_y)) {
+            if (ubDepth)
+                logWrite("Script at (%d,%d) ends with %d open IF(s)\n", pPrev->_x, pPrev->_y, ubDepth);
+            ubDepth = 0;
+        }
+        BOOL isValid = scriptCheckEvent(pMaze, pEvent);
+        switch (pEvent->_eventType) {
+            case EVENT_IF:
+                if (++ubDepth > SCRIPT_RETURN_STACK_SIZE) {
+                    logWrite("IF at (%d,%d) nested deeper than %d\n", pEvent->_x, pEvent->_y, SCRIPT_RETURN_STACK_SIZE);
+                    isValid = FALSE;
+                }
+                break;
+            case EVENT_GOSUB:
+                // IF frames open here, the return address, then whatever the callee needs
+                if (isValid) {
+                    UBYTE ubSub = s_pCallNeed[pEvent->_eventData[0]];
+                    if (ubSub == SCRIPT_CALL_BAD || ubDepth + 1 + ubSub > SCRIPT_RETURN_STACK_SIZE) {
+                        logWrite("GOSUB at (%d,%d) recurses or nests deeper than %d\n",
+                            pEvent->_x, pEvent->_y, SCRIPT_RETURN_STACK_SIZE);
+                        isValid = FALSE;
+                    }
+                }
+                break;
+            case EVENT_ELSE:
+            case EVENT_ENDIF:
+                if (!ubDepth) {
+                    logWrite("Event type %d at (%d,%d) without IF\n", pEvent->_eventType, pEvent->_x, pEvent->_y);
+                    isValid = FALSE;
+                }
+                else if (pEvent->_eventType == EVENT_ENDIF) {
+                    ubDepth--;
+                }
+                break;
+        }
+        if (isValid) {
+            pEvent->_flags &= ~MAZE_EVENT_INVALID;
+        }
+        else {
+            pEvent->_flags |= MAZE_EVENT_INVALID;
+            uwRejected++;
+        }
+    }
+    pMaze->_eventsVerified = 1;
+    // The list changed: running scripts look their event up again by ordinal
+    if (g_pGameState) {
+        for (UBYTE i = 0; i < SCRIPT_MAX_CONTEXTS; i++)
+            g_pGameState->_scriptContexts[i]._pEvent = NULL;
+    }
+    return uwRejected;
+}
+
+// Cell writes go through here so the save journal sees them
+static void scriptSetCell(tMaze *pMaze, UBYTE layer, UBYTE x, UBYTE y, UBYTE value)
+{
+    UWORD idx = x + y * pMaze->_width;
+    if (layer == SAVE_JOURNAL_LAYER_WALL) {
+        pMaze->_mazeData[idx] = value;
+        partyFieldCellChanged(x, y);
+    }
+    else if (layer == SAVE_JOURNAL_LAYER_FLOOR)
+        pMaze->_mazeFloor[idx] = value;
+    else
+        pMaze->_mazeCol[idx] = value;
+    saveJournalCell(layer, x, y, value);
+}
+
 // Main event execution function
-tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
+tScriptExecutionResult executeEvent(tScriptContext *pCtx, tMaze *pMaze, tMazeEvent *pEvent)
 {
+    // Payload sizes, coordinates and jump targets were checked by scriptVerifyMaze()
     tScriptExecutionResult result = {SCRIPT_RESULT_CONTINUE, 0, SCRIPT_ERROR_NONE};
     
-    // Validate event data
-    if (!validateEventData(pEvent, pMaze)) {
-        logWrite("Invalid event data for event type %d\n", pEvent->_eventType);
-        result.result = SCRIPT_RESULT_ERROR;
-        result.error = SCRIPT_ERROR_INVALID_EVENT;
-        return result;
-    }
-    
+#ifdef GAME_DEBUG_SCRIPT
     logWrite("Executing event type %d at (%d,%d) with data size %d\n", 
         pEvent->_eventType, pEvent->_x, pEvent->_y, pEvent->_eventDataSize);
+#endif
     
     switch (pEvent->_eventType)
     {
     case EVENT_SETWALL:
-        pMaze->_mazeData[pEvent->_x + pEvent->_y * pMaze->_width] = pEvent->_eventData[0];
+        scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_WALL, pEvent->_x, pEvent->_y, pEvent->_eventData[0]);
         break;
         
     case EVENT_SETFLOOR:
-        pMaze->_mazeFloor[pEvent->_x + pEvent->_y * pMaze->_width] = pEvent->_eventData[0];
+        scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_FLOOR, pEvent->_x, pEvent->_y, pEvent->_eventData[0]);
         break;
         
     case EVENT_SETCOL:
-        pMaze->_mazeCol[pEvent->_x + pEvent->_y * pMaze->_width] = pEvent->_eventData[0];
+        scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_COL, pEvent->_x, pEvent->_y, pEvent->_eventData[0]);
         break;
         
     case EVENT_CLEARWALL:
-        pMaze->_mazeData[pEvent->_x + pEvent->_y * pMaze->_width] = 0;
+        scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_WALL, pEvent->_x, pEvent->_y, 0);
         break;
         
     case EVENT_CLEARFLOOR:
-        pMaze->_mazeFloor[pEvent->_x + pEvent->_y * pMaze->_width] = 0;
+        scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_FLOOR, pEvent->_x, pEvent->_y, 0);
         break;
         
     case EVENT_CLEARCOL:
-        pMaze->_mazeCol[pEvent->_x + pEvent->_y * pMaze->_width] = 0;
+        scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_COL, pEvent->_x, pEvent->_y, 0);
         break;
         
     case EVENT_SETWALLCOL:
-        if (pEvent->_eventDataSize >= 2) {
-            pMaze->_mazeData[pEvent->_x + pEvent->_y * pMaze->_width] = pEvent->_eventData[0];
-            pMaze->_mazeCol[pEvent->_x + pEvent->_y * pMaze->_width] = pEvent->_eventData[1];
+        {
+            scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_WALL, pEvent->_x, pEvent->_y, pEvent->_eventData[0]);
+            scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_COL, pEvent->_x, pEvent->_y, pEvent->_eventData[1]);
         }
         break;
         
     case EVENT_CLEARWALLCOL:
-        pMaze->_mazeData[pEvent->_x + pEvent->_y * pMaze->_width] = 0;
-        pMaze->_mazeCol[pEvent->_x + pEvent->_y * pMaze->_width] = 0;
+        scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_WALL, pEvent->_x, pEvent->_y, 0);
+        scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_COL, pEvent->_x, pEvent->_y, 0);
         break;
         
     case EVENT_SHOWMESSAGE:
-        if (pEvent->_eventDataSize > 0) {
+        {
             UWORD messageId = pEvent->_eventData[0];
             if (pEvent->_eventDataSize >= 2)
                 messageId |= (UWORD)(pEvent->_eventData[1] << 8);
-            char msgBuffer[512];
-            if (mazeGetStringByIndex(pMaze, messageId, msgBuffer, sizeof(msgBuffer))) {
-                gameDisplayMessage(msgBuffer);
+            UWORD length;
+            const char* text = mazeGetString(pMaze, messageId, &length);
+            if (text) {
+                gameDisplayText(text, length);
             } else {
                 logWrite("Showing message ID: %d (no string in maze table)\n", (int)messageId);
             }
@@ -292,12 +577,12 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
             logWrite("Opening door at (%d,%d)\n", doorX, doorY);
             tDoorAnim* anim = doorAnimCreate(doorX, doorY, DOOR_ANIM_OPENING);
             doorAnimAdd(pMaze, anim);
-            pMaze->_mazeData[doorX + doorY * pMaze->_width] = MAZE_DOOR_OPEN;
+            scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_WALL, doorX, doorY, MAZE_DOOR_OPEN);
         } else {
             logWrite("Opening door at event position (%d,%d)\n", pEvent->_x, pEvent->_y);
             tDoorAnim* anim = doorAnimCreate(pEvent->_x, pEvent->_y, DOOR_ANIM_OPENING);
             doorAnimAdd(pMaze, anim);
-            pMaze->_mazeData[pEvent->_x + pEvent->_y * pMaze->_width] = MAZE_DOOR_OPEN;
+            scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_WALL, pEvent->_x, pEvent->_y, MAZE_DOOR_OPEN);
         }
         break;
         
@@ -305,7 +590,7 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
         {
             tDoorAnim* anim = doorAnimCreate(pEvent->_x, pEvent->_y, DOOR_ANIM_CLOSING);
             doorAnimAdd(pMaze, anim);
-            pMaze->_mazeData[pEvent->_x + pEvent->_y * pMaze->_width] = MAZE_DOOR;
+            scriptSetCell(pMaze, SAVE_JOURNAL_LAYER_WALL, pEvent->_x, pEvent->_y, MAZE_DOOR);
         }
         break;
         
@@ -316,6 +601,7 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
             if (g_pGameState->m_pCurrentParty->_BatteryLevel < 100) {
                 g_pGameState->m_pCurrentParty->_BatteryLevel += 1;
                 pEvent->_eventData[0]--;  // Decrement charger's remaining charge
+                saveJournalEventByte(mazeEventOrdinalOf(pMaze, pEvent), 0, pEvent->_eventData[0]);
                 logWrite("Battery recharged to %d, charger has %d units left\n", 
                     g_pGameState->m_pCurrentParty->_BatteryLevel, pEvent->_eventData[0]);
             }
@@ -325,7 +611,7 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
         break;
         
     case EVENT_TELEPORT:
-        if (pEvent->_eventDataSize >= 2) {
+        {
             UBYTE targetX = pEvent->_eventData[0];
             UBYTE targetY = pEvent->_eventData[1];
             logWrite("Teleporting party to (%d,%d)\n", targetX, targetY);
@@ -345,7 +631,7 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
         break;
         
     case EVENT_GIVEITEM:
-        if (pEvent->_eventDataSize >= 1 && g_pGameState->m_pInventory) {
+        if (g_pGameState->m_pInventory) {
             UBYTE itemType = pEvent->_eventData[0];
             UBYTE quantity = pEvent->_eventDataSize > 1 ? pEvent->_eventData[1] : 1;
             if (inventoryAddItem(g_pGameState->m_pInventory, itemType, quantity)) {
@@ -357,7 +643,7 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
         break;
         
     case EVENT_TAKEITEM:
-        if (pEvent->_eventDataSize >= 1 && g_pGameState->m_pInventory) {
+        if (g_pGameState->m_pInventory) {
             UBYTE itemType = pEvent->_eventData[0];
             UBYTE quantity = pEvent->_eventDataSize > 1 ? pEvent->_eventData[1] : 1;
             if (inventoryRemoveItem(g_pGameState->m_pInventory, itemType, quantity)) {
@@ -369,75 +655,62 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
         break;
         
     case EVENT_SETFLAG:
-        if (pEvent->_eventDataSize >= 2) {
+        {
             UBYTE flagType = pEvent->_eventData[0]; // 0=local, 1=global
             UBYTE flagIndex = pEvent->_eventData[1];
             UBYTE flagValue = pEvent->_eventDataSize > 2 ? pEvent->_eventData[2] : 1;
             
-            if (flagIndex < 256) {
-                if (flagType == 0) {
-                    g_pGameState->m_bLocalFlags[flagIndex] = flagValue;
-                    logWrite("Set local flag %d to %d\n", flagIndex, flagValue);
-                } else {
-                    g_pGameState->m_bGlobalFlags[flagIndex] = flagValue;
-                    logWrite("Set global flag %d to %d\n", flagIndex, flagValue);
-                }
+            if (flagType == 0) {
+                g_pGameState->m_bLocalFlags[flagIndex] = flagValue;
+                logWrite("Set local flag %d to %d\n", flagIndex, flagValue);
+            } else {
+                g_pGameState->m_bGlobalFlags[flagIndex] = flagValue;
+                logWrite("Set global flag %d to %d\n", flagIndex, flagValue);
             }
         }
         break;
         
     case EVENT_CLEARFLAG:
-        if (pEvent->_eventDataSize >= 2) {
+        {
             UBYTE flagType = pEvent->_eventData[0]; // 0=local, 1=global
             UBYTE flagIndex = pEvent->_eventData[1];
             
-            if (flagIndex < 256) {
-                if (flagType == 0) {
-                    g_pGameState->m_bLocalFlags[flagIndex] = 0;
-                    logWrite("Cleared local flag %d\n", flagIndex);
-                } else {
-                    g_pGameState->m_bGlobalFlags[flagIndex] = 0;
-                    logWrite("Cleared global flag %d\n", flagIndex);
-                }
+            if (flagType == 0) {
+                g_pGameState->m_bLocalFlags[flagIndex] = 0;
+                logWrite("Cleared local flag %d\n", flagIndex);
+            } else {
+                g_pGameState->m_bGlobalFlags[flagIndex] = 0;
+                logWrite("Cleared global flag %d\n", flagIndex);
             }
         }
         break;
         
     case EVENT_ADDMONSTER:
-        if (pEvent->_eventDataSize >= 3) {
+        {
             UBYTE monsterType = pEvent->_eventData[0];
             UBYTE x = pEvent->_eventData[1];
             UBYTE y = pEvent->_eventData[2];
             
-            tMonster* monster = monsterCreate(monsterType);
-            if (monster) {
-                monsterPlaceInMaze(pMaze, monster, x, y);
-                if (g_pGameState->m_pMonsterList->_numMonsters < MAX_MONSTERS) {
-                    g_pGameState->m_pMonsterList->_monsters[g_pGameState->m_pMonsterList->_numMonsters++] = monster;
-                    logWrite("Added monster type %d at (%d,%d)\n", monsterType, x, y);
-                } else {
-                    logWrite("Monster list full, cannot add monster\n");
-                    monsterDestroy(monster);
-                }
+            // Usually the dormant monster made for this event at level load
+            if (encounterSpawn(&g_pGameState->m_encounters, pMaze, g_pGameState->m_pMonsterList, monsterType, x, y)) {
+                saveJournalMonsterAdd(monsterType, x, y);
+                logWrite("Added monster type %d at (%d,%d)\n", monsterType, x, y);
+            } else {
+                logWrite("Monster list full, cannot add monster\n");
             }
         }
         break;
         
     case EVENT_REMOVEMONSTER:
-        if (pEvent->_eventDataSize >= 2) {
+        {
             UBYTE x = pEvent->_eventData[0];
             UBYTE y = pEvent->_eventData[1];
             
             for (UBYTE i = 0; i < g_pGameState->m_pMonsterList->_numMonsters; i++) {
                 tMonster* monster = g_pGameState->m_pMonsterList->_monsters[i];
                 if (monster->_partyPosX == x && monster->_partyPosY == y) {
-                    monsterRemoveFromMaze(pMaze, monster);
-                    monsterDestroy(monster);
-                    
-                    for (UBYTE j = i; j < g_pGameState->m_pMonsterList->_numMonsters - 1; j++) {
-                        g_pGameState->m_pMonsterList->_monsters[j] = g_pGameState->m_pMonsterList->_monsters[j + 1];
-                    }
-                    g_pGameState->m_pMonsterList->_numMonsters--;
+                    saveJournalMonsterRemove(monster->_spawnId);
+                    monsterListRemove(g_pGameState->m_pMonsterList, pMaze, i);
                     logWrite("Removed monster at (%d,%d)\n", x, y);
                     break;
                 }
@@ -446,7 +719,7 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
         break;
         
     case EVENT_ADDXP:
-        if (pEvent->_eventDataSize >= 1 && g_pGameState->m_pCurrentParty) {
+        if (g_pGameState->m_pCurrentParty) {
             UWORD xpAmount = pEvent->_eventData[0];
             if (pEvent->_eventDataSize >= 2)
                 xpAmount |= (UWORD)(pEvent->_eventData[1] << 8);
@@ -458,7 +731,7 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
         break;
         
     case EVENT_DAMAGE:
-        if (pEvent->_eventDataSize >= 1 && g_pGameState->m_pCurrentParty) {
+        if (g_pGameState->m_pCurrentParty) {
             UBYTE damageAmount = pEvent->_eventData[0];
             if (g_pGameState->m_pCurrentParty->_BatteryLevel > damageAmount)
                 g_pGameState->m_pCurrentParty->_BatteryLevel -= damageAmount;
@@ -468,7 +741,7 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
         break;
         
     case EVENT_TURN:
-        if (pEvent->_eventDataSize >= 2) {
+        {
             UBYTE direction = pEvent->_eventData[0];
             UBYTE count = pEvent->_eventData[1];
             logWrite("Turning party %s %d times\n", direction ? "right" : "left", count);
@@ -485,62 +758,79 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
         
     case EVENT_IF:
         {
-            BOOL conditionResult = evaluateCondition(pMaze, pEvent->_eventData, pEvent->_eventDataSize);
-            g_pGameState->_scriptState._conditionMet = conditionResult;
+            BOOL conditionResult = scriptCompileCondition(pEvent) &&
+                evaluateCondition(pMaze, pEvent->_condition);
+            pCtx->_conditionMet = conditionResult;
             
             if (!conditionResult) {
-                g_pGameState->_scriptState._skippingBlock = TRUE;
+                pCtx->_skippingBlock = TRUE;
             }
             
-            pushStackFrame(1, g_pGameState->_scriptState._scriptProgramCounter, conditionResult);
+            if (!pushStackFrame(pCtx, 1, pCtx->_scriptProgramCounter, conditionResult)) {
+                result.result = SCRIPT_RESULT_ERROR;
+                result.error = SCRIPT_ERROR_STACK_OVERFLOW;
+                break;
+            }
+#ifdef GAME_DEBUG_SCRIPT
             logWrite("IF condition evaluated to %s\n", conditionResult ? "TRUE" : "FALSE");
+#endif
         }
         break;
         
     case EVENT_ELSE:
-        if (!isStackEmpty()) {
-            tStackFrame frame = popStackFrame();
+        if (!isStackEmpty(pCtx)) {
+            tStackFrame frame = popStackFrame(pCtx);
             if (frame.type == 1) { // IF frame
-                g_pGameState->_scriptState._skippingBlock = frame.conditionMet;
-                pushStackFrame(1, frame.address, frame.conditionMet);
+                pCtx->_skippingBlock = frame.conditionMet;
+                pushStackFrame(pCtx, 1, frame.address, frame.conditionMet);
             }
         }
         break;
         
     case EVENT_ENDIF:
-        if (!isStackEmpty()) {
-            tStackFrame frame = popStackFrame();
+        if (!isStackEmpty(pCtx)) {
+            tStackFrame frame = popStackFrame(pCtx);
             if (frame.type == 1) { // IF frame
-                g_pGameState->_scriptState._skippingBlock = FALSE;
-                g_pGameState->_scriptState._conditionMet = FALSE;
+                pCtx->_skippingBlock = FALSE;
+                pCtx->_conditionMet = FALSE;
             }
         }
         break;
         
     case EVENT_GOTO:
-        if (pEvent->_eventDataSize > 0) {
+        {
             result.result = SCRIPT_RESULT_GOTO;
             result.targetIndex = pEvent->_eventData[0];
+#ifdef GAME_DEBUG_SCRIPT
             logWrite("GOTO to index %d\n", result.targetIndex);
+#endif
         }
         break;
         
     case EVENT_GOSUB:
-        if (pEvent->_eventDataSize > 0) {
-            pushStackFrame(2, g_pGameState->_scriptState._scriptProgramCounter + 1, FALSE);
+        {
+            if (!pushStackFrame(pCtx, 2, pCtx->_scriptProgramCounter + 1, FALSE)) {
+                result.result = SCRIPT_RESULT_ERROR;
+                result.error = SCRIPT_ERROR_STACK_OVERFLOW;
+                break;
+            }
             result.result = SCRIPT_RESULT_GOSUB;
             result.targetIndex = pEvent->_eventData[0];
+#ifdef GAME_DEBUG_SCRIPT
             logWrite("GOSUB to index %d\n", result.targetIndex);
+#endif
         }
         break;
         
     case EVENT_RETURN:
-        if (!isStackEmpty()) {
-            tStackFrame frame = popStackFrame();
+        if (!isStackEmpty(pCtx)) {
+            tStackFrame frame = popStackFrame(pCtx);
             if (frame.type == 2) { // GOSUB frame
                 result.result = SCRIPT_RESULT_RETURN;
                 result.targetIndex = frame.address;
+#ifdef GAME_DEBUG_SCRIPT
                 logWrite("RETURN to index %d\n", result.targetIndex);
+#endif
             }
         } else {
             logWrite("RETURN stack underflow!\n");
@@ -550,7 +840,7 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
         break;
         
     case EVENT_SOUND:
-        if (pEvent->_eventDataSize >= 1) {
+        {
             UBYTE soundId = pEvent->_eventData[0];
             logWrite("Playing sound ID: %d\n", soundId);
             /* SFX API not wired yet; placeholder for ptplayer or sound effects */
@@ -560,12 +850,31 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
     case EVENT_WIN:
         g_ubRequestWin = 1;
         break;
+
+    case EVENT_CHANGE_LEVEL:
+        // Loading frees this maze, so the game loop does it once the script has returned
+        g_sLevelRequest.isPending = 1;
+        g_sLevelRequest.ubLevel = pEvent->_eventData[0];
+        g_sLevelRequest.ubX = pEvent->_eventData[1];
+        g_sLevelRequest.ubY = pEvent->_eventData[2];
+        g_sLevelRequest.ubFacing = pEvent->_eventDataSize > 3 ? pEvent->_eventData[3] & 3 : 0;
+        result.result = SCRIPT_RESULT_END;
+        break;
+        
+    case EVENT_WAIT:
+        pCtx->_waitFrames = pEvent->_eventDataSize >= 1 ? pEvent->_eventData[0] : 0;
+        result.result = SCRIPT_RESULT_YIELD;
+        break;
         
     case EVENT_ENCOUNTER:
-        if (pEvent->_eventDataSize >= 1) {
+        {
             UBYTE encounterId = pEvent->_eventData[0];
-            logWrite("Starting encounter ID: %d\n", encounterId);
-            // TODO: Implement encounter system integration
+            if (encounterTrigger(&g_pGameState->m_encounters, pMaze, g_pGameState->m_pMonsterList, encounterId)) {
+                saveJournalEncounter(encounterId);
+                logWrite("Started encounter %d\n", encounterId);
+            } else {
+                logWrite("Encounter %d is unknown or already fired\n", encounterId);
+            }
         }
         break;
         
@@ -582,6 +891,15 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
     case EVENT_PARTY_DIRECTION:
     case EVENT_HAS_CLASS:
     case EVENT_HAS_RACE:
+    case EVENT_PARTY_VISIBLE:
+    case EVENT_ROLL_DICE:
+    case EVENT_TRIGGER_FLAG:
+    case EVENT_POINTER_ITEM:
+    case EVENT_WALL_SIDE:
+    case EVENT_ELSE_GOTO:
+    case EVENT_MONSTERS_ON_POS:
+    case EVENT_ITEMS_ON_POS:
+    case EVENT_WALL_NUMBER:
         logWrite("Warning: Condition event %d executed directly\n", pEvent->_eventType);
         break;
         
@@ -593,100 +911,214 @@ tScriptExecutionResult executeEvent(tMaze *pMaze, tMazeEvent *pEvent)
     return result;
 }
 
-// Main script execution function (linked-list safe; stops when maze event list leaves anchor cell)
-void executeScript(tMaze *pMaze, UWORD startIndex)
+static void scriptContextJump(tScriptContext *pCtx, tMaze *pMaze, UWORD targetIndex)
 {
-    if (!pMaze || !pMaze->_events || pMaze->_eventCount == 0 || !g_pGameState) {
-        logWrite("No script events to execute.\n");
-        return;
-    }
-
-    tMazeEvent* startEv = mazeEventAtOrdinal(pMaze, startIndex);
-    if (!startEv) {
-        logWrite("executeScript: bad start index %u\n", (unsigned)startIndex);
-        return;
+    pCtx->_scriptProgramCounter = targetIndex;
+    tMazeEvent* t = mazeEventAtOrdinal(pMaze, targetIndex);
+    pCtx->_pEvent = t;
+    if (t) {
+        pCtx->_anchorX = t->_x;
+        pCtx->_anchorY = t->_y;
     }
+}
 
-    UBYTE anchorX = startEv->_x;
-    UBYTE anchorY = startEv->_y;
-
-    g_pGameState->_scriptState._scriptProgramCounter = startIndex;
-    g_pGameState->_scriptState._top = 0;
-    g_pGameState->_scriptState._conditionMet = FALSE;
-    g_pGameState->_scriptState._skippingBlock = FALSE;
-
-    logWrite("Script from index %u at (%u,%u), %u events.\n",
-        (unsigned)startIndex, anchorX, anchorY, (unsigned)pMaze->_eventCount);
-
-    while (g_pGameState->_scriptState._scriptProgramCounter < pMaze->_eventCount) {
-        tMazeEvent* currentEvent = mazeEventAtOrdinal(
-            pMaze, g_pGameState->_scriptState._scriptProgramCounter);
-        if (!currentEvent)
+// Run one context for at most uwBudget opcodes. Returns the opcodes used.
+// Clears _active when the script ends; leaves it set on EVENT_WAIT or when out of budget.
+static UWORD scriptContextRun(tScriptContext *pCtx, tMaze *pMaze, UWORD uwBudget)
+{
+    UWORD steps = 0;
+    while (steps < uwBudget) {
+        if (pCtx->_scriptProgramCounter >= pMaze->_eventCount) {
+            logWrite("Script execution completed.\n");
+            pCtx->_active = 0;
             break;
+        }
+        if (++pCtx->_stepsSinceYield > SCRIPT_MAX_STEPS) {
+            logWrite("executeScript: step limit reached at ordinal %u\n",
+                (unsigned)pCtx->_scriptProgramCounter);
+            pCtx->_active = 0;
+            break;
+        }
+        steps++;
 
-        if (currentEvent->_x != anchorX || currentEvent->_y != anchorY) {
+        // Straight-line code follows _next; only jumps and a changed event list look the ordinal up
+        if (!pCtx->_pEvent)
+            pCtx->_pEvent = mazeEventAtOrdinal(pMaze, pCtx->_scriptProgramCounter);
+        tMazeEvent* currentEvent = pCtx->_pEvent;
+
+        if (currentEvent->_x != pCtx->_anchorX || currentEvent->_y != pCtx->_anchorY) {
             logWrite("executeScript: anchor cell ended at ordinal %u\n",
-                (unsigned)g_pGameState->_scriptState._scriptProgramCounter);
-            return;
+                (unsigned)pCtx->_scriptProgramCounter);
+            pCtx->_active = 0;
+            break;
         }
 
-        if (g_pGameState->_scriptState._skippingBlock) {
+        if (pCtx->_skippingBlock) {
             if (currentEvent->_eventType != EVENT_ELSE && currentEvent->_eventType != EVENT_ENDIF) {
-                g_pGameState->_scriptState._scriptProgramCounter++;
+                pCtx->_scriptProgramCounter++;
+                pCtx->_pEvent = currentEvent->_next;
                 continue;
             }
         }
 
-        tScriptExecutionResult execResult = executeEvent(pMaze, currentEvent);
+        if (currentEvent->_flags & MAZE_EVENT_INVALID) {
+            logWrite("executeScript: rejected event at ordinal %u\n", (unsigned)pCtx->_scriptProgramCounter);
+            pCtx->_active = 0;
+            break;
+        }
+
+        tScriptExecutionResult execResult = executeEvent(pCtx, pMaze, currentEvent);
 
         switch (execResult.result) {
         case SCRIPT_RESULT_CONTINUE:
-            g_pGameState->_scriptState._scriptProgramCounter++;
+            pCtx->_scriptProgramCounter++;
+            pCtx->_pEvent = currentEvent->_next;
             break;
 
         case SCRIPT_RESULT_GOTO:
         case SCRIPT_RESULT_GOSUB:
-            if (execResult.targetIndex < pMaze->_eventCount) {
-                g_pGameState->_scriptState._scriptProgramCounter = execResult.targetIndex;
-                tMazeEvent* t = mazeEventAtOrdinal(pMaze, execResult.targetIndex);
-                if (t) {
-                    anchorX = t->_x;
-                    anchorY = t->_y;
-                }
-            } else {
-                logWrite("Invalid jump target: %u\n", (unsigned)execResult.targetIndex);
-                g_pGameState->_scriptState._scriptProgramCounter++;
-            }
-            break;
-
         case SCRIPT_RESULT_RETURN:
-            g_pGameState->_scriptState._scriptProgramCounter = execResult.targetIndex;
-            {
-                tMazeEvent* t = mazeEventAtOrdinal(pMaze, execResult.targetIndex);
-                if (t) {
-                    anchorX = t->_x;
-                    anchorY = t->_y;
-                }
-            }
+            scriptContextJump(pCtx, pMaze, execResult.targetIndex);
             break;
 
+        case SCRIPT_RESULT_YIELD:
+            pCtx->_scriptProgramCounter++;
+            pCtx->_pEvent = currentEvent->_next;
+            pCtx->_stepsSinceYield = 0;
+            return steps;
+
         case SCRIPT_RESULT_END:
             logWrite("Script execution ended.\n");
-            return;
+            pCtx->_active = 0;
+            return steps;
 
         case SCRIPT_RESULT_ERROR:
             logWrite("Script execution error: %d\n", execResult.error);
-            return;
+            pCtx->_active = 0;
+            return steps;
+        }
+    }
+    return steps;
+}
+
+void executeScript(tMaze *pMaze, UWORD startIndex)
+{
+    if (!pMaze || !pMaze->_events || pMaze->_eventCount == 0 || !g_pGameState) {
+        logWrite("No script events to execute.\n");
+        return;
+    }
+
+    if (!pMaze->_eventsVerified) {
+        UWORD rejected = scriptVerifyMaze(pMaze);
+        if (rejected)
+            logWrite("executeScript: %u invalid event(s) after the event list changed\n", (unsigned)rejected);
+    }
+
+    tMazeEvent* startEv = mazeEventAtOrdinal(pMaze, startIndex);
+    if (!startEv) {
+        logWrite("executeScript: bad start index %u\n", (unsigned)startIndex);
+        return;
+    }
+
+    tScriptContext* pCtx = NULL;
+    for (UBYTE i = 0; i < SCRIPT_MAX_CONTEXTS; i++) {
+        if (!g_pGameState->_scriptContexts[i]._active) {
+            pCtx = &g_pGameState->_scriptContexts[i];
+            break;
         }
     }
 
-    logWrite("Script execution completed.\n");
+    // Pool exhausted: run to completion on a temporary context rather than drop the script
+    tScriptContext sDetached;
+    UBYTE isDetached = (pCtx == NULL);
+    if (isDetached) {
+        logWrite("executeScript: no free context, running index %u synchronously\n", (unsigned)startIndex);
+        pCtx = &sDetached;
+    }
+
+    memset(pCtx, 0, sizeof(tScriptContext));
+    pCtx->_active = 1;
+    pCtx->_scriptProgramCounter = startIndex;
+    pCtx->_pEvent = startEv;
+    pCtx->_anchorX = startEv->_x;
+    pCtx->_anchorY = startEv->_y;
+
+    logWrite("Script from index %u at (%u,%u), %u events.\n",
+        (unsigned)startIndex, pCtx->_anchorX, pCtx->_anchorY, (unsigned)pMaze->_eventCount);
+
+    if (isDetached) {
+        // EVENT_WAIT cannot suspend a detached script, so it only ends the slice
+        UWORD total = 0;
+        while (pCtx->_active && total < SCRIPT_MAX_STEPS)
+            total += scriptContextRun(pCtx, pMaze, SCRIPT_MAX_STEPS - total);
+        return;
+    }
+
+    scriptContextRun(pCtx, pMaze, s_uwFrameBudget);
+}
+
+UWORD scriptUpdate(tMaze *pMaze)
+{
+    if (!pMaze || !g_pGameState)
+        return 0;
+
+    if (!pMaze->_eventsVerified)
+        scriptVerifyMaze(pMaze);
+
+    UWORD budget = s_uwFrameBudget;
+    UWORD executed = 0;
+    // Round-robin start so one busy script cannot starve the others
+    UBYTE first = s_ubNextContext;
+    s_ubNextContext = (UBYTE)((s_ubNextContext + 1) % SCRIPT_MAX_CONTEXTS);
+    for (UBYTE n = 0; n < SCRIPT_MAX_CONTEXTS && budget > 0; n++) {
+        tScriptContext* pCtx = &g_pGameState->_scriptContexts[(first + n) % SCRIPT_MAX_CONTEXTS];
+        if (!pCtx->_active)
+            continue;
+        if (pCtx->_waitFrames > 0) {
+            pCtx->_waitFrames--;
+            continue;
+        }
+        UWORD used = scriptContextRun(pCtx, pMaze, budget);
+        budget -= used;
+        executed += used;
+    }
+    return executed;
+}
+
+void scriptSetFrameBudget(UWORD uwOpcodes)
+{
+    s_uwFrameBudget = uwOpcodes ? uwOpcodes : 1;
+}
+
+UBYTE scriptActiveCount(void)
+{
+    UBYTE count = 0;
+    if (!g_pGameState)
+        return 0;
+    for (UBYTE i = 0; i < SCRIPT_MAX_CONTEXTS; i++) {
+        if (g_pGameState->_scriptContexts[i]._active)
+            count++;
+    }
+    return count;
+}
+
+void scriptStopAll(void)
+{
+    if (!g_pGameState)
+        return;
+    for (UBYTE i = 0; i < SCRIPT_MAX_CONTEXTS; i++)
+        g_pGameState->_scriptContexts[i]._active = 0;
 }
 
 // Legacy handleEvent function for compatibility
 void handleEvent(tMaze *pMaze, tMazeEvent *pEvent)
 {
-    executeEvent(pMaze, pEvent);
+    // Single opcode: flow control has nothing to act on, so a throwaway context is enough
+    tScriptContext sCtx;
+    if (!scriptCheckEvent(pMaze, pEvent))
+        return;
+    memset(&sCtx, 0, sizeof(sCtx));
+    executeEvent(&sCtx, pMaze, pEvent);
 }
 
 void createEventTrigger(tMaze* pMaze, UBYTE x, UBYTE y, UBYTE eventType, UBYTE eventDataSize, UBYTE* eventData)
@@ -696,6 +1128,7 @@ void createEventTrigger(tMaze* pMaze, UBYTE x, UBYTE y, UBYTE eventType, UBYTE e
     
     // Set the cell as an event trigger
     pMaze->_mazeData[x + y * pMaze->_width] = MAZE_EVENT_TRIGGER;
+    partyFieldCellChanged(x, y);
     
     // Create and add the event
     tMazeEvent* pEvent = mazeEventCreate(x, y, eventType, eventDataSize, eventData);
@@ -801,16 +1234,20 @@ void updateBatteryChargers(tMaze* maze)
     
     // Iterate through all events and recharge battery chargers
     tMazeEvent* event = maze->_events;
+    UWORD ordinal = 0;
     while (event != NULL) {
         if (event->_eventType == EVENT_BATTERY_CHARGER) {
             // If charger has event data and charge is below max (25), slowly recharge
             if (event->_eventDataSize > 0 && event->_eventData[0] < 25) {
                 event->_eventData[0]++;  // Recharge by 1 unit
+                // Journalled like the drain, so a save keeps the refilled charge
+                saveJournalEventByte(ordinal, 0, event->_eventData[0]);
                 logWrite("Battery charger at (%d,%d) recharged to %d/25\n", 
                     event->_x, event->_y, event->_eventData[0]);
             }
         }
         event = event->_next;
+        ordinal++;
     }
 }
 
@@ -0,0 +1,131 @@
+#include "slz.h"
+#include <string.h>
+
+typedef struct {
+	const UBYTE *ip;
+	const UBYTE *end;
+	tBinReader *reader; // NULL: all input is already in [ip, end)
+	ULONG left;         // stream bytes not yet pulled from reader
+} tSlzInput;
+
+static UBYTE slzRefill(tSlzInput *in)
+{
+	if (!in->reader || !in->left)
+		return 0;
+	// Memory reader: the rest of the stream at once; file reader: a buffer's worth,
+	// decoded in place from the reader's read-ahead buffer
+	ULONG step = in->left;
+	if (in->reader->file && step > in->reader->bufferSize)
+		step = in->reader->bufferSize;
+	const UBYTE *at = (const UBYTE *)binReadInPlace(in->reader, step);
+	if (!at)
+		return 0;
+	in->ip = at;
+	in->end = at + step;
+	in->left -= step;
+	return 1;
+}
+
+static inline UBYTE slzByte(tSlzInput *in, UBYTE *ok)
+{
+	if (in->ip == in->end && !slzRefill(in)) {
+		*ok = 0;
+		return 0;
+	}
+	return *in->ip++;
+}
+
+static ULONG slzLength(tSlzInput *in, ULONG length, UBYTE *ok)
+{
+	if (length != 15)
+		return length;
+	UBYTE b;
+	do {
+		b = slzByte(in, ok);
+		length += b;
+	} while (b == 255 && *ok);
+	return length;
+}
+
+static UBYTE slzRun(tSlzInput *in, UBYTE *dest, ULONG rawSize)
+{
+	UBYTE *op = dest;
+	UBYTE *const oend = dest + rawSize;
+	UBYTE ok = 1;
+	while (op < oend) {
+		UBYTE token = slzByte(in, &ok);
+		ULONG literals = slzLength(in, token >> 4, &ok);
+		if (!ok || literals > (ULONG)(oend - op))
+			return 0;
+		while (literals) {
+			if (in->ip == in->end && !slzRefill(in))
+				return 0;
+			ULONG step = (ULONG)(in->end - in->ip);
+			if (step > literals)
+				step = literals;
+			memcpy(op, in->ip, step);
+			op += step;
+			in->ip += step;
+			literals -= step;
+		}
+		if (op == oend)
+			break;
+		ULONG offset = (ULONG)slzByte(in, &ok) << 8;
+		offset |= slzByte(in, &ok);
+		ULONG length = slzLength(in, token & 15, &ok) + SLZ_MIN_MATCH;
+		if (!ok || offset == 0 || offset > (ULONG)(op - dest) || length > (ULONG)(oend - op))
+			return 0;
+		// Overlapping copies (offset < length) repeat the pattern, so go bytewise
+		const UBYTE *match = op - offset;
+		while (length--)
+			*op++ = *match++;
+	}
+	return 1;
+}
+
+UBYTE slzDecode(const UBYTE *src, ULONG srcSize, UBYTE *dest, ULONG rawSize)
+{
+	tSlzInput in;
+	in.ip = src;
+	in.end = src + srcSize;
+	in.reader = NULL;
+	in.left = 0;
+	// A stream that ends early or has bytes left over is corrupt either way
+	return slzRun(&in, dest, rawSize) && in.ip == in.end;
+}
+
+UBYTE slzDecodeStream(tBinReader *reader, ULONG packedSize, UBYTE *dest, ULONG rawSize)
+{
+	tSlzInput in;
+	in.ip = in.end = NULL;
+	in.reader = reader;
+	in.left = packedSize;
+	UBYTE ok = slzRun(&in, dest, rawSize) && in.ip == in.end && !in.left;
+	// Leave the reader after this stream even if the decoder stopped early
+	if (in.left)
+		binSkip(reader, in.left);
+	return ok;
+}
+
+UBYTE slzIsPacked(const UBYTE *data, ULONG size)
+{
+	return size >= SLZ_HEADER_SIZE && memcmp(data, SLZ_MAGIC, 4) == 0;
+}
+
+static ULONG slzU32(const UBYTE *p)
+{
+	return ((ULONG)p[0] << 24) | ((ULONG)p[1] << 16) | ((ULONG)p[2] << 8) | (ULONG)p[3];
+}
+
+ULONG slzRawSize(const UBYTE *data)
+{
+	return slzU32(data + 4);
+}
+
+UBYTE slzUnpack(const UBYTE *data, ULONG size, UBYTE *dest)
+{
+	ULONG packedSize = slzU32(data + 8);
+	if (packedSize > size - SLZ_HEADER_SIZE)
+		return 0;
+	return slzDecode(data + SLZ_HEADER_SIZE, packedSize, dest, slzRawSize(data));
+}
@@ -17,6 +17,8 @@
 #endif
 
 #include "smite.h"
+#include "asset_cache.h"
+#include "input.h"
 
 tStateManager *g_pStateMachineGame;
 
@@ -43,6 +45,7 @@ void genericProcess(void) {
     ptplayerProcess();
     keyProcess();
     mouseProcess();
+    inputProcess();
     stateProcess(g_pStateMachineGame);
 }
 
@@ -51,4 +54,7 @@ void genericDestroy(void) {
     keyDestroy();
     mouseDestroy();
     stateManagerDestroy(g_pStateMachineGame);
+    inputRecordStop(NULL);
+    // States have released what they held; free what the cache kept for reuse
+    assetCacheFlush();
 }
\ No newline at end of file
@@ -0,0 +1,7 @@
+#pragma once
+#include <ace/types.h>
+
+/* Drawing is a no-op on the host; these exist so render code links. */
+UBYTE blitUnsafeCopyMask(tBitMap *pSrc, WORD wSrcX, WORD wSrcY, tBitMap *pDst, WORD wDstX, WORD wDstY,
+	WORD wWidth, WORD wHeight, const UBYTE *pMsk);
+void blitRect(tBitMap *pDst, WORD wDstX, WORD wDstY, WORD wWidth, WORD wHeight, UBYTE ubColor);
@@ -0,0 +1,9 @@
+#pragma once
+#include <ace/types.h>
+
+#define JOY1 0
+#define JOY2 16
+#define JOY_FIRE 0
+
+UBYTE joyCheck(UBYTE ubJoyCode);
+UBYTE joyUse(UBYTE ubJoyCode);
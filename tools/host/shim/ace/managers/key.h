@@ -0,0 +1,32 @@
+#pragma once
+#include <ace/types.h>
+
+/* Raw key codes as in ACE; the host reads them from g_sHostInput (host_ace.h). */
+#define KEY_Q 0x10
+#define KEY_W 0x11
+#define KEY_E 0x12
+#define KEY_P 0x19
+#define KEY_A 0x20
+#define KEY_S 0x21
+#define KEY_D 0x22
+#define KEY_F 0x23
+#define KEY_ESCAPE 0x45
+#define KEY_DEL 0x46
+#define KEY_UP 0x4C
+#define KEY_DOWN 0x4D
+#define KEY_RIGHT 0x4E
+#define KEY_LEFT 0x4F
+#define KEY_F1 0x50
+#define KEY_F2 0x51
+#define KEY_F3 0x52
+#define KEY_F4 0x53
+#define KEY_F5 0x54
+#define KEY_F6 0x55
+#define KEY_F7 0x56
+#define KEY_F8 0x57
+#define KEY_F9 0x58
+#define KEY_F10 0x59
+#define KEY_HELP 0x5F
+
+UBYTE keyCheck(UBYTE ubKeyCode);
+UBYTE keyUse(UBYTE ubKeyCode);
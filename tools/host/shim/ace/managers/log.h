@@ -0,0 +1,7 @@
+#pragma once
+#include <ace/types.h>
+
+/* Silent unless SMITE_HOST_LOG is set in the environment. */
+void logWrite(const char *szFormat, ...);
+#define logBlockBegin(...) do {} while (0)
+#define logBlockEnd(...) do {} while (0)
@@ -0,0 +1,12 @@
+#pragma once
+#include <ace/types.h>
+#include <ace/managers/log.h>
+
+void *memAllocFast(ULONG ulSize);
+void *memAllocFastClear(ULONG ulSize);
+void *memAllocChip(ULONG ulSize);
+void *memAllocChipClear(ULONG ulSize);
+void *memAlloc(ULONG ulSize, ULONG ulFlags);
+void memFree(void *pMem, ULONG ulSize);
+ULONG memGetFreeSize(void);
+ULONG memGetFreeChipSize(void);
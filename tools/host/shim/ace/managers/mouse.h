@@ -0,0 +1,11 @@
+#pragma once
+#include <ace/types.h>
+
+#define MOUSE_PORT_1 1
+#define MOUSE_LMB 0
+#define MOUSE_RMB 1
+
+UBYTE mouseCheck(UBYTE ubPort, UBYTE ubButton);
+UBYTE mouseUse(UBYTE ubPort, UBYTE ubButton);
+UWORD mouseGetX(UBYTE ubPort);
+UWORD mouseGetY(UBYTE ubPort);
@@ -0,0 +1,6 @@
+#pragma once
+#include <ace/types.h>
+#include <ace/managers/log.h>
+
+void systemUse(void);
+void systemUnuse(void);
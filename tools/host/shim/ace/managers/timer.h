@@ -0,0 +1,11 @@
+#pragma once
+#include <ace/types.h>
+
+/* Host timer: timerGet() counts 50Hz frames since timerCreate(),
+ * timerGetPrec() returns microseconds (the Amiga build counts CIA E-clock ticks). */
+void timerCreate(void);
+void timerDestroy(void);
+ULONG timerGet(void);
+ULONG timerGetPrec(void);
+ULONG timerGetDelta(ULONG ulStart, ULONG ulStop);
+void timerFormatPrec(char *szBfr, ULONG ulPrecTime);
@@ -0,0 +1,64 @@
+/* Host (Linux) stand-in for ACE's <ace/types.h>.
+ * Only the subset of ACE used by the game logic linked into tools/host. */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t UBYTE;
+typedef int8_t BYTE;
+typedef uint16_t UWORD;
+typedef int16_t WORD;
+typedef uint32_t ULONG;
+typedef int32_t LONG;
+typedef UBYTE BOOL;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define MEMF_ANY 0
+#define MEMF_CHIP 2
+#define MEMF_FAST 4
+#define MEMF_CLEAR (1 << 16)
+
+typedef struct _tBitMap {
+	UWORD BytesPerRow;
+	UWORD Rows;
+	UBYTE Flags;
+	UBYTE Depth;
+	UWORD _pad;
+	UBYTE *Planes[8];
+} tBitMap;
+
+typedef struct _tView tView;
+typedef struct _tVPort tVPort;
+typedef struct _tFont tFont;
+typedef struct _tTextBitMap tTextBitMap;
+typedef struct _tSimpleBufferManager tSimpleBufferManager;
+
+typedef struct _tUwRect {
+	UWORD uwY;
+	UWORD uwX;
+	UWORD uwWidth;
+	UWORD uwHeight;
+} tUwRect;
+
+typedef void (*tStateCb)(void);
+
+typedef struct _tState {
+	tStateCb cbCreate;
+	tStateCb cbLoop;
+	tStateCb cbDestroy;
+	tStateCb cbSuspend;
+	tStateCb cbResume;
+	struct _tState *pPrev;
+} tState;
+
+typedef struct _tStateManager {
+	tState *pCurrent;
+} tStateManager;
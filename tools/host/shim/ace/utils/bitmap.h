@@ -0,0 +1,13 @@
+#pragma once
+#include <ace/types.h>
+
+#define BMF_CLEAR 1
+#define BMF_INTERLEAVED 4
+
+tBitMap *bitmapCreate(UWORD uwWidth, UWORD uwHeight, UBYTE ubDepth, UBYTE ubFlags);
+tBitMap *bitmapCreateFromPath(const char *szPath, UBYTE isFast);
+void bitmapSave(tBitMap *pBitMap, const char *szPath);
+void bitmapDestroy(tBitMap *pBitMap);
+UBYTE bitmapIsInterleaved(const tBitMap *pBitMap);
+/** Bytes of one plane's row; BytesPerRow covers every plane when interleaved. */
+UWORD bitmapGetByteWidth(const tBitMap *pBitMap);
@@ -0,0 +1,11 @@
+#pragma once
+#include <ace/utils/file.h>
+
+typedef enum tDiskFileMode {
+	DISK_FILE_MODE_READ,
+	DISK_FILE_MODE_WRITE,
+	DISK_FILE_MODE_APPEND,
+} tDiskFileMode;
+
+tFile *diskFileOpen(const char *szPath, tDiskFileMode eMode, UBYTE isUninterrupted);
+UBYTE diskFileExists(const char *szPath);
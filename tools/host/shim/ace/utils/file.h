@@ -0,0 +1,16 @@
+#pragma once
+#include <ace/types.h>
+
+typedef struct _tFile tFile;
+
+ULONG fileRead(tFile *pFile, void *pDest, ULONG ulSize);
+ULONG fileWrite(tFile *pFile, const void *pSrc, ULONG ulSize);
+UBYTE fileSeek(tFile *pFile, LONG lPos, WORD wMode);
+ULONG fileGetPos(tFile *pFile);
+ULONG fileGetSize(const char *szPath);
+UBYTE fileIsEof(tFile *pFile);
+void fileClose(tFile *pFile);
+
+#define FILE_SEEK_SET 0
+#define FILE_SEEK_CURRENT 1
+#define FILE_SEEK_END 2
@@ -0,0 +1,13 @@
+#pragma once
+#include <ace/types.h>
+
+struct _tFont {
+	UWORD uwWidth;
+	UWORD uwHeight;
+	UBYTE ubChars;
+	UWORD *pCharOffsets;
+	tBitMap *pRawData;
+};
+
+tFont *fontCreateFromPath(const char *szPath);
+void fontDestroy(tFont *pFont);
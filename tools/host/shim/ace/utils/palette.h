@@ -0,0 +1,4 @@
+#pragma once
+#include <ace/types.h>
+
+void paletteLoadFromPath(const char *szPath, UWORD *pPalette, UBYTE ubMaxLength);
@@ -0,0 +1,39 @@
+#pragma once
+/* Host-side counters kept by the ACE shim (tools/host/src/host_ace.c). */
+#include <ace/types.h>
+
+typedef struct _tHostMemStats {
+	ULONG ulAllocs;
+	ULONG ulFrees;
+	LONG lBytesLive;
+	ULONG ulPeakBytes;
+	ULONG ulSizeMismatches; /* memFree() called with a size other than the allocation's */
+} tHostMemStats;
+
+typedef struct _tHostFileStats {
+	ULONG ulOpens;
+	ULONG ulReadCalls;
+	ULONG ulReadBytes;
+	ULONG ulWriteCalls;
+} tHostFileStats;
+
+/* What the key, mouse and joystick shims report; tests set it directly. */
+typedef struct _tHostInput {
+	UBYTE pKeys[128];
+	UBYTE pMouse[2];   /* MOUSE_LMB, MOUSE_RMB */
+	UBYTE pJoy[32];    /* JOY1 / JOY2 + direction or fire */
+	UWORD uwMouseX;
+	UWORD uwMouseY;
+} tHostInput;
+
+extern tHostMemStats g_sHostMem;
+extern tHostInput g_sHostInput;
+/** What memGetFreeSize() reports; lower it to simulate a machine short of memory. */
+extern ULONG g_ulHostFreeSize;
+/** What memGetFreeChipSize() reports. */
+extern ULONG g_ulHostFreeChipSize;
+extern tHostFileStats g_sHostFile;
+
+void hostStatsReset(void);
+/** Wall-clock microseconds, for benchmarks. */
+double hostNowUs(void);
@@ -0,0 +1,282 @@
+/* Monster AI frame cost: MAX_MONSTERS chasers on dungeons of growing size.
+ *
+ *   ai_bench [frames]
+ *
+ * Each maze is rooms joined by corridors. Monsters start on random open cells
+ * already aggressive; the party walks the corridors one cell every
+ * BENCH_PARTY_PERIOD frames. Each size runs twice: once calling
+ * monsterUpdate() on every monster each frame, once through
+ * monsterListUpdate() with its default budget as game.c does. Reports
+ * monster updates and microseconds per frame (mean and worst), how often the
+ * party field was rebuilt, and the mean walking distance of the monsters in
+ * reach of the party at the start and at the end.
+ *
+ * A second table is the aggro line-of-sight check on a 64x64 dungeon: every
+ * monster within BENCH_AGGRO steps asks each frame whether it sees the party,
+ * as an idle monster in aggro range does, once tracing the line
+ * with mazeLineOfSight() every time and once through partyFieldSees() and its
+ * per-cell cache.
+ *
+ * The last table puts 8 to MAX_MONSTERS chasers on a 255x255 dungeon and runs
+ * monsterListUpdate() with and without activity zones: with them the cost
+ * should stay flat as monsters are added far from the party. 0 frames runs a
+ * short pass for ctest. */
+#include "host_game.h"
+#include "host_ace.h"
+#include "monster.h"
+#include "party_field.h"
+#include "maze_zones.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_PARTY_PERIOD 15
+#define BENCH_AGGRO 12
+
+static ULONG s_ulSeed = 99;
+
+static ULONG benchRand(void)
+{
+	s_ulSeed = s_ulSeed * 1103515245UL + 12345UL;
+	return (s_ulSeed >> 8) & 0xFFFFFF;
+}
+
+static void carve(tMaze *pMaze, UBYTE x, UBYTE y)
+{
+	pMaze->_mazeData[x + y * pMaze->_width] = MAZE_FLOOR;
+}
+
+static tMaze *buildDungeon(UBYTE ubSize)
+{
+	tMaze *pMaze = mazeCreate(ubSize, ubSize);
+	for (UWORD i = 0; i < (UWORD)ubSize * ubSize; i++)
+		pMaze->_mazeData[i] = MAZE_WALL;
+	UBYTE px = (UBYTE)(ubSize / 2), py = (UBYTE)(ubSize / 2);
+	UWORD uwRooms = (UWORD)(ubSize * ubSize / 120);
+	for (UWORD r = 0; r < uwRooms; r++) {
+		UBYTE w = (UBYTE)(3 + benchRand() % 6), h = (UBYTE)(3 + benchRand() % 6);
+		UBYTE rx = (UBYTE)(1 + benchRand() % (ubSize - w - 2));
+		UBYTE ry = (UBYTE)(1 + benchRand() % (ubSize - h - 2));
+		for (UBYTE y = ry; y < ry + h; y++)
+			for (UBYTE x = rx; x < rx + w; x++)
+				carve(pMaze, x, y);
+		UBYTE cx = (UBYTE)(rx + w / 2), cy = (UBYTE)(ry + h / 2);
+		for (UBYTE x = px < cx ? px : cx; x <= (px < cx ? cx : px); x++)
+			carve(pMaze, x, py);
+		for (UBYTE y = py < cy ? py : cy; y <= (py < cy ? cy : py); y++)
+			carve(pMaze, cx, y);
+		/* Some corridors get a door, open or shut */
+		if (benchRand() % 4 == 0)
+			pMaze->_mazeData[cx + py * ubSize] = (benchRand() & 1) ? MAZE_DOOR : MAZE_DOOR_OPEN;
+		px = cx;
+		py = cy;
+	}
+	return pMaze;
+}
+
+static void randomFloor(const tMaze *pMaze, UBYTE *pX, UBYTE *pY)
+{
+	do {
+		*pX = (UBYTE)(benchRand() % pMaze->_width);
+		*pY = (UBYTE)(benchRand() % pMaze->_height);
+	} while (pMaze->_mazeData[*pX + *pY * pMaze->_width] != MAZE_FLOOR || monsterCountAt(pMaze, *pX, *pY));
+}
+
+static void walkParty(const tMaze *pMaze, tCharacterParty *pParty)
+{
+	static const BYTE s_dx[4] = {0, 1, 0, -1};
+	static const BYTE s_dy[4] = {-1, 0, 1, 0};
+	UBYTE dir = (UBYTE)(benchRand() & 3);
+	for (UBYTE k = 0; k < 4; k++, dir = (UBYTE)((dir + 1) & 3)) {
+		UBYTE x = (UBYTE)(pParty->_PartyX + s_dx[dir]), y = (UBYTE)(pParty->_PartyY + s_dy[dir]);
+		if (mazeGetCell((tMaze *)pMaze, x, y) == MAZE_FLOOR) {
+			pParty->_PartyX = x;
+			pParty->_PartyY = y;
+			return;
+		}
+	}
+}
+
+/* Mean steps to the party over the monsters within the field's radius */
+static double meanDistance(const tMaze *pMaze, const tCharacterParty *pParty, const tMonsterList *pList)
+{
+	partyFieldUpdate(pMaze, pParty->_PartyX, pParty->_PartyY);
+	ULONG ulSum = 0, ulCount = 0;
+	for (UBYTE i = 0; i < pList->_numMonsters; i++) {
+		UBYTE d = partyFieldAt(pList->_monsters[i]->_partyPosX, pList->_monsters[i]->_partyPosY);
+		if (d != PARTY_FIELD_FAR) {
+			ulSum += d;
+			ulCount++;
+		}
+	}
+	return ulCount ? (double)ulSum / (double)ulCount : 0.0;
+}
+
+static int runCase(UBYTE ubSize, ULONG ulFrames, UBYTE isScheduled)
+{
+	s_ulSeed = 99;
+	hostGameReset();
+	tMaze *pMaze = buildDungeon(ubSize);
+	hostGameSetMaze(pMaze);
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	tMonsterList *pList = g_pGameState->m_pMonsterList;
+	randomFloor(pMaze, &pParty->_PartyX, &pParty->_PartyY);
+	while (pList->_numMonsters < MAX_MONSTERS) {
+		tMonster *pMonster = monsterCreate(MONSTER_TYPE_NORMAL);
+		if (!pMonster || !monsterListAppend(pList, pMonster))
+			return 1;
+		UBYTE x, y;
+		randomFloor(pMaze, &x, &y);
+		monsterPlaceInMaze(pMaze, pMonster, x, y);
+		pMonster->_state = MONSTER_STATE_AGGRESSIVE;
+		pMonster->_aggroRange = 255;
+		pMonster->_fleeThreshold = 0;
+		pMonster->_moveCooldown = (UBYTE)(1 + pList->_numMonsters % 10);
+	}
+
+	double dStart = meanDistance(pMaze, pParty, pList);
+	double dTotal = 0, dWorst = 0;
+	ULONG ulUpdates = 0;
+	UBYTE pUpdated[MAX_MONSTERS];
+	for (ULONG f = 0; f < ulFrames; f++) {
+		if (f % BENCH_PARTY_PERIOD == 0)
+			walkParty(pMaze, pParty);
+		double t0 = hostNowUs();
+		if (isScheduled)
+			ulUpdates += monsterListUpdate(pList, pMaze, pParty, pUpdated);
+		else {
+			for (UBYTE i = 0; i < pList->_numMonsters; i++)
+				monsterUpdate(pList->_monsters[i], pMaze, pParty, pList);
+			ulUpdates += pList->_numMonsters;
+		}
+		double dFrame = hostNowUs() - t0;
+		dTotal += dFrame;
+		if (dFrame > dWorst)
+			dWorst = dFrame;
+	}
+
+	double dEnd = meanDistance(pMaze, pParty, pList);
+	printf("%3ux%-3u %-5s %8lu %8.1f %10.2f %10.2f %9lu %6.1f %6.1f\n", ubSize, ubSize,
+		isScheduled ? "sched" : "all", (unsigned long)ulFrames, (double)ulUpdates / (double)ulFrames,
+		dTotal / (double)ulFrames, dWorst, (unsigned long)partyFieldRebuilds(), dStart, dEnd);
+	return 0;
+}
+
+static int runSight(ULONG ulFrames, UBYTE isCached)
+{
+	s_ulSeed = 7;
+	hostGameReset();
+	tMaze *pMaze = buildDungeon(64);
+	hostGameSetMaze(pMaze);
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	tMonsterList *pList = g_pGameState->m_pMonsterList;
+	randomFloor(pMaze, &pParty->_PartyX, &pParty->_PartyY);
+	while (pList->_numMonsters < MAX_MONSTERS) {
+		tMonster *pMonster = monsterCreate(MONSTER_TYPE_NORMAL);
+		if (!pMonster || !monsterListAppend(pList, pMonster))
+			return 1;
+		UBYTE x, y;
+		randomFloor(pMaze, &x, &y);
+		monsterPlaceInMaze(pMaze, pMonster, x, y);
+	}
+
+	ULONG ulTraces0 = partyFieldSightTraces();
+	ULONG ulSeen = 0, ulAsked = 0;
+	double dTotal = 0, dWorst = 0;
+	for (ULONG f = 0; f < ulFrames; f++) {
+		if (f % BENCH_PARTY_PERIOD == 0)
+			walkParty(pMaze, pParty);
+		double t0 = hostNowUs();
+		for (UBYTE i = 0; i < pList->_numMonsters; i++) {
+			const tMonster *m = pList->_monsters[i];
+			WORD dx = (WORD)m->_partyPosX - pParty->_PartyX, dy = (WORD)m->_partyPosY - pParty->_PartyY;
+			if ((dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy) > BENCH_AGGRO)
+				continue;
+			ulAsked++;
+			ulSeen += isCached
+				? partyFieldSees(pMaze, pParty->_PartyX, pParty->_PartyY, m->_partyPosX, m->_partyPosY)
+				: mazeLineOfSight(pMaze, pParty->_PartyX, pParty->_PartyY, m->_partyPosX, m->_partyPosY);
+		}
+		double dFrame = hostNowUs() - t0;
+		dTotal += dFrame;
+		if (dFrame > dWorst)
+			dWorst = dFrame;
+	}
+	ULONG ulTraces = isCached ? partyFieldSightTraces() - ulTraces0 : ulAsked;
+	printf("%-7s %8lu %10.2f %10.2f %8.2f %10.2f %8.2f\n", isCached ? "cached" : "trace", (unsigned long)ulFrames,
+		dTotal / (double)ulFrames, dWorst, (double)ulAsked / (double)ulFrames, (double)ulTraces / (double)ulFrames,
+		(double)ulSeen / (double)ulFrames);
+	return 0;
+}
+
+static int runZones(UBYTE ubMonsters, ULONG ulFrames, UBYTE isZoned)
+{
+	s_ulSeed = 31;
+	hostGameReset();
+	tMaze *pMaze = buildDungeon(255);
+	hostGameSetMaze(pMaze);
+	if (isZoned && !mazeZonesBuild(pMaze))
+		return 1;
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	tMonsterList *pList = g_pGameState->m_pMonsterList;
+	randomFloor(pMaze, &pParty->_PartyX, &pParty->_PartyY);
+	while (pList->_numMonsters < ubMonsters) {
+		tMonster *pMonster = monsterCreate(MONSTER_TYPE_NORMAL);
+		if (!pMonster || !monsterListAppend(pList, pMonster))
+			return 1;
+		UBYTE x, y;
+		randomFloor(pMaze, &x, &y);
+		monsterPlaceInMaze(pMaze, pMonster, x, y);
+		pMonster->_state = MONSTER_STATE_AGGRESSIVE;
+		pMonster->_aggroRange = 255;
+		pMonster->_fleeThreshold = 0;
+	}
+	monsterAiSetBudget(MAX_MONSTERS);
+	monsterAiStatsReset();
+	UBYTE pUpdated[MAX_MONSTERS];
+	double dTotal = 0, dWorst = 0;
+	for (ULONG f = 0; f < ulFrames; f++) {
+		if (f % BENCH_PARTY_PERIOD == 0)
+			walkParty(pMaze, pParty);
+		double t0 = hostNowUs();
+		monsterListUpdate(pList, pMaze, pParty, pUpdated);
+		double dFrame = hostNowUs() - t0;
+		dTotal += dFrame;
+		if (dFrame > dWorst)
+			dWorst = dFrame;
+	}
+	const tMonsterAiStats *pStats = monsterAiStatsGet();
+	printf("%8u %-5s %8lu %10.2f %10.2f %8.2f %8.2f\n", ubMonsters, isZoned ? "zones" : "all",
+		(unsigned long)ulFrames, dTotal / (double)ulFrames, dWorst,
+		(double)pStats->ulUpdates / (double)ulFrames, (double)pStats->ulFrozen / (double)ulFrames);
+	monsterAiSetBudget(MONSTER_AI_DEFAULT_BUDGET);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	long lFrames = argc > 1 ? atol(argv[1]) : 3000;
+	if (lFrames < 1)
+		lFrames = 200;
+	hostGameCreate();
+	printf("%-7s %-5s %8s %8s %10s %10s %9s %6s %6s\n", "maze", "mode", "frames", "upd/fr", "us/frame",
+		"worst us", "rebuilds", "dist0", "dist1");
+	int iResult = 0;
+	static const UBYTE s_pSizes[] = {32, 64, 128, 255};
+	for (UBYTE i = 0; i < sizeof(s_pSizes); i++)
+		for (UBYTE isScheduled = 0; isScheduled < 2; isScheduled++)
+			iResult |= runCase(s_pSizes[i], (ULONG)lFrames, isScheduled);
+	printf("\n64x64 line of sight, %u monsters\n", MAX_MONSTERS);
+	printf("%-7s %8s %10s %10s %8s %10s %8s\n", "mode", "frames", "us/frame", "worst us", "asked/fr", "traces/fr",
+		"seen/fr");
+	for (UBYTE isCached = 0; isCached < 2; isCached++)
+		iResult |= runSight((ULONG)lFrames, isCached);
+	printf("\n255x255 activity zones, every monster's budget\n");
+	printf("%8s %-5s %8s %10s %10s %8s %8s\n", "monsters", "mode", "frames", "us/frame", "worst us", "upd/fr",
+		"frozen");
+	for (UBYTE ubMonsters = 8; ubMonsters && ubMonsters <= MAX_MONSTERS; ubMonsters = (UBYTE)(ubMonsters * 2))
+		for (UBYTE isZoned = 0; isZoned < 2; isZoned++)
+			iResult |= runZones(ubMonsters, (ULONG)lFrames, isZoned);
+	hostGameDestroy();
+	return iResult;
+}
@@ -0,0 +1,622 @@
+/* Headless combat and AI simulator for tuning monsters.dat.
+ *
+ *   balance_sim [options]
+ *
+ * Loads a level the way LoadLevel() does (manifest entry, loose files or a
+ * .pak, or a maze given directly), then runs seeded trials of it with the
+ * game's own monster code: monsterListUpdate() each frame and
+ * monsterCombatRound() for the monsters it updated. Trial i is seeded with
+ * seed + i, so a run is repeatable whatever the number of workers.
+ *
+ *   session    the level's .lvl spawns; the party takes a random step every
+ *              -w frames until -f frames pass or the hero dies
+ *   encounter  one monster of each type (or -t) on a random cell at most -R
+ *              steps from the party, run until one side dies or -f frames
+ *
+ * Trials are split into contiguous blocks over -j forked workers. Each worker
+ * sums per monster type and hands the sums back through a pipe; -r instead
+ * writes one CSV row per monster per trial. Results go to stdout as CSV, a
+ * summary line to stderr. Run from the directory the manifest's paths are
+ * relative to (the repository root for data/game.smt). */
+#include "host_game.h"
+#include "host_ace.h"
+#include "level_entities.h"
+#include "game_manifest.h"
+#include "pak.h"
+#include "item.h"
+#include "monster.h"
+#include "party_field.h"
+#include "maze_zones.h"
+#include "rng.h"
+#include "wallbutton.h"
+#include "doorbutton.h"
+#include "doorlock.h"
+#include "pressure_plate.h"
+#include "ground_item.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define SIM_TYPES 256
+#define SIM_MAX_JOBS 64
+
+typedef enum _tSimMode {
+	SIM_MODE_SESSION,
+	SIM_MODE_ENCOUNTER,
+} tSimMode;
+
+/* Sums over every monster of one type in every trial */
+typedef struct _tSimTypeTotals {
+	ULONG ulSpawns;
+	ULONG ulContacts;    /* reached the party and fought at least one round */
+	ULONG ulKills;
+	ULONG ulKillFrames;  /* first round to death, over the kills */
+	ULONG ulKillRounds;  /* rounds fought, over the kills */
+	ULONG ulDamageDealt; /* HP taken off the hero */
+	ULONG ulPath;        /* cells walked */
+} tSimTypeTotals;
+
+typedef struct _tSimTotals {
+	ULONG ulTrials;
+	ULONG ulHeroDeaths;
+	ULONG ulFrames;
+	tSimTypeTotals pTypes[SIM_TYPES];
+} tSimTotals;
+
+/* One monster through one trial */
+typedef struct _tSimTrack {
+	UBYTE ubX, ubY;
+	UWORD uwRounds;
+	UWORD uwDamage;
+	UWORD uwPath;
+	LONG lContactFrame; /* -1 until the first round */
+	LONG lKillFrame;
+} tSimTrack;
+
+static struct {
+	tSimMode eMode;
+	ULONG ulTrials;
+	ULONG ulSeed;
+	ULONG ulFrames;
+	UWORD uwWalkPeriod;
+	UBYTE ubJobs;
+	UBYTE ubRadius;
+	WORD wType;          /* encounter type, -1 for all in the table */
+	WORD wStartX, wStartY;
+	WORD wHeroHP, wHeroAttack, wHeroDefense;
+	UBYTE isRaw;
+} s_sOpt;
+
+static UBYTE *s_pMazeImage, *s_pLvlImage;
+static ULONG s_ulMazeSize, s_ulLvlSize;
+static UBYTE s_isDemoMaze;
+static UBYTE s_ubTypeCount;
+static ULONG s_ulRand;
+
+static ULONG simRand(void)
+{
+	s_ulRand = s_ulRand * 1103515245UL + 12345UL;
+	return (s_ulRand >> 8) & 0xFFFFFF;
+}
+
+static UBYTE *readFile(const char *szPath, ULONG *pSize)
+{
+	FILE *pFile = fopen(szPath, "rb");
+	if (!pFile)
+		return NULL;
+	fseek(pFile, 0, SEEK_END);
+	long lSize = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+	UBYTE *pData = lSize > 0 ? (UBYTE *)malloc((size_t)lSize) : NULL;
+	if (pData && fread(pData, 1, (size_t)lSize, pFile) != (size_t)lSize) {
+		free(pData);
+		pData = NULL;
+	}
+	fclose(pFile);
+	*pSize = (ULONG)lSize;
+	return pData;
+}
+
+static UBYTE *copyBytes(const UBYTE *pSrc, ULONG ulSize)
+{
+	UBYTE *pData = (UBYTE *)malloc(ulSize);
+	if (pData)
+		memcpy(pData, pSrc, ulSize);
+	return pData;
+}
+
+/* Maze and .lvl images of one level, kept to rebuild the level for every trial */
+static int loadLevelImages(const tGameManifest *pMan, int iLevel, const char *szMaze, const char *szLvl)
+{
+	if (!szMaze) {
+		if (iLevel < 0)
+			iLevel = pMan->startLevel;
+		if (iLevel >= pMan->levelCount) {
+			fprintf(stderr, "balance_sim: level %d not in the manifest (%u levels)\n", iLevel, pMan->levelCount);
+			return 0;
+		}
+		const tGameLevelEntry *pEntry = &pMan->levels[iLevel];
+		if (pakIsPath(pEntry->mazePath)) {
+			tPak sPak;
+			if (!pakLoad(&sPak, pEntry->mazePath)) {
+				fprintf(stderr, "balance_sim: cannot load %s\n", pEntry->mazePath);
+				return 0;
+			}
+			ULONG ulSize;
+			const UBYTE *pChunk = pakFind(&sPak, PAK_TAG_MAZE, 0, &ulSize);
+			if (pChunk) {
+				s_pMazeImage = copyBytes(pChunk, ulSize);
+				s_ulMazeSize = ulSize;
+			}
+			pChunk = pakFind(&sPak, PAK_TAG_ENTITIES, 0, &ulSize);
+			if (pChunk && !szLvl) {
+				s_pLvlImage = copyBytes(pChunk, ulSize);
+				s_ulLvlSize = ulSize;
+			}
+			pakDestroy(&sPak);
+		}
+		else if (iLevel == 0 && pEntry->mazePath[0] == '\0')
+			s_isDemoMaze = 1;
+		else
+			szMaze = pEntry->mazePath;
+		if (!szLvl && pEntry->entitiesPath[0])
+			szLvl = pEntry->entitiesPath;
+	}
+	if (szMaze && !(s_pMazeImage = readFile(szMaze, &s_ulMazeSize))) {
+		fprintf(stderr, "balance_sim: cannot read %s\n", szMaze);
+		return 0;
+	}
+	if (!s_pMazeImage && !s_isDemoMaze) {
+		fprintf(stderr, "balance_sim: the level has no maze\n");
+		return 0;
+	}
+	if (szLvl && !(s_pLvlImage = readFile(szLvl, &s_ulLvlSize))) {
+		fprintf(stderr, "balance_sim: cannot read %s\n", szLvl);
+		return 0;
+	}
+	return 1;
+}
+
+static UBYTE isWalkable(tMaze *pMaze, UBYTE x, UBYTE y)
+{
+	UBYTE c = mazeGetCell(pMaze, x, y);
+	return c == MAZE_FLOOR || c == MAZE_DOOR_OPEN || c == MAZE_EVENT_TRIGGER;
+}
+
+/* Fresh copy of the level, as after LoadLevel(); the party on its start cell at full HP */
+static UBYTE setUpTrial(ULONG ulSeed)
+{
+	hostGameReset();
+	wallButtonListDestroy(&g_pGameState->m_wallButtons);
+	doorButtonListDestroy(&g_pGameState->m_doorButtons);
+	pressurePlateListClear(&g_pGameState->m_pressurePlates);
+	wallButtonListCreate(&g_pGameState->m_wallButtons);
+	doorButtonListCreate(&g_pGameState->m_doorButtons);
+	doorLockListCreate(&g_pGameState->m_doorLocks);
+	tMaze *pMaze = s_isDemoMaze ? mazeCreateDemoData() : mazeLoadFromMemory(s_pMazeImage, s_ulMazeSize);
+	if (!pMaze)
+		return 0;
+	hostGameSetMaze(pMaze);
+	mazeZonesBuild(pMaze);
+	if (s_sOpt.eMode == SIM_MODE_SESSION && s_pLvlImage)
+		levelEntitiesLoadFromMemory(g_pGameState, s_pLvlImage, s_ulLvlSize);
+
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	if (s_sOpt.wStartX >= 0) {
+		pParty->_PartyX = (UBYTE)s_sOpt.wStartX;
+		pParty->_PartyY = (UBYTE)s_sOpt.wStartY;
+	}
+	else {
+		/* A new game starts at (0, 0); levels wall their border, so take the first open cell */
+		UWORD uwCell = 0;
+		while (uwCell < (UWORD)pMaze->_width * pMaze->_height
+			&& !isWalkable(pMaze, (UBYTE)(uwCell % pMaze->_width), (UBYTE)(uwCell / pMaze->_width)))
+			uwCell++;
+		pParty->_PartyX = (UBYTE)(uwCell % pMaze->_width);
+		pParty->_PartyY = (UBYTE)(uwCell / pMaze->_width);
+	}
+	tCharacter *pHero = pParty->_characters[0];
+	if (s_sOpt.wHeroHP >= 0)
+		pHero->_MaxHP = (UWORD)s_sOpt.wHeroHP;
+	if (s_sOpt.wHeroAttack >= 0)
+		pHero->_Attack = (UBYTE)s_sOpt.wHeroAttack;
+	if (s_sOpt.wHeroDefense >= 0)
+		pHero->_Defense = (UBYTE)s_sOpt.wHeroDefense;
+	pHero->_HP = pHero->_MaxHP;
+
+	rngSeed(ulSeed);
+	s_ulRand = ulSeed ^ 0x5EED5EEDUL;
+	return 1;
+}
+
+/* One monster of ubType on a random cell 2..radius steps from the party */
+static UBYTE spawnEncounter(UBYTE ubType)
+{
+	tMaze *pMaze = g_pGameState->m_pCurrentMaze;
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	partyFieldUpdate(pMaze, pParty->_PartyX, pParty->_PartyY);
+	UWORD uwCandidates = 0;
+	for (UBYTE pass = 0; pass < 2; pass++) {
+		UWORD uwPick = pass ? (UWORD)(simRand() % uwCandidates) : 0;
+		for (UWORD y = 0; y < pMaze->_height; y++) {
+			for (UWORD x = 0; x < pMaze->_width; x++) {
+				UBYTE d = partyFieldAt((UBYTE)x, (UBYTE)y);
+				if (d < 2 || d > s_sOpt.ubRadius || d == PARTY_FIELD_FAR)
+					continue;
+				if (!pass) {
+					uwCandidates++;
+					continue;
+				}
+				if (uwPick--)
+					continue;
+				tMonster *pMonster = monsterCreate(ubType);
+				if (!pMonster)
+					return 0;
+				monsterListAppend(g_pGameState->m_pMonsterList, pMonster);
+				monsterPlaceInMaze(pMaze, pMonster, (UBYTE)x, (UBYTE)y);
+				return 1;
+			}
+		}
+		if (!uwCandidates)
+			return 0;
+	}
+	return 0;
+}
+
+/* A random step onto an open cell, as mazeMove() allows */
+static void walkParty(void)
+{
+	static const BYTE s_dx[4] = {0, 1, 0, -1};
+	static const BYTE s_dy[4] = {-1, 0, 1, 0};
+	tMaze *pMaze = g_pGameState->m_pCurrentMaze;
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	UBYTE ubDir = (UBYTE)(simRand() & 3);
+	for (UBYTE k = 0; k < 4; k++, ubDir = (UBYTE)((ubDir + 1) & 3)) {
+		UBYTE x = (UBYTE)(pParty->_PartyX + s_dx[ubDir]), y = (UBYTE)(pParty->_PartyY + s_dy[ubDir]);
+		if (isWalkable(pMaze, x, y)) {
+			pParty->_PartyX = x;
+			pParty->_PartyY = y;
+			return;
+		}
+	}
+}
+
+static UBYTE anyAlive(const tMonsterList *pList)
+{
+	for (UBYTE i = 0; i < pList->_numMonsters; i++)
+		if (pList->_monsters[i]->_state != MONSTER_STATE_DEAD)
+			return 1;
+	return 0;
+}
+
+static void runTrial(ULONG ulTrial, WORD wEncounterType, tSimTotals *pTotals, FILE *pRaw)
+{
+	ULONG ulSeed = s_sOpt.ulSeed + ulTrial;
+	if (!setUpTrial(ulSeed))
+		return;
+	if (wEncounterType >= 0 && !spawnEncounter((UBYTE)wEncounterType))
+		return;
+	tMaze *pMaze = g_pGameState->m_pCurrentMaze;
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	tMonsterList *pList = g_pGameState->m_pMonsterList;
+	tCharacter *pHero = pParty->_characters[0];
+	tSimTrack pTrack[MAX_MONSTERS];
+	for (UBYTE i = 0; i < pList->_numMonsters; i++) {
+		pTrack[i] = (tSimTrack){pList->_monsters[i]->_partyPosX, pList->_monsters[i]->_partyPosY, 0, 0, 0, -1, -1};
+	}
+
+	ULONG f = 0;
+	UBYTE pUpdated[MAX_MONSTERS];
+	for (; f < s_sOpt.ulFrames && pHero->_HP > 0; f++) {
+		if (s_sOpt.uwWalkPeriod && f % s_sOpt.uwWalkPeriod == 0)
+			walkParty();
+		UBYTE ubUpdated = monsterListUpdate(pList, pMaze, pParty, pUpdated);
+		/* The game's combat step; killed monsters stay listed so their track keeps its index */
+		for (UBYTE u = 0; u < ubUpdated && pHero->_HP > 0; u++) {
+			UBYTE i = pUpdated[u];
+			UWORD uwHP = pHero->_HP;
+			UBYTE ubResult = monsterCombatRound(pList->_monsters[i], pMaze, pParty, g_pGameState->m_pInventory);
+			if (ubResult == MONSTER_COMBAT_NONE)
+				continue;
+			pTrack[i].uwDamage = (UWORD)(pTrack[i].uwDamage + uwHP - pHero->_HP);
+			if (pTrack[i].lContactFrame < 0)
+				pTrack[i].lContactFrame = (LONG)f;
+			pTrack[i].uwRounds++;
+			if (ubResult == MONSTER_COMBAT_KILL)
+				pTrack[i].lKillFrame = (LONG)f;
+		}
+		for (UBYTE i = 0; i < pList->_numMonsters; i++) {
+			tMonster *pMonster = pList->_monsters[i];
+			if (pMonster->_partyPosX != pTrack[i].ubX || pMonster->_partyPosY != pTrack[i].ubY) {
+				pTrack[i].ubX = pMonster->_partyPosX;
+				pTrack[i].ubY = pMonster->_partyPosY;
+				pTrack[i].uwPath++;
+			}
+		}
+		if (wEncounterType >= 0 && !anyAlive(pList))
+			break;
+	}
+
+	pTotals->ulTrials++;
+	pTotals->ulFrames += f;
+	if (pHero->_HP == 0)
+		pTotals->ulHeroDeaths++;
+	for (UBYTE i = 0; i < pList->_numMonsters; i++) {
+		const tSimTrack *pT = &pTrack[i];
+		UBYTE ubType = pList->_monsters[i]->_monsterType;
+		tSimTypeTotals *pType = &pTotals->pTypes[ubType];
+		pType->ulSpawns++;
+		pType->ulContacts += pT->lContactFrame >= 0;
+		pType->ulDamageDealt += pT->uwDamage;
+		pType->ulPath += pT->uwPath;
+		if (pT->lKillFrame >= 0) {
+			pType->ulKills++;
+			pType->ulKillFrames += (ULONG)(pT->lKillFrame - pT->lContactFrame);
+			pType->ulKillRounds += pT->uwRounds;
+		}
+		if (pRaw)
+			fprintf(pRaw, "%lu,%u,%u,%d,%ld,%ld,%u,%u,%u,%d\n", (unsigned long)ulSeed, i, ubType,
+				pT->lKillFrame >= 0, (long)pT->lContactFrame, (long)pT->lKillFrame, pT->uwRounds,
+				pT->uwDamage, pT->uwPath, pHero->_HP == 0);
+	}
+}
+
+static void runBlock(ULONG ulFirst, ULONG ulEnd, tSimTotals *pTotals, FILE *pRaw)
+{
+	for (ULONG t = ulFirst; t < ulEnd; t++) {
+		if (s_sOpt.eMode == SIM_MODE_SESSION)
+			runTrial(t, -1, pTotals, pRaw);
+		else if (s_sOpt.wType >= 0)
+			runTrial(t, s_sOpt.wType, pTotals, pRaw);
+		else {
+			for (UBYTE ubType = 0; ubType < s_ubTypeCount; ubType++)
+				runTrial(t, ubType, pTotals, pRaw);
+		}
+	}
+}
+
+static int writeAll(int iFd, const void *pData, size_t ulSize)
+{
+	const char *p = (const char *)pData;
+	while (ulSize) {
+		ssize_t lDone = write(iFd, p, ulSize);
+		if (lDone <= 0)
+			return 0;
+		p += lDone;
+		ulSize -= (size_t)lDone;
+	}
+	return 1;
+}
+
+static int readAll(int iFd, void *pData, size_t ulSize)
+{
+	char *p = (char *)pData;
+	while (ulSize) {
+		ssize_t lDone = read(iFd, p, ulSize);
+		if (lDone <= 0)
+			return 0;
+		p += lDone;
+		ulSize -= (size_t)lDone;
+	}
+	return 1;
+}
+
+static void addTotals(tSimTotals *pSum, const tSimTotals *pPart)
+{
+	pSum->ulTrials += pPart->ulTrials;
+	pSum->ulHeroDeaths += pPart->ulHeroDeaths;
+	pSum->ulFrames += pPart->ulFrames;
+	for (UWORD t = 0; t < SIM_TYPES; t++) {
+		tSimTypeTotals *pA = &pSum->pTypes[t];
+		const tSimTypeTotals *pB = &pPart->pTypes[t];
+		pA->ulSpawns += pB->ulSpawns;
+		pA->ulContacts += pB->ulContacts;
+		pA->ulKills += pB->ulKills;
+		pA->ulKillFrames += pB->ulKillFrames;
+		pA->ulKillRounds += pB->ulKillRounds;
+		pA->ulDamageDealt += pB->ulDamageDealt;
+		pA->ulPath += pB->ulPath;
+	}
+}
+
+static double ratio(ULONG ulNum, ULONG ulDen)
+{
+	return ulDen ? (double)ulNum / (double)ulDen : 0.0;
+}
+
+static void printTypeRow(const char *szType, const tSimTypeTotals *pT)
+{
+	printf("%s,%lu,%.4f,%.4f,%.2f,%.2f,%.2f,%.2f\n", szType, (unsigned long)pT->ulSpawns,
+		ratio(pT->ulKills, pT->ulSpawns), ratio(pT->ulContacts, pT->ulSpawns),
+		ratio(pT->ulKillFrames, pT->ulKills), ratio(pT->ulKillRounds, pT->ulKills),
+		ratio(pT->ulDamageDealt, pT->ulSpawns), ratio(pT->ulPath, pT->ulSpawns));
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: balance_sim [options]\n"
+		"  -x mode     session (level spawns) or encounter (one monster per trial)\n"
+		"  -g path     game manifest (data/game.smt)\n"
+		"  -l level    manifest level (its start level)\n"
+		"  -m maze     maze file instead of a manifest level\n"
+		"  -e lvl      .lvl to spawn from (the level's own)\n"
+		"  -M path     monsters.dat (the manifest's)\n"
+		"  -n trials   trials (1000); encounter mode runs each type per trial\n"
+		"  -s seed     seed of trial 0 (1)\n"
+		"  -j jobs     worker processes (online CPUs)\n"
+		"  -f frames   frame cap per trial (3000, a minute at 50 Hz)\n"
+		"  -w frames   party steps every n frames, 0 stands (session 15, encounter 0)\n"
+		"  -p x,y      party start (first open cell)\n"
+		"  -t type     encounter: this monster type only\n"
+		"  -R steps    encounter: furthest spawn from the party (6)\n"
+		"  -H/-A/-D n  hero max HP, attack, defense\n"
+		"  -r          one CSV row per monster per trial\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *szManifest = "data/game.smt", *szMaze = NULL, *szLvl = NULL, *szMonsters = NULL;
+	int iLevel = -1;
+	int iWalk = -1;
+	long lJobs = sysconf(_SC_NPROCESSORS_ONLN);
+	s_sOpt.eMode = SIM_MODE_SESSION;
+	s_sOpt.ulTrials = 1000;
+	s_sOpt.ulSeed = 1;
+	s_sOpt.ulFrames = 3000;
+	s_sOpt.ubRadius = 6;
+	s_sOpt.wType = -1;
+	s_sOpt.wStartX = s_sOpt.wStartY = -1;
+	s_sOpt.wHeroHP = s_sOpt.wHeroAttack = s_sOpt.wHeroDefense = -1;
+	int iOpt;
+	while ((iOpt = getopt(argc, argv, "x:g:l:m:e:M:n:s:j:f:w:p:t:R:H:A:D:rh")) != -1) {
+		switch (iOpt) {
+		case 'x':
+			if (!strcmp(optarg, "session"))
+				s_sOpt.eMode = SIM_MODE_SESSION;
+			else if (!strcmp(optarg, "encounter"))
+				s_sOpt.eMode = SIM_MODE_ENCOUNTER;
+			else {
+				usage();
+				return 2;
+			}
+			break;
+		case 'g': szManifest = optarg; break;
+		case 'l': iLevel = atoi(optarg); break;
+		case 'm': szMaze = optarg; break;
+		case 'e': szLvl = optarg; break;
+		case 'M': szMonsters = optarg; break;
+		case 'n': s_sOpt.ulTrials = strtoul(optarg, NULL, 0); break;
+		case 's': s_sOpt.ulSeed = strtoul(optarg, NULL, 0); break;
+		case 'j': lJobs = atol(optarg); break;
+		case 'f': s_sOpt.ulFrames = strtoul(optarg, NULL, 0); break;
+		case 'w': iWalk = atoi(optarg); break;
+		case 'p':
+			if (sscanf(optarg, "%hd,%hd", &s_sOpt.wStartX, &s_sOpt.wStartY) != 2) {
+				usage();
+				return 2;
+			}
+			break;
+		case 't': s_sOpt.wType = (WORD)atoi(optarg); break;
+		case 'R': s_sOpt.ubRadius = (UBYTE)atoi(optarg); break;
+		case 'H': s_sOpt.wHeroHP = (WORD)atoi(optarg); break;
+		case 'A': s_sOpt.wHeroAttack = (WORD)atoi(optarg); break;
+		case 'D': s_sOpt.wHeroDefense = (WORD)atoi(optarg); break;
+		case 'r': s_sOpt.isRaw = 1; break;
+		default:
+			usage();
+			return 2;
+		}
+	}
+	if (iWalk < 0)
+		iWalk = s_sOpt.eMode == SIM_MODE_SESSION ? 15 : 0;
+	s_sOpt.uwWalkPeriod = (UWORD)iWalk;
+	if (lJobs < 1)
+		lJobs = 1;
+	if (lJobs > SIM_MAX_JOBS)
+		lJobs = SIM_MAX_JOBS;
+	if ((ULONG)lJobs > s_sOpt.ulTrials)
+		lJobs = s_sOpt.ulTrials ? (long)s_sOpt.ulTrials : 1;
+	s_sOpt.ubJobs = (UBYTE)lJobs;
+
+	tGameManifest sMan;
+	gameManifestLoad(&sMan, szManifest);
+	if (!loadLevelImages(&sMan, iLevel, szMaze, szLvl))
+		return 1;
+	hostGameCreate();
+	loadItems(sMan.itemsPath);
+	monsterTableLoad(szMonsters ? szMonsters : sMan.monstersPath);
+	s_ubTypeCount = monsterTableCount() ? monsterTableCount() : 3;
+
+	double dStart = hostNowUs();
+	int pFds[SIM_MAX_JOBS];
+	FILE *pRaws[SIM_MAX_JOBS];
+	pid_t pPids[SIM_MAX_JOBS];
+	if (s_sOpt.isRaw)
+		printf("seed,spawn,type,killed,contact_frame,kill_frame,rounds,damage_to_party,path,hero_died\n");
+	fflush(stdout);
+	for (UBYTE j = 0; j < s_sOpt.ubJobs; j++) {
+		int pPipe[2];
+		pRaws[j] = s_sOpt.isRaw ? tmpfile() : NULL;
+		if (pipe(pPipe) != 0 || (pPids[j] = fork()) < 0) {
+			fprintf(stderr, "balance_sim: cannot start worker %u\n", j);
+			return 1;
+		}
+		if (pPids[j] == 0) {
+			close(pPipe[0]);
+			tSimTotals *pTotals = (tSimTotals *)calloc(1, sizeof(tSimTotals));
+			ULONG ulFirst = s_sOpt.ulTrials * j / s_sOpt.ubJobs;
+			ULONG ulEnd = s_sOpt.ulTrials * (j + 1) / s_sOpt.ubJobs;
+			runBlock(ulFirst, ulEnd, pTotals, pRaws[j]);
+			if (pRaws[j])
+				fflush(pRaws[j]);
+			_exit(writeAll(pPipe[1], pTotals, sizeof(tSimTotals)) ? 0 : 1);
+		}
+		close(pPipe[1]);
+		pFds[j] = pPipe[0];
+	}
+
+	tSimTotals *pSum = (tSimTotals *)calloc(1, sizeof(tSimTotals));
+	tSimTotals *pPart = (tSimTotals *)malloc(sizeof(tSimTotals));
+	int iResult = 0;
+	for (UBYTE j = 0; j < s_sOpt.ubJobs; j++) {
+		if (readAll(pFds[j], pPart, sizeof(tSimTotals)))
+			addTotals(pSum, pPart);
+		else
+			iResult = 1;
+		close(pFds[j]);
+		int iStatus;
+		waitpid(pPids[j], &iStatus, 0);
+		if (!WIFEXITED(iStatus) || WEXITSTATUS(iStatus) != 0)
+			iResult = 1;
+		if (pRaws[j]) {
+			char pBuf[4096];
+			size_t ulGot;
+			rewind(pRaws[j]);
+			while ((ulGot = fread(pBuf, 1, sizeof(pBuf), pRaws[j])) > 0)
+				fwrite(pBuf, 1, ulGot, stdout);
+			fclose(pRaws[j]);
+		}
+	}
+	double dSeconds = (hostNowUs() - dStart) / 1e6;
+
+	if (!s_sOpt.isRaw) {
+		printf("type,spawns,kill_rate,contact_rate,ttk_frames,ttk_rounds,damage_to_party,path\n");
+		tSimTypeTotals sAll;
+		memset(&sAll, 0, sizeof(sAll));
+		for (UWORD t = 0; t < SIM_TYPES; t++) {
+			const tSimTypeTotals *pT = &pSum->pTypes[t];
+			if (!pT->ulSpawns)
+				continue;
+			char szType[8];
+			snprintf(szType, sizeof(szType), "%u", t);
+			printTypeRow(szType, pT);
+			sAll.ulSpawns += pT->ulSpawns;
+			sAll.ulContacts += pT->ulContacts;
+			sAll.ulKills += pT->ulKills;
+			sAll.ulKillFrames += pT->ulKillFrames;
+			sAll.ulKillRounds += pT->ulKillRounds;
+			sAll.ulDamageDealt += pT->ulDamageDealt;
+			sAll.ulPath += pT->ulPath;
+		}
+		printTypeRow("all", &sAll);
+	}
+	fprintf(stderr, "%lu trials, %lu frames, hero died in %.1f%%, %u workers, %.2f s\n",
+		(unsigned long)pSum->ulTrials, (unsigned long)pSum->ulFrames,
+		100.0 * ratio(pSum->ulHeroDeaths, pSum->ulTrials), s_sOpt.ubJobs, dSeconds);
+
+	if (!pSum->ulTrials)
+		iResult = 1;
+	free(pPart);
+	free(pSum);
+	free(s_pMazeImage);
+	free(s_pLvlImage);
+	wallButtonListDestroy(&g_pGameState->m_wallButtons);
+	doorButtonListDestroy(&g_pGameState->m_doorButtons);
+	doorLockListDestroy(&g_pGameState->m_doorLocks);
+	hostGameDestroy();
+	return iResult;
+}
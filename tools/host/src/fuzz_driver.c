@@ -0,0 +1,67 @@
+/* Stand-alone driver for script_fuzz when libFuzzer is unavailable (GCC builds).
+ *
+ *   script_fuzz [-runs=N] [-seed=S] [file...]
+ *
+ * With files, each one is fed once (crash reproduction / corpus replay).
+ * Otherwise N random inputs are generated from seed S. */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *pData, size_t ulSize);
+
+static uint32_t s_ulState;
+
+static uint32_t nextRand(void)
+{
+	/* xorshift32 */
+	s_ulState ^= s_ulState << 13;
+	s_ulState ^= s_ulState >> 17;
+	s_ulState ^= s_ulState << 5;
+	return s_ulState;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long ulRuns = 10000;
+	uint32_t ulSeed = 1;
+	int iFiles = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "-runs=", 6) == 0)
+			ulRuns = strtoul(argv[i] + 6, NULL, 10);
+		else if (strncmp(argv[i], "-seed=", 6) == 0)
+			ulSeed = (uint32_t)strtoul(argv[i] + 6, NULL, 10);
+	}
+	for (int i = 1; i < argc; i++) {
+		if (argv[i][0] == '-')
+			continue;
+		FILE *pFp = fopen(argv[i], "rb");
+		if (!pFp) {
+			fprintf(stderr, "cannot open %s\n", argv[i]);
+			return 1;
+		}
+		static uint8_t s_pBuf[1 << 16];
+		size_t ulSize = fread(s_pBuf, 1, sizeof(s_pBuf), pFp);
+		fclose(pFp);
+		LLVMFuzzerTestOneInput(s_pBuf, ulSize);
+		iFiles++;
+	}
+	if (iFiles)
+		return 0;
+
+	s_ulState = ulSeed ? ulSeed : 1;
+	uint8_t pBuf[1024];
+	for (unsigned long ulRun = 0; ulRun < ulRuns; ulRun++) {
+		size_t ulSize = 3 + nextRand() % (sizeof(pBuf) - 3);
+		for (size_t i = 0; i < ulSize; i++) {
+			uint32_t r = nextRand();
+			/* Bias opcode-ish bytes towards the defined ranges */
+			pBuf[i] = (r & 0x300) ? (uint8_t)r : (uint8_t)(128 + (r >> 24) % 6);
+		}
+		LLVMFuzzerTestOneInput(pBuf, ulSize);
+	}
+	printf("%lu runs, seed %u\n", ulRuns, (unsigned)ulSeed);
+	return 0;
+}
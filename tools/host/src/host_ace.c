@@ -0,0 +1,356 @@
+/* Minimal ACE implementation over libc so game logic can run on Linux. */
+#include <ace/managers/memory.h>
+#include <ace/managers/log.h>
+#include <ace/managers/system.h>
+#include <ace/managers/timer.h>
+#include <ace/utils/disk_file.h>
+#include <ace/utils/bitmap.h>
+#include <ace/utils/font.h>
+#include <ace/utils/palette.h>
+#include <ace/managers/blit.h>
+#include <ace/managers/key.h>
+#include <ace/managers/mouse.h>
+#include <ace/managers/joy.h>
+#include "host_ace.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+tHostMemStats g_sHostMem;
+tHostFileStats g_sHostFile;
+tHostInput g_sHostInput;
+
+struct _tFile {
+	FILE *pFp;
+};
+
+/* Each allocation carries its size in front so memFree() sizes can be checked. */
+typedef struct _tHostAllocHeader {
+	ULONG ulSize;
+	ULONG ulMagic;
+} tHostAllocHeader;
+
+#define HOST_ALLOC_MAGIC 0x534D4954
+
+void hostStatsReset(void)
+{
+	g_sHostMem.ulAllocs = 0;
+	g_sHostMem.ulFrees = 0;
+	g_sHostMem.lBytesLive = 0;
+	g_sHostMem.ulPeakBytes = 0;
+	g_sHostMem.ulSizeMismatches = 0;
+	g_sHostFile.ulOpens = 0;
+	g_sHostFile.ulReadCalls = 0;
+	g_sHostFile.ulReadBytes = 0;
+	g_sHostFile.ulWriteCalls = 0;
+}
+
+double hostNowUs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static void *hostAlloc(ULONG ulSize, UBYTE isClear)
+{
+	tHostAllocHeader *pHeader = isClear
+		? calloc(1, sizeof(tHostAllocHeader) + ulSize)
+		: malloc(sizeof(tHostAllocHeader) + ulSize);
+	if (!pHeader)
+		return NULL;
+	pHeader->ulSize = ulSize;
+	pHeader->ulMagic = HOST_ALLOC_MAGIC;
+	g_sHostMem.ulAllocs++;
+	g_sHostMem.lBytesLive += (LONG)ulSize;
+	if (g_sHostMem.lBytesLive > (LONG)g_sHostMem.ulPeakBytes)
+		g_sHostMem.ulPeakBytes = (ULONG)g_sHostMem.lBytesLive;
+	return pHeader + 1;
+}
+
+void *memAllocFast(ULONG ulSize) { return hostAlloc(ulSize, 0); }
+void *memAllocFastClear(ULONG ulSize) { return hostAlloc(ulSize, 1); }
+void *memAllocChip(ULONG ulSize) { return hostAlloc(ulSize, 0); }
+void *memAllocChipClear(ULONG ulSize) { return hostAlloc(ulSize, 1); }
+void *memAlloc(ULONG ulSize, ULONG ulFlags) { return hostAlloc(ulSize, (ulFlags & MEMF_CLEAR) != 0); }
+
+void memFree(void *pMem, ULONG ulSize)
+{
+	if (!pMem)
+		return;
+	tHostAllocHeader *pHeader = (tHostAllocHeader *)pMem - 1;
+	if (pHeader->ulMagic != HOST_ALLOC_MAGIC) {
+		fprintf(stderr, "memFree: %p was not allocated by memAlloc*\n", pMem);
+		abort();
+	}
+	if (pHeader->ulSize != ulSize)
+		g_sHostMem.ulSizeMismatches++;
+	g_sHostMem.ulFrees++;
+	g_sHostMem.lBytesLive -= (LONG)pHeader->ulSize;
+	pHeader->ulMagic = 0;
+	free(pHeader);
+}
+
+ULONG g_ulHostFreeSize = 0x7FFFFFFF;
+
+ULONG memGetFreeSize(void)
+{
+	return g_ulHostFreeSize;
+}
+
+ULONG g_ulHostFreeChipSize = 0x7FFFFFFF;
+
+ULONG memGetFreeChipSize(void)
+{
+	return g_ulHostFreeChipSize;
+}
+
+void logWrite(const char *szFormat, ...)
+{
+	static int s_iEnabled = -1;
+	if (s_iEnabled < 0)
+		s_iEnabled = getenv("SMITE_HOST_LOG") != NULL;
+	if (!s_iEnabled)
+		return;
+	va_list vArgs;
+	va_start(vArgs, szFormat);
+	vfprintf(stderr, szFormat, vArgs);
+	va_end(vArgs);
+}
+
+void systemUse(void) {}
+void systemUnuse(void) {}
+
+static double s_dTimerStart;
+
+void timerCreate(void) { s_dTimerStart = hostNowUs(); }
+void timerDestroy(void) {}
+ULONG timerGet(void) { return (ULONG)((hostNowUs() - s_dTimerStart) / 20000.0); }
+ULONG timerGetPrec(void) { return (ULONG)hostNowUs(); }
+ULONG timerGetDelta(ULONG ulStart, ULONG ulStop) { return ulStop - ulStart; }
+void timerFormatPrec(char *szBfr, ULONG ulPrecTime) { sprintf(szBfr, "%lu.%03lu ms", (unsigned long)(ulPrecTime / 1000), (unsigned long)(ulPrecTime % 1000)); }
+
+UBYTE keyCheck(UBYTE ubKeyCode) { return g_sHostInput.pKeys[ubKeyCode & 127]; }
+UBYTE keyUse(UBYTE ubKeyCode) { return keyCheck(ubKeyCode); }
+UBYTE mouseCheck(UBYTE ubPort, UBYTE ubButton) { (void)ubPort; return g_sHostInput.pMouse[ubButton & 1]; }
+UBYTE mouseUse(UBYTE ubPort, UBYTE ubButton) { return mouseCheck(ubPort, ubButton); }
+UWORD mouseGetX(UBYTE ubPort) { (void)ubPort; return g_sHostInput.uwMouseX; }
+UWORD mouseGetY(UBYTE ubPort) { (void)ubPort; return g_sHostInput.uwMouseY; }
+UBYTE joyCheck(UBYTE ubJoyCode) { return g_sHostInput.pJoy[ubJoyCode & 31]; }
+UBYTE joyUse(UBYTE ubJoyCode) { return joyCheck(ubJoyCode); }
+
+tFile *diskFileOpen(const char *szPath, tDiskFileMode eMode, UBYTE isUninterrupted)
+{
+	(void)isUninterrupted;
+	const char *szMode = eMode == DISK_FILE_MODE_READ ? "rb" :
+		(eMode == DISK_FILE_MODE_WRITE ? "wb" : "ab");
+	FILE *pFp = fopen(szPath, szMode);
+	if (!pFp)
+		return NULL;
+	tFile *pFile = malloc(sizeof(tFile));
+	pFile->pFp = pFp;
+	g_sHostFile.ulOpens++;
+	return pFile;
+}
+
+UBYTE diskFileExists(const char *szPath)
+{
+	FILE *pFp = fopen(szPath, "rb");
+	if (!pFp)
+		return 0;
+	fclose(pFp);
+	return 1;
+}
+
+ULONG fileRead(tFile *pFile, void *pDest, ULONG ulSize)
+{
+	g_sHostFile.ulReadCalls++;
+	if (!ulSize)
+		return 0;
+	ULONG ulRead = (ULONG)fread(pDest, 1, ulSize, pFile->pFp);
+	g_sHostFile.ulReadBytes += ulRead;
+	return ulRead;
+}
+
+ULONG fileWrite(tFile *pFile, const void *pSrc, ULONG ulSize)
+{
+	g_sHostFile.ulWriteCalls++;
+	if (!ulSize)
+		return 0;
+	return (ULONG)fwrite(pSrc, 1, ulSize, pFile->pFp);
+}
+
+UBYTE fileSeek(tFile *pFile, LONG lPos, WORD wMode)
+{
+	int iWhence = wMode == FILE_SEEK_SET ? SEEK_SET : (wMode == FILE_SEEK_CURRENT ? SEEK_CUR : SEEK_END);
+	return fseek(pFile->pFp, lPos, iWhence) == 0;
+}
+
+ULONG fileGetPos(tFile *pFile)
+{
+	return (ULONG)ftell(pFile->pFp);
+}
+
+ULONG fileGetSize(const char *szPath)
+{
+	FILE *pFp = fopen(szPath, "rb");
+	if (!pFp)
+		return (ULONG)-1;
+	fseek(pFp, 0, SEEK_END);
+	ULONG ulSize = (ULONG)ftell(pFp);
+	fclose(pFp);
+	return ulSize;
+}
+
+UBYTE fileIsEof(tFile *pFile)
+{
+	return feof(pFile->pFp) != 0;
+}
+
+void fileClose(tFile *pFile)
+{
+	fclose(pFile->pFp);
+	free(pFile);
+}
+
+tBitMap *bitmapCreate(UWORD uwWidth, UWORD uwHeight, UBYTE ubDepth, UBYTE ubFlags)
+{
+	tBitMap *pBitMap = memAllocFastClear(sizeof(tBitMap));
+	UWORD uwByteWidth = ((uwWidth + 15) / 16) * 2;
+	pBitMap->Rows = uwHeight;
+	pBitMap->Depth = ubDepth;
+	pBitMap->Flags = ubFlags;
+	if (ubFlags & BMF_INTERLEAVED) {
+		/* As ACE: one buffer, each row holds every plane's row in turn */
+		pBitMap->BytesPerRow = uwByteWidth * ubDepth;
+		pBitMap->Planes[0] = memAllocFastClear((ULONG)pBitMap->BytesPerRow * uwHeight);
+		for (UBYTE i = 1; i < ubDepth && i < 8; i++)
+			pBitMap->Planes[i] = pBitMap->Planes[0] + (ULONG)uwByteWidth * i;
+		return pBitMap;
+	}
+	pBitMap->BytesPerRow = uwByteWidth;
+	for (UBYTE i = 0; i < ubDepth && i < 8; i++)
+		pBitMap->Planes[i] = memAllocFastClear((ULONG)pBitMap->BytesPerRow * uwHeight);
+	return pBitMap;
+}
+
+UBYTE bitmapIsInterleaved(const tBitMap *pBitMap)
+{
+	return pBitMap->Depth > 1 && (ULONG)(pBitMap->Planes[1] - pBitMap->Planes[0]) == pBitMap->BytesPerRow / pBitMap->Depth;
+}
+
+UWORD bitmapGetByteWidth(const tBitMap *pBitMap)
+{
+	return bitmapIsInterleaved(pBitMap) ? pBitMap->BytesPerRow / pBitMap->Depth : pBitMap->BytesPerRow;
+}
+
+tBitMap *bitmapCreateFromPath(const char *szPath, UBYTE isFast)
+{
+	(void)isFast;
+	tFile *pFile = diskFileOpen(szPath, DISK_FILE_MODE_READ, 1);
+	if (!pFile)
+		return NULL;
+	UBYTE pHeader[8];
+	if (fileRead(pFile, pHeader, sizeof(pHeader)) != sizeof(pHeader)) {
+		fileClose(pFile);
+		return NULL;
+	}
+	UWORD uwWidth = (UWORD)((pHeader[0] << 8) | pHeader[1]);
+	UWORD uwHeight = (UWORD)((pHeader[2] << 8) | pHeader[3]);
+	tBitMap *pBitMap = bitmapCreate(uwWidth, uwHeight, pHeader[4], 0);
+	/* File rows are byte-packed; bitmap rows are word-aligned */
+	UWORD uwFileBpr = (UWORD)((uwWidth + 7) / 8);
+	for (UBYTE i = 0; i < pBitMap->Depth && i < 8; i++)
+		for (UWORD y = 0; y < uwHeight; y++)
+			fileRead(pFile, pBitMap->Planes[i] + (ULONG)y * pBitMap->BytesPerRow, uwFileBpr);
+	fileClose(pFile);
+	return pBitMap;
+}
+
+void bitmapSave(tBitMap *pBitMap, const char *szPath)
+{
+	tFile *pFile = diskFileOpen(szPath, DISK_FILE_MODE_WRITE, 1);
+	if (!pFile)
+		return;
+	UWORD uwWidth = (UWORD)(bitmapGetByteWidth(pBitMap) * 8);
+	UBYTE isInterleaved = bitmapIsInterleaved(pBitMap);
+	UBYTE pHeader[8] = {
+		(UBYTE)(uwWidth >> 8), (UBYTE)uwWidth, (UBYTE)(pBitMap->Rows >> 8), (UBYTE)pBitMap->Rows,
+		pBitMap->Depth, 0, isInterleaved, 0
+	};
+	fileWrite(pFile, pHeader, sizeof(pHeader));
+	if (isInterleaved)
+		fileWrite(pFile, pBitMap->Planes[0], (ULONG)pBitMap->BytesPerRow * pBitMap->Rows);
+	else
+		for (UBYTE i = 0; i < pBitMap->Depth && i < 8; i++)
+			fileWrite(pFile, pBitMap->Planes[i], (ULONG)pBitMap->BytesPerRow * pBitMap->Rows);
+	fileClose(pFile);
+}
+
+void bitmapDestroy(tBitMap *pBitMap)
+{
+	if (!pBitMap)
+		return;
+	if (pBitMap->Flags & BMF_INTERLEAVED)
+		memFree(pBitMap->Planes[0], (ULONG)pBitMap->BytesPerRow * pBitMap->Rows);
+	else
+		for (UBYTE i = 0; i < pBitMap->Depth && i < 8; i++)
+			memFree(pBitMap->Planes[i], (ULONG)pBitMap->BytesPerRow * pBitMap->Rows);
+	memFree(pBitMap, sizeof(tBitMap));
+}
+
+UBYTE blitUnsafeCopyMask(tBitMap *pSrc, WORD wSrcX, WORD wSrcY, tBitMap *pDst, WORD wDstX, WORD wDstY,
+	WORD wWidth, WORD wHeight, const UBYTE *pMsk)
+{
+	(void)pSrc; (void)wSrcX; (void)wSrcY; (void)pDst; (void)wDstX; (void)wDstY;
+	(void)wWidth; (void)wHeight; (void)pMsk;
+	return 1;
+}
+
+void blitRect(tBitMap *pDst, WORD wDstX, WORD wDstY, WORD wWidth, WORD wHeight, UBYTE ubColor)
+{
+	(void)pDst; (void)wDstX; (void)wDstY; (void)wWidth; (void)wHeight; (void)ubColor;
+}
+
+/* The font's glyph sheet only: a 1-plane bitmap as wide as the file is long */
+tFont *fontCreateFromPath(const char *szPath)
+{
+	tFile *pFile = diskFileOpen(szPath, DISK_FILE_MODE_READ, 1);
+	if (!pFile)
+		return NULL;
+	fileSeek(pFile, 0, FILE_SEEK_END);
+	ULONG ulSize = (ULONG)fileGetPos(pFile);
+	fileClose(pFile);
+	tFont *pFont = memAllocFastClear(sizeof(tFont));
+	pFont->uwWidth = (UWORD)(ulSize * 8);
+	pFont->uwHeight = 1;
+	pFont->pRawData = bitmapCreate(pFont->uwWidth, 1, 1, 0);
+	return pFont;
+}
+
+void fontDestroy(tFont *pFont)
+{
+	if (!pFont)
+		return;
+	bitmapDestroy(pFont->pRawData);
+	memFree(pFont, sizeof(tFont));
+}
+
+/* ACE .plt: colour count, then one big-endian 0x0RGB word per colour */
+void paletteLoadFromPath(const char *szPath, UWORD *pPalette, UBYTE ubMaxLength)
+{
+	tFile *pFile = diskFileOpen(szPath, DISK_FILE_MODE_READ, 1);
+	if (!pFile)
+		return;
+	UBYTE ubCount = 0;
+	fileRead(pFile, &ubCount, 1);
+	for (UBYTE i = 0; i < ubCount && i < ubMaxLength; i++) {
+		UBYTE pRgb[2];
+		if (fileRead(pFile, pRgb, 2) != 2)
+			break;
+		pPalette[i] = (UWORD)((pRgb[0] << 8) | pRgb[1]);
+	}
+	fileClose(pFile);
+}
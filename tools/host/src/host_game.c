@@ -0,0 +1,98 @@
+#include "host_game.h"
+#include "save_journal.h"
+#include "party_field.h"
+#include <ace/managers/memory.h>
+#include <stdio.h>
+
+tGameState *g_pGameState = NULL;
+UBYTE g_ubRequestWin = 0;
+tLevelRequest g_sLevelRequest;
+
+char g_szHostLastMessage[256];
+ULONG g_ulHostMessageCount;
+
+void gameDisplayMessage(const char *szMessage)
+{
+	snprintf(g_szHostLastMessage, sizeof(g_szHostLastMessage), "%s", szMessage);
+	g_ulHostMessageCount++;
+}
+
+void gameDisplayText(const char *pText, UWORD uwLength)
+{
+	snprintf(g_szHostLastMessage, sizeof(g_szHostLastMessage), "%.*s", (int)uwLength, pText);
+	g_ulHostMessageCount++;
+}
+
+UBYTE LoadLevel(BYTE level)
+{
+	/* No manifest levels here; cases swap mazes in with hostGameSetMaze() */
+	(void)level;
+	return 0;
+}
+
+void hostGameCreate(void)
+{
+	g_pGameState = (tGameState *)memAllocFastClear(sizeof(tGameState));
+	g_pGameState->m_pCurrentParty = characterPartyCreate();
+	g_pGameState->m_pCurrentParty->_BatteryLevel = 100;
+	g_pGameState->m_pMonsterList = monsterListCreate();
+	g_pGameState->m_pInventory = inventoryCreate();
+	/* Missing file -> built-in Key (0) and Potion (1) */
+	loadItems("");
+	characterPartyEnsureDefaultHero(g_pGameState->m_pCurrentParty);
+}
+
+void hostGameSetMaze(tMaze *pMaze)
+{
+	if (g_pGameState->m_pCurrentMaze && g_pGameState->m_pCurrentMaze != pMaze) {
+		/* Same as LoadLevel(): monsters are counted in the maze being dropped */
+		monsterListClear(g_pGameState->m_pMonsterList);
+		encounterListClear(&g_pGameState->m_encounters);
+		mazeDelete(g_pGameState->m_pCurrentMaze);
+	}
+	g_pGameState->m_pCurrentMaze = pMaze;
+	partyFieldReset();
+	/* ADD_MONSTER's dormant monsters, as LoadLevel() makes them */
+	if (pMaze && !g_pGameState->m_encounters.spawnCount)
+		encounterAddMazeSpawns(&g_pGameState->m_encounters, pMaze);
+}
+
+void hostGameReset(void)
+{
+	memset(g_pGameState->m_bGlobalFlags, 0, sizeof(g_pGameState->m_bGlobalFlags));
+	memset(g_pGameState->m_bLocalFlags, 0, sizeof(g_pGameState->m_bLocalFlags));
+	inventoryDestroy(g_pGameState->m_pInventory);
+	g_pGameState->m_pInventory = inventoryCreate();
+	monsterListClear(g_pGameState->m_pMonsterList);
+	encounterListClear(&g_pGameState->m_encounters);
+	groundItemListClear(&g_pGameState->m_groundItems);
+	doorLockListDestroy(&g_pGameState->m_doorLocks);
+	saveJournalReset();
+	partyFieldReset();
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	pParty->_PartyX = 0;
+	pParty->_PartyY = 0;
+	pParty->_PartyFacing = 0;
+	pParty->_BatteryLevel = 100;
+	scriptStopAll();
+	scriptSetFrameBudget(SCRIPT_DEFAULT_FRAME_BUDGET);
+	g_ubRequestWin = 0;
+	memset(&g_sLevelRequest, 0, sizeof(g_sLevelRequest));
+	g_szHostLastMessage[0] = '\0';
+	g_ulHostMessageCount = 0;
+}
+
+void hostGameDestroy(void)
+{
+	if (!g_pGameState)
+		return;
+	if (g_pGameState->m_pCurrentMaze)
+		mazeDelete(g_pGameState->m_pCurrentMaze);
+	characterPartyDestroy(g_pGameState->m_pCurrentParty);
+	encounterListClear(&g_pGameState->m_encounters);
+	monsterListDestroy(g_pGameState->m_pMonsterList);
+	inventoryDestroy(g_pGameState->m_pInventory);
+	itemSystemDestroy();
+	memFree(g_pGameState, sizeof(tGameState));
+	g_pGameState = NULL;
+}
@@ -0,0 +1,16 @@
+#pragma once
+/* Game-state fixture for host tools: a party, inventory and monster list
+ * around a maze, without ACE views or the state manager. */
+#include "GameState.h"
+
+/** Last text passed to gameDisplayMessage() or gameDisplayText(), and how many times they were called. */
+extern char g_szHostLastMessage[256];
+extern ULONG g_ulHostMessageCount;
+
+/** Creates g_pGameState with a default hero, empty inventory, fallback items and no monsters. */
+void hostGameCreate(void);
+/** Swaps in pMaze as the current maze; the previous one is deleted (NULL just deletes it). */
+void hostGameSetMaze(tMaze *pMaze);
+/** Clears flags, inventory, monsters, ground items, door locks, the save journal, party position and script/message side effects between cases. */
+void hostGameReset(void);
+void hostGameDestroy(void);
@@ -0,0 +1,499 @@
+/* Level load benchmark: loose files versus a .pak built by smite_pack, plain and -z.
+ *
+ *   load_bench [iterations]
+ *
+ * Writes a synthetic level (maze, wallset with bitmaps, .lvl) to a temp
+ * directory, packs it, then runs the same sequence LoadLevel() does both
+ * ways. Reports wall time plus file opens and read calls per load, which is
+ * what costs on floppy. Exits non-zero if the two loads disagree.
+ * A second table times the small loaders (manifest, items, monsters, .lvl), and
+ * the last rows load both levels again after level_prefetch.c staged them.
+ * The "cached" rows re-enter a level whose wallset is still idle in asset_cache.c. */
+#include "host_game.h"
+#include "host_ace.h"
+#include "level_entities.h"
+#include "pak.h"
+#include "wallset.h"
+#include "wallbutton.h"
+#include "doorbutton.h"
+#include "doorlock.h"
+#include "pressure_plate.h"
+#include "ground_item.h"
+#include "game_manifest.h"
+#include "item.h"
+#include "monster.h"
+#include "level_prefetch.h"
+#include "asset_cache.h"
+#include "script.h"
+#include <ace/managers/memory.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_GROUPS 4
+#define BENCH_TILES_PER_GROUP 12
+
+static char s_szDir[256];
+static char s_szMaze[320], s_szWall[320], s_szLvl[320], s_szPak[320], s_szPakZ[320];
+static const char *s_szPakIn = s_szPak; /* which pack loadPak() opens */
+static UBYTE s_ubUseCache; /* wallsets through asset_cache.c, as LoadLevel() does */
+static char s_szItems[320], s_szMonsters[320], s_szManifest[320], s_szLevelsSmt[320];
+
+static void writeLevelFiles(void)
+{
+	tMaze *pMaze = mazeCreate(64, 64);
+	for (UWORD i = 0; i < 64 * 64; i++)
+		pMaze->_mazeData[i] = (UBYTE)(i % 7 == 0);
+	for (UWORD i = 0; i < 600; i++) {
+		UBYTE pData[6] = {(UBYTE)i, 1, 2, 3, 4, 5};
+		mazeAppendEvent(pMaze, mazeEventCreate((UBYTE)(i % 64), (UBYTE)(i / 64),
+			EVENT_SETFLAG, (UBYTE)(2 + i % 5), pData));
+	}
+	for (UWORD i = 0; i < 120; i++) {
+		char szText[48];
+		int iLen = snprintf(szText, sizeof(szText), "Message number %u for the level", (unsigned)i);
+		mazeAddString(pMaze, szText, (UWORD)iLen);
+	}
+	mazeSave(pMaze, s_szMaze);
+	mazeDelete(pMaze);
+
+	/* Same ownership layout wallsetLoad() produces, so wallsetDestroy() can free it */
+	tWallset *pSet = memAllocFastClear(sizeof(tWallset));
+	UWORD uwTiles = BENCH_GROUPS * BENCH_TILES_PER_GROUP;
+	pSet->_paletteSize = 32;
+	pSet->_palette = memAllocFastClear(32 * 3);
+	pSet->_tilesetCount = uwTiles;
+	pSet->_gfxCount = BENCH_GROUPS;
+	tWallGfx *pTiles = memAllocFastClear(sizeof(tWallGfx) * uwTiles);
+	pSet->_tileset = memAllocFastClear(sizeof(tWallGfx *) * uwTiles);
+	pSet->_tilesPerGroup = memAllocFastClear(BENCH_GROUPS);
+	pSet->_gfx = memAllocFastClear(sizeof(tBitMap *) * BENCH_GROUPS);
+	pSet->_mask = memAllocFastClear(sizeof(tBitMap *) * BENCH_GROUPS);
+	for (UWORD i = 0; i < uwTiles; i++) {
+		pSet->_tileset[i] = &pTiles[i];
+		pTiles[i]._setIndex = (UBYTE)(i / BENCH_TILES_PER_GROUP);
+		pTiles[i]._width = 32;
+		pTiles[i]._height = 48;
+		pTiles[i]._x = (UWORD)((i % BENCH_TILES_PER_GROUP) * 32);
+	}
+	for (UBYTE g = 0; g < BENCH_GROUPS; g++) {
+		pSet->_tilesPerGroup[g] = BENCH_TILES_PER_GROUP;
+		pSet->_gfx[g] = bitmapCreate(384, 96, 5, 0);
+		pSet->_mask[g] = bitmapCreate(384, 96, 1, 0);
+		/* Textured rather than flat, so -z has something realistic to chew on */
+		for (UBYTE p = 0; p < 5; p++)
+			for (UWORD y = 0; y < 96; y++)
+				for (UWORD x = 0; x < pSet->_gfx[g]->BytesPerRow; x++)
+					pSet->_gfx[g]->Planes[p][y * pSet->_gfx[g]->BytesPerRow + x] = (UBYTE)((x * (p + 1) + y / 8 + g) & 0x3F);
+	}
+	wallsetSave(pSet, s_szWall);
+	wallsetDestroy(pSet);
+
+	FILE *pFile = fopen(s_szLvl, "wb");
+	static const UBYTE s_pLvl[] = {
+		'L', 'V', 'L', 'E', LEVEL_ENTITIES_VERSION,
+		2, /* wall buttons */
+		3, 4, 0, 0, LEVEL_ENT_GFX_AUTO_WALL_BTN, EVENT_SETFLAG, 3, 0, 7, 1,
+		5, 6, 1, 0, 0, EVENT_SHOWMESSAGE, 1, 0,
+		1, /* door buttons */
+		8, 8, 2, 0, LEVEL_ENT_GFX_AUTO_DOOR_BTN, 9, 8,
+		1, /* locks */
+		9, 8, 0, 0, 0,
+		2, /* plates */
+		10, 10, EVENT_SHOWMESSAGE, 1, 0,
+		11, 10, EVENT_SETFLAG, 3, 0, 1, 1,
+		3, /* ground items */
+		12, 12, 0, 1,
+		13, 12, 1, 2,
+		14, 12, 1, 1,
+		0, /* monsters */
+		0, /* encounters */
+	};
+	fwrite(s_pLvl, 1, sizeof(s_pLvl), pFile);
+	fclose(pFile);
+}
+
+/* items.dat, monsters.dat and game.smt at their usual sizes */
+static void writeTableFiles(void)
+{
+	FILE *pFile = fopen(s_szItems, "wb");
+	fputc(100, pFile);
+	for (int i = 0; i < 100; i++) {
+		for (int f = 0; f < 11; f++)
+			fputc((i + f) & 0x7F, pFile);
+		fputc(12, pFile);
+		fprintf(pFile, "Item %7d", i);
+	}
+	fclose(pFile);
+
+	pFile = fopen(s_szMonsters, "wb");
+	fwrite("MONS\1\x30", 1, 6, pFile);
+	for (int i = 0; i < 48; i++) {
+		UBYTE pDef[26] = {(UBYTE)(1 + i % 9), 0, (UBYTE)(20 + i), 5, 3, 0, 10, 5, 20};
+		pDef[25] = 10;
+		fwrite(pDef, 1, sizeof(pDef), pFile);
+		fprintf(pFile, "Monster %02d", i);
+	}
+	fclose(pFile);
+
+	static char s_pPath[GAME_MANIFEST_PATH_MAX];
+	pFile = fopen(s_szManifest, "wb");
+	fwrite("SMTE\1\0\x10", 1, 7, pFile);
+	for (int i = 0; i < 3 + 16 * 3; i++) {
+		memset(s_pPath, 0, sizeof(s_pPath));
+		snprintf(s_pPath, sizeof(s_pPath), "data/asset%02d.dat", i);
+		fwrite(s_pPath, 1, sizeof(s_pPath), pFile);
+	}
+	fclose(pFile);
+}
+
+static void clearEntities(void)
+{
+	wallButtonListDestroy(&g_pGameState->m_wallButtons);
+	doorButtonListDestroy(&g_pGameState->m_doorButtons);
+	doorLockListDestroy(&g_pGameState->m_doorLocks);
+	pressurePlateListClear(&g_pGameState->m_pressurePlates);
+	groundItemListClear(&g_pGameState->m_groundItems);
+	wallButtonListCreate(&g_pGameState->m_wallButtons);
+	doorButtonListCreate(&g_pGameState->m_doorButtons);
+	doorLockListCreate(&g_pGameState->m_doorLocks);
+}
+
+/* The loose-file half of LoadLevel() */
+static UBYTE loadLoose(tMaze **ppMaze, tWallset **ppSet)
+{
+	*ppMaze = mazeLoad(s_szMaze);
+	*ppSet = s_ubUseCache ? assetWallsetGet(s_szWall) : wallsetLoad(s_szWall);
+	g_pGameState->m_pCurrentWallset = *ppSet;
+	levelEntitiesLoad(g_pGameState, s_szLvl);
+	return *ppMaze && *ppSet;
+}
+
+/* The .pak half of LoadLevel() */
+static UBYTE loadPak(tMaze **ppMaze, tWallset **ppSet)
+{
+	tPak sPak;
+	*ppMaze = NULL;
+	*ppSet = NULL;
+	if (!pakLoad(&sPak, s_szPakIn))
+		return 0;
+	ULONG ulSize;
+	const UBYTE *pChunk = pakFind(&sPak, PAK_TAG_MAZE, 0, &ulSize);
+	*ppMaze = mazeLoadFromMemory(pChunk, ulSize);
+	*ppSet = s_ubUseCache ? assetWallsetGetFromPak(&sPak, s_szPakIn) : wallsetLoadFromPak(&sPak);
+	g_pGameState->m_pCurrentWallset = *ppSet;
+	pChunk = pakFind(&sPak, PAK_TAG_ENTITIES, 0, &ulSize);
+	levelEntitiesLoadFromMemory(g_pGameState, pChunk, ulSize);
+	pakDestroy(&sPak);
+	return *ppMaze && *ppSet;
+}
+
+static void unload(tMaze *pMaze, tWallset *pSet)
+{
+	g_pGameState->m_pCurrentWallset = NULL;
+	clearEntities();
+	mazeDelete(pMaze);
+	if (s_ubUseCache)
+		assetWallsetRelease(pSet);
+	else
+		wallsetDestroy(pSet);
+}
+
+static int sameLevel(tMaze *pA, tWallset *pSetA, tMaze *pB, tWallset *pSetB)
+{
+	if (pA->_width != pB->_width || pA->_eventCount != pB->_eventCount || pA->_stringCount != pB->_stringCount)
+		return 0;
+	if (memcmp(pA->_mazeData, pB->_mazeData, pA->_width * pA->_height) != 0)
+		return 0;
+	for (tMazeEvent *pEa = pA->_events, *pEb = pB->_events; pEa; pEa = pEa->_next, pEb = pEb->_next) {
+		if (pEa->_eventDataSize != pEb->_eventDataSize
+			|| memcmp(pEa->_eventData, pEb->_eventData, pEa->_eventDataSize) != 0)
+			return 0;
+	}
+	if (pSetA->_tilesetCount != pSetB->_tilesetCount || pSetA->_gfxCount != pSetB->_gfxCount)
+		return 0;
+	for (UWORD g = 0; g < pSetA->_gfxCount; g++) {
+		tBitMap *pBa = pSetA->_gfx[g], *pBb = pSetB->_gfx[g];
+		if (!pBa || !pBb || !pSetB->_mask[g] || pBa->Depth != pBb->Depth || pBa->Rows != pBb->Rows)
+			return 0;
+		for (UBYTE p = 0; p < pBa->Depth; p++)
+			if (memcmp(pBa->Planes[p], pBb->Planes[p], pBa->BytesPerRow * pBa->Rows) != 0)
+				return 0;
+	}
+	return 1;
+}
+
+static void runCase(const char *szName, UBYTE (*cbLoad)(tMaze **, tWallset **), int iIters)
+{
+	double dTotal = 0;
+	ULONG ulOpens = 0, ulReads = 0, ulBytes = 0;
+	tMaze *pMaze;
+	tWallset *pSet;
+	if (s_ubUseCache) {
+		/* Leave the wallset idle in the cache, as the level just left would */
+		cbLoad(&pMaze, &pSet);
+		unload(pMaze, pSet);
+	}
+	for (int i = 0; i < iIters; i++) {
+		hostStatsReset();
+		double dStart = hostNowUs();
+		cbLoad(&pMaze, &pSet);
+		dTotal += hostNowUs() - dStart;
+		ulOpens = g_sHostFile.ulOpens;
+		ulReads = g_sHostFile.ulReadCalls;
+		ulBytes = g_sHostFile.ulReadBytes;
+		unload(pMaze, pSet);
+	}
+	printf("%-6s %9.1f us/load %4lu opens %6lu reads %8lu bytes\n", szName, dTotal / iIters,
+		(unsigned long)ulOpens, (unsigned long)ulReads, (unsigned long)ulBytes);
+}
+
+/* What game start and LoadLevel() read besides the maze and wallset */
+static void runTables(int iIters)
+{
+	static tGameManifest s_sManifest;
+	double dTotal = 0;
+	ULONG ulOpens = 0, ulReads = 0, ulBytes = 0;
+	for (int i = 0; i < iIters; i++) {
+		hostStatsReset();
+		double dStart = hostNowUs();
+		gameManifestLoad(&s_sManifest, s_szManifest);
+		loadItems(s_szItems);
+		monsterTableLoad(s_szMonsters);
+		levelEntitiesLoad(g_pGameState, s_szLvl);
+		dTotal += hostNowUs() - dStart;
+		ulOpens = g_sHostFile.ulOpens;
+		ulReads = g_sHostFile.ulReadCalls;
+		ulBytes = g_sHostFile.ulReadBytes;
+		itemSystemDestroy();
+		clearEntities();
+	}
+	printf("%-6s %9.1f us/load %4lu opens %6lu reads %8lu bytes\n", "tables", dTotal / iIters,
+		(unsigned long)ulOpens, (unsigned long)ulReads, (unsigned long)ulBytes);
+}
+
+/* Manifest with the loose files as level 0 and the plain pack as level 1 */
+static void writeLevelsManifest(void)
+{
+	static char s_pPath[GAME_MANIFEST_PATH_MAX];
+	FILE *pFile = fopen(s_szLevelsSmt, "wb");
+	fwrite("SMTE\1\0\2", 1, 7, pFile);
+	const char *pPaths[] = {"", "", "", s_szMaze, s_szWall, s_szLvl, s_szPak, "", ""};
+	for (int i = 0; i < 9; i++) {
+		memset(s_pPath, 0, sizeof(s_pPath));
+		snprintf(s_pPath, sizeof(s_pPath), "%s", pPaths[i]);
+		fwrite(s_pPath, 1, sizeof(s_pPath), pFile);
+	}
+	fclose(pFile);
+}
+
+/* Stage both levels as the game would between frames, then time the level change */
+static int runPrefetch(int iIters)
+{
+	int iResult = 0;
+	tMaze *pHere = mazeCreate(4, 4);
+	UBYTE pToLoose[] = {0, 1, 1}, pToPak[] = {1, 2, 2};
+	mazeAppendEvent(pHere, mazeEventCreate(1, 1, EVENT_CHANGE_LEVEL, 3, pToLoose));
+	mazeAppendEvent(pHere, mazeEventCreate(2, 2, EVENT_CHANGE_LEVEL, 3, pToPak));
+	double dLoose = 0, dPak = 0;
+	ULONG ulSlices = 0, ulLooseOpens = 0, ulLooseReads = 0, ulPakOpens = 0, ulPakReads = 0;
+	for (int i = 0; i < iIters; i++) {
+		levelPrefetchPlan(pHere, 9);
+		ulSlices = 0;
+		while (levelPrefetchUpdate())
+			ulSlices++;
+
+		tMaze *pMaze;
+		tWallset *pSet;
+		hostStatsReset();
+		double dStart = hostNowUs();
+		levelPrefetchRetain(0);
+		UBYTE ubOk = loadLoose(&pMaze, &pSet);
+		dLoose += hostNowUs() - dStart;
+		ulLooseOpens = g_sHostFile.ulOpens;
+		ulLooseReads = g_sHostFile.ulReadCalls;
+		unload(pMaze, pSet);
+
+		levelPrefetchPlan(pHere, 9);
+		while (levelPrefetchUpdate())
+			;
+		hostStatsReset();
+		dStart = hostNowUs();
+		levelPrefetchRetain(1);
+		s_szPakIn = s_szPak;
+		ubOk &= loadPak(&pMaze, &pSet);
+		dPak += hostNowUs() - dStart;
+		ulPakOpens = g_sHostFile.ulOpens;
+		ulPakReads = g_sHostFile.ulReadCalls;
+		unload(pMaze, pSet);
+		if (!ubOk || ulPakOpens != 0 || levelPrefetchStagedBytes() != 0) {
+			fprintf(stderr, "load_bench: prefetched level change still went to disk\n");
+			iResult = 1;
+			break;
+		}
+	}
+	printf("%-6s %9.1f us/load %4lu opens %6lu reads   (staged in %lu slices)\n", "pf lse", dLoose / iIters,
+		(unsigned long)ulLooseOpens, (unsigned long)ulLooseReads, (unsigned long)ulSlices);
+	printf("%-6s %9.1f us/load %4lu opens %6lu reads\n", "pf pak", dPak / iIters,
+		(unsigned long)ulPakOpens, (unsigned long)ulPakReads);
+
+	/* Short of memory: staging gives up and frees what it had */
+	levelPrefetchPlan(pHere, 9);
+	levelPrefetchUpdate();
+	levelPrefetchUpdate();
+	g_ulHostFreeSize = LEVEL_PREFETCH_RESERVE;
+	for (int i = 0; i < 100 && levelPrefetchUpdate(); i++)
+		;
+	g_ulHostFreeSize = 0x7FFFFFFF;
+	if (levelPrefetchStagedBytes() != 0 || levelPrefetchUpdate()) {
+		fprintf(stderr, "load_bench: prefetch did not cancel when memory ran short\n");
+		iResult = 1;
+	}
+
+	/* No fast left: the maze would land in chip, where the chip reserve applies */
+	g_ulHostFreeSize = LEVEL_PREFETCH_CHIP_RESERVE;
+	g_ulHostFreeChipSize = 0;
+	levelPrefetchPlan(pHere, 9);
+	levelPrefetchUpdate();
+	ULONG ulStagedFast = levelPrefetchStagedBytes();
+	levelPrefetchCancel();
+	g_ulHostFreeChipSize = LEVEL_PREFETCH_CHIP_RESERVE;
+	levelPrefetchPlan(pHere, 9);
+	levelPrefetchUpdate();
+	g_ulHostFreeSize = g_ulHostFreeChipSize = 0x7FFFFFFF;
+	if (!ulStagedFast || levelPrefetchStagedBytes() != 0 || levelPrefetchUpdate()) {
+		fprintf(stderr, "load_bench: prefetch staged into chip past its reserve\n");
+		iResult = 1;
+	}
+
+	/* The asset cache gives up staged levels before its idle assets */
+	levelPrefetchPlan(pHere, 9);
+	levelPrefetchUpdate();
+	levelPrefetchUpdate();
+	g_ulHostFreeSize = ASSET_CACHE_RESERVE - 1;
+	assetCacheTrim(ASSET_CACHE_RESERVE);
+	g_ulHostFreeSize = 0x7FFFFFFF;
+	if (levelPrefetchStagedBytes() != 0) {
+		fprintf(stderr, "load_bench: asset cache trimmed with levels still staged\n");
+		iResult = 1;
+	}
+	levelPrefetchCancel();
+	mazeDelete(pHere);
+	return iResult;
+}
+
+int main(int argc, char **argv)
+{
+	int iIters = argc > 1 ? atoi(argv[1]) : 200;
+	if (iIters < 1)
+		iIters = 1;
+	const char *szTmp = getenv("TMPDIR");
+	snprintf(s_szDir, sizeof(s_szDir), "%s/smite_load_XXXXXX", szTmp ? szTmp : "/tmp");
+	if (!mkdtemp(s_szDir)) {
+		perror("mkdtemp");
+		return 1;
+	}
+	snprintf(s_szMaze, sizeof(s_szMaze), "%s/bench.maze", s_szDir);
+	snprintf(s_szWall, sizeof(s_szWall), "%s/bench.wll", s_szDir);
+	snprintf(s_szLvl, sizeof(s_szLvl), "%s/bench.lvl", s_szDir);
+	snprintf(s_szPak, sizeof(s_szPak), "%s/bench.pak", s_szDir);
+	snprintf(s_szPakZ, sizeof(s_szPakZ), "%s/bench_z.pak", s_szDir);
+	snprintf(s_szItems, sizeof(s_szItems), "%s/items.dat", s_szDir);
+	snprintf(s_szMonsters, sizeof(s_szMonsters), "%s/monsters.dat", s_szDir);
+	snprintf(s_szManifest, sizeof(s_szManifest), "%s/game.smt", s_szDir);
+	snprintf(s_szLevelsSmt, sizeof(s_szLevelsSmt), "%s/levels.smt", s_szDir);
+
+	hostGameCreate();
+	clearEntities();
+	writeLevelFiles();
+	writeTableFiles();
+
+	char szCmd[1600];
+	snprintf(szCmd, sizeof(szCmd), "\"%s\" \"%s\" \"%s\" \"%s\" \"%s\"",
+		SMITE_PACK_EXE, s_szPak, s_szMaze, s_szWall, s_szLvl);
+	int iStatus = system(szCmd);
+	snprintf(szCmd, sizeof(szCmd), "\"%s\" -z \"%s\" \"%s\" \"%s\" \"%s\"",
+		SMITE_PACK_EXE, s_szPakZ, s_szMaze, s_szWall, s_szLvl);
+	if (iStatus == 0)
+		iStatus = system(szCmd);
+
+	int iResult = 0;
+	tMaze *pLooseMaze, *pPakMaze;
+	tWallset *pLooseSet, *pPakSet;
+	if (iStatus != 0 || !loadLoose(&pLooseMaze, &pLooseSet)) {
+		fprintf(stderr, "load_bench: could not build or load the loose level\n");
+		iResult = 1;
+	}
+	else {
+		UBYTE ubLooseButtons = g_pGameState->m_wallButtons._numButtons;
+		UBYTE ubLoosePlates = g_pGameState->m_pressurePlates.count;
+		g_pGameState->m_pCurrentWallset = NULL;
+		clearEntities();
+		const char *pPaks[] = {s_szPak, s_szPakZ};
+		for (int i = 0; i < 2; i++) {
+			s_szPakIn = pPaks[i];
+			if (!loadPak(&pPakMaze, &pPakSet) || !sameLevel(pLooseMaze, pLooseSet, pPakMaze, pPakSet)
+				|| g_pGameState->m_wallButtons._numButtons != ubLooseButtons
+				|| g_pGameState->m_pressurePlates.count != ubLoosePlates) {
+				fprintf(stderr, "load_bench: %s differs from the loose files\n", s_szPakIn);
+				iResult = 1;
+			}
+			unload(pPakMaze, pPakSet);
+		}
+		mazeDelete(pLooseMaze);
+		wallsetDestroy(pLooseSet);
+	}
+
+	if (iResult == 0) {
+		runCase("loose", loadLoose, iIters);
+		s_szPakIn = s_szPak;
+		runCase("pak", loadPak, iIters);
+		s_szPakIn = s_szPakZ;
+		runCase("pak -z", loadPak, iIters);
+		s_ubUseCache = 1;
+		runCase("lse $", loadLoose, iIters);
+		s_szPakIn = s_szPak;
+		runCase("pak $", loadPak, iIters);
+		s_szPakIn = s_szPakZ;
+		runCase("pkz $", loadPak, iIters);
+		tAssetCacheStats sStats;
+		assetCacheGetStats(&sStats);
+		assetCacheFlush();
+		s_ubUseCache = 0;
+		if (sStats.ulMisses != 3) {
+			fprintf(stderr, "load_bench: cached wallsets were loaded again (%lu misses)\n",
+				(unsigned long)sStats.ulMisses);
+			iResult = 1;
+		}
+		runTables(iIters);
+		writeLevelsManifest();
+		gameManifestEnsureLoaded(s_szLevelsSmt);
+		iResult = runPrefetch(iIters);
+	}
+
+	unlink(s_szMaze);
+	unlink(s_szWall);
+	unlink(s_szLvl);
+	unlink(s_szPak);
+	unlink(s_szPakZ);
+	unlink(s_szItems);
+	unlink(s_szMonsters);
+	unlink(s_szManifest);
+	unlink(s_szLevelsSmt);
+	for (int g = 0; g < BENCH_GROUPS; g++) {
+		char szPath[340];
+		snprintf(szPath, sizeof(szPath), "%s/bench_%d.pln", s_szDir, g);
+		unlink(szPath);
+		snprintf(szPath, sizeof(szPath), "%s/bench_%d.msk", s_szDir, g);
+		unlink(szPath);
+	}
+	rmdir(s_szDir);
+	clearEntities();
+	wallButtonListDestroy(&g_pGameState->m_wallButtons);
+	doorButtonListDestroy(&g_pGameState->m_doorButtons);
+	doorLockListDestroy(&g_pGameState->m_doorLocks);
+	hostGameDestroy();
+	return iResult;
+}
@@ -0,0 +1,230 @@
+/* SLZ1 benchmark: compression ratio, host decode speed and a 68020 cycle estimate.
+ *
+ *   lz_bench [decode-repeats]
+ *
+ * Corpus: the built-in demo maze, a generated 64x64 level with events and
+ * strings, and wallset-style bitmap sheets tiled from the editor's sample
+ * textures (5 planes plus a 1-plane mask). Streams are made by the editor's
+ * encoder (formats.cpp) and decoded by the game's decoder (src/misc/slz.c).
+ *
+ * The cycle estimate walks each stream and charges a 68020 cost per sequence
+ * and per byte (see k*Cycles below): roughly what the decode loop costs with
+ * the instruction cache warm, writing to chip RAM. It is a model, not a
+ * measurement; use it to compare assets, not to promise frame times.
+ * Exits non-zero if any stream fails to round-trip. */
+#include "formats.hpp"
+
+extern "C" {
+#include "host_ace.h"
+#include "maze.h"
+#include "script.h"
+#include "slz.h"
+}
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/* 68020 cost model (cycles): token fetch, nibble split, offset fetch and loop setup;
+ * then a move.b/dbra pair per literal byte, and a chip RAM read+write per match byte */
+static const double kSequenceCycles = 44.0;
+static const double kLiteralByteCycles = 8.0;
+static const double kMatchByteCycles = 10.0;
+static const double kAmigaHz = 14.19e6;
+
+struct StreamStats {
+	size_t sequences = 0, literalBytes = 0, matchBytes = 0;
+};
+
+static size_t readLength(const std::vector<unsigned char> &s, size_t &ip, size_t len)
+{
+	if (len != 15) return len;
+	unsigned char b;
+	do { b = s[ip++]; len += b; } while (b == 255);
+	return len;
+}
+
+static StreamStats walkStream(const std::vector<unsigned char> &s, size_t rawSize)
+{
+	StreamStats st;
+	size_t ip = 0, op = 0;
+	while (op < rawSize) {
+		unsigned char token = s[ip++];
+		size_t lit = readLength(s, ip, token >> 4);
+		ip += lit;
+		op += lit;
+		st.literalBytes += lit;
+		st.sequences++;
+		if (op == rawSize) break;
+		ip += 2;
+		size_t len = readLength(s, ip, token & 15) + SLZ_MIN_MATCH;
+		op += len;
+		st.matchBytes += len;
+	}
+	return st;
+}
+
+struct Totals {
+	size_t raw = 0, packed = 0;
+	double cycles = 0, hostUs = 0;
+};
+
+static int s_failures;
+
+static void benchAsset(const char *name, const std::vector<unsigned char> &raw, int repeats, Totals &tot)
+{
+	std::vector<unsigned char> stream = slzCompress(raw.data(), raw.size());
+	std::vector<unsigned char> out(raw.size() + 1, 0xAA);
+	if (!slzDecode(stream.data(), (ULONG)stream.size(), out.data(), (ULONG)raw.size())
+		|| std::memcmp(out.data(), raw.data(), raw.size()) != 0 || out[raw.size()] != 0xAA) {
+		std::fprintf(stderr, "FAIL %s: round trip\n", name);
+		s_failures++;
+		return;
+	}
+	double best = 1e30;
+	for (int r = 0; r < repeats; r++) {
+		double start = hostNowUs();
+		for (int k = 0; k < 16; k++)
+			slzDecode(stream.data(), (ULONG)stream.size(), out.data(), (ULONG)raw.size());
+		double took = (hostNowUs() - start) / 16;
+		if (took < best) best = took;
+	}
+	StreamStats st = walkStream(stream, raw.size());
+	double cycles = st.sequences * kSequenceCycles + st.literalBytes * kLiteralByteCycles
+		+ st.matchBytes * kMatchByteCycles;
+	double cpb = raw.empty() ? 0 : cycles / raw.size();
+	if (repeats > 0)
+		std::printf("%-22s %7zu -> %7zu  %5.1f%%  %8.0f MB/s  %5.2f cyc/B  %6.0f KB/s@14MHz\n", name,
+			raw.size(), stream.size(), 100.0 * stream.size() / raw.size(), raw.size() / best,
+			cpb, kAmigaHz / cpb / 1024);
+	tot.raw += raw.size();
+	tot.packed += stream.size();
+	tot.cycles += cycles;
+	tot.hostUs += repeats > 0 ? best : 0;
+}
+
+static std::vector<unsigned char> readTemp(tMaze *pMaze)
+{
+	const char *tmp = std::getenv("TMPDIR");
+	std::string path = std::string(tmp ? tmp : "/tmp") + "/smite_lz_bench.maze";
+	mazeSave(pMaze, path.c_str());
+	std::vector<unsigned char> data;
+	std::string err;
+	readRawFile(path, data, err);
+	std::remove(path.c_str());
+	return data;
+}
+
+static std::vector<unsigned char> generatedLevel()
+{
+	tMaze *pMaze = mazeCreate(64, 64);
+	unsigned seed = 12345;
+	auto rnd = [&]() { seed = seed * 1103515245u + 12345u; return (seed >> 16) & 0x7fff; };
+	for (int y = 0; y < 64; y++)
+		for (int x = 0; x < 64; x++) {
+			bool wall = x == 0 || y == 0 || x == 63 || y == 63 || (x % 8 == 0 && y % 5 != 2) || (y % 8 == 0 && x % 6 != 3);
+			pMaze->_mazeData[y * 64 + x] = wall ? MAZE_WALL : ((rnd() % 40) == 0 ? MAZE_DOOR : MAZE_FLOOR);
+			pMaze->_mazeCol[y * 64 + x] = (UBYTE)((x / 16) + (y / 16) * 4);
+			pMaze->_mazeFloor[y * 64 + x] = (UBYTE)(rnd() % 3 == 0);
+		}
+	for (int i = 0; i < 400; i++) {
+		UBYTE data[4] = {(UBYTE)(rnd() % 64), (UBYTE)(rnd() % 64), (UBYTE)(i % 16), 1};
+		mazeAppendEvent(pMaze, mazeEventCreate((UBYTE)(rnd() % 64), (UBYTE)(rnd() % 64),
+			(UBYTE)(EVENT_SETWALL + i % 8), (UBYTE)(1 + i % 4), data));
+	}
+	for (int i = 0; i < 100; i++) {
+		char text[64];
+		int n = std::snprintf(text, sizeof(text), "The door to room %d is locked. Find key %d.", i, i % 7);
+		mazeAddString(pMaze, text, (UWORD)n);
+	}
+	std::vector<unsigned char> data = readTemp(pMaze);
+	mazeDelete(pMaze);
+	return data;
+}
+
+/* A width x height 5-plane ACE bitmap tiled from a PNG, colours reduced to 32; and its mask */
+static bool texturedSheet(const std::string &png, int width, int height,
+	std::vector<unsigned char> &planes, std::vector<unsigned char> &mask)
+{
+	int tw, th, ch;
+	unsigned char *px = stbi_load(png.c_str(), &tw, &th, &ch, 4);
+	if (!px) return false;
+	const int bpr = width / 8, depth = 5;
+	auto header = [&](std::vector<unsigned char> &bm, int d) {
+		bm.assign(8, 0);
+		bm[0] = (unsigned char)(width >> 8); bm[1] = (unsigned char)width;
+		bm[2] = (unsigned char)(height >> 8); bm[3] = (unsigned char)height;
+		bm[4] = (unsigned char)d;
+		bm.resize(8 + (size_t)bpr * height * d, 0);
+	};
+	header(planes, depth);
+	header(mask, 1);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++) {
+			const unsigned char *p = px + 4 * ((y % th) * tw + (x % tw));
+			int idx = (p[0] >> 6) | (p[1] >> 6) << 2 | (p[2] >> 7) << 4;
+			// Leave a transparent border between tiles, like a wallset page
+			bool solid = (x % (tw + 8)) < tw && p[3] > 127;
+			if (!solid) idx = 0;
+			size_t byte = (size_t)y * bpr + x / 8;
+			unsigned char bit = (unsigned char)(0x80 >> (x & 7));
+			for (int d = 0; d < depth; d++)
+				if (idx >> d & 1) planes[8 + (size_t)d * bpr * height + byte] |= bit;
+			if (solid) mask[8 + byte] |= bit;
+		}
+	stbi_image_free(px);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	int repeats = argc > 1 ? std::atoi(argv[1]) : 20;
+	std::printf("%-22s %7s    %7s  %6s  %13s  %9s  %s\n", "asset", "raw", "packed", "ratio", "host decode",
+		"68020 est", "");
+	Totals tot;
+
+	tMaze *pDemo = mazeCreateDemoData();
+	benchAsset("demo.maze", readTemp(pDemo), repeats, tot);
+	mazeDelete(pDemo);
+	benchAsset("generated64.maze", generatedLevel(), repeats, tot);
+
+	const char *textures[] = {"eob_bricks.png", "eob_keyhole.png"};
+	for (const char *tex : textures) {
+		std::vector<unsigned char> planes, mask, packed;
+		std::string path = std::string(SMITE_SAMPLE_TEX_DIR) + "/" + tex;
+		if (!texturedSheet(path, 320, 160, planes, mask)) {
+			std::fprintf(stderr, "FAIL %s: cannot load\n", path.c_str());
+			s_failures++;
+			continue;
+		}
+		// Plane by plane, as the game decodes them into chip RAM
+		const size_t planeSize = 320 / 8 * 160;
+		for (int d = 0; d < 5; d++) {
+			std::vector<unsigned char> plane(planes.begin() + 8 + d * planeSize, planes.begin() + 8 + (d + 1) * planeSize);
+			std::string name = std::string(tex) + " pln" + std::to_string(d);
+			benchAsset(name.c_str(), plane, repeats, tot);
+		}
+		std::vector<unsigned char> maskPlane(mask.begin() + 8, mask.end());
+		benchAsset((std::string(tex) + " msk").c_str(), maskPlane, repeats, tot);
+
+		// The file-level packer must round-trip through the editor's reader as well
+		std::string err;
+		std::vector<unsigned char> back;
+		if (!packBitmapFile(planes, packed, err) || !(back = packed, unpackBitmapFile(back, err)) || back != planes) {
+			std::fprintf(stderr, "FAIL %s: bitmap file round trip %s\n", tex, err.c_str());
+			s_failures++;
+		}
+	}
+
+	if (repeats > 0 && tot.raw) {
+		double cpb = tot.cycles / tot.raw;
+		std::printf("%-22s %7zu -> %7zu  %5.1f%%  %8.0f MB/s  %5.2f cyc/B  %6.0f KB/s@14MHz\n", "total", tot.raw,
+			tot.packed, 100.0 * tot.packed / tot.raw, tot.raw / tot.hostUs, cpb, kAmigaHz / cpb / 1024);
+	}
+	return s_failures ? 1 : 0;
+}
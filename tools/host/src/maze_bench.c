@@ -0,0 +1,266 @@
+/* Chunked maze benchmark: maze_chunked.c against a flat array on a 1024x1024 level.
+ *
+ *   maze_bench [repeats]
+ *
+ * Builds a dungeon of rooms and corridors in solid rock, copies it into a
+ * tMazeChunked and checks every cell of every layer reads back. Then times
+ * reads in row order, chunk order, at random over the whole map, and around
+ * a party walking the corridors (a view window read each step, focus moved
+ * with it), with page-ins per pass and the memory held against the flat
+ * grids. 0 repeats does only the checks, for ctest. Exits non-zero on a
+ * mismatch or a leak. */
+#include "host_ace.h"
+#include "maze_chunked.h"
+#include <ace/managers/memory.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_SIZE MAZE_CHUNKED_MAX_SIZE
+#define BENCH_CELLS ((ULONG)BENCH_SIZE * BENCH_SIZE)
+#define BENCH_RANDOM_READS 4000000UL
+#define BENCH_WALK_STEPS 200000UL
+#define BENCH_VIEW 4 /* cells read each side of the party per step */
+
+static UBYTE *s_pFlat[MAZE_CHUNK_LAYERS];
+static ULONG s_ulSeed = 12345;
+static volatile ULONG s_ulSink;
+
+static ULONG benchRand(void)
+{
+	s_ulSeed = s_ulSeed * 1103515245UL + 12345UL;
+	return (s_ulSeed >> 8) & 0xFFFFFF;
+}
+
+static void flatSet(UWORD x, UWORD y, UBYTE ubLayer, UBYTE ubValue)
+{
+	s_pFlat[ubLayer][x + (ULONG)y * BENCH_SIZE] = ubValue;
+}
+
+static void carve(UWORD x, UWORD y, UBYTE ubStyle)
+{
+	flatSet(x, y, MAZE_LAYER_WALL, MAZE_FLOOR);
+	flatSet(x, y, MAZE_LAYER_COL, ubStyle);
+	flatSet(x, y, MAZE_LAYER_FLOOR, (UBYTE)(1 + (ubStyle & 3)));
+}
+
+/* Rooms joined by L-shaped corridors; about a fifth of the map is open */
+static void buildDungeon(void)
+{
+	memset(s_pFlat[MAZE_LAYER_WALL], MAZE_WALL, BENCH_CELLS);
+	memset(s_pFlat[MAZE_LAYER_COL], 0, BENCH_CELLS);
+	memset(s_pFlat[MAZE_LAYER_FLOOR], 0, BENCH_CELLS);
+	UWORD px = BENCH_SIZE / 2, py = BENCH_SIZE / 2;
+	for (int r = 0; r < 900; r++) {
+		UWORD w = (UWORD)(4 + benchRand() % 12), h = (UWORD)(4 + benchRand() % 12);
+		UWORD rx = (UWORD)(1 + benchRand() % (BENCH_SIZE - w - 2));
+		UWORD ry = (UWORD)(1 + benchRand() % (BENCH_SIZE - h - 2));
+		UBYTE col = (UBYTE)(benchRand() % 8);
+		for (UWORD y = ry; y < ry + h; y++)
+			for (UWORD x = rx; x < rx + w; x++)
+				carve(x, y, col);
+		if (benchRand() % 3 == 0)
+			flatSet(rx, (UWORD)(ry + h / 2), MAZE_LAYER_WALL, MAZE_DOOR);
+		UWORD cx = (UWORD)(rx + w / 2), cy = (UWORD)(ry + h / 2);
+		for (UWORD x = px < cx ? px : cx; x <= (px < cx ? cx : px); x++)
+			carve(x, py, 0);
+		for (UWORD y = py < cy ? py : cy; y <= (py < cy ? cy : py); y++)
+			carve(cx, y, 0);
+		px = cx;
+		py = cy;
+	}
+}
+
+static UBYTE flatGet(UWORD x, UWORD y, UBYTE ubLayer)
+{
+	return s_pFlat[ubLayer][x + (ULONG)y * BENCH_SIZE];
+}
+
+static tMazeChunked *buildChunked(void)
+{
+	tMazeChunked *pMaze = mazeChunkedCreate(BENCH_SIZE, BENCH_SIZE, MAZE_CHUNKED_DEFAULT_SLOTS, MAZE_WALL, 0, 0);
+	if (!pMaze)
+		return NULL;
+	/* Chunk by chunk, packing as we go, as a level loader would */
+	for (UWORD cy = 0; cy < pMaze->uwChunksY; cy++) {
+		for (UWORD cx = 0; cx < pMaze->uwChunksX; cx++) {
+			for (UWORD y = (UWORD)(cy * MAZE_CHUNK_SIZE); y < (cy + 1) * MAZE_CHUNK_SIZE; y++)
+				for (UWORD x = (UWORD)(cx * MAZE_CHUNK_SIZE); x < (cx + 1) * MAZE_CHUNK_SIZE; x++)
+					for (UBYTE l = 0; l < MAZE_CHUNK_LAYERS; l++)
+						mazeChunkedSet(pMaze, x, y, l, flatGet(x, y, l));
+		}
+		mazeChunkedIdle(pMaze, 255);
+	}
+	return pMaze;
+}
+
+static int checkAll(tMazeChunked *pMaze)
+{
+	for (UWORD y = 0; y < BENCH_SIZE; y++) {
+		for (UWORD x = 0; x < BENCH_SIZE; x++) {
+			for (UBYTE l = 0; l < MAZE_CHUNK_LAYERS; l++) {
+				if (mazeChunkedGet(pMaze, x, y, l) != flatGet(x, y, l)) {
+					fprintf(stderr, "maze_bench: cell %u,%u layer %u differs\n", x, y, l);
+					return 0;
+				}
+			}
+		}
+	}
+	if (mazeChunkedGetCell(pMaze, BENCH_SIZE, 0) != MAZE_WALL) {
+		fprintf(stderr, "maze_bench: off-map cell is not wall\n");
+		return 0;
+	}
+	return 1;
+}
+
+/* Doors and switches changing in the middle of the map while the party moves, then a full check */
+static int checkWrites(tMazeChunked *pMaze)
+{
+	for (ULONG i = 0; i < 200000; i++) {
+		UWORD x = (UWORD)(384 + benchRand() % 256), y = (UWORD)(384 + benchRand() % 256);
+		UBYTE l = (UBYTE)(benchRand() % MAZE_CHUNK_LAYERS), v = (UBYTE)(benchRand() % 4);
+		if (i % 1000 == 0)
+			mazeChunkedFocus(pMaze, x, y);
+		mazeChunkedSet(pMaze, x, y, l, v);
+		flatSet(x, y, l, v);
+		if (i % 5000 == 0)
+			mazeChunkedIdle(pMaze, 8);
+	}
+	while (mazeChunkedIdle(pMaze, 255)) {}
+	return checkAll(pMaze);
+}
+
+typedef ULONG (*tPass)(tMazeChunked *pMaze, UBYTE isFlat);
+
+static ULONG passRows(tMazeChunked *pMaze, UBYTE isFlat)
+{
+	ULONG sum = 0;
+	for (UWORD y = 0; y < BENCH_SIZE; y++)
+		for (UWORD x = 0; x < BENCH_SIZE; x++)
+			sum += isFlat ? flatGet(x, y, MAZE_LAYER_WALL) : mazeChunkedGetCell(pMaze, x, y);
+	s_ulSink = sum;
+	return BENCH_CELLS;
+}
+
+static ULONG passChunks(tMazeChunked *pMaze, UBYTE isFlat)
+{
+	ULONG sum = 0;
+	for (UWORD cy = 0; cy < BENCH_SIZE; cy += MAZE_CHUNK_SIZE)
+		for (UWORD cx = 0; cx < BENCH_SIZE; cx += MAZE_CHUNK_SIZE)
+			for (UWORD y = cy; y < cy + MAZE_CHUNK_SIZE; y++)
+				for (UWORD x = cx; x < cx + MAZE_CHUNK_SIZE; x++)
+					sum += isFlat ? flatGet(x, y, MAZE_LAYER_WALL) : mazeChunkedGetCell(pMaze, x, y);
+	s_ulSink = sum;
+	return BENCH_CELLS;
+}
+
+static ULONG passRandom(tMazeChunked *pMaze, UBYTE isFlat)
+{
+	ULONG sum = 0;
+	s_ulSeed = 777;
+	for (ULONG i = 0; i < BENCH_RANDOM_READS; i++) {
+		ULONG r = benchRand();
+		UWORD x = (UWORD)(r & (BENCH_SIZE - 1)), y = (UWORD)((r >> 10) & (BENCH_SIZE - 1));
+		sum += isFlat ? flatGet(x, y, MAZE_LAYER_WALL) : mazeChunkedGetCell(pMaze, x, y);
+	}
+	s_ulSink = sum;
+	return BENCH_RANDOM_READS;
+}
+
+/* The party wanders open cells; each step reads the view square and refocuses */
+static ULONG passWalk(tMazeChunked *pMaze, UBYTE isFlat)
+{
+	static const WORD dx[4] = {1, 0, -1, 0}, dy[4] = {0, 1, 0, -1};
+	ULONG sum = 0, reads = 0;
+	UWORD px = BENCH_SIZE / 2, py = BENCH_SIZE / 2;
+	UBYTE dir = 0;
+	s_ulSeed = 4242;
+	if (!isFlat)
+		mazeChunkedFocus(pMaze, px, py);
+	for (ULONG s = 0; s < BENCH_WALK_STEPS; s++) {
+		if (benchRand() % 8 == 0)
+			dir = (UBYTE)(benchRand() & 3);
+		UWORD nx = (UWORD)(px + dx[dir]), ny = (UWORD)(py + dy[dir]);
+		UBYTE wall = isFlat ? flatGet(nx, ny, MAZE_LAYER_WALL) : mazeChunkedGetCell(pMaze, nx, ny);
+		if (wall == MAZE_WALL) {
+			dir = (UBYTE)((dir + 1) & 3);
+			continue;
+		}
+		px = nx;
+		py = ny;
+		if (!isFlat && ((px | py) & (MAZE_CHUNK_SIZE - 1)) == 0)
+			mazeChunkedFocus(pMaze, px, py);
+		for (WORD y = -BENCH_VIEW; y <= BENCH_VIEW; y++) {
+			for (WORD x = -BENCH_VIEW; x <= BENCH_VIEW; x++) {
+				UWORD vx = (UWORD)(px + x), vy = (UWORD)(py + y);
+				if (isFlat)
+					sum += vx < BENCH_SIZE && vy < BENCH_SIZE ? flatGet(vx, vy, MAZE_LAYER_WALL) : MAZE_WALL;
+				else
+					sum += mazeChunkedGetCell(pMaze, vx, vy);
+				reads++;
+			}
+		}
+	}
+	s_ulSink = sum;
+	return reads;
+}
+
+int main(int argc, char **argv)
+{
+	int iRepeats = argc > 1 ? atoi(argv[1]) : 5;
+	if (iRepeats < 0)
+		iRepeats = 0;
+	for (UBYTE l = 0; l < MAZE_CHUNK_LAYERS; l++)
+		s_pFlat[l] = (UBYTE *)malloc(BENCH_CELLS);
+	buildDungeon();
+
+	hostStatsReset();
+	tMazeChunked *pMaze = buildChunked();
+	if (!pMaze) {
+		fprintf(stderr, "maze_bench: could not create the chunked maze\n");
+		return 1;
+	}
+	int iResult = checkAll(pMaze) && checkWrites(pMaze) ? 0 : 1;
+
+	ULONG ulDirectory = (ULONG)pMaze->uwChunksX * pMaze->uwChunksY * sizeof(tMazeChunk);
+	printf("%ux%u, %u slots: directory %lu + resident %lu + packed %lu bytes (flat grids %lu), peak %lu live\n",
+		BENCH_SIZE, BENCH_SIZE, (unsigned)pMaze->uwSlots, (unsigned long)ulDirectory,
+		(unsigned long)pMaze->sStats.ulResidentBytes, (unsigned long)pMaze->sStats.ulPackedBytes,
+		(unsigned long)(BENCH_CELLS * MAZE_CHUNK_LAYERS), (unsigned long)g_sHostMem.ulPeakBytes);
+
+	if (iRepeats) {
+		static const struct { const char *szName; tPass cbPass; } s_pPasses[] = {
+			{"rows", passRows}, {"chunks", passChunks}, {"random", passRandom}, {"walk", passWalk},
+		};
+		printf("%-8s %10s %10s %12s\n", "pass", "flat ns", "chunk ns", "page-ins");
+		for (size_t p = 0; p < sizeof(s_pPasses) / sizeof(s_pPasses[0]); p++) {
+			double flatUs = 0, chunkUs = 0;
+			ULONG reads = 0, pageIns = pMaze->sStats.ulPageIns;
+			for (int r = 0; r < iRepeats; r++) {
+				double t0 = hostNowUs();
+				reads = s_pPasses[p].cbPass(pMaze, 1);
+				double t1 = hostNowUs();
+				s_pPasses[p].cbPass(pMaze, 0);
+				double t2 = hostNowUs();
+				flatUs += t1 - t0;
+				chunkUs += t2 - t1;
+			}
+			printf("%-8s %10.2f %10.2f %12lu\n", s_pPasses[p].szName,
+				flatUs * 1000.0 / ((double)reads * iRepeats), chunkUs * 1000.0 / ((double)reads * iRepeats),
+				(unsigned long)((pMaze->sStats.ulPageIns - pageIns) / (ULONG)iRepeats));
+		}
+		printf("page-ins %lu, evictions %lu, packs %lu\n", (unsigned long)pMaze->sStats.ulPageIns,
+			(unsigned long)pMaze->sStats.ulEvictions, (unsigned long)pMaze->sStats.ulPacks);
+	}
+
+	mazeChunkedDestroy(pMaze);
+	if (g_sHostMem.lBytesLive || g_sHostMem.ulSizeMismatches) {
+		fprintf(stderr, "maze_bench: %ld bytes leaked, %lu size mismatches\n",
+			(long)g_sHostMem.lBytesLive, (unsigned long)g_sHostMem.ulSizeMismatches);
+		iResult = 1;
+	}
+	for (UBYTE l = 0; l < MAZE_CHUNK_LAYERS; l++)
+		free(s_pFlat[l]);
+	return iResult;
+}
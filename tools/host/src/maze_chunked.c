@@ -0,0 +1,361 @@
+#include "maze_chunked.h"
+#include <ace/managers/memory.h>
+#include <ace/managers/log.h>
+#include <string.h>
+
+#define MAZE_CHUNK_FREE_SLOT 0xFFFF
+// Index bits of the first cell past the bit array of a chunk packed at b bits a cell
+#define MAZE_CHUNK_INDEX_BYTES(b) ((MAZE_CHUNK_CELLS * (b)) >> 3)
+
+static UBYTE s_pPackBuffer[MAZE_CHUNK_INDEX_BYTES(8) + MAZE_CHUNK_CELLS * MAZE_CHUNK_LAYERS];
+
+// Palette index of cell i in a packed chunk: b bits a cell, first cell in the top bits
+static UBYTE mazeChunkedIndex(const UBYTE *pPacked, UBYTE ubBits, UWORD i)
+{
+	UWORD bit = (UWORD)(i * ubBits);
+	UBYTE shift = (UBYTE)(8 - ubBits - (bit & 7));
+	return (UBYTE)((pPacked[bit >> 3] >> shift) & ((1 << ubBits) - 1));
+}
+
+/*
+ * Pack a chunk as a palette of its distinct (wall, col, floor) triples and a
+ * bit array of palette indices, 1, 2, 4 or 8 bits a cell. Dungeon chunks hold
+ * a handful of triples (rock, corridor, a room style, a door), so most pack to
+ * 64 or 128 bytes of indices, and a cell can still be read straight from the
+ * packed chunk. Returns the size and the bits a cell.
+ */
+static UWORD mazeChunkedPack(const UBYTE *pSrc, UBYTE *pDst, UBYTE *pBits)
+{
+	UBYTE *pPalette = &pDst[MAZE_CHUNK_INDEX_BYTES(8)];
+	UBYTE pIndex[MAZE_CHUNK_CELLS];
+	UWORD count = 0;
+	for (UWORD i = 0; i < MAZE_CHUNK_CELLS; i++) {
+		UBYTE wall = pSrc[MAZE_LAYER_WALL * MAZE_CHUNK_CELLS + i];
+		UBYTE col = pSrc[MAZE_LAYER_COL * MAZE_CHUNK_CELLS + i];
+		UBYTE floor = pSrc[MAZE_LAYER_FLOOR * MAZE_CHUNK_CELLS + i];
+		UWORD p = 0;
+		// Neighbours usually match the previous cell
+		if (i && pPalette[pIndex[i - 1] * 3] == wall && pPalette[pIndex[i - 1] * 3 + 1] == col
+			&& pPalette[pIndex[i - 1] * 3 + 2] == floor)
+			p = pIndex[i - 1];
+		else {
+			while (p < count && (pPalette[p * 3] != wall || pPalette[p * 3 + 1] != col || pPalette[p * 3 + 2] != floor))
+				p++;
+			if (p == count) {
+				pPalette[p * 3] = wall;
+				pPalette[p * 3 + 1] = col;
+				pPalette[p * 3 + 2] = floor;
+				count++;
+			}
+		}
+		pIndex[i] = (UBYTE)p;
+	}
+	UBYTE bits = count <= 2 ? 1 : count <= 4 ? 2 : count <= 16 ? 4 : 8;
+	UWORD indexBytes = MAZE_CHUNK_INDEX_BYTES(bits);
+	memset(pDst, 0, indexBytes);
+	for (UWORD i = 0; i < MAZE_CHUNK_CELLS; i++) {
+		UWORD bit = (UWORD)(i * bits);
+		pDst[bit >> 3] |= (UBYTE)(pIndex[i] << (8 - bits - (bit & 7)));
+	}
+	memmove(&pDst[indexBytes], pPalette, count * 3);
+	*pBits = bits;
+	return (UWORD)(indexBytes + count * 3);
+}
+
+static void mazeChunkedUnpack(const tMazeChunk *pChunk, UBYTE *pDst)
+{
+	const UBYTE *pPalette = &pChunk->packed[MAZE_CHUNK_INDEX_BYTES(pChunk->bits)];
+	for (UWORD i = 0; i < MAZE_CHUNK_CELLS; i++) {
+		const UBYTE *pEntry = &pPalette[mazeChunkedIndex(pChunk->packed, pChunk->bits, i) * 3];
+		pDst[MAZE_LAYER_WALL * MAZE_CHUNK_CELLS + i] = pEntry[0];
+		pDst[MAZE_LAYER_COL * MAZE_CHUNK_CELLS + i] = pEntry[1];
+		pDst[MAZE_LAYER_FLOOR * MAZE_CHUNK_CELLS + i] = pEntry[2];
+	}
+}
+
+// Replace the chunk's packed image with the contents of its slot
+static void mazeChunkedStore(tMazeChunked *pMaze, tMazeChunk *pChunk)
+{
+	const UBYTE *pData = &pMaze->pSlotData[(ULONG)pChunk->slot * MAZE_CHUNK_BYTES];
+	if (pChunk->packed) {
+		memFree(pChunk->packed, pChunk->packedSize);
+		pMaze->sStats.ulPackedBytes -= pChunk->packedSize;
+		pChunk->packed = NULL;
+		pChunk->packedSize = 0;
+	}
+	pChunk->isDirty = 0;
+	pMaze->sStats.ulPacks++;
+
+	UBYTE isUniform = 1;
+	for (UBYTE l = 0; l < MAZE_CHUNK_LAYERS && isUniform; l++) {
+		const UBYTE *pLayer = &pData[l * MAZE_CHUNK_CELLS];
+		for (UWORD i = 1; i < MAZE_CHUNK_CELLS; i++) {
+			if (pLayer[i] != pLayer[0]) {
+				isUniform = 0;
+				break;
+			}
+		}
+	}
+	if (isUniform) {
+		for (UBYTE l = 0; l < MAZE_CHUNK_LAYERS; l++)
+			pChunk->fill[l] = pData[l * MAZE_CHUNK_CELLS];
+		return;
+	}
+	UWORD size = mazeChunkedPack(pData, s_pPackBuffer, &pChunk->bits);
+	pChunk->packed = (UBYTE *)memAllocFast(size);
+	if (!pChunk->packed) {
+		// Keep it resident rather than lose the cells
+		logWrite("ERR: maze chunk: no memory to pack %u bytes\n", (unsigned)size);
+		pChunk->isDirty = 1;
+		return;
+	}
+	memcpy(pChunk->packed, s_pPackBuffer, size);
+	pChunk->packedSize = size;
+	pMaze->sStats.ulPackedBytes += size;
+}
+
+static UWORD mazeChunkedFreeSlot(tMazeChunked *pMaze)
+{
+	UWORD victim = MAZE_CHUNK_FREE_SLOT;
+	ULONG oldest = 0;
+	for (UWORD s = 0; s < pMaze->uwSlots; s++) {
+		UWORD uwChunk = pMaze->pSlotChunk[s];
+		if (uwChunk == MAZE_CHUNK_FREE_SLOT)
+			return s;
+		if (pMaze->pChunks[uwChunk].isPinned)
+			continue;
+		ULONG age = pMaze->ulClock - pMaze->pSlotLastUse[s];
+		if (victim == MAZE_CHUNK_FREE_SLOT || age > oldest) {
+			victim = s;
+			oldest = age;
+		}
+	}
+	if (victim == MAZE_CHUNK_FREE_SLOT)
+		return victim;
+	tMazeChunk *pOld = &pMaze->pChunks[pMaze->pSlotChunk[victim]];
+	if (pOld->isDirty) {
+		mazeChunkedStore(pMaze, pOld);
+		if (pOld->isDirty)
+			return MAZE_CHUNK_FREE_SLOT;
+	}
+	pOld->slot = MAZE_CHUNK_NOT_RESIDENT;
+	pMaze->pSlotChunk[victim] = MAZE_CHUNK_FREE_SLOT;
+	pMaze->sStats.ulEvictions++;
+	return victim;
+}
+
+// Slot data of the chunk, paging it in; NULL if every slot is pinned
+static UBYTE *mazeChunkedPageIn(tMazeChunked *pMaze, UWORD uwChunk)
+{
+	tMazeChunk *pChunk = &pMaze->pChunks[uwChunk];
+	UWORD slot = mazeChunkedFreeSlot(pMaze);
+	if (slot == MAZE_CHUNK_FREE_SLOT) {
+		logWrite("ERR: maze chunk: all %u slots pinned\n", (unsigned)pMaze->uwSlots);
+		return NULL;
+	}
+	UBYTE *pData = &pMaze->pSlotData[(ULONG)slot * MAZE_CHUNK_BYTES];
+	if (pChunk->packed)
+		mazeChunkedUnpack(pChunk, pData);
+	else {
+		for (UBYTE l = 0; l < MAZE_CHUNK_LAYERS; l++)
+			memset(&pData[l * MAZE_CHUNK_CELLS], pChunk->fill[l], MAZE_CHUNK_CELLS);
+	}
+	pChunk->slot = slot;
+	pMaze->pSlotChunk[slot] = uwChunk;
+	pMaze->pSlotLastUse[slot] = ++pMaze->ulClock;
+	pMaze->sStats.ulPageIns++;
+	return pData;
+}
+
+tMazeChunked *mazeChunkedCreate(UWORD uwWidth, UWORD uwHeight, UWORD uwSlots, UBYTE ubWall, UBYTE ubCol, UBYTE ubFloor)
+{
+	UWORD minSlots = (2 * MAZE_CHUNKED_FOCUS_RADIUS + 1) * (2 * MAZE_CHUNKED_FOCUS_RADIUS + 1) + 1;
+	if (!uwWidth || !uwHeight || uwWidth > MAZE_CHUNKED_MAX_SIZE || uwHeight > MAZE_CHUNKED_MAX_SIZE) {
+		logWrite("ERR: chunked maze %ux%u out of range\n", (unsigned)uwWidth, (unsigned)uwHeight);
+		return NULL;
+	}
+	if (uwSlots < minSlots)
+		uwSlots = minSlots;
+	tMazeChunked *pMaze = (tMazeChunked *)memAllocFastClear(sizeof(tMazeChunked));
+	if (!pMaze)
+		return NULL;
+	pMaze->uwWidth = uwWidth;
+	pMaze->uwHeight = uwHeight;
+	pMaze->uwChunksX = (UWORD)((uwWidth + MAZE_CHUNK_SIZE - 1) >> MAZE_CHUNK_SHIFT);
+	pMaze->uwChunksY = (UWORD)((uwHeight + MAZE_CHUNK_SIZE - 1) >> MAZE_CHUNK_SHIFT);
+	pMaze->uwSlots = uwSlots;
+	// Nothing pinned until the first mazeChunkedFocus()
+	pMaze->uwFocusX0 = pMaze->uwFocusY0 = 1;
+	pMaze->uwFocusX1 = pMaze->uwFocusY1 = 0;
+
+	ULONG chunks = (ULONG)pMaze->uwChunksX * pMaze->uwChunksY;
+	pMaze->pChunks = (tMazeChunk *)memAllocFastClear(chunks * sizeof(tMazeChunk));
+	pMaze->pSlotData = (UBYTE *)memAllocFast((ULONG)uwSlots * MAZE_CHUNK_BYTES);
+	pMaze->pSlotChunk = (UWORD *)memAllocFast(uwSlots * sizeof(UWORD));
+	pMaze->pSlotLastUse = (ULONG *)memAllocFastClear(uwSlots * sizeof(ULONG));
+	if (!pMaze->pChunks || !pMaze->pSlotData || !pMaze->pSlotChunk || !pMaze->pSlotLastUse) {
+		logWrite("ERR: no memory for a %ux%u chunked maze\n", (unsigned)uwWidth, (unsigned)uwHeight);
+		mazeChunkedDestroy(pMaze);
+		return NULL;
+	}
+	for (ULONG i = 0; i < chunks; i++) {
+		tMazeChunk *pChunk = &pMaze->pChunks[i];
+		pChunk->slot = MAZE_CHUNK_NOT_RESIDENT;
+		pChunk->fill[MAZE_LAYER_WALL] = ubWall;
+		pChunk->fill[MAZE_LAYER_COL] = ubCol;
+		pChunk->fill[MAZE_LAYER_FLOOR] = ubFloor;
+	}
+	for (UWORD s = 0; s < uwSlots; s++)
+		pMaze->pSlotChunk[s] = MAZE_CHUNK_FREE_SLOT;
+	pMaze->sStats.ulResidentBytes = (ULONG)uwSlots * MAZE_CHUNK_BYTES;
+	return pMaze;
+}
+
+tMazeChunked *mazeChunkedFromMaze(const tMaze *pSrc, UWORD uwSlots)
+{
+	tMazeChunked *pMaze = mazeChunkedCreate(pSrc->_width, pSrc->_height, uwSlots, MAZE_WALL, 0, 0);
+	if (!pMaze)
+		return NULL;
+	// Cells past the edge of the last row/column of chunks read as solid wall
+	for (UWORD cy = 0; cy < pMaze->uwChunksY; cy++) {
+		for (UWORD cx = 0; cx < pMaze->uwChunksX; cx++) {
+			UWORD uwChunk = (UWORD)(cx + cy * pMaze->uwChunksX);
+			UBYTE *pData = mazeChunkedPageIn(pMaze, uwChunk);
+			if (!pData) {
+				mazeChunkedDestroy(pMaze);
+				return NULL;
+			}
+			for (UWORD ly = 0; ly < MAZE_CHUNK_SIZE; ly++) {
+				for (UWORD lx = 0; lx < MAZE_CHUNK_SIZE; lx++) {
+					UWORD x = (UWORD)((cx << MAZE_CHUNK_SHIFT) + lx);
+					UWORD y = (UWORD)((cy << MAZE_CHUNK_SHIFT) + ly);
+					UWORD i = (UWORD)((ly << MAZE_CHUNK_SHIFT) | lx);
+					if (x < pSrc->_width && y < pSrc->_height) {
+						UWORD src = (UWORD)(x + y * pSrc->_width);
+						pData[MAZE_LAYER_WALL * MAZE_CHUNK_CELLS + i] = pSrc->_mazeData[src];
+						pData[MAZE_LAYER_COL * MAZE_CHUNK_CELLS + i] = pSrc->_mazeCol[src];
+						pData[MAZE_LAYER_FLOOR * MAZE_CHUNK_CELLS + i] = pSrc->_mazeFloor[src];
+					}
+				}
+			}
+			pMaze->pChunks[uwChunk].isDirty = 1;
+		}
+	}
+	return pMaze;
+}
+
+void mazeChunkedDestroy(tMazeChunked *pMaze)
+{
+	if (!pMaze)
+		return;
+	ULONG chunks = (ULONG)pMaze->uwChunksX * pMaze->uwChunksY;
+	if (pMaze->pChunks) {
+		for (ULONG i = 0; i < chunks; i++) {
+			if (pMaze->pChunks[i].packed)
+				memFree(pMaze->pChunks[i].packed, pMaze->pChunks[i].packedSize);
+		}
+		memFree(pMaze->pChunks, chunks * sizeof(tMazeChunk));
+	}
+	if (pMaze->pSlotData)
+		memFree(pMaze->pSlotData, (ULONG)pMaze->uwSlots * MAZE_CHUNK_BYTES);
+	if (pMaze->pSlotChunk)
+		memFree(pMaze->pSlotChunk, pMaze->uwSlots * sizeof(UWORD));
+	if (pMaze->pSlotLastUse)
+		memFree(pMaze->pSlotLastUse, pMaze->uwSlots * sizeof(ULONG));
+	memFree(pMaze, sizeof(tMazeChunked));
+}
+
+UBYTE mazeChunkedGet(tMazeChunked *pMaze, UWORD x, UWORD y, UBYTE ubLayer)
+{
+	if (x >= pMaze->uwWidth || y >= pMaze->uwHeight)
+		return ubLayer == MAZE_LAYER_WALL ? MAZE_WALL : 0;
+	UWORD uwChunk = (UWORD)((x >> MAZE_CHUNK_SHIFT) + (y >> MAZE_CHUNK_SHIFT) * pMaze->uwChunksX);
+	UWORD i = (UWORD)(((y & (MAZE_CHUNK_SIZE - 1)) << MAZE_CHUNK_SHIFT) | (x & (MAZE_CHUNK_SIZE - 1)));
+	tMazeChunk *pChunk = &pMaze->pChunks[uwChunk];
+	if (pChunk->slot != MAZE_CHUNK_NOT_RESIDENT) {
+		pMaze->pSlotLastUse[pChunk->slot] = pMaze->ulClock;
+		return pMaze->pSlotData[(ULONG)pChunk->slot * MAZE_CHUNK_BYTES + ubLayer * MAZE_CHUNK_CELLS + i];
+	}
+	// Paged-out chunks are read in place; only writes page in
+	if (!pChunk->packed)
+		return pChunk->fill[ubLayer];
+	UBYTE ubEntry = mazeChunkedIndex(pChunk->packed, pChunk->bits, i);
+	return pChunk->packed[MAZE_CHUNK_INDEX_BYTES(pChunk->bits) + ubEntry * 3 + ubLayer];
+}
+
+void mazeChunkedSet(tMazeChunked *pMaze, UWORD x, UWORD y, UBYTE ubLayer, UBYTE ubValue)
+{
+	if (x >= pMaze->uwWidth || y >= pMaze->uwHeight || ubLayer >= MAZE_CHUNK_LAYERS)
+		return;
+	UWORD uwChunk = (UWORD)((x >> MAZE_CHUNK_SHIFT) + (y >> MAZE_CHUNK_SHIFT) * pMaze->uwChunksX);
+	UWORD i = (UWORD)(((y & (MAZE_CHUNK_SIZE - 1)) << MAZE_CHUNK_SHIFT) | (x & (MAZE_CHUNK_SIZE - 1)));
+	tMazeChunk *pChunk = &pMaze->pChunks[uwChunk];
+	UBYTE *pData;
+	if (pChunk->slot != MAZE_CHUNK_NOT_RESIDENT) {
+		pData = &pMaze->pSlotData[(ULONG)pChunk->slot * MAZE_CHUNK_BYTES];
+		pMaze->pSlotLastUse[pChunk->slot] = pMaze->ulClock;
+	}
+	else {
+		if (!pChunk->packed && pChunk->fill[ubLayer] == ubValue)
+			return;
+		pData = mazeChunkedPageIn(pMaze, uwChunk);
+		if (!pData)
+			return;
+	}
+	pData[ubLayer * MAZE_CHUNK_CELLS + i] = ubValue;
+	pChunk->isDirty = 1;
+}
+
+UBYTE mazeChunkedGetCell(tMazeChunked *pMaze, UWORD x, UWORD y)
+{
+	return mazeChunkedGet(pMaze, x, y, MAZE_LAYER_WALL);
+}
+
+static void mazeChunkedPin(tMazeChunked *pMaze, UBYTE isPinned)
+{
+	for (UWORD j = pMaze->uwFocusY0; j <= pMaze->uwFocusY1; j++) {
+		for (UWORD i = pMaze->uwFocusX0; i <= pMaze->uwFocusX1; i++)
+			pMaze->pChunks[i + j * pMaze->uwChunksX].isPinned = isPinned;
+	}
+}
+
+void mazeChunkedFocus(tMazeChunked *pMaze, UWORD x, UWORD y)
+{
+	mazeChunkedPin(pMaze, 0);
+	UWORD cx = (UWORD)(x >> MAZE_CHUNK_SHIFT);
+	UWORD cy = (UWORD)(y >> MAZE_CHUNK_SHIFT);
+	pMaze->uwFocusX0 = cx > MAZE_CHUNKED_FOCUS_RADIUS ? (UWORD)(cx - MAZE_CHUNKED_FOCUS_RADIUS) : 0;
+	pMaze->uwFocusY0 = cy > MAZE_CHUNKED_FOCUS_RADIUS ? (UWORD)(cy - MAZE_CHUNKED_FOCUS_RADIUS) : 0;
+	pMaze->uwFocusX1 = (UWORD)(cx + MAZE_CHUNKED_FOCUS_RADIUS);
+	pMaze->uwFocusY1 = (UWORD)(cy + MAZE_CHUNKED_FOCUS_RADIUS);
+	if (pMaze->uwFocusX1 >= pMaze->uwChunksX)
+		pMaze->uwFocusX1 = (UWORD)(pMaze->uwChunksX - 1);
+	if (pMaze->uwFocusY1 >= pMaze->uwChunksY)
+		pMaze->uwFocusY1 = (UWORD)(pMaze->uwChunksY - 1);
+	mazeChunkedPin(pMaze, 1);
+	pMaze->ulClock++;
+	for (UWORD j = pMaze->uwFocusY0; j <= pMaze->uwFocusY1; j++) {
+		for (UWORD i = pMaze->uwFocusX0; i <= pMaze->uwFocusX1; i++) {
+			UWORD uwChunk = (UWORD)(i + j * pMaze->uwChunksX);
+			tMazeChunk *pChunk = &pMaze->pChunks[uwChunk];
+			if (pChunk->slot != MAZE_CHUNK_NOT_RESIDENT)
+				pMaze->pSlotLastUse[pChunk->slot] = pMaze->ulClock;
+			else
+				mazeChunkedPageIn(pMaze, uwChunk);
+		}
+	}
+}
+
+UBYTE mazeChunkedIdle(tMazeChunked *pMaze, UBYTE ubMaxChunks)
+{
+	UBYTE packed = 0;
+	for (UWORD s = 0; s < pMaze->uwSlots && packed < ubMaxChunks; s++) {
+		UWORD uwChunk = pMaze->pSlotChunk[s];
+		if (uwChunk == MAZE_CHUNK_FREE_SLOT || !pMaze->pChunks[uwChunk].isDirty
+			|| pMaze->pChunks[uwChunk].isPinned)
+			continue;
+		mazeChunkedStore(pMaze, &pMaze->pChunks[uwChunk]);
+		packed++;
+	}
+	return packed;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <ace/types.h>
+#include "maze.h"
+
+/*
+ * Chunked cell storage for levels larger than tMaze's 255x255 (up to
+ * MAZE_CHUNKED_MAX_SIZE a side). The map is cut into 16x16 chunks holding
+ * the wall, colour and floor layers of their cells. Only a fixed pool of
+ * chunks is resident; the rest are packed as a palette of the distinct cells
+ * in the chunk plus 1-8 index bits a cell, or as three fill bytes when the
+ * whole chunk is alike (solid rock).
+ *
+ * Reads are O(1) either way: a shift, a directory lookup, then the slot byte
+ * or an index and palette lookup in the packed chunk. Writes page the chunk
+ * into the least recently used slot (one bounded unpack). mazeChunkedFocus()
+ * pins the chunks around the party so they stay unpacked; mazeChunkedIdle()
+ * packs chunks written since they were paged in, so evicting them later is
+ * free. Memory is the slot pool plus the packed chunks.
+ *
+ * Script events, strings and entities stay in tMaze; this holds the grids.
+ * Host-only for now: tMaze does not use it, so it stays out of the game
+ * build until it does.
+ */
+
+#define MAZE_CHUNK_SHIFT 4
+#define MAZE_CHUNK_SIZE (1 << MAZE_CHUNK_SHIFT)
+#define MAZE_CHUNK_CELLS (MAZE_CHUNK_SIZE * MAZE_CHUNK_SIZE)
+#define MAZE_CHUNK_BYTES (MAZE_CHUNK_CELLS * MAZE_CHUNK_LAYERS)
+#define MAZE_CHUNKED_MAX_SIZE 1024
+// Resident chunks by default: 48 * 768 bytes = 36 KB
+#define MAZE_CHUNKED_DEFAULT_SLOTS 48
+// Chunks pinned around the focus in each direction (2 gives a 5x5 block, 80x80 cells)
+#define MAZE_CHUNKED_FOCUS_RADIUS 2
+
+typedef enum {
+	MAZE_LAYER_WALL,
+	MAZE_LAYER_COL,
+	MAZE_LAYER_FLOOR,
+	MAZE_CHUNK_LAYERS
+} tMazeLayer;
+
+typedef struct _tMazeChunk {
+	UBYTE *packed;     // Palette-indexed image of the chunk, NULL if uniform
+	UWORD packedSize;
+	UWORD slot;        // Resident slot, or MAZE_CHUNK_NOT_RESIDENT
+	UBYTE fill[MAZE_CHUNK_LAYERS]; // Cell values of a uniform chunk
+	UBYTE bits;        // Palette index bits a cell in packed
+	UBYTE isDirty;     // Written since paged in; packed is stale
+	UBYTE isPinned;    // Inside the focus; never evicted
+} tMazeChunk;
+
+#define MAZE_CHUNK_NOT_RESIDENT 0xFFFF
+
+typedef struct _tMazeChunkedStats {
+	ULONG ulPageIns;
+	ULONG ulEvictions;
+	ULONG ulPacks;        // Chunks packed, at eviction or by mazeChunkedIdle()
+	ULONG ulPackedBytes;  // Bytes held by packed chunks now
+	ULONG ulResidentBytes; // Size of the slot pool
+} tMazeChunkedStats;
+
+typedef struct _tMazeChunked {
+	UWORD uwWidth;
+	UWORD uwHeight;
+	UWORD uwChunksX;
+	UWORD uwChunksY;
+	tMazeChunk *pChunks;   // uwChunksX * uwChunksY, row-major
+	UBYTE *pSlotData;      // uwSlots * MAZE_CHUNK_BYTES
+	UWORD *pSlotChunk;     // Chunk index held by each slot, 0xFFFF if free
+	ULONG *pSlotLastUse;
+	UWORD uwSlots;
+	UWORD uwFocusX0, uwFocusY0, uwFocusX1, uwFocusY1; // Pinned chunk rectangle
+	ULONG ulClock;
+	tMazeChunkedStats sStats;
+} tMazeChunked;
+
+/** Every cell set to wall / col / floor. uwSlots at least (2 * radius + 1)^2 + 1. NULL if out of memory. */
+tMazeChunked *mazeChunkedCreate(UWORD uwWidth, UWORD uwHeight, UWORD uwSlots, UBYTE ubWall, UBYTE ubCol, UBYTE ubFloor);
+
+/** The grids of a classic maze, packed chunk by chunk. */
+tMazeChunked *mazeChunkedFromMaze(const tMaze *pMaze, UWORD uwSlots);
+
+void mazeChunkedDestroy(tMazeChunked *pMaze);
+
+/** Cell value; off the map reads as MAZE_WALL on the wall layer and 0 on the others. */
+UBYTE mazeChunkedGet(tMazeChunked *pMaze, UWORD x, UWORD y, UBYTE ubLayer);
+
+void mazeChunkedSet(tMazeChunked *pMaze, UWORD x, UWORD y, UBYTE ubLayer, UBYTE ubValue);
+
+/** Wall layer, as mazeGetCell(). */
+UBYTE mazeChunkedGetCell(tMazeChunked *pMaze, UWORD x, UWORD y);
+
+/** Page in and pin the chunks around (x, y), e.g. after the party moved. */
+void mazeChunkedFocus(tMazeChunked *pMaze, UWORD x, UWORD y);
+
+/**
+ * Pack up to ubMaxChunks dirty resident chunks outside the focus. Call from
+ * idle frame time. Returns the number packed.
+ */
+UBYTE mazeChunkedIdle(tMazeChunked *pMaze, UBYTE ubMaxChunks);
@@ -0,0 +1,91 @@
+/* Script VM throughput benchmark (opcodes/second on the host CPU).
+ *
+ *   script_bench [seconds-per-case]
+ *
+ * Each case is a single anchor-cell script run repeatedly through
+ * executeScript(). "deep" places the same script behind a long list of
+ * unrelated events, which is what large levels look like to the VM. */
+#include "host_game.h"
+#include "host_ace.h"
+#include "script.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct _tBenchCase {
+	const char *szName;
+	UWORD uwPadEvents; /* unrelated events in front of the script */
+	UWORD uwScriptLen; /* opcodes executed per run */
+	UBYTE isBranchy;   /* IF/ENDIF blocks instead of straight-line stores */
+} tBenchCase;
+
+static UWORD buildScript(tMaze *pMaze, const tBenchCase *pCase)
+{
+	static const UBYTE s_pPad[] = {25};
+	for (UWORD i = 0; i < pCase->uwPadEvents; i++)
+		mazeAppendEvent(pMaze, mazeEventCreate((UBYTE)(i % 64), (UBYTE)(1 + (i / 64) % 62),
+			EVENT_BATTERY_CHARGER, 1, (UBYTE *)s_pPad));
+
+	UWORD uwStart = pMaze->_eventCount;
+	UWORD uwOps = 0;
+	while (uwOps < pCase->uwScriptLen) {
+		UBYTE pFlag[3] = {0, (UBYTE)uwOps, 1};
+		UBYTE pWall[1] = {(UBYTE)(uwOps & 1)};
+		if (pCase->isBranchy) {
+			UBYTE pCond[4] = {EVENT_EQUAL, EVENT_LEVEL_FLAG, 0, 0};
+			mazeAppendEvent(pMaze, mazeEventCreate(0, 0, EVENT_IF, 4, pCond));
+			mazeAppendEvent(pMaze, mazeEventCreate(0, 0, EVENT_SETFLAG, 3, pFlag));
+			mazeAppendEvent(pMaze, mazeEventCreate(0, 0, EVENT_ENDIF, 0, NULL));
+			uwOps += 3;
+		}
+		else {
+			mazeAppendEvent(pMaze, mazeEventCreate(0, 0, EVENT_SETFLAG, 3, pFlag));
+			mazeAppendEvent(pMaze, mazeEventCreate(0, 0, EVENT_SETWALL, 1, pWall));
+			uwOps += 2;
+		}
+	}
+	return uwStart;
+}
+
+static void runCase(const tBenchCase *pCase, double dSeconds)
+{
+	hostGameReset();
+	/* Measure the interpreter, not the frame slicing */
+	scriptSetFrameBudget(0xFFFF);
+	tMaze *pMaze = mazeCreate(64, 64);
+	hostGameSetMaze(pMaze);
+	UWORD uwStart = buildScript(pMaze, pCase);
+	UWORD uwOpsPerRun = (UWORD)(pMaze->_eventCount - uwStart);
+
+	ULONG ulRuns = 0;
+	double dStart = hostNowUs();
+	double dElapsed = 0;
+	do {
+		for (int i = 0; i < 64; i++)
+			executeScript(pMaze, uwStart);
+		ulRuns += 64;
+		dElapsed = hostNowUs() - dStart;
+	} while (dElapsed < dSeconds * 1e6);
+
+	double dOps = (double)ulRuns * uwOpsPerRun;
+	printf("%-14s %6u pad %5u ops/run %12.0f ops/s %8.3f us/run\n",
+		pCase->szName, (unsigned)pCase->uwPadEvents, (unsigned)uwOpsPerRun,
+		dOps / (dElapsed / 1e6), dElapsed / (double)ulRuns);
+}
+
+int main(int argc, char **argv)
+{
+	static const tBenchCase s_pCases[] = {
+		{"straight", 0, 64, 0},
+		{"branchy", 0, 63, 1},
+		{"straight-deep", 2000, 64, 0},
+		{"branchy-deep", 2000, 63, 1},
+	};
+	double dSeconds = argc > 1 ? atof(argv[1]) : 0.5;
+
+	hostGameCreate();
+	for (size_t i = 0; i < sizeof(s_pCases) / sizeof(s_pCases[0]); i++)
+		runCase(&s_pCases[i], dSeconds);
+	hostGameDestroy();
+	return 0;
+}
@@ -0,0 +1,60 @@
+/* libFuzzer entry point for the maze script VM.
+ *
+ * Input layout: width, height, event count, then per event
+ * x, y, type, size, payload; remaining bytes become maze strings.
+ * Event cells are folded into the grid (the editor never writes
+ * off-grid events) but opcodes and payloads are taken raw. */
+#include "host_game.h"
+#include "script.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *pData, size_t ulSize)
+{
+	static int s_isInit = 0;
+	if (!s_isInit) {
+		hostGameCreate();
+		s_isInit = 1;
+	}
+	if (ulSize < 3)
+		return 0;
+
+	UBYTE ubW = (UBYTE)(1 + pData[0] % 32);
+	UBYTE ubH = (UBYTE)(1 + pData[1] % 32);
+	UBYTE ubEvents = pData[2];
+	size_t ulPos = 3;
+
+	hostGameReset();
+	tMaze *pMaze = mazeCreate(ubW, ubH);
+	hostGameSetMaze(pMaze);
+
+	for (UBYTE i = 0; i < ubEvents && ulPos + 4 <= ulSize; i++) {
+		UBYTE x = (UBYTE)(pData[ulPos] % ubW);
+		UBYTE y = (UBYTE)(pData[ulPos + 1] % ubH);
+		UBYTE ubType = pData[ulPos + 2];
+		UBYTE ubLen = pData[ulPos + 3];
+		ulPos += 4;
+		if (ubLen > ulSize - ulPos)
+			ubLen = (UBYTE)(ulSize - ulPos);
+		mazeAppendEvent(pMaze, mazeEventCreate(x, y, ubType, ubLen, (UBYTE *)(pData + ulPos)));
+		ulPos += ubLen;
+	}
+	while (ulPos < ulSize) {
+		UWORD uwLen = (UWORD)(pData[ulPos] % 48);
+		ulPos++;
+		if (uwLen > ulSize - ulPos)
+			uwLen = (UWORD)(ulSize - ulPos);
+		mazeAddString(pMaze, (char *)(pData + ulPos), uwLen);
+		ulPos += uwLen;
+	}
+
+	/* Start from every anchor in turn, as handleEventTrigger would */
+	for (UWORD uwStart = 0; uwStart < pMaze->_eventCount; uwStart++)
+		executeScript(pMaze, uwStart);
+	for (UWORD uwFrame = 0; uwFrame < 64 && scriptActiveCount(); uwFrame++)
+		scriptUpdate(pMaze);
+
+	hostGameSetMaze(NULL);
+	return 0;
+}
@@ -0,0 +1,1819 @@
+/* Host regression tests for the maze script VM (src/misc/script.c).
+ *
+ *   script_test                      run the built-in cases
+ *   script_test <file.maze> [opts]   run a maze script and check expectations
+ *     --start N        event ordinal to start from (default 0)
+ *     --party X,Y      party position before running
+ *     --flag L5=1      local flag 5 must equal 1 (G5=1 for global)
+ *     --cell X,Y=V     _mazeData at X,Y must equal V
+ *     --item I=Q       inventory must hold Q of item index I
+ *     --message TEXT   last gameDisplayMessage() text must equal TEXT
+ */
+#include "host_game.h"
+#include "host_ace.h"
+#include "script.h"
+#include "slz.h"
+#include "asset_cache.h"
+#include "wallset.h"
+#include "load_profile.h"
+#include "save_journal.h"
+#include "snapshot.h"
+#include "maze_chunked.h"
+#include "party_field.h"
+#include "maze_zones.h"
+#include "level_entities.h"
+#include "rng.h"
+#include "input.h"
+#include <ace/managers/key.h>
+#include <ace/managers/mouse.h>
+#include "bin_reader.h"
+#include <ace/utils/disk_file.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int s_iFailures;
+static int s_iChecks;
+static const char *s_szCase = "";
+
+#define CHECK(cond) do { \
+	s_iChecks++; \
+	if (!(cond)) { \
+		s_iFailures++; \
+		fprintf(stderr, "FAIL [%s] %s:%d: %s\n", s_szCase, __FILE__, __LINE__, #cond); \
+	} \
+} while (0)
+
+static char s_szTmpPath[512];
+
+static void addEvent(tMaze *pMaze, UBYTE x, UBYTE y, UBYTE ubType, UBYTE ubSize, const UBYTE *pData)
+{
+	mazeAppendEvent(pMaze, mazeEventCreate(x, y, ubType, ubSize, (UBYTE *)pData));
+}
+
+/* Saves and reloads pMaze so every case also covers the .maze round trip. */
+static tMaze *roundTrip(tMaze *pMaze)
+{
+	mazeSave(pMaze, s_szTmpPath);
+	tMaze *pLoaded = mazeLoad(s_szTmpPath);
+	CHECK(pLoaded != NULL);
+	if (pLoaded) {
+		CHECK(pLoaded->_width == pMaze->_width && pLoaded->_height == pMaze->_height);
+		CHECK(pLoaded->_eventCount == pMaze->_eventCount);
+		CHECK(pLoaded->_stringCount == pMaze->_stringCount);
+	}
+	if (g_pGameState->m_pCurrentMaze != pMaze)
+		mazeDelete(pMaze);
+	hostGameSetMaze(pLoaded);
+	return pLoaded;
+}
+
+static tMaze *beginCase(const char *szName, UBYTE ubW, UBYTE ubH)
+{
+	s_szCase = szName;
+	hostGameReset();
+	return mazeCreate(ubW, ubH);
+}
+
+static UBYTE cell(tMaze *pMaze, UBYTE x, UBYTE y)
+{
+	return pMaze->_mazeData[x + y * pMaze->_width];
+}
+
+static void testStraightLine(void)
+{
+	tMaze *pMaze = beginCase("straight-line", 8, 8);
+	const UBYTE pWall[] = {MAZE_DOOR};
+	const UBYTE pCol[] = {7};
+	const UBYTE pFlag[] = {0, 5, 3};
+	const UBYTE pGlobal[] = {1, 9};
+	addEvent(pMaze, 2, 2, EVENT_SETWALL, 1, pWall);
+	addEvent(pMaze, 2, 2, EVENT_SETCOL, 1, pCol);
+	addEvent(pMaze, 2, 2, EVENT_SETFLAG, 3, pFlag);
+	addEvent(pMaze, 2, 2, EVENT_SETFLAG, 2, pGlobal);
+	/* Different anchor: must not run */
+	addEvent(pMaze, 3, 2, EVENT_SETWALL, 1, pWall);
+	pMaze = roundTrip(pMaze);
+
+	executeScript(pMaze, 0);
+	CHECK(cell(pMaze, 2, 2) == MAZE_DOOR);
+	CHECK(pMaze->_mazeCol[2 + 2 * 8] == 7);
+	CHECK(g_pGameState->m_bLocalFlags[5] == 3);
+	CHECK(g_pGameState->m_bGlobalFlags[9] == 1);
+	CHECK(cell(pMaze, 3, 2) == MAZE_FLOOR);
+}
+
+static void testIfElse(void)
+{
+	tMaze *pMaze = beginCase("if-else", 4, 4);
+	const UBYTE pCond[] = {EVENT_EQUAL, EVENT_LEVEL_FLAG, 1, 1};
+	const UBYTE pThen[] = {0, 2, 1};
+	const UBYTE pElse[] = {0, 3, 1};
+	addEvent(pMaze, 1, 1, EVENT_IF, 4, pCond);
+	addEvent(pMaze, 1, 1, EVENT_SETFLAG, 3, pThen);
+	addEvent(pMaze, 1, 1, EVENT_ELSE, 0, NULL);
+	addEvent(pMaze, 1, 1, EVENT_SETFLAG, 3, pElse);
+	addEvent(pMaze, 1, 1, EVENT_ENDIF, 0, NULL);
+	pMaze = roundTrip(pMaze);
+
+	executeScript(pMaze, 0);
+	CHECK(g_pGameState->m_bLocalFlags[2] == 0);
+	CHECK(g_pGameState->m_bLocalFlags[3] == 1);
+
+	hostGameReset();
+	g_pGameState->m_bLocalFlags[1] = 1;
+	executeScript(pMaze, 0);
+	CHECK(g_pGameState->m_bLocalFlags[2] == 1);
+	CHECK(g_pGameState->m_bLocalFlags[3] == 0);
+}
+
+static void testGotoGosub(void)
+{
+	tMaze *pMaze = beginCase("goto-gosub", 8, 8);
+	const UBYTE pGosub[] = {3};
+	const UBYTE pGoto[] = {5};
+	const UBYTE pFlagA[] = {0, 10, 1};
+	const UBYTE pFlagB[] = {0, 11, 1};
+	const UBYTE pFlagC[] = {0, 12, 1};
+	addEvent(pMaze, 0, 0, EVENT_GOSUB, 1, pGosub);   /* 0 */
+	addEvent(pMaze, 0, 0, EVENT_GOTO, 1, pGoto);     /* 1 */
+	addEvent(pMaze, 0, 0, EVENT_SETFLAG, 3, pFlagC); /* 2: skipped by GOTO */
+	addEvent(pMaze, 4, 4, EVENT_SETFLAG, 3, pFlagA); /* 3: subroutine */
+	addEvent(pMaze, 4, 4, EVENT_RETURN, 0, NULL);    /* 4 */
+	addEvent(pMaze, 5, 5, EVENT_SETFLAG, 3, pFlagB); /* 5: GOTO target */
+	pMaze = roundTrip(pMaze);
+
+	executeScript(pMaze, 0);
+	CHECK(g_pGameState->m_bLocalFlags[10] == 1);
+	CHECK(g_pGameState->m_bLocalFlags[11] == 1);
+	CHECK(g_pGameState->m_bLocalFlags[12] == 0);
+}
+
+static void testInventory(void)
+{
+	tMaze *pMaze = beginCase("inventory", 4, 4);
+	const UBYTE pGive[] = {1, 3};
+	const UBYTE pTake[] = {1, 1};
+	const UBYTE pKey[] = {0};
+	addEvent(pMaze, 0, 1, EVENT_GIVEITEM, 2, pGive);
+	addEvent(pMaze, 0, 1, EVENT_TAKEITEM, 2, pTake);
+	addEvent(pMaze, 0, 1, EVENT_GIVEITEM, 1, pKey);
+	pMaze = roundTrip(pMaze);
+
+	executeScript(pMaze, 0);
+	CHECK(inventoryGetItemCount(g_pGameState->m_pInventory, 1) == 2);
+	CHECK(inventoryHasItem(g_pGameState->m_pInventory, 0));
+}
+
+static void testMessageAndParty(void)
+{
+	tMaze *pMaze = beginCase("message-party", 6, 6);
+	mazeAddString(pMaze, "first", 5);
+	mazeAddString(pMaze, "second", 6);
+	const UBYTE pMsg[] = {1};
+	const UBYTE pTeleport[] = {4, 3};
+	const UBYTE pTurn[] = {1, 3};
+	const UBYTE pDamage[] = {30};
+	addEvent(pMaze, 1, 0, EVENT_SHOWMESSAGE, 1, pMsg);
+	addEvent(pMaze, 1, 0, EVENT_TELEPORT, 2, pTeleport);
+	addEvent(pMaze, 1, 0, EVENT_TURN, 2, pTurn);
+	addEvent(pMaze, 1, 0, EVENT_DAMAGE, 1, pDamage);
+	addEvent(pMaze, 1, 0, EVENT_WIN, 0, NULL);
+	pMaze = roundTrip(pMaze);
+
+	executeScript(pMaze, 0);
+	CHECK(strcmp(g_szHostLastMessage, "second") == 0);
+	CHECK(g_pGameState->m_pCurrentParty->_PartyX == 4);
+	CHECK(g_pGameState->m_pCurrentParty->_PartyY == 3);
+	CHECK(g_pGameState->m_pCurrentParty->_PartyFacing == 3);
+	CHECK(g_pGameState->m_pCurrentParty->_BatteryLevel == 70);
+	CHECK(g_ubRequestWin == 1);
+}
+
+static void testDoors(void)
+{
+	tMaze *pMaze = beginCase("doors", 4, 4);
+	const UBYTE pDoor[] = {3, 3};
+	const UBYTE pOffGrid[] = {200, 200};
+	addEvent(pMaze, 0, 0, EVENT_OPENDOOR, 2, pDoor);
+	addEvent(pMaze, 0, 0, EVENT_OPENDOOR, 2, pOffGrid);
+	addEvent(pMaze, 1, 0, EVENT_CLOSEDOOR, 0, NULL);
+	pMaze = roundTrip(pMaze);
+
+	executeScript(pMaze, 0);
+	CHECK(cell(pMaze, 3, 3) == MAZE_DOOR_OPEN);
+	executeScript(pMaze, 2);
+	CHECK(cell(pMaze, 1, 0) == MAZE_DOOR);
+}
+
+static void testChangeLevel(void)
+{
+	tMaze *pMaze = beginCase("change-level", 4, 4);
+	const UBYTE pTarget[] = {2, 5, 6, 3};
+	const UBYTE pAfter[] = {0, 4, 1};
+	addEvent(pMaze, 0, 0, EVENT_CHANGE_LEVEL, 4, pTarget);
+	addEvent(pMaze, 0, 0, EVENT_SETFLAG, 3, pAfter);
+	pMaze = roundTrip(pMaze);
+
+	executeScript(pMaze, 0);
+	CHECK(g_sLevelRequest.isPending == 1);
+	CHECK(g_sLevelRequest.ubLevel == 2);
+	CHECK(g_sLevelRequest.ubX == 5 && g_sLevelRequest.ubY == 6);
+	CHECK(g_sLevelRequest.ubFacing == 3);
+	/* The script ends at the level change */
+	CHECK(g_pGameState->m_bLocalFlags[4] == 0);
+	CHECK(scriptActiveCount() == 0);
+}
+
+/* Changes made while recording replay onto the pristine level; repeated writes merge */
+static void testSaveJournal(void)
+{
+	tMaze *pMaze = beginCase("save-journal", 8, 8);
+	const UBYTE pDoor[] = {MAZE_DOOR};
+	const UBYTE pWall[] = {MAZE_WALL};
+	const UBYTE pCol[] = {7};
+	const UBYTE pCharge[] = {5};
+	const UBYTE pAddA[] = {0, 3, 3};
+	const UBYTE pAddB[] = {0, 4, 4};
+	const UBYTE pRemove[] = {4, 4};
+	addEvent(pMaze, 1, 1, EVENT_SETWALL, 1, pDoor);
+	addEvent(pMaze, 1, 1, EVENT_SETWALL, 1, pWall);
+	addEvent(pMaze, 1, 1, EVENT_SETCOL, 1, pCol);
+	addEvent(pMaze, 1, 1, EVENT_BATTERY_CHARGER, 1, pCharge);
+	addEvent(pMaze, 1, 1, EVENT_ADDMONSTER, 3, pAddA);
+	addEvent(pMaze, 1, 1, EVENT_ADDMONSTER, 3, pAddB);
+	addEvent(pMaze, 1, 1, EVENT_REMOVEMONSTER, 2, pRemove);
+	pMaze = roundTrip(pMaze);
+	doorLockAdd(&g_pGameState->m_doorLocks, doorLockCreate(5, 5, DOORLOCK_TYPE_KEY, 1));
+
+	/* Level load phase: nothing recorded */
+	groundItemAdd(&g_pGameState->m_groundItems, 3, 3, 1, 2);
+	CHECK(saveJournalCount() == 0);
+
+	saveJournalStart();
+	g_pGameState->m_pCurrentParty->_BatteryLevel = 90;
+	executeScript(pMaze, 0);
+	doorLockUnlock(doorLockFindAt(&g_pGameState->m_doorLocks, 5, 5));
+	groundItemAdd(&g_pGameState->m_groundItems, 3, 3, 1, 4);
+	groundItemRemoveAt(&g_pGameState->m_groundItems, 3, 3, 1, 1);
+	groundItemAdd(&g_pGameState->m_groundItems, 6, 6, 0, 1);
+	groundItemRemoveAt(&g_pGameState->m_groundItems, 6, 6, 0, 1);
+	CHECK(g_pGameState->m_pMonsterList->_numMonsters == 1);
+	monsterKill(pMaze, g_pGameState->m_pMonsterList->_monsters[0]);
+	monsterKill(pMaze, g_pGameState->m_pMonsterList->_monsters[0]);
+	/* One recharge tick a second; it updates the charger's record */
+	for (UBYTE i = 0; i < 60; i++)
+		updateBatteryChargers(pMaze);
+	/* wall + col, charger, 2 adds, remove, lock, net ground at (3,3), kill */
+	CHECK(saveJournalCount() == 9);
+
+	char szSave[540];
+	snprintf(szSave, sizeof(szSave), "%s.sav", s_szTmpPath);
+	tFile *pFile = diskFileOpen(szSave, DISK_FILE_MODE_WRITE, 1);
+	saveJournalWrite(pFile);
+	fileClose(pFile);
+
+	/* Back to the level as shipped, then replay */
+	hostGameReset();
+	hostGameSetMaze(mazeLoad(s_szTmpPath));
+	pMaze = g_pGameState->m_pCurrentMaze;
+	doorLockAdd(&g_pGameState->m_doorLocks, doorLockCreate(5, 5, DOORLOCK_TYPE_KEY, 1));
+	groundItemAdd(&g_pGameState->m_groundItems, 3, 3, 1, 2);
+	CHECK(cell(pMaze, 1, 1) == 0 && saveJournalCount() == 0);
+
+	tBinReader reader;
+	CHECK(binReaderOpen(&reader, szSave));
+	UWORD uwCount = binReadU16Be(&reader);
+	CHECK(uwCount == 9);
+	const UBYTE *pRecords = binReadInPlace(&reader, (ULONG)uwCount * SAVE_JOURNAL_RECORD_SIZE);
+	CHECK(pRecords && binReadU8(&reader) == 0 && reader.isOverrun);
+	CHECK(saveJournalReplay(g_pGameState, pRecords, uwCount));
+	binReaderClose(&reader);
+	remove(szSave);
+
+	CHECK(cell(pMaze, 1, 1) == MAZE_WALL && pMaze->_mazeCol[1 + 8] == 7);
+	CHECK(mazeEventAtOrdinal(pMaze, 3)->_eventData[0] == 5);
+	CHECK(doorLockFindAt(&g_pGameState->m_doorLocks, 5, 5)->_state == DOORLOCK_STATE_UNLOCKED);
+	CHECK(groundItemQtyAt(&g_pGameState->m_groundItems, 3, 3) == 5);
+	CHECK(groundItemQtyAt(&g_pGameState->m_groundItems, 6, 6) == 0);
+	/* The killed monster's record went back to the pool */
+	CHECK(g_pGameState->m_pMonsterList->_numMonsters == 0);
+	CHECK(monsterCountAt(pMaze, 3, 3) == 0 && monsterCountAt(pMaze, 4, 4) == 0);
+	/* The replayed records are the journal the next save writes */
+	CHECK(saveJournalCount() == 9);
+	saveJournalCell(SAVE_JOURNAL_LAYER_WALL, 1, 1, MAZE_DOOR);
+	CHECK(saveJournalCount() == 9 && saveJournalGet(0)->value == MAZE_DOOR);
+}
+
+/* A ground record cancelling out must not move later monster records ahead of their spawn */
+static void testSaveJournalOrder(void)
+{
+	tMaze *pMaze = beginCase("save-journal order", 8, 8);
+	const UBYTE pAdd[] = {0, 3, 3};
+	addEvent(pMaze, 1, 1, EVENT_ADDMONSTER, 3, pAdd);
+	pMaze = roundTrip(pMaze);
+	groundItemAdd(&g_pGameState->m_groundItems, 2, 2, 1, 1);
+
+	saveJournalStart();
+	groundItemRemoveAt(&g_pGameState->m_groundItems, 2, 2, 1, 1);
+	executeScript(pMaze, 0);
+	monsterKill(pMaze, g_pGameState->m_pMonsterList->_monsters[0]);
+	groundItemAdd(&g_pGameState->m_groundItems, 2, 2, 1, 1);
+	CHECK(saveJournalCount() == 2);
+	CHECK(saveJournalGet(0)->type == SAVE_JOURNAL_MONSTER_ADD && saveJournalGet(1)->type == SAVE_JOURNAL_MONSTER_KILL);
+
+	UBYTE pRecords[2 * SAVE_JOURNAL_RECORD_SIZE];
+	for (UBYTE i = 0; i < 2; i++) {
+		const tSaveJournalRecord *r = saveJournalGet(i);
+		UBYTE *p = &pRecords[i * SAVE_JOURNAL_RECORD_SIZE];
+		p[0] = r->type;
+		p[1] = r->x;
+		p[2] = r->y;
+		p[3] = r->arg;
+		p[4] = (UBYTE)(r->value >> 8);
+		p[5] = (UBYTE)r->value;
+	}
+	hostGameReset();
+	hostGameSetMaze(mazeLoad(s_szTmpPath));
+	pMaze = g_pGameState->m_pCurrentMaze;
+	groundItemAdd(&g_pGameState->m_groundItems, 2, 2, 1, 1);
+	CHECK(saveJournalReplay(g_pGameState, pRecords, 2));
+	CHECK(monsterCountAt(pMaze, 3, 3) == 0 && groundItemQtyAt(&g_pGameState->m_groundItems, 2, 2) == 1);
+}
+
+/* Spawn ids keep counting past 255, so a late kill is not taken for an early one's */
+static void testSpawnIdWrap(void)
+{
+	tMaze *pMaze = roundTrip(beginCase("spawn id wrap", 8, 8));
+	tMonsterList *pList = g_pGameState->m_pMonsterList;
+	for (UWORD i = 0; i < 257; i++) {
+		monsterListAppend(pList, monsterCreate(MONSTER_TYPE_NORMAL));
+		if (i != 1)
+			monsterListRemove(pList, pMaze, (UBYTE)(pList->_numMonsters - 1));
+	}
+	CHECK(pList->_numMonsters == 1 && pList->_nextSpawnId == 257);
+	monsterListAppend(pList, monsterCreate(MONSTER_TYPE_NORMAL));
+	CHECK(pList->_monsters[1]->_spawnId == 257);
+
+	saveJournalStart();
+	monsterKill(pMaze, pList->_monsters[0]);
+	monsterKill(pMaze, pList->_monsters[1]);
+	CHECK(saveJournalCount() == 2);
+	CHECK(saveJournalGet(0)->value == 1 && saveJournalGet(1)->value == 257);
+}
+
+/* Restore puts back exactly what was taken, whatever happened in between */
+static void testSnapshot(void)
+{
+	tMaze *pMaze = beginCase("snapshot", 16, 16);
+	const UBYTE pCharge[] = {9};
+	const UBYTE pAdd[] = {0, 5, 5};
+	const UBYTE pWall[] = {MAZE_DOOR};
+	addEvent(pMaze, 1, 1, EVENT_BATTERY_CHARGER, 1, pCharge);
+	addEvent(pMaze, 2, 2, EVENT_ADDMONSTER, 3, pAdd);
+	addEvent(pMaze, 2, 2, EVENT_ADDMONSTER, 3, pAdd);
+	addEvent(pMaze, 3, 3, EVENT_SETWALL, 1, pWall);
+	pMaze = roundTrip(pMaze);
+	doorLockAdd(&g_pGameState->m_doorLocks, doorLockCreate(7, 7, DOORLOCK_TYPE_KEY, 1));
+	saveJournalStart();
+	executeScript(pMaze, 1);
+	inventoryAddItem(g_pGameState->m_pInventory, 1, 3);
+	groundItemAdd(&g_pGameState->m_groundItems, 4, 4, 0, 2);
+	g_pGameState->m_bLocalFlags[10] = 1;
+	g_pGameState->m_pCurrentParty->_PartyX = 6;
+	g_pGameState->m_pCurrentParty->_BatteryLevel = 50;
+
+	tSnapshot sSnap;
+	CHECK(snapshotCreate(&sSnap, 256));
+	CHECK(!snapshotTake(&sSnap, g_pGameState) && sSnap.ulSize == 0);
+	CHECK(!snapshotRestore(&sSnap, g_pGameState));
+	snapshotDestroy(&sSnap);
+	CHECK(snapshotCreate(&sSnap, snapshotSizeOf(g_pGameState)));
+	CHECK(snapshotTake(&sSnap, g_pGameState) && sSnap.ulSize == snapshotSizeOf(g_pGameState));
+	UWORD uwJournal = saveJournalCount();
+	UBYTE pCells[16 * 16];
+	memcpy(pCells, pMaze->_mazeData, sizeof(pCells));
+	UWORD uwMonsterHp = g_pGameState->m_pMonsterList->_monsters[1]->_base._HP;
+	ULONG ulDice = rngStateGet(RNG_SCRIPT);
+	ULONG ulAi = rngStateGet(RNG_AI);
+
+	/* Play on: charger drained, doors opened, monsters killed and removed, items moved */
+	for (UBYTE i = 0; i < 5; i++)
+		executeScript(pMaze, 0);
+	executeScript(pMaze, 3);
+	doorLockUnlock(doorLockFindAt(&g_pGameState->m_doorLocks, 7, 7));
+	monsterKill(pMaze, g_pGameState->m_pMonsterList->_monsters[0]);
+	g_pGameState->m_pMonsterList->_monsters[1]->_base._HP = 1;
+	monsterListRemove(g_pGameState->m_pMonsterList, pMaze, 1);
+	inventoryRemoveItem(g_pGameState->m_pInventory, 1, 3);
+	groundItemRemoveAt(&g_pGameState->m_groundItems, 4, 4, 0, 2);
+	g_pGameState->m_bLocalFlags[10] = 0;
+	g_pGameState->m_bGlobalFlags[3] = 4;
+	g_pGameState->m_pCurrentParty->_PartyX = 9;
+	g_pGameState->m_pCurrentParty->_characters[0]->_HP = 0;
+	rngStateSet(RNG_SCRIPT, ulDice + 77);
+	rngNext(RNG_AI);
+
+	hostStatsReset();
+	double dStart = hostNowUs();
+	CHECK(snapshotRestore(&sSnap, g_pGameState));
+	double dRestoreUs = hostNowUs() - dStart;
+	CHECK(memcmp(pCells, pMaze->_mazeData, sizeof(pCells)) == 0);
+	CHECK(mazeEventAtOrdinal(pMaze, 0)->_eventData[0] == 9);
+	CHECK(doorLockFindAt(&g_pGameState->m_doorLocks, 7, 7)->_state == DOORLOCK_STATE_LOCKED);
+	CHECK(g_pGameState->m_pMonsterList->_numMonsters == 2);
+	CHECK(g_pGameState->m_pMonsterList->_monsters[0]->_state != MONSTER_STATE_DEAD);
+	CHECK(g_pGameState->m_pMonsterList->_monsters[1]->_base._HP == uwMonsterHp);
+	CHECK(monsterCountAt(pMaze, 5, 5) == 2);
+	CHECK(inventoryGetItemCount(g_pGameState->m_pInventory, 1) == 3);
+	CHECK(groundItemQtyAt(&g_pGameState->m_groundItems, 4, 4) == 2);
+	CHECK(g_pGameState->m_bLocalFlags[10] == 1 && g_pGameState->m_bGlobalFlags[3] == 0);
+	CHECK(g_pGameState->m_pCurrentParty->_PartyX == 6 && g_pGameState->m_pCurrentParty->_BatteryLevel == 50);
+	CHECK(g_pGameState->m_pCurrentParty->_characters[0]->_HP != 0);
+	CHECK(saveJournalCount() == uwJournal && rngStateGet(RNG_SCRIPT) == ulDice && rngStateGet(RNG_AI) == ulAi);
+	/* The monster that had been removed comes back from the pool, not the heap */
+	CHECK(g_sHostMem.ulAllocs == 0);
+	printf("snapshot: %lu bytes, restore %.1f us\n", (unsigned long)sSnap.ulSize, dRestoreUs);
+
+	/* A level whose layout changed since is refused */
+	hostGameSetMaze(mazeCreate(8, 8));
+	CHECK(!snapshotRestore(&sSnap, g_pGameState));
+	snapshotDestroy(&sSnap);
+}
+
+/* A big level's grids are copied once, not again with the image; the buffer grows keeping its snapshot */
+static void testSnapshotBigLevel(void)
+{
+	tMaze *pMaze = beginCase("snapshot big level", 96, 96);
+	const UBYTE pCharge[] = {9};
+	addEvent(pMaze, 1, 1, EVENT_BATTERY_CHARGER, 1, pCharge);
+	pMaze = roundTrip(pMaze);
+	ULONG ulCells = 96 * 96;
+	ULONG ulSize = snapshotSizeOf(g_pGameState);
+	CHECK(ulSize > 4 * ulCells && ulSize < 5 * ulCells);
+
+	tSnapshot sSnap;
+	CHECK(snapshotCreate(&sSnap, 64));
+	CHECK(snapshotReserve(&sSnap, ulSize) && sSnap.ulCapacity == ulSize);
+	CHECK(snapshotTake(&sSnap, g_pGameState));
+	mazeEventAtOrdinal(pMaze, 0)->_eventData[0] = 1;
+	pMaze->_mazeFloor[ulCells - 1] = 3;
+	CHECK(snapshotReserve(&sSnap, ulSize + SNAPSHOT_HEADROOM) && sSnap.ulSize == ulSize);
+	CHECK(snapshotReserve(&sSnap, 64) && sSnap.ulCapacity == ulSize + SNAPSHOT_HEADROOM);
+	CHECK(snapshotRestore(&sSnap, g_pGameState));
+	CHECK(mazeEventAtOrdinal(pMaze, 0)->_eventData[0] == 9 && pMaze->_mazeFloor[ulCells - 1] == 0);
+	snapshotDestroy(&sSnap);
+}
+
+/* Returns the heap allocations the event itself made */
+static ULONG fireEncounter(tMaze *pMaze, UBYTE ubId)
+{
+	tMazeEvent *pEvent = mazeEventCreate(1, 1, EVENT_ENCOUNTER, 1, &ubId);
+	hostStatsReset();
+	handleEvent(pMaze, pEvent);
+	ULONG ulAllocs = g_sHostMem.ulAllocs;
+	mazeRemoveEvent(pMaze, pEvent);
+	return ulAllocs;
+}
+
+/* Encounter monsters are made at level load; firing one only moves them in */
+static void testEncounters(void)
+{
+	static const UBYTE s_pLvl[] = {
+		'L', 'V', 'L', 'E', LEVEL_ENTITIES_VERSION,
+		0, 0, 0, 0, 0,
+		1, /* monsters */
+		0, 2, 2,
+		2, /* encounters */
+		7, 3, 0, 5, 5, 1, 5, 6, 0, 6, 5,
+		9, 2, 2, 9, 9, 0, 9, 10,
+	};
+	tMaze *pMaze = beginCase("encounters", 16, 16);
+	hostGameSetMaze(pMaze);
+	UBYTE ubUsed = monsterPoolUsed();
+	CHECK(levelEntitiesLoadFromMemory(g_pGameState, s_pLvl, sizeof(s_pLvl)));
+	tEncounterList *pEnc = &g_pGameState->m_encounters;
+	tMonsterList *pList = g_pGameState->m_pMonsterList;
+	CHECK(pEnc->count == 2 && pEnc->memberCount == 5 && monsterPoolUsed() == ubUsed + 6);
+	CHECK(pList->_numMonsters == 1 && pEnc->pDormant[1]->_monsterType == MONSTER_TYPE_BOSS);
+	CHECK(!pEnc->pDormant[0]->_inMaze && monsterCountAt(pMaze, 5, 5) == 0);
+	CHECK(!encounterAdd(pEnc, 7, 1, s_pLvl));
+
+	saveJournalStart();
+	CHECK(fireEncounter(pMaze, 7) == 0);
+	CHECK(pList->_numMonsters == 4 && pList->_monsters[3]->_spawnId == 3);
+	CHECK(monsterCountAt(pMaze, 5, 5) == 1 && monsterCountAt(pMaze, 6, 5) == 1);
+	CHECK(pEnc->pDormant[0] == NULL && pEnc->encounters[0].isFired);
+	CHECK(saveJournalCount() == 1 && saveJournalGet(0)->type == SAVE_JOURNAL_ENCOUNTER);
+	/* Once only; unknown ids do nothing */
+	fireEncounter(pMaze, 7);
+	fireEncounter(pMaze, 8);
+	CHECK(pList->_numMonsters == 4 && saveJournalCount() == 1);
+
+	/* A snapshot from before the second fight arms it again */
+	tSnapshot sSnap;
+	CHECK(snapshotCreate(&sSnap, snapshotSizeOf(g_pGameState)) && snapshotTake(&sSnap, g_pGameState));
+	fireEncounter(pMaze, 9);
+	CHECK(pList->_numMonsters == 6 && encounterFiredMask(pEnc) == 3);
+	ubUsed = monsterPoolUsed();
+	CHECK(snapshotRestore(&sSnap, g_pGameState));
+	snapshotDestroy(&sSnap);
+	CHECK(pList->_numMonsters == 4 && encounterFiredMask(pEnc) == 1 && monsterPoolUsed() == ubUsed);
+	CHECK(pEnc->pDormant[3] && pEnc->pDormant[4] && monsterCountAt(pMaze, 9, 9) == 0);
+
+	/* Loading a save fires it again from the journal, with the same spawn ids */
+	const UBYTE pRecord[SAVE_JOURNAL_RECORD_SIZE] = {SAVE_JOURNAL_ENCOUNTER, 0, 0, 7, 0, 0};
+	pMaze = beginCase("encounters", 16, 16);
+	hostGameSetMaze(pMaze);
+	CHECK(levelEntitiesLoadFromMemory(g_pGameState, s_pLvl, sizeof(s_pLvl)));
+	CHECK(saveJournalReplay(g_pGameState, pRecord, 1));
+	CHECK(pList->_numMonsters == 4 && pList->_monsters[1]->_partyPosX == 5 && encounterFiredMask(pEnc) == 1);
+}
+
+/* ADD_MONSTER's monster is made at level load too; the event only takes it, unless it runs again */
+static void testAddMonsterSpawns(void)
+{
+	tMaze *pMaze = beginCase("add-monster spawns", 16, 16);
+	const UBYTE pAdd[] = {MONSTER_TYPE_BOSS, 4, 4};
+	addEvent(pMaze, 1, 1, EVENT_ADDMONSTER, 3, pAdd);
+	pMaze = roundTrip(pMaze);
+	tEncounterList *pEnc = &g_pGameState->m_encounters;
+	tMonsterList *pList = g_pGameState->m_pMonsterList;
+	tMonster *pDormant = pEnc->pEventDormant[0];
+	UBYTE ubUsed = monsterPoolUsed();
+	CHECK(pEnc->spawnCount == 1 && pDormant && !pDormant->_inMaze);
+
+	saveJournalStart();
+	tSnapshot sSnap;
+	CHECK(snapshotCreate(&sSnap, snapshotSizeOf(g_pGameState)) && snapshotTake(&sSnap, g_pGameState));
+	executeScript(pMaze, 0);
+	CHECK(pList->_numMonsters == 1 && pList->_monsters[0] == pDormant && monsterPoolUsed() == ubUsed);
+	CHECK(monsterCountAt(pMaze, 4, 4) == 1 && encounterFiredMask(pEnc) == 0x10000);
+	/* Again: no dormant one left, so one is made */
+	executeScript(pMaze, 0);
+	CHECK(pList->_numMonsters == 2 && monsterPoolUsed() == ubUsed + 1);
+	CHECK(saveJournalCount() == 2 && saveJournalGet(0)->type == SAVE_JOURNAL_MONSTER_ADD);
+
+	/* The snapshot from before arms the spawn again */
+	CHECK(snapshotRestore(&sSnap, g_pGameState));
+	snapshotDestroy(&sSnap);
+	CHECK(pList->_numMonsters == 0 && pEnc->pEventDormant[0] && encounterFiredMask(pEnc) == 0);
+
+	/* Replay takes the dormant monster, as the event did */
+	const UBYTE pRecord[SAVE_JOURNAL_RECORD_SIZE] = {SAVE_JOURNAL_MONSTER_ADD, 4, 4, MONSTER_TYPE_BOSS, 0, 0};
+	pDormant = pEnc->pEventDormant[0];
+	CHECK(saveJournalReplay(g_pGameState, pRecord, 1));
+	CHECK(pList->_numMonsters == 1 && pList->_monsters[0] == pDormant && !pEnc->pEventDormant[0]);
+}
+
+/* Streams are independent; a recorded session plays back the same input and random numbers */
+static void testRngAndReplay(void)
+{
+	s_szCase = "rng streams and input replay";
+	rngSeed(5);
+	CHECK(rngStateGet(RNG_AI) != rngStateGet(RNG_LOOT));
+	ULONG ulAi = rngStateGet(RNG_AI);
+	rngNext(RNG_LOOT);
+	CHECK(rngStateGet(RNG_AI) == ulAi);
+	ULONG ulFirst = rngNext(RNG_AI);
+	rngStateSet(RNG_AI, ulAi);
+	CHECK(rngNext(RNG_AI) == ulFirst);
+
+	enum { FRAMES = 300 };
+	static UBYTE s_pSeen[FRAMES];
+	static ULONG s_pRolls[FRAMES];
+	memset(&g_sHostInput, 0, sizeof(g_sHostInput));
+	ULONG ulStart = rngStateGet(RNG_SCRIPT);
+	CHECK(inputRecordStart() && inputModeGet() == INPUT_RECORDING);
+	for (UWORD f = 0; f < FRAMES; f++) {
+		g_sHostInput.pKeys[KEY_W] = f >= 10 && f < 40;
+		g_sHostInput.pKeys[KEY_F6] = f >= 100 && f < 130;
+		g_sHostInput.pMouse[MOUSE_LMB] = f % 50 == 7;
+		g_sHostInput.uwMouseX = (UWORD)(f < 200 ? f / 3 : 66);
+		inputProcess();
+		s_pSeen[f] = (UBYTE)(inputKeyCheck(KEY_W) | inputKeyUse(KEY_F6) << 1 | inputMouseUse(MOUSE_LMB) << 2
+			| (inputMouseX() & 31) << 3);
+		s_pRolls[f] = inputKeyCheck(KEY_W) ? rngNext(RNG_SCRIPT) : 0;
+	}
+	/* F6 held for 30 frames is used once */
+	UBYTE ubF6 = 0;
+	for (UWORD f = 0; f < FRAMES; f++)
+		ubF6 += (s_pSeen[f] >> 1) & 1;
+	CHECK(ubF6 == 1 && inputFrameCount() == FRAMES);
+	char szRec[540];
+	snprintf(szRec, sizeof(szRec), "%s.rec", s_szTmpPath);
+	CHECK(inputRecordStop(szRec) && inputModeGet() == INPUT_LIVE);
+	/* Unchanged frames share a run */
+	ULONG ulRuns = (fileGetSize(szRec) - (8 + 4 * RNG_STREAM_COUNT)) / 10;
+	CHECK(ulRuns > 60 && ulRuns < FRAMES / 3);
+
+	/* Whatever the hardware says now, the replay wins until it runs out */
+	rngSeed(99);
+	memset(&g_sHostInput, 0, sizeof(g_sHostInput));
+	g_sHostInput.pKeys[KEY_W] = 1;
+	g_sHostInput.uwMouseX = 300;
+	CHECK(inputReplayStart(szRec) && rngStateGet(RNG_SCRIPT) == ulStart);
+	UWORD uwSame = 0;
+	for (UWORD f = 0; f < FRAMES; f++) {
+		inputProcess();
+		UBYTE ubSeen = (UBYTE)(inputKeyCheck(KEY_W) | inputKeyUse(KEY_F6) << 1 | inputMouseUse(MOUSE_LMB) << 2
+			| (inputMouseX() & 31) << 3);
+		ULONG ulRoll = inputKeyCheck(KEY_W) ? rngNext(RNG_SCRIPT) : 0;
+		uwSame += ubSeen == s_pSeen[f] && ulRoll == s_pRolls[f];
+	}
+	CHECK(uwSame == FRAMES && inputModeGet() == INPUT_REPLAYING);
+	inputProcess();
+	CHECK(inputModeGet() == INPUT_LIVE && inputKeyCheck(KEY_W) && inputMouseX() == 300);
+	remove(szRec);
+	CHECK(!inputReplayStart(szRec));
+	memset(&g_sHostInput, 0, sizeof(g_sHostInput));
+	inputProcess();
+}
+
+static void testRunawayLoop(void)
+{
+	tMaze *pMaze = beginCase("runaway-goto", 4, 4);
+	const UBYTE pSelf[] = {0};
+	addEvent(pMaze, 0, 0, EVENT_GOTO, 1, pSelf);
+	pMaze = roundTrip(pMaze);
+	/* Must be killed by the step guard instead of running forever */
+	executeScript(pMaze, 0);
+	for (int i = 0; i < 100 && scriptActiveCount(); i++)
+		scriptUpdate(pMaze);
+	CHECK(scriptActiveCount() == 0);
+}
+
+static void testWait(void)
+{
+	tMaze *pMaze = beginCase("wait", 4, 4);
+	const UBYTE pFlagA[] = {0, 1, 1};
+	const UBYTE pWait[] = {2};
+	const UBYTE pFlagB[] = {0, 2, 1};
+	addEvent(pMaze, 2, 1, EVENT_SETFLAG, 3, pFlagA);
+	addEvent(pMaze, 2, 1, EVENT_WAIT, 1, pWait);
+	addEvent(pMaze, 2, 1, EVENT_SETFLAG, 3, pFlagB);
+	addEvent(pMaze, 2, 1, EVENT_WAIT, 0, NULL);
+	addEvent(pMaze, 2, 1, EVENT_CLEARFLAG, 2, pFlagA);
+	pMaze = roundTrip(pMaze);
+
+	executeScript(pMaze, 0);
+	CHECK(g_pGameState->m_bLocalFlags[1] == 1);
+	CHECK(g_pGameState->m_bLocalFlags[2] == 0);
+	CHECK(scriptActiveCount() == 1);
+	scriptUpdate(pMaze);
+	scriptUpdate(pMaze);
+	CHECK(g_pGameState->m_bLocalFlags[2] == 0);
+	scriptUpdate(pMaze); /* third frame: resumes, sets B, yields again */
+	CHECK(g_pGameState->m_bLocalFlags[2] == 1);
+	CHECK(g_pGameState->m_bLocalFlags[1] == 1);
+	scriptUpdate(pMaze);
+	CHECK(g_pGameState->m_bLocalFlags[1] == 0);
+	CHECK(scriptActiveCount() == 0);
+}
+
+static void testFrameBudget(void)
+{
+	tMaze *pMaze = beginCase("frame-budget", 8, 8);
+	for (UWORD i = 0; i < 100; i++) {
+		UBYTE pFlag[3] = {0, (UBYTE)i, 1};
+		addEvent(pMaze, 3, 3, EVENT_SETFLAG, 3, pFlag);
+	}
+	for (UWORD i = 0; i < 100; i++) {
+		UBYTE pFlag[3] = {1, (UBYTE)i, 1};
+		addEvent(pMaze, 4, 4, EVENT_SETFLAG, 3, pFlag);
+	}
+	pMaze = roundTrip(pMaze);
+	scriptSetFrameBudget(30);
+
+	executeScript(pMaze, 0);
+	executeScript(pMaze, 100);
+	CHECK(scriptActiveCount() == 2);
+	CHECK(g_pGameState->m_bLocalFlags[29] == 1 && g_pGameState->m_bLocalFlags[30] == 0);
+	CHECK(g_pGameState->m_bGlobalFlags[29] == 1 && g_pGameState->m_bGlobalFlags[30] == 0);
+
+	/* Budget is shared per frame, so both scripts finish after a few frames */
+	UWORD uwFrames = 0;
+	while (scriptActiveCount() && uwFrames < 20) {
+		CHECK(scriptUpdate(pMaze) <= 30);
+		uwFrames++;
+	}
+	CHECK(scriptActiveCount() == 0);
+	CHECK(uwFrames >= 5);
+	CHECK(g_pGameState->m_bLocalFlags[99] == 1);
+	CHECK(g_pGameState->m_bGlobalFlags[99] == 1);
+}
+
+static void testContextPoolFull(void)
+{
+	tMaze *pMaze = beginCase("pool-full", 16, 4);
+	const UBYTE pWait[] = {255};
+	for (UBYTE i = 0; i < SCRIPT_MAX_CONTEXTS; i++)
+		addEvent(pMaze, i, 0, EVENT_WAIT, 1, pWait);
+	const UBYTE pFlag[] = {0, 7, 1};
+	const UBYTE pYield[] = {0};
+	addEvent(pMaze, 15, 3, EVENT_WAIT, 1, pYield);
+	addEvent(pMaze, 15, 3, EVENT_SETFLAG, 3, pFlag);
+	pMaze = roundTrip(pMaze);
+
+	for (UBYTE i = 0; i < SCRIPT_MAX_CONTEXTS; i++)
+		executeScript(pMaze, i);
+	CHECK(scriptActiveCount() == SCRIPT_MAX_CONTEXTS);
+	/* No free context: runs synchronously instead of being dropped */
+	executeScript(pMaze, SCRIPT_MAX_CONTEXTS);
+	CHECK(g_pGameState->m_bLocalFlags[7] == 1);
+}
+
+/* Runs "IF cond / SETFLAG L255=1 / ENDIF" on a fresh anchor cell and reports whether the block ran. */
+static int condHolds(tMaze *pMaze, const UBYTE *pCond, UBYTE ubSize)
+{
+	static const UBYTE s_pHit[] = {0, 255, 1};
+	UWORD uwStart = pMaze->_eventCount;
+	UBYTE x = (UBYTE)(uwStart / 3 % pMaze->_width);
+	UBYTE y = (UBYTE)(uwStart / 3 / pMaze->_width);
+	addEvent(pMaze, x, y, EVENT_IF, ubSize, pCond);
+	addEvent(pMaze, x, y, EVENT_SETFLAG, 3, s_pHit);
+	addEvent(pMaze, x, y, EVENT_ENDIF, 0, NULL);
+	g_pGameState->m_bLocalFlags[255] = 0;
+	executeScript(pMaze, uwStart);
+	return g_pGameState->m_bLocalFlags[255];
+}
+
+static void testConditions(void)
+{
+	tMaze *pMaze = beginCase("conditions", 16, 16);
+	hostGameSetMaze(pMaze);
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+
+	/* A AND B OR C groups as A AND (B OR C) */
+	const UBYTE pAndOr[] = {
+		EVENT_EQUAL, EVENT_LEVEL_FLAG, 1, 1, EVENT_AND,
+		EVENT_EQUAL, EVENT_LEVEL_FLAG, 2, 1, EVENT_OR,
+		EVENT_EQUAL, EVENT_LEVEL_FLAG, 3, 1};
+	g_pGameState->m_bLocalFlags[3] = 1;
+	CHECK(!condHolds(pMaze, pAndOr, sizeof(pAndOr)));
+	g_pGameState->m_bLocalFlags[1] = 1;
+	CHECK(condHolds(pMaze, pAndOr, sizeof(pAndOr)));
+	g_pGameState->m_bLocalFlags[3] = 0;
+	CHECK(!condHolds(pMaze, pAndOr, sizeof(pAndOr)));
+	g_pGameState->m_bLocalFlags[2] = 1;
+	CHECK(condHolds(pMaze, pAndOr, sizeof(pAndOr)));
+
+	const UBYTE pLess[] = {EVENT_LESS, EVENT_GLOBAL_FLAG, 7, 3};
+	const UBYTE pNotEq[] = {EVENT_NOT_EQUAL, EVENT_GLOBAL_FLAG, 7, 2};
+	g_pGameState->m_bGlobalFlags[7] = 2;
+	CHECK(condHolds(pMaze, pLess, sizeof(pLess)));
+	CHECK(!condHolds(pMaze, pNotEq, sizeof(pNotEq)));
+
+	/* 3-byte direction term in front of AND */
+	const UBYTE pFacing[] = {
+		EVENT_EQUAL, EVENT_PARTY_DIRECTION, 2, EVENT_AND,
+		EVENT_GREATER, EVENT_PARTY_ON_POS, 3, 4};
+	pParty->_PartyFacing = 2;
+	pParty->_PartyX = 5;
+	pParty->_PartyY = 5;
+	CHECK(condHolds(pMaze, pFacing, sizeof(pFacing)));
+	pParty->_PartyY = 4;
+	CHECK(!condHolds(pMaze, pFacing, sizeof(pFacing)));
+
+	/* Monster counts follow placement, movement and death */
+	const UBYTE pMonsters[] = {EVENT_EQUAL, EVENT_MONSTERS_ON_POS, 9, 9, 1};
+	const UBYTE pNoMonsters[] = {EVENT_EQUAL, EVENT_MONSTERS_ON_POS, 9, 9, 0};
+	CHECK(condHolds(pMaze, pNoMonsters, sizeof(pNoMonsters)));
+	tMonster *pMonster = monsterCreate(MONSTER_TYPE_NORMAL);
+	g_pGameState->m_pMonsterList->_monsters[g_pGameState->m_pMonsterList->_numMonsters++] = pMonster;
+	monsterPlaceInMaze(pMaze, pMonster, 9, 9);
+	CHECK(condHolds(pMaze, pMonsters, sizeof(pMonsters)));
+	monsterPlaceInMaze(pMaze, pMonster, 9, 10);
+	CHECK(monsterCountAt(pMaze, 9, 9) == 0 && monsterCountAt(pMaze, 9, 10) == 1);
+	monsterPlaceInMaze(pMaze, pMonster, 9, 9);
+	monsterKill(pMaze, pMonster);
+	CHECK(condHolds(pMaze, pNoMonsters, sizeof(pNoMonsters)));
+
+	const UBYTE pItems[] = {EVENT_GREATER, EVENT_ITEMS_ON_POS, 2, 3, 4};
+	groundItemAdd(&g_pGameState->m_groundItems, 2, 3, 0, 2);
+	CHECK(!condHolds(pMaze, pItems, sizeof(pItems)));
+	groundItemAdd(&g_pGameState->m_groundItems, 2, 3, 1, 3);
+	CHECK(condHolds(pMaze, pItems, sizeof(pItems)));
+
+	const UBYTE pCarried[] = {EVENT_EQUAL, EVENT_POINTER_ITEM, 1, 2};
+	inventoryAddItem(g_pGameState->m_pInventory, 1, 2);
+	CHECK(condHolds(pMaze, pCarried, sizeof(pCarried)));
+
+	const UBYTE pWall[] = {EVENT_EQUAL, EVENT_WALL_NUMBER, 4, 4, MAZE_WALL};
+	CHECK(!condHolds(pMaze, pWall, sizeof(pWall)));
+	pMaze->_mazeData[4 + 4 * 16] = MAZE_WALL;
+	CHECK(condHolds(pMaze, pWall, sizeof(pWall)));
+
+	/* A one-sided die always rolls 1 */
+	const UBYTE pDice[] = {EVENT_EQUAL, EVENT_ROLL_DICE, 1, 1, EVENT_AND,
+		EVENT_GREATER, EVENT_ROLL_DICE, 6, 6, EVENT_OR, EVENT_EQUAL, EVENT_PARTY_VISIBLE};
+	CHECK(condHolds(pMaze, pDice, sizeof(pDice)));
+
+	/* Malformed payloads never run their block */
+	const UBYTE pTrailing[] = {EVENT_EQUAL, EVENT_LEVEL_FLAG, 1, 1, 0};
+	const UBYTE pUnsupported[] = {EVENT_EQUAL, EVENT_TRIGGER_FLAG, 1};
+	const UBYTE pDangling[] = {EVENT_EQUAL, EVENT_LEVEL_FLAG, 1, 1, EVENT_OR};
+	CHECK(!condHolds(pMaze, pTrailing, sizeof(pTrailing)));
+	CHECK(!condHolds(pMaze, pUnsupported, sizeof(pUnsupported)));
+	CHECK(!condHolds(pMaze, pDangling, sizeof(pDangling)));
+
+	/* mazeLoad() compiles every IF up front */
+	pMaze = roundTrip(pMaze);
+	tMazeEvent *pIf = mazeEventAtOrdinal(pMaze, 0);
+	CHECK(pIf && pIf->_eventType == EVENT_IF && pIf->_condition != NULL);
+}
+
+static void testVerifier(void)
+{
+	tMaze *pMaze = beginCase("verifier", 4, 4);
+	const UBYTE pFarJump[] = {50};
+	const UBYTE pBadTable[] = {2, 5, 1};
+	const UBYTE pWall[] = {MAZE_WALL};
+	const UBYTE pBadCond[] = {EVENT_EQUAL, EVENT_TRIGGER_FLAG, 1};
+	const UBYTE pCond[] = {EVENT_EQUAL, EVENT_LEVEL_FLAG, 0, 0};
+	const UBYTE pFlag9[] = {0, 9, 1};
+	const UBYTE pFlag10[] = {0, 10, 1};
+	addEvent(pMaze, 0, 0, EVENT_SETWALL, 0, NULL);         /* 0: no payload */
+	addEvent(pMaze, 0, 0, EVENT_GOTO, 1, pFarJump);        /* 1: target past the end */
+	addEvent(pMaze, 1, 0, EVENT_ENDIF, 0, NULL);           /* 2: no IF */
+	addEvent(pMaze, 1, 1, EVENT_SETFLAG, 3, pBadTable);    /* 3: flag table 2 */
+	addEvent(pMaze, 9, 9, EVENT_SETWALL, 1, pWall);        /* 4: off the map */
+	addEvent(pMaze, 2, 2, EVENT_IF, 3, pBadCond);          /* 5: unsupported operand */
+	addEvent(pMaze, 2, 2, EVENT_ENDIF, 0, NULL);           /* 6 */
+	/* 7..17: IF nesting one deeper than the stack, 18..28: ENDIFs */
+	for (int i = 0; i <= SCRIPT_RETURN_STACK_SIZE; i++)
+		addEvent(pMaze, 3, 3, EVENT_IF, 4, pCond);
+	for (int i = 0; i <= SCRIPT_RETURN_STACK_SIZE; i++)
+		addEvent(pMaze, 3, 3, EVENT_ENDIF, 0, NULL);
+	UWORD uwStop = pMaze->_eventCount;
+	addEvent(pMaze, 3, 0, EVENT_SETFLAG, 3, pFlag9);
+	addEvent(pMaze, 3, 0, EVENT_SETFLOOR, 0, NULL);
+	addEvent(pMaze, 3, 0, EVENT_SETFLAG, 3, pFlag10);
+	CHECK(scriptVerifyMaze(pMaze) == 8);
+	pMaze = roundTrip(pMaze);
+
+	static const UWORD s_pBad[] = {0, 1, 2, 3, 4, 5, 7 + SCRIPT_RETURN_STACK_SIZE};
+	for (size_t i = 0; i < sizeof(s_pBad) / sizeof(s_pBad[0]); i++)
+		CHECK(mazeEventAtOrdinal(pMaze, s_pBad[i])->_flags & MAZE_EVENT_INVALID);
+	CHECK(mazeEventAtOrdinal(pMaze, uwStop + 1)->_flags & MAZE_EVENT_INVALID);
+	CHECK(!(mazeEventAtOrdinal(pMaze, 6)->_flags & MAZE_EVENT_INVALID));
+
+	/* A script stops at the first rejected event */
+	executeScript(pMaze, uwStop);
+	CHECK(g_pGameState->m_bLocalFlags[9] == 1);
+	CHECK(g_pGameState->m_bLocalFlags[10] == 0);
+
+	/* Editing the list re-runs the verifier on the next script start */
+	addEvent(pMaze, 0, 3, EVENT_SETFLAG, 3, pFlag10);
+	CHECK(!pMaze->_eventsVerified);
+	executeScript(pMaze, (UWORD)(pMaze->_eventCount - 1));
+	CHECK(pMaze->_eventsVerified);
+	CHECK(g_pGameState->m_bLocalFlags[10] == 1);
+
+	/* One-shot events for handleEvent() are checked too and never touch the list */
+	UWORD uwCount = pMaze->_eventCount;
+	tMazeEvent *pLoose = mazeEventCreate(0, 1, EVENT_SETWALL, 0, NULL);
+	handleEvent(pMaze, pLoose);
+	mazeRemoveEvent(pMaze, pLoose);
+	CHECK(pMaze->_eventCount == uwCount);
+	CHECK(pMaze->_eventsVerified);
+}
+
+/* GOSUB chains are bounded by the return stack; recursion is rejected and overflow stops the script */
+static void testGosubDepth(void)
+{
+	tMaze *pMaze = beginCase("gosub-depth", 16, 16);
+	const UBYTE pSelf[] = {0};
+	const UBYTE pCond[] = {EVENT_EQUAL, EVENT_LEVEL_FLAG, 0, 0};
+	const UBYTE pFlag20[] = {0, 20, 1};
+	const UBYTE pFlag21[] = {0, 21, 1};
+	const UBYTE pFlag22[] = {0, 22, 1};
+	addEvent(pMaze, 1, 1, EVENT_GOSUB, 1, pSelf);           /* 0: calls itself */
+	/* SIZE+1 links of GOSUB next + RETURN, one cell each, then a leaf */
+	for (UBYTE i = 1; i <= SCRIPT_RETURN_STACK_SIZE + 1; i++) {
+		const UBYTE pNext[] = {(UBYTE)(1 + 2 * i)};
+		addEvent(pMaze, i, 2, EVENT_GOSUB, 1, pNext);
+		addEvent(pMaze, i, 2, EVENT_RETURN, 0, NULL);
+	}
+	addEvent(pMaze, 0, 3, EVENT_SETFLAG, 3, pFlag22);
+	addEvent(pMaze, 0, 3, EVENT_RETURN, 0, NULL);
+	/* A subroutine later in its own cell is not recursion */
+	UBYTE ubLocal = (UBYTE)pMaze->_eventCount;
+	const UBYTE pSub[] = {(UBYTE)(ubLocal + 2)};
+	const UBYTE pOut[] = {(UBYTE)(ubLocal + 4)};
+	addEvent(pMaze, 4, 4, EVENT_GOSUB, 1, pSub);
+	addEvent(pMaze, 4, 4, EVENT_GOTO, 1, pOut);
+	addEvent(pMaze, 4, 4, EVENT_SETFLAG, 3, pFlag20);
+	addEvent(pMaze, 4, 4, EVENT_RETURN, 0, NULL);
+	addEvent(pMaze, 5, 5, EVENT_SETFLAG, 3, pFlag21);
+	/* An IF re-entered through GOTO, which the verifier does not follow */
+	UBYTE ubLoop = (UBYTE)pMaze->_eventCount;
+	const UBYTE pLoop[] = {ubLoop};
+	addEvent(pMaze, 6, 6, EVENT_IF, 4, pCond);
+	addEvent(pMaze, 6, 6, EVENT_GOTO, 1, pLoop);
+	pMaze = roundTrip(pMaze);
+
+	CHECK(mazeEventAtOrdinal(pMaze, 0)->_flags & MAZE_EVENT_INVALID);
+	CHECK(mazeEventAtOrdinal(pMaze, 1)->_flags & MAZE_EVENT_INVALID);
+	CHECK(!(mazeEventAtOrdinal(pMaze, 3)->_flags & MAZE_EVENT_INVALID));
+	CHECK(!(mazeEventAtOrdinal(pMaze, ubLocal)->_flags & MAZE_EVENT_INVALID));
+
+	/* From the second link the chain fits exactly and reaches the end */
+	executeScript(pMaze, 3);
+	CHECK(g_pGameState->m_bLocalFlags[22] == 1 && scriptActiveCount() == 0);
+	executeScript(pMaze, ubLocal);
+	CHECK(g_pGameState->m_bLocalFlags[20] == 1 && g_pGameState->m_bLocalFlags[21] == 1);
+	/* The eleventh IF frame errors out well inside the first slice */
+	executeScript(pMaze, ubLoop);
+	CHECK(scriptActiveCount() == 0);
+}
+
+static void testMazeArena(void)
+{
+	tMaze *pMaze = beginCase("maze-arena", 32, 32);
+	char szText[32];
+	for (int i = 0; i < 200; i++) {
+		UBYTE pData[10];
+		for (int j = 0; j < 10; j++)
+			pData[j] = (UBYTE)(i + j);
+		addEvent(pMaze, (UBYTE)(i % 32), (UBYTE)(i / 32), EVENT_SOUND, (UBYTE)(1 + i % 10), pData);
+	}
+	for (int i = 0; i < 50; i++) {
+		int iLen = snprintf(szText, sizeof(szText), "string number %d", i);
+		mazeAddString(pMaze, szText, (UWORD)iLen);
+	}
+	mazeSave(pMaze, s_szTmpPath);
+	mazeDelete(pMaze);
+
+	LONG lLiveBefore = g_sHostMem.lBytesLive;
+	ULONG ulAllocsBefore = g_sHostMem.ulAllocs;
+	pMaze = mazeLoad(s_szTmpPath);
+	CHECK(pMaze && pMaze->_eventCount == 200 && pMaze->_stringCount == 50);
+	/* maze struct + 4 grids + file image + string offsets + a handful of arena blocks, not one per event/string */
+	CHECK(g_sHostMem.ulAllocs - ulAllocsBefore < 16);
+	CHECK(pMaze->_arena.allocCount == 200);
+
+	tMazeEvent *pEvent = mazeEventAtOrdinal(pMaze, 123);
+	CHECK(pEvent->_eventDataSize == 1 + 123 % 10 && pEvent->_eventData[0] == 123);
+	CHECK((pEvent->_flags & MAZE_EVENT_IN_ARENA) != 0);
+	char szOut[32];
+	CHECK(mazeGetStringByIndex(pMaze, 49, szOut, sizeof(szOut)) && strcmp(szOut, "string number 49") == 0);
+	/* Strings are looked up in place in the file image */
+	UWORD uwLen = 0;
+	const char *pText = mazeGetString(pMaze, 7, &uwLen);
+	CHECK(pText && uwLen == 15 && memcmp(pText, "string number 7", 15) == 0);
+	CHECK((const UBYTE *)pText > pMaze->_image && (const UBYTE *)pText < pMaze->_image + pMaze->_imageSize);
+	CHECK(!mazeGetString(pMaze, 50, &uwLen));
+
+	/* Arena and heap events mix: removing either keeps the list and counts right */
+	const UBYTE pWall[] = {MAZE_WALL};
+	addEvent(pMaze, 0, 0, EVENT_SETWALL, 1, pWall);
+	mazeRemoveEvent(pMaze, pEvent);
+	mazeRemoveEvent(pMaze, mazeEventAtOrdinal(pMaze, 199));
+	CHECK(pMaze->_eventCount == 199);
+	/* Adding to a loaded maze copies the blob out of the image; older strings stay readable */
+	mazeAddString(pMaze, "heap", 4);
+	CHECK(pMaze->_stringCount == 51 && pMaze->_stringBlobCapacity != 0);
+	CHECK(mazeGetStringByIndex(pMaze, 50, szOut, sizeof(szOut)) && strcmp(szOut, "heap") == 0);
+	CHECK(mazeGetStringByIndex(pMaze, 7, szOut, sizeof(szOut)) && strcmp(szOut, "string number 7") == 0);
+	/* Cut to the buffer */
+	CHECK(mazeGetStringByIndex(pMaze, 7, szOut, 7) && strcmp(szOut, "string") == 0);
+	mazeSave(pMaze, s_szTmpPath);
+	mazeDelete(pMaze);
+	CHECK(g_sHostMem.lBytesLive == lLiveBefore);
+
+	pMaze = mazeLoad(s_szTmpPath);
+	CHECK(pMaze && pMaze->_stringCount == 51);
+	CHECK(pMaze && mazeGetStringByIndex(pMaze, 50, szOut, sizeof(szOut)) && strcmp(szOut, "heap") == 0);
+	mazeDelete(pMaze);
+}
+
+/* Writes a maze with the given event and string counts to s_szTmpPath. */
+static void writeStressMaze(int iEvents, int iStrings)
+{
+	tMaze *pMaze = mazeCreate(64, 64);
+	char szText[40];
+	for (int i = 0; i < iEvents; i++) {
+		UBYTE pData[12];
+		for (int j = 0; j < 12; j++)
+			pData[j] = (UBYTE)(i * 7 + j);
+		addEvent(pMaze, (UBYTE)(i % 64), (UBYTE)((i / 64) % 64), EVENT_SOUND, (UBYTE)(1 + i % 12), pData);
+	}
+	for (int i = 0; i < iStrings; i++) {
+		int iLen = snprintf(szText, sizeof(szText), "stress string %d", i);
+		mazeAddString(pMaze, szText, (UWORD)iLen);
+	}
+	mazeSave(pMaze, s_szTmpPath);
+	mazeDelete(pMaze);
+}
+
+/* Best of a few loads, in microseconds */
+static double timeMazeLoad(void)
+{
+	double dBest = 1e30;
+	for (int i = 0; i < 5; i++) {
+		double dStart = hostNowUs();
+		tMaze *pMaze = mazeLoad(s_szTmpPath);
+		double dTook = hostNowUs() - dStart;
+		mazeDelete(pMaze);
+		if (dTook < dBest)
+			dBest = dTook;
+	}
+	return dBest;
+}
+
+static void testMazeLoadStress(void)
+{
+	s_szCase = "maze-load-stress";
+	writeStressMaze(500, 50);
+	double dSmall = timeMazeLoad();
+	writeStressMaze(5000, 500);
+	double dLarge = timeMazeLoad();
+
+	hostStatsReset();
+	tMaze *pMaze = mazeLoad(s_szTmpPath);
+	CHECK(pMaze && pMaze->_eventCount == 5000 && pMaze->_stringCount == 500);
+	CHECK(g_sHostFile.ulOpens == 1 && g_sHostFile.ulReadCalls == 1);
+	CHECK(g_sHostMem.ulAllocs < 16);
+	tMazeEvent *pEvent = mazeEventAtOrdinal(pMaze, 4999);
+	CHECK(pEvent && pEvent->_eventDataSize == 1 + 4999 % 12 && pEvent->_eventData[0] == (UBYTE)(4999 * 7));
+	CHECK(pMaze->_lastEvent == pEvent && pEvent->_next == NULL);
+	char szOut[40];
+	CHECK(mazeGetStringByIndex(pMaze, 499, szOut, sizeof(szOut)) && strcmp(szOut, "stress string 499") == 0);
+	/* Appends after load go straight to the tail */
+	const UBYTE pWall[] = {MAZE_WALL};
+	addEvent(pMaze, 0, 0, EVENT_SETWALL, 1, pWall);
+	CHECK(mazeEventAtOrdinal(pMaze, 5000) == pMaze->_lastEvent && pMaze->_lastEvent->_prev == pEvent);
+	mazeDelete(pMaze);
+
+	/* 10x the data: linear is ~10x, the old tail walk was ~100x */
+	printf("maze load: 500 events %.0f us, 5000 events %.0f us\n", dSmall, dLarge);
+	CHECK(dLarge < dSmall * 40);
+}
+
+/* A profiled mazeLoad() nests its phases under the loader; an early pop closes what it left open */
+static void testLoadProfile(void)
+{
+	s_szCase = "load-profile";
+	writeStressMaze(500, 50);
+	static const char *pExpect[] = {"session", "mazeLoad", "open", "read", "build", "verify"};
+	static const UBYTE pDepth[] = {0, 1, 2, 2, 2, 2};
+	loadProfileBegin("session", NULL);
+	tMaze *pMaze = mazeLoad(s_szTmpPath);
+	UBYTE ubOuter = loadProfilePush("outer", NULL);
+	loadProfilePush("left-open", NULL);
+	loadProfilePop(ubOuter);
+	UBYTE ubAfter = loadProfilePush("after", NULL);
+	loadProfilePop(ubAfter);
+	loadProfileEnd(NULL);
+	CHECK(pMaze != NULL);
+	mazeDelete(pMaze);
+
+	CHECK(loadProfileMarkCount() == 9);
+	const char *szLabel;
+	UBYTE ubDepth;
+	ULONG ulElapsed, ulSession = 0, ulChildren = 0;
+	for (UBYTE i = 0; i < 6; i++) {
+		CHECK(loadProfileMarkGet(i, &szLabel, &ubDepth, &ulElapsed));
+		CHECK(strcmp(szLabel, pExpect[i]) == 0 && ubDepth == pDepth[i]);
+		if (i == 0)
+			ulSession = ulElapsed;
+		else if (i == 1)
+			ulChildren = ulElapsed;
+	}
+	CHECK(ulChildren <= ulSession);
+	/* "after" went back to depth 1 once "outer" closed "left-open" */
+	CHECK(loadProfileMarkGet(8, &szLabel, &ubDepth, &ulElapsed) && strcmp(szLabel, "after") == 0 && ubDepth == 1);
+	CHECK(!loadProfileMarkGet(9, &szLabel, &ubDepth, &ulElapsed));
+	/* Outside a session markers record nothing */
+	CHECK(loadProfilePush("stray", NULL) == 0xFF && loadProfileMarkCount() == 9);
+}
+
+/* Buffered file reads across refills, direct large reads and skips match the bytes on disk */
+static void testBinReader(void)
+{
+	s_szCase = "bin-reader";
+	enum { SIZE = BIN_READER_BUFFER_SIZE * 3 + 123 };
+	static UBYTE s_pData[SIZE], s_pBig[BIN_READER_BUFFER_SIZE + 7];
+	for (int i = 0; i < SIZE; i++)
+		s_pData[i] = (UBYTE)(i * 31 + (i >> 8));
+	FILE *pFile = fopen(s_szTmpPath, "wb");
+	fwrite(s_pData, 1, SIZE, pFile);
+	fclose(pFile);
+
+	tBinReader sReader;
+	hostStatsReset();
+	CHECK(binReaderOpen(&sReader, s_szTmpPath));
+	ULONG ulAt = 0;
+	int iSame = 1;
+	/* Byte and word fields up to just before the first buffer boundary... */
+	for (; ulAt + 2 <= BIN_READER_BUFFER_SIZE - 1; ulAt += 2)
+		iSame &= binReadU16Be(&sReader) == (UWORD)(s_pData[ulAt] << 8 | s_pData[ulAt + 1]);
+	/* ...a field straddling it, an in-place run that needs a refill, a skip */
+	iSame &= binReadU32Be(&sReader) == ((ULONG)s_pData[ulAt] << 24 | (ULONG)s_pData[ulAt + 1] << 16
+		| (ULONG)s_pData[ulAt + 2] << 8 | s_pData[ulAt + 3]);
+	ulAt += 4;
+	const UBYTE *pRun = binReadInPlace(&sReader, 4000);
+	iSame &= pRun && memcmp(pRun, s_pData + ulAt, 4000) == 0;
+	ulAt += 4000;
+	binSkip(&sReader, 10);
+	ulAt += 10;
+	/* A read bigger than the buffer goes straight to the destination */
+	iSame &= binRead(&sReader, s_pBig, sizeof(s_pBig)) == sizeof(s_pBig)
+		&& memcmp(s_pBig, s_pData + ulAt, sizeof(s_pBig)) == 0;
+	ulAt += sizeof(s_pBig);
+	binSkip(&sReader, SIZE - ulAt - 1);
+	iSame &= binReadU8(&sReader) == s_pData[SIZE - 1];
+	CHECK(iSame && !sReader.isOverrun);
+	CHECK(binReadU8(&sReader) == 0 && sReader.isOverrun);
+	binReaderClose(&sReader);
+	CHECK(g_sHostFile.ulOpens == 1 && g_sHostFile.ulReadCalls <= 6);
+	CHECK(!binReaderOpen(&sReader, "/nonexistent/file.dat"));
+}
+
+static void writeBytes(const char *szPath, const UBYTE *pData, size_t ulSize)
+{
+	FILE *pFile = fopen(szPath, "wb");
+	fwrite(pData, 1, ulSize, pFile);
+	fclose(pFile);
+}
+
+/* Interleaved .pln/.msk files load into interleaved bitmaps; unknown header versions are refused */
+static void testWallsetBitmaps(void)
+{
+	s_szCase = "wallset-bitmaps";
+	char szWall[540], szPln[540], szMsk[540];
+	snprintf(szWall, sizeof(szWall), "%s.wll", s_szTmpPath);
+	snprintf(szPln, sizeof(szPln), "%s_0.pln", s_szTmpPath);
+	snprintf(szMsk, sizeof(szMsk), "%s_0.msk", s_szTmpPath);
+	/* No palette, one tile in one bitmap pair */
+	const UBYTE pWll[8 + 16] = {0, 0, 0, 0, 0, 1, 1, 1};
+	writeBytes(szWall, pWll, sizeof(pWll));
+
+	/* Word-aligned rows: the file is the bitmap's buffer as is */
+	tBitMap *pSrc = bitmapCreate(16, 4, 3, BMF_INTERLEAVED);
+	for (UBYTE p = 0; p < 3; p++)
+		for (UWORD y = 0; y < 4; y++)
+			pSrc->Planes[p][y * pSrc->BytesPerRow] = (UBYTE)(p * 16 + y);
+	bitmapSave(pSrc, szPln);
+	bitmapDestroy(pSrc);
+	const UBYTE pMskNewer[] = {0, 16, 0, 1, 1, 1, 0, 0, 0xFF, 0xFF};
+	writeBytes(szMsk, pMskNewer, sizeof(pMskNewer));
+	hostStatsReset();
+	tWallset *pSet = wallsetLoad(szWall);
+	CHECK(pSet && pSet->_gfx[0] && bitmapIsInterleaved(pSet->_gfx[0]) && pSet->_gfx[0]->BytesPerRow == 6);
+	CHECK(pSet && pSet->_gfx[0] && pSet->_gfx[0]->Planes[2][3 * 6] == 2 * 16 + 3);
+	CHECK(pSet && !pSet->_mask[0]);
+	CHECK(g_sHostFile.ulReadCalls <= 4);
+	wallsetDestroy(pSet);
+
+	/* Byte-packed rows (20 px: 3 file bytes, 4 bitmap bytes) go in row by row */
+	UBYTE pPln[8 + 2 * 2 * 3] = {0, 20, 0, 2, 2, 0, 1, 0};
+	for (int y = 0; y < 2; y++)
+		for (int p = 0; p < 2; p++)
+			for (int x = 0; x < 3; x++)
+				pPln[8 + (y * 2 + p) * 3 + x] = (UBYTE)(y * 10 + p * 3 + x + 1);
+	writeBytes(szPln, pPln, sizeof(pPln));
+	const UBYTE pMsk[] = {0, 16, 0, 1, 1, 0, 1, 0, 0xF0, 0x0F};
+	writeBytes(szMsk, pMsk, sizeof(pMsk));
+	pSet = wallsetLoad(szWall);
+	tBitMap *pGfx = pSet ? pSet->_gfx[0] : NULL;
+	CHECK(pGfx && bitmapIsInterleaved(pGfx) && bitmapGetByteWidth(pGfx) == 4);
+	CHECK(pGfx && pGfx->Planes[1][pGfx->BytesPerRow + 2] == 16 && pGfx->Planes[1][pGfx->BytesPerRow + 3] == 0);
+	CHECK(pSet && pSet->_mask[0] && pSet->_mask[0]->Planes[0][1] == 0x0F);
+	wallsetDestroy(pSet);
+
+	/* A newer .pln is refused too, not read as pixels */
+	pPln[5] = 1;
+	writeBytes(szPln, pPln, sizeof(pPln));
+	pSet = wallsetLoad(szWall);
+	CHECK(pSet && !pSet->_gfx[0] && pSet->_mask[0]);
+	wallsetDestroy(pSet);
+	unlink(szWall);
+	unlink(szPln);
+	unlink(szMsk);
+}
+
+/* Shared handles, idle reuse without touching the disk, LRU eviction by budget and by free memory */
+static void testAssetCache(void)
+{
+	s_szCase = "asset-cache";
+	enum { SHEETS = 4 };
+	char pPaths[SHEETS][540];
+	for (int i = 0; i < SHEETS; i++) {
+		/* 320x256x5: ~50 KB each, so four idle sheets overrun ASSET_CACHE_IDLE_BUDGET */
+		tBitMap *pSheet = bitmapCreate(320, 256, 5, 0);
+		pSheet->Planes[0][0] = (UBYTE)(i + 1);
+		snprintf(pPaths[i], sizeof(pPaths[i]), "%s.%d.bm", s_szTmpPath, i);
+		bitmapSave(pSheet, pPaths[i]);
+		bitmapDestroy(pSheet);
+	}
+	tAssetCacheStats sStats;
+	hostStatsReset();
+	tBitMap *pA = assetBitmapGet(pPaths[0], 0);
+	tBitMap *pB = assetBitmapGet(pPaths[0], 0);
+	CHECK(pA && pA == pB && pA->Planes[0][0] == 1);
+	CHECK(g_sHostFile.ulOpens == 1);
+	assetBitmapRelease(pA);
+	assetBitmapRelease(pB);
+	assetCacheGetStats(&sStats);
+	CHECK(sStats.ulIdleBytes == 40UL * 256 * 5);
+	/* Idle: the next get is a hit, no file opened */
+	hostStatsReset();
+	pA = assetBitmapGet(pPaths[0], 0);
+	CHECK(pA == pB && g_sHostFile.ulOpens == 0);
+	assetBitmapRelease(pA);
+
+	/* Over the idle budget the least recently used sheet (0) goes first */
+	for (int i = 1; i < SHEETS; i++)
+		assetBitmapRelease(assetBitmapGet(pPaths[i], 0));
+	assetCacheGetStats(&sStats);
+	CHECK(sStats.ulIdleBytes <= ASSET_CACHE_IDLE_BUDGET);
+	/* They are chip bitmaps, so the tighter chip budget drops sheet 1 too */
+	CHECK(sStats.ulIdleChipBytes == sStats.ulIdleBytes && sStats.ulIdleChipBytes <= ASSET_CACHE_IDLE_CHIP_BUDGET);
+	CHECK(sStats.ulEvictions == 2);
+	hostStatsReset();
+	assetBitmapRelease(assetBitmapGet(pPaths[SHEETS - 1], 0));
+	CHECK(g_sHostFile.ulOpens == 0);
+	assetBitmapRelease(assetBitmapGet(pPaths[0], 0));
+	CHECK(g_sHostFile.ulOpens == 1);
+
+	/* Short of chip: a fast bitmap's miss leaves chip assets alone, a chip one's does not */
+	assetCacheFlush();
+	assetBitmapRelease(assetBitmapGet(pPaths[0], 0));
+	g_ulHostFreeChipSize = ASSET_CACHE_CHIP_RESERVE - 1;
+	assetBitmapRelease(assetBitmapGet(pPaths[1], 1));
+	assetCacheGetStats(&sStats);
+	CHECK(sStats.ubEntries == 2 && sStats.ulIdleChipBytes == 40UL * 256 * 5);
+	assetBitmapRelease(assetBitmapGet(pPaths[2], 0));
+	assetCacheGetStats(&sStats);
+	CHECK(sStats.ubEntries == 2 && sStats.ulIdleChipBytes == 40UL * 256 * 5);
+	CHECK(sStats.ulIdleBytes == 2 * 40UL * 256 * 5);
+	/* A large chip allocation coming: idle chip assets go, the fast one stays */
+	assetCacheTrimChip(100UL * 1024);
+	g_ulHostFreeChipSize = 0x7FFFFFFF;
+	assetCacheGetStats(&sStats);
+	CHECK(sStats.ubEntries == 1 && sStats.ulIdleChipBytes == 0 && sStats.ulIdleBytes == 40UL * 256 * 5);
+	hostStatsReset();
+	assetBitmapRelease(assetBitmapGet(pPaths[1], 1));
+	CHECK(g_sHostFile.ulOpens == 0);
+
+	/* Short of memory: a miss drops idle assets before it loads; referenced ones stay */
+	pA = assetBitmapGet(pPaths[1], 0);
+	g_ulHostFreeSize = ASSET_CACHE_RESERVE - 1;
+	pB = assetBitmapGet(pPaths[1], 1); /* isFast is part of the key: a miss */
+	g_ulHostFreeSize = 0x7FFFFFFF;
+	assetCacheGetStats(&sStats);
+	CHECK(pA && pB && sStats.ulIdleBytes == 0 && sStats.ubEntries == 2);
+	assetBitmapRelease(pA);
+	assetBitmapRelease(pB);
+
+	/* Palettes are copied out of one cached read */
+	FILE *pFile = fopen(s_szTmpPath, "wb");
+	const UBYTE pPlt[] = {3, 0x0F, 0x00, 0x00, 0xF0, 0x00, 0x0F};
+	fwrite(pPlt, 1, sizeof(pPlt), pFile);
+	fclose(pFile);
+	UWORD pPalette[4] = {0xAAAA, 0xAAAA, 0xAAAA, 0xAAAA};
+	hostStatsReset();
+	CHECK(assetPaletteLoad(s_szTmpPath, pPalette, 2) && pPalette[0] == 0xF00 && pPalette[1] == 0x0F0);
+	CHECK(pPalette[2] == 0xAAAA);
+	CHECK(assetPaletteLoad(s_szTmpPath, pPalette, 4) && pPalette[2] == 0x00F && pPalette[3] == 0);
+	CHECK(g_sHostFile.ulOpens == 1);
+	CHECK(!assetPaletteLoad("/nonexistent/file.plt", pPalette, 4));
+
+	assetCacheFlush();
+	assetCacheGetStats(&sStats);
+	CHECK(sStats.ubEntries == 0 && sStats.ulIdleBytes == 0);
+	for (int i = 0; i < SHEETS; i++)
+		unlink(pPaths[i]);
+}
+
+/* A classic maze copied into chunks: every cell reads back, packed or resident */
+static void testMazeChunked(void)
+{
+	tMaze *pMaze = beginCase("maze chunked", 120, 40);
+	for (UWORD i = 0; i < 120 * 40; i++) {
+		pMaze->_mazeData[i] = (UBYTE)(i % 7 == 0 ? MAZE_WALL : i % 11 == 0 ? MAZE_DOOR : MAZE_FLOOR);
+		pMaze->_mazeCol[i] = (UBYTE)(i / 120 % 3);
+		pMaze->_mazeFloor[i] = (UBYTE)(i < 2400 ? 1 : i % 40);
+	}
+	LONG lLive = g_sHostMem.lBytesLive;
+	tMazeChunked *pChunked = mazeChunkedFromMaze(pMaze, 0);
+	CHECK(pChunked && pChunked->uwChunksX == 8 && pChunked->uwChunksY == 3);
+	if (!pChunked) {
+		mazeDelete(pMaze);
+		return;
+	}
+	/* Pack everything the loader left dirty, then read through the packed chunks */
+	mazeChunkedIdle(pChunked, 255);
+	UBYTE isSame = 1;
+	for (UBYTE y = 0; y < 40; y++) {
+		for (UBYTE x = 0; x < 120; x++) {
+			UWORD i = (UWORD)(x + y * 120);
+			isSame &= mazeChunkedGetCell(pChunked, x, y) == pMaze->_mazeData[i]
+				&& mazeChunkedGet(pChunked, x, y, MAZE_LAYER_COL) == pMaze->_mazeCol[i]
+				&& mazeChunkedGet(pChunked, x, y, MAZE_LAYER_FLOOR) == pMaze->_mazeFloor[i];
+		}
+	}
+	CHECK(isSame);
+	CHECK(mazeChunkedGetCell(pChunked, 120, 0) == MAZE_WALL && mazeChunkedGetCell(pChunked, 0, 0xFFFF) == MAZE_WALL);
+	CHECK(mazeChunkedGet(pChunked, 121, 0, MAZE_LAYER_FLOOR) == 0);
+
+	/* A write far from the focus survives being packed and evicted */
+	mazeChunkedFocus(pChunked, 0, 0);
+	mazeChunkedSet(pChunked, 119, 39, MAZE_LAYER_FLOOR, 200);
+	CHECK(pChunked->pChunks[23].isDirty && !pChunked->pChunks[23].isPinned);
+	CHECK(mazeChunkedIdle(pChunked, 255) == 1 && !pChunked->pChunks[23].isDirty);
+	CHECK(mazeChunkedGet(pChunked, 119, 39, MAZE_LAYER_FLOOR) == 200);
+	CHECK(mazeChunkedGet(pChunked, 118, 39, MAZE_LAYER_FLOOR) == pMaze->_mazeFloor[118 + 39 * 120]);
+	mazeChunkedDestroy(pChunked);
+	CHECK(g_sHostMem.lBytesLive == lLive);
+	mazeDelete(pMaze);
+	CHECK(!mazeChunkedCreate(MAZE_CHUNKED_MAX_SIZE + 1, 16, 0, MAZE_WALL, 0, 0));
+}
+
+/* One monster move: cooldown spent, state forced */
+static void monsterStep(tMaze *pMaze, tMonster *pMonster, UBYTE ubState)
+{
+	pMonster->_state = ubState;
+	pMonster->_moveCooldown = 1;
+	monsterUpdate(pMonster, pMaze, g_pGameState->m_pCurrentParty, g_pGameState->m_pMonsterList);
+}
+
+/* A wall with a gap at the bottom between party and monster */
+static void testPartyField(void)
+{
+	tMaze *pMaze = beginCase("party field", 10, 6);
+	for (UBYTE y = 0; y < 5; y++)
+		pMaze->_mazeData[4 + y * 10] = MAZE_WALL;
+	hostGameSetMaze(pMaze);
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	pParty->_PartyX = 2;
+	pParty->_PartyY = 0;
+	partyFieldUpdate(pMaze, 2, 0);
+	CHECK(partyFieldAt(2, 0) == 0 && partyFieldAt(3, 0) == 1 && partyFieldAt(4, 0) == PARTY_FIELD_FAR);
+	CHECK(partyFieldAt(4, 5) == 7 && partyFieldAt(5, 0) == 13 && partyFieldAt(6, 0) == 14);
+	CHECK(partyFieldAt(200, 200) == PARTY_FIELD_FAR);
+
+	/* Straight-line greedy would push into the wall; the field goes round */
+	tMonster *pMonster = monsterCreate(MONSTER_TYPE_NORMAL);
+	monsterListAppend(g_pGameState->m_pMonsterList, pMonster);
+	monsterPlaceInMaze(pMaze, pMonster, 5, 0);
+	pMonster->_aggroRange = 30;
+	pMonster->_fleeThreshold = 0;
+	UBYTE ubMoves = 0;
+	while (ubMoves < 20 && (pMonster->_partyPosX != 2 || pMonster->_partyPosY != 0)) {
+		monsterStep(pMaze, pMonster, MONSTER_STATE_AGGRESSIVE);
+		ubMoves++;
+	}
+	CHECK(ubMoves == 13 && monsterCountAt(pMaze, 2, 0) == 1);
+	CHECK(partyFieldRebuilds() == 1);
+
+	/* Fleeing climbs the field */
+	monsterPlaceInMaze(pMaze, pMonster, 3, 1);
+	monsterStep(pMaze, pMonster, MONSTER_STATE_FLEEING);
+	CHECK(pMonster->_partyPosX == 3 && pMonster->_partyPosY == 2);
+
+	/* A door shut across the gap cuts the far side off; a change out of reach does not rebuild */
+	mazeSetCell(pMaze, 4, 5, MAZE_DOOR);
+	partyFieldUpdate(pMaze, 2, 0);
+	CHECK(partyFieldRebuilds() == 2 && partyFieldAt(5, 0) == PARTY_FIELD_FAR);
+	mazeSetCell(pMaze, 8, 2, MAZE_WALL);
+	partyFieldUpdate(pMaze, 2, 0);
+	CHECK(partyFieldRebuilds() == 2);
+	monsterPlaceInMaze(pMaze, pMonster, 5, 1);
+	monsterStep(pMaze, pMonster, MONSTER_STATE_AGGRESSIVE);
+	CHECK(pMonster->_partyPosX != 4);
+	pParty->_PartyY = 1;
+	partyFieldUpdate(pMaze, 2, 1);
+	CHECK(partyFieldRebuilds() == 3 && partyFieldAt(2, 0) == 1);
+}
+
+/* The combat step gameGsLoop() and balance_sim share: only an aggressive monster on the party's cell fights */
+static void testCombatRound(void)
+{
+	tMaze *pMaze = beginCase("combat round", 8, 8);
+	hostGameSetMaze(pMaze);
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	tInventory *pInventory = g_pGameState->m_pInventory;
+	pParty->_PartyX = 3;
+	pParty->_PartyY = 3;
+	tCharacter *pHero = pParty->_characters[0];
+	pHero->_HP = 500;
+	pHero->_Attack = 10;
+	tMonster *pMonster = monsterCreate(MONSTER_TYPE_NORMAL);
+	monsterListAppend(g_pGameState->m_pMonsterList, pMonster);
+	monsterPlaceInMaze(pMaze, pMonster, 4, 3);
+	pMonster->_state = MONSTER_STATE_AGGRESSIVE;
+	pMonster->_base._HP = 200;
+	CHECK(monsterCombatRound(pMonster, pMaze, pParty, pInventory) == MONSTER_COMBAT_NONE && pHero->_HP == 500);
+	monsterPlaceInMaze(pMaze, pMonster, 3, 3);
+	pMonster->_state = MONSTER_STATE_IDLE;
+	CHECK(monsterCombatRound(pMonster, pMaze, pParty, pInventory) == MONSTER_COMBAT_NONE);
+
+	pMonster->_state = MONSTER_STATE_AGGRESSIVE;
+	CHECK(monsterCombatRound(pMonster, pMaze, pParty, pInventory) == MONSTER_COMBAT_ROUND);
+	CHECK(pHero->_HP < 500 && pMonster->_base._HP < 200);
+
+	/* The killing blow: off its cell, and every party member gets the experience */
+	UWORD pExperience[4] = {0};
+	for (UBYTE j = 0; j < pParty->_numCharacters && j < 4; j++)
+		pExperience[j] = pParty->_characters[j]->_Experience;
+	pMonster->_base._HP = 1;
+	CHECK(monsterCombatRound(pMonster, pMaze, pParty, pInventory) == MONSTER_COMBAT_KILL);
+	CHECK(pMonster->_state == MONSTER_STATE_DEAD && monsterCountAt(pMaze, 3, 3) == 0);
+	for (UBYTE j = 0; j < pParty->_numCharacters && j < 4; j++)
+		CHECK(pParty->_characters[j]->_Experience == pExperience[j] + monsterCold(pMonster)->_experienceValue);
+	CHECK(monsterCombatRound(pMonster, pMaze, pParty, pInventory) == MONSTER_COMBAT_NONE);
+}
+
+/* A shut door in a wall between party and monster: in aggro range but out of sight */
+static void testSight(void)
+{
+	tMaze *pMaze = beginCase("line of sight", 24, 5);
+	for (UBYTE y = 0; y < 5; y++)
+		pMaze->_mazeData[5 + y * 24] = MAZE_WALL;
+	pMaze->_mazeData[5 + 2 * 24] = MAZE_DOOR;
+	hostGameSetMaze(pMaze);
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	pParty->_PartyX = 1;
+	pParty->_PartyY = 2;
+	CHECK(mazeLineOfSight(pMaze, 1, 2, 4, 0) && !mazeLineOfSight(pMaze, 1, 2, 8, 2));
+	CHECK(mazeLineOfSight(pMaze, 8, 2, 8, 2) && !mazeLineOfSight(pMaze, 1, 2, 80, 2));
+	/* Diagonal between two solid corners */
+	pMaze->_mazeData[2 + 1 * 24] = MAZE_WALL;
+	pMaze->_mazeData[1 + 0 * 24] = MAZE_WALL;
+	CHECK(!mazeLineOfSight(pMaze, 1, 1, 2, 0));
+	pMaze->_mazeData[1 + 0 * 24] = MAZE_FLOOR;
+	CHECK(mazeLineOfSight(pMaze, 1, 1, 2, 0));
+
+	tMonster *pMonster = monsterCreate(MONSTER_TYPE_NORMAL);
+	monsterListAppend(g_pGameState->m_pMonsterList, pMonster);
+	monsterPlaceInMaze(pMaze, pMonster, 8, 2);
+	pMonster->_aggroRange = 10;
+	monsterStep(pMaze, pMonster, MONSTER_STATE_IDLE);
+	CHECK(pMonster->_state == MONSTER_STATE_IDLE && pMonster->_partyPosX == 8);
+	ULONG ulTraces = partyFieldSightTraces();
+	CHECK(!partyFieldSees(pMaze, 1, 2, 8, 2) && partyFieldSightTraces() == ulTraces);
+
+	/* Opening the door clears the cache; the next update sees the party */
+	mazeSetCell(pMaze, 5, 2, MAZE_DOOR_OPEN);
+	pMonster->_moveCooldown = 5;
+	monsterUpdate(pMonster, pMaze, pParty, g_pGameState->m_pMonsterList);
+	CHECK(pMonster->_state == MONSTER_STATE_AGGRESSIVE);
+	ulTraces = partyFieldSightTraces();
+	CHECK(partyFieldSees(pMaze, 1, 2, 8, 2) && partyFieldSightTraces() == ulTraces);
+	/* Far cells are traced on every call */
+	CHECK(partyFieldSees(pMaze, 1, 2, 20, 2) && partyFieldSightTraces() == ulTraces + 1);
+}
+
+/* Records come from the fixed pool; a destroyed one is the next handed out, cold half cleared */
+static void testMonsterPool(void)
+{
+	s_szCase = "monster pool";
+	hostGameReset();
+	UBYTE ubUsed = monsterPoolUsed();
+	tMonster *pTaken[MONSTER_POOL_SIZE];
+	UBYTE ubTaken = 0;
+	while (ubTaken < MONSTER_POOL_SIZE && (pTaken[ubTaken] = monsterCreate(MONSTER_TYPE_BOSS)) != NULL)
+		ubTaken++;
+	CHECK(ubTaken == MONSTER_POOL_SIZE - ubUsed && monsterPoolUsed() == MONSTER_POOL_SIZE);
+	CHECK(monsterCreate(MONSTER_TYPE_NORMAL) == NULL);
+	CHECK(monsterCold(pTaken[0])->_experienceValue != 0);
+	monsterCold(pTaken[1])->_dropTable[0] = 7;
+	tMonster *pFreed = pTaken[1];
+	monsterDestroy(pFreed);
+	/* Destroying it again must not chain it twice */
+	monsterDestroy(pFreed);
+	CHECK(monsterPoolUsed() == MONSTER_POOL_SIZE - 1);
+	tMonster *pReused = monsterCreate(MONSTER_TYPE_NORMAL);
+	CHECK(pReused == pFreed && monsterCold(pReused)->_dropTable[0] == 0);
+	CHECK(pReused->_monsterType == MONSTER_TYPE_NORMAL && pReused->_inMaze == 0);
+	CHECK(monsterCreate(MONSTER_TYPE_NORMAL) == NULL);
+	pTaken[1] = pReused;
+	for (UBYTE i = 0; i < ubTaken; i++)
+		monsterDestroy(pTaken[i]);
+	CHECK(monsterPoolUsed() == ubUsed);
+
+	/* Killed and removed, a monster frees its slot: respawning never fills the list */
+	tMonsterList *pList = g_pGameState->m_pMonsterList;
+	UWORD uwSpawned = 0;
+	for (UWORD i = 0; i < 3 * MAX_MONSTERS; i++) {
+		tMonster *pMonster = monsterCreate(MONSTER_TYPE_NORMAL);
+		if (!pMonster || !monsterListAppend(pList, pMonster))
+			break;
+		uwSpawned++;
+		monsterKill(NULL, pMonster);
+		monsterListRemove(pList, NULL, (UBYTE)(pList->_numMonsters - 1));
+	}
+	CHECK(uwSpawned == 3 * MAX_MONSTERS && pList->_numMonsters == 0 && monsterPoolUsed() == ubUsed);
+}
+
+/* Budget 3: two chasers by the party every frame, three far ones in turn, one idle one parked */
+static void testMonsterSchedule(void)
+{
+	tMaze *pMaze = beginCase("monster schedule", 40, 4);
+	hostGameSetMaze(pMaze);
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	tMonsterList *pList = g_pGameState->m_pMonsterList;
+	pParty->_PartyX = 0;
+	pParty->_PartyY = 0;
+	static const UBYTE s_pX[6] = {3, 4, 30, 32, 34, 38};
+	for (UBYTE i = 0; i < 6; i++) {
+		tMonster *pMonster = monsterCreate(MONSTER_TYPE_NORMAL);
+		monsterListAppend(pList, pMonster);
+		monsterPlaceInMaze(pMaze, pMonster, s_pX[i], 2);
+		pMonster->_state = i < 5 ? MONSTER_STATE_AGGRESSIVE : MONSTER_STATE_IDLE;
+		pMonster->_aggroRange = i < 5 ? 255 : 3;
+		pMonster->_fleeThreshold = 0;
+		pMonster->_moveCooldown = 3;
+	}
+	monsterAiSetBudget(3);
+	monsterAiStatsReset();
+	UBYTE pUpdated[MAX_MONSTERS];
+	UBYTE ubFarRuns[3] = {0, 0, 0};
+	UBYTE isOrdered = 1;
+	for (UBYTE f = 0; f < 6; f++) {
+		UBYTE ubCount = monsterListUpdate(pList, pMaze, pParty, pUpdated);
+		if (ubCount != 3 || pUpdated[0] != 0 || pUpdated[1] != 1 || pUpdated[2] != 2 + f % 3)
+			isOrdered = 0;
+		if (ubCount == 3 && pUpdated[2] >= 2 && pUpdated[2] < 5)
+			ubFarRuns[pUpdated[2] - 2]++;
+		/* The third far chaser owes three frames on its first turn and moves at once */
+		if (f == 1)
+			CHECK(pList->_monsters[4]->_partyPosX == 34);
+		if (f == 2)
+			CHECK(pList->_monsters[4]->_partyPosX == 33);
+	}
+	CHECK(isOrdered);
+	CHECK(ubFarRuns[0] == 2 && ubFarRuns[1] == 2 && ubFarRuns[2] == 2);
+	CHECK(pList->_monsters[5]->_partyPosX == 38 && pList->_monsters[5]->_state == MONSTER_STATE_IDLE);
+	const tMonsterAiStats *pStats = monsterAiStatsGet();
+	CHECK(pStats->ulFrames == 6 && pStats->ulUpdates == 18 && pStats->ulParked == 6);
+
+	/* The party walks up: the idle one wakes into the rotation */
+	pParty->_PartyX = 36;
+	pParty->_PartyY = 2;
+	monsterAiSetBudget(MAX_MONSTERS);
+	CHECK(monsterListUpdate(pList, pMaze, pParty, pUpdated) == 6);
+	CHECK(pList->_monsters[5]->_state == MONSTER_STATE_AGGRESSIVE);
+	monsterAiSetBudget(MONSTER_AI_DEFAULT_BUDGET);
+}
+
+/* Three rooms behind two doors, the outer two cut by block edges; only the party's side runs */
+static void testZones(void)
+{
+	tMaze *pMaze = beginCase("activity zones", 40, 5);
+	for (UBYTE y = 0; y < 5; y++) {
+		pMaze->_mazeData[10 + y * 40] = MAZE_WALL;
+		pMaze->_mazeData[25 + y * 40] = MAZE_WALL;
+	}
+	pMaze->_mazeData[10 + 2 * 40] = MAZE_DOOR;
+	pMaze->_mazeData[25 + 2 * 40] = MAZE_DOOR_LOCKED;
+	hostGameSetMaze(pMaze);
+	CHECK(mazeZoneIsActive(pMaze, 35, 2));
+	CHECK(mazeZonesBuild(pMaze));
+	tMazeZones *pZones = pMaze->_zones;
+	CHECK(pZones->ubCount == 5 && pZones->uwLinkCount == 4);
+	CHECK(mazeZoneAt(pMaze, 0, 0) == 0 && mazeZoneAt(pMaze, 15, 4) == 1 && mazeZoneAt(pMaze, 16, 0) == 2);
+	CHECK(mazeZoneAt(pMaze, 26, 1) == 3 && mazeZoneAt(pMaze, 39, 4) == 4);
+	CHECK(mazeZoneAt(pMaze, 10, 2) == 1 && mazeZoneAt(pMaze, 10, 1) == MAZE_ZONE_NONE);
+
+	tCharacterParty *pParty = g_pGameState->m_pCurrentParty;
+	tMonsterList *pList = g_pGameState->m_pMonsterList;
+	pParty->_PartyX = 2;
+	pParty->_PartyY = 2;
+	static const UBYTE s_pX[3] = {14, 20, 35};
+	for (UBYTE i = 0; i < 3; i++) {
+		tMonster *pMonster = monsterCreate(MONSTER_TYPE_NORMAL);
+		monsterListAppend(pList, pMonster);
+		monsterPlaceInMaze(pMaze, pMonster, s_pX[i], 2);
+		pMonster->_state = MONSTER_STATE_AGGRESSIVE;
+		pMonster->_aggroRange = 255;
+		pMonster->_fleeThreshold = 0;
+		pMonster->_moveCooldown = 3;
+	}
+	monsterAiSetBudget(MAX_MONSTERS);
+	monsterAiStatsReset();
+	UBYTE pUpdated[MAX_MONSTERS];
+	UBYTE isFrozen = 1;
+	for (UBYTE f = 0; f < 3; f++)
+		if (monsterListUpdate(pList, pMaze, pParty, pUpdated) != 1 || pUpdated[0] != 0)
+			isFrozen = 0;
+	CHECK(isFrozen && monsterAiStatsGet()->ulFrozen == 6);
+	CHECK(pZones->pActive[0] && pZones->pActive[1] && !pZones->pActive[2] && !pZones->pActive[4]);
+	CHECK(pList->_monsters[1]->_partyPosX == 20 && pList->_monsters[2]->_partyPosX == 35);
+
+	/* Into the middle room: its neighbour wakes and catches up the frames it owed */
+	pParty->_PartyX = 18;
+	CHECK(monsterListUpdate(pList, pMaze, pParty, pUpdated) == 2);
+	CHECK(pZones->ubPartyZone == 2 && pZones->pActive[3] && !pZones->pActive[4]);
+	CHECK(pList->_monsters[1]->_partyPosX == 19 && pList->_monsters[2]->_partyPosX == 35);
+
+	/* A wall opened since the build has no zone and is always simulated */
+	mazeSetCell(pMaze, 10, 0, MAZE_FLOOR);
+	CHECK(mazeZoneAt(pMaze, 10, 0) == MAZE_ZONE_NONE && mazeZoneIsActive(pMaze, 10, 0));
+	monsterAiSetBudget(MONSTER_AI_DEFAULT_BUDGET);
+}
+
+/* A 255x255 level has more 16x16 blocks than zone ids: cut coarser, every cell keeps a zone */
+static void testZonesBigLevel(void)
+{
+	tMaze *pMaze = beginCase("activity zones big level", 255, 255);
+	hostGameSetMaze(pMaze);
+	CHECK(mazeZonesBuild(pMaze));
+	CHECK(pMaze->_zones->ubBlock == 32 && pMaze->_zones->ubCount == 64);
+	CHECK(mazeZoneAt(pMaze, 254, 254) != MAZE_ZONE_NONE);
+	mazeZonesSetParty(pMaze, 0, 0);
+	CHECK(mazeZoneIsActive(pMaze, 40, 10) && !mazeZoneIsActive(pMaze, 254, 254));
+
+	/* Thousands of one-cell rooms: the ones past the last id share it, and it sleeps too */
+	for (UWORD i = 0; i < 255 * 255; i++)
+		pMaze->_mazeData[i] = (i % 255) % 2 || (i / 255) % 2 ? MAZE_WALL : MAZE_FLOOR;
+	CHECK(mazeZonesBuild(pMaze));
+	CHECK(pMaze->_zones->ubBlock == MAZE_ZONE_BLOCK_MAX && pMaze->_zones->ubCount == MAZE_ZONE_MAX);
+	CHECK(mazeZoneAt(pMaze, 254, 254) == MAZE_ZONE_MAX - 1);
+	mazeZonesSetParty(pMaze, 0, 0);
+	CHECK(!mazeZoneIsActive(pMaze, 254, 254));
+}
+
+/* SLZ1 streams built by hand, so the decoder is checked without the editor's encoder */
+static void testSlz(void)
+{
+	s_szCase = "slz";
+	UBYTE pOut[64];
+	/* "ab" then a 7-byte match at offset 2 (overlapping), then "!" */
+	const UBYTE pRepeat[] = {0x24, 'a', 'b', 0x00, 0x02, 0x10, '!'};
+	memset(pOut, 0xEE, sizeof(pOut));
+	CHECK(slzDecode(pRepeat, sizeof(pRepeat), pOut, 10) && memcmp(pOut, "ababababa!", 10) == 0);
+	CHECK(pOut[10] == 0xEE);
+	/* Offset 1 run with a length extension: 'z' + (3 + 15 + 20) more, then "!" */
+	const UBYTE pRun[] = {0x1F, 'z', 0x00, 0x01, 20, 0x10, '!'};
+	CHECK(slzDecode(pRun, sizeof(pRun), pOut, 40));
+	CHECK(pOut[0] == 'z' && pOut[38] == 'z' && pOut[39] == '!' && pOut[40] == 0xEE);
+	/* 15 + 2 literals via the literal extension */
+	UBYTE pLits[20] = {0xF0, 2};
+	for (int i = 0; i < 17; i++)
+		pLits[2 + i] = (UBYTE)('A' + i);
+	CHECK(slzDecode(pLits, 19, pOut, 17) && pOut[16] == 'Q');
+
+	/* Corrupt input fails rather than writing out of bounds */
+	const UBYTE pFarOffset[] = {0x10, 'a', 0x00, 0x02, 0x00};
+	CHECK(!slzDecode(pFarOffset, sizeof(pFarOffset), pOut, 5));
+	const UBYTE pZeroOffset[] = {0x10, 'a', 0x00, 0x00, 0x00};
+	CHECK(!slzDecode(pZeroOffset, sizeof(pZeroOffset), pOut, 5));
+	CHECK(!slzDecode(pRepeat, sizeof(pRepeat), pOut, 9));  /* output overrun */
+	CHECK(!slzDecode(pRepeat, sizeof(pRepeat) - 1, pOut, 10)); /* truncated */
+	CHECK(!slzDecode(pRun, 4, pOut, 40)); /* truncated in a length extension */
+
+	/* Streaming from a file: input arrives in blocks, trailing bytes are rejected */
+	FILE *pFile = fopen(s_szTmpPath, "wb");
+	fwrite(pRun, 1, sizeof(pRun), pFile);
+	fputc(0x5A, pFile);
+	fclose(pFile);
+	tBinReader sReader;
+	CHECK(binReaderOpen(&sReader, s_szTmpPath));
+	CHECK(slzDecodeStream(&sReader, sizeof(pRun), pOut, 40) && pOut[39] == '!');
+	CHECK(binReadU8(&sReader) == 0x5A && !sReader.isOverrun);
+	binReaderClose(&sReader);
+	binReaderInitMemory(&sReader, pRun, sizeof(pRun));
+	CHECK(!slzDecodeStream(&sReader, sizeof(pRun), pOut, 30));
+	CHECK(sReader.pos == sizeof(pRun));
+
+	/* A packed .maze (one literal run in a container) loads like the plain file */
+	tMaze *pMaze = mazeCreate(4, 4);
+	pMaze->_mazeData[5] = MAZE_DOOR;
+	mazeAddString(pMaze, "packed", 6);
+	mazeSave(pMaze, s_szTmpPath);
+	mazeDelete(pMaze);
+	UBYTE pRaw[256];
+	pFile = fopen(s_szTmpPath, "rb");
+	ULONG ulRaw = (ULONG)fread(pRaw, 1, sizeof(pRaw), pFile);
+	fclose(pFile);
+	UBYTE pHeader[SLZ_HEADER_SIZE + 2] = {'S', 'L', 'Z', '1'};
+	ULONG ulPacked = 2 + ulRaw;
+	for (int i = 0; i < 4; i++) {
+		pHeader[4 + i] = (UBYTE)(ulRaw >> (24 - 8 * i));
+		pHeader[8 + i] = (UBYTE)(ulPacked >> (24 - 8 * i));
+	}
+	pHeader[SLZ_HEADER_SIZE] = 0xF0;
+	pHeader[SLZ_HEADER_SIZE + 1] = (UBYTE)(ulRaw - 15);
+	CHECK(ulRaw - 15 < 255);
+	pFile = fopen(s_szTmpPath, "wb");
+	fwrite(pHeader, 1, sizeof(pHeader), pFile);
+	fwrite(pRaw, 1, ulRaw, pFile);
+	fclose(pFile);
+	pMaze = mazeLoad(s_szTmpPath);
+	char szOut[16];
+	CHECK(pMaze && pMaze->_mazeData[5] == MAZE_DOOR);
+	CHECK(pMaze && mazeGetStringByIndex(pMaze, 0, szOut, sizeof(szOut)) && strcmp(szOut, "packed") == 0);
+	if (pMaze)
+		mazeDelete(pMaze);
+}
+
+static int runBuiltIn(void)
+{
+	testStraightLine();
+	testIfElse();
+	testConditions();
+	testVerifier();
+	testGosubDepth();
+	testMazeArena();
+	testMazeLoadStress();
+	testLoadProfile();
+	testBinReader();
+	testAssetCache();
+	testWallsetBitmaps();
+	testSlz();
+	testGotoGosub();
+	testInventory();
+	testMessageAndParty();
+	testDoors();
+	testChangeLevel();
+	testSaveJournal();
+	testSaveJournalOrder();
+	testSpawnIdWrap();
+	testSnapshot();
+	testSnapshotBigLevel();
+	testEncounters();
+	testAddMonsterSpawns();
+	testRngAndReplay();
+	testMazeChunked();
+	testPartyField();
+	testSight();
+	testCombatRound();
+	testMonsterPool();
+	testZones();
+	testZonesBigLevel();
+	testMonsterSchedule();
+	testRunawayLoop();
+	testWait();
+	testFrameBudget();
+	testContextPoolFull();
+	return s_iFailures;
+}
+
+static int runFile(int argc, char **argv)
+{
+	s_szCase = argv[1];
+	tMaze *pMaze = mazeLoad(argv[1]);
+	if (!pMaze) {
+		fprintf(stderr, "cannot load %s\n", argv[1]);
+		return 1;
+	}
+	hostGameReset();
+	hostGameSetMaze(pMaze);
+	UWORD uwStart = 0;
+	int i;
+	for (i = 2; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "--start") == 0)
+			uwStart = (UWORD)atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--party") == 0) {
+			unsigned x = 0, y = 0;
+			sscanf(argv[i + 1], "%u,%u", &x, &y);
+			g_pGameState->m_pCurrentParty->_PartyX = (UBYTE)x;
+			g_pGameState->m_pCurrentParty->_PartyY = (UBYTE)y;
+		}
+	}
+	executeScript(pMaze, uwStart);
+	/* Let EVENT_WAIT / budget-suspended scripts finish */
+	for (ULONG ulFrame = 0; ulFrame < 10000 && scriptActiveCount(); ulFrame++)
+		scriptUpdate(pMaze);
+
+	for (i = 2; i + 1 < argc; i += 2) {
+		const char *szArg = argv[i + 1];
+		unsigned a = 0, b = 0, v = 0;
+		char c = 0;
+		if (strcmp(argv[i], "--flag") == 0 && sscanf(szArg, "%c%u=%u", &c, &a, &v) == 3 && a < 256) {
+			UBYTE *pFlags = (c == 'G' || c == 'g') ? g_pGameState->m_bGlobalFlags : g_pGameState->m_bLocalFlags;
+			CHECK(pFlags[a] == v);
+		}
+		else if (strcmp(argv[i], "--cell") == 0 && sscanf(szArg, "%u,%u=%u", &a, &b, &v) == 3) {
+			CHECK(mazeGetCell(pMaze, (UBYTE)a, (UBYTE)b) == v);
+		}
+		else if (strcmp(argv[i], "--item") == 0 && sscanf(szArg, "%u=%u", &a, &v) == 2) {
+			CHECK(inventoryGetItemCount(g_pGameState->m_pInventory, (UBYTE)a) == v);
+		}
+		else if (strcmp(argv[i], "--message") == 0) {
+			CHECK(strcmp(g_szHostLastMessage, szArg) == 0);
+		}
+	}
+	return s_iFailures;
+}
+
+int main(int argc, char **argv)
+{
+	const char *szTmp = getenv("TMPDIR");
+	snprintf(s_szTmpPath, sizeof(s_szTmpPath), "%s/smite_script_test_%d.maze",
+		szTmp ? szTmp : "/tmp", (int)getpid());
+
+	hostGameCreate();
+	int iResult = argc > 1 ? runFile(argc, argv) : runBuiltIn();
+	hostGameDestroy();
+	remove(s_szTmpPath);
+
+	printf("%d checks, %d failures\n", s_iChecks, s_iFailures);
+	return iResult ? 1 : 0;
+}
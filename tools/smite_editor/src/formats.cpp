@@ -39,6 +39,17 @@ void writeBe16(std::vector<unsigned char> &out, std::uint16_t v)
 	out.push_back((unsigned char)(v & 0xff));
 }
 
+static void writeBe32(std::vector<unsigned char> &out, std::uint32_t v)
+{
+	writeBe16(out, (std::uint16_t)(v >> 16));
+	writeBe16(out, (std::uint16_t)(v & 0xffff));
+}
+
+static std::uint32_t readBe32(const unsigned char *p)
+{
+	return (std::uint32_t)readBe16(p) << 16 | readBe16(p + 2);
+}
+
 static void padPath(std::vector<unsigned char> &o, const std::string &s)
 {
 	for (int i = 0; i < 64; i++) {
@@ -203,6 +214,7 @@ bool loadMaze(const std::string &path, MazeFile &m, std::string &err)
 {
 	std::vector<unsigned char> d;
 	if (!readFile(path, d, err)) return false;
+	if (!unpackSlzFile(d, err)) return false;
 	if (d.size() < 2) { err = "maze small"; return false; }
 	m.width = d[0]; m.height = d[1];
 	size_t cells = (size_t)m.width * m.height;
@@ -339,13 +351,32 @@ bool loadLvl(const std::string &path, LvlEntities &e, std::string &err)
 		x.type = d[off++]; x.x = d[off++]; x.y = d[off++];
 		e.monsters.push_back(x);
 	}
+	e.encounters.clear();
+	if (e.version < 2)
+		return true;
+	if (off >= d.size()) { err = "enc cnt"; return false; }
+	int ne = d[off++];
+	for (int i = 0; i < ne; i++) {
+		if (off + 2 > d.size()) { err = "enc"; return false; }
+		LvlEntities::Enc x;
+		x.id = d[off++];
+		int nm = d[off++];
+		if (off + 3 * (size_t)nm > d.size()) { err = "enc m"; return false; }
+		for (int j = 0; j < nm; j++) {
+			LvlEntities::MS m;
+			m.type = d[off++]; m.x = d[off++]; m.y = d[off++];
+			x.members.push_back(m);
+		}
+		e.encounters.push_back(std::move(x));
+	}
 	return true;
 }
 
 bool saveLvl(const std::string &path, const LvlEntities &e, std::string &err)
 {
 	std::vector<unsigned char> o;
-	o.insert(o.end(), {'L','V','L','E', (unsigned char)e.version});
+	int version = e.encounters.empty() || e.version >= 2 ? e.version : 2;
+	o.insert(o.end(), {'L','V','L','E', (unsigned char)version});
 	o.push_back((unsigned char)e.wallBtns.size());
 	for (const auto &w : e.wallBtns) {
 		o.push_back((unsigned char)w.x);
@@ -388,6 +419,16 @@ bool saveLvl(const std::string &path, const LvlEntities &e, std::string &err)
 	for (const auto &x : e.monsters) {
 		o.push_back((unsigned char)x.type); o.push_back((unsigned char)x.x); o.push_back((unsigned char)x.y);
 	}
+	if (version >= 2) {
+		o.push_back((unsigned char)e.encounters.size());
+		for (const auto &x : e.encounters) {
+			o.push_back((unsigned char)x.id);
+			o.push_back((unsigned char)x.members.size());
+			for (const auto &m : x.members) {
+				o.push_back((unsigned char)m.type); o.push_back((unsigned char)m.x); o.push_back((unsigned char)m.y);
+			}
+		}
+	}
 	return writeFile(path, o, err);
 }
 
@@ -411,7 +452,7 @@ bool loadWallsetMain(const std::string &path, WallsetFile &w, std::string &err)
 		int wc = d[off++];
 		w.tilesPerGroup.push_back(wc);
 		for (int k = 0; k < wc; k++) {
-			if (off + 18 > d.size()) { err = "tile"; return false; }
+			if (off + 16 > d.size()) { err = "tile"; return false; }
 			WallsetFile::Tile t;
 			t.type = d[off++]; t.setIndex = d[off++];
 			t.loc[0] = (char)d[off++]; t.loc[1] = (char)d[off++];
@@ -427,7 +468,7 @@ bool loadWallsetMain(const std::string &path, WallsetFile &w, std::string &err)
 	return true;
 }
 
-bool decodeAcePlanar(const std::vector<unsigned char> &fileData, const unsigned char *palRgb, int palColors,
+static bool decodeAcePlanarRaw(const std::vector<unsigned char> &fileData, const unsigned char *palRgb, int palColors,
 	std::vector<unsigned char> &rgbaOut, int &outW, int &outH, std::string &err)
 {
 	if (fileData.size() < 8) { err = "bm small"; return false; }
@@ -468,3 +509,287 @@ bool decodeAcePlanar(const std::vector<unsigned char> &fileData, const unsigned
 	}
 	return true;
 }
+
+bool decodeAcePlanar(const std::vector<unsigned char> &fileData, const unsigned char *palRgb, int palColors,
+	std::vector<unsigned char> &rgbaOut, int &outW, int &outH, std::string &err)
+{
+	if (fileData.size() < 8 || !(fileData[6] & 0x80))
+		return decodeAcePlanarRaw(fileData, palRgb, palColors, rgbaOut, outW, outH, err);
+	std::vector<unsigned char> plain = fileData;
+	if (!unpackBitmapFile(plain, err)) return false;
+	return decodeAcePlanarRaw(plain, palRgb, palColors, rgbaOut, outW, outH, err);
+}
+
+static const size_t kSlzMinMatch = 3;
+static const size_t kSlzWindow = 65535;
+static const int kSlzHashBits = 14;
+static const int kSlzMaxChain = 64;
+static const unsigned char kSlzBitmapFlag = 0x80;
+
+static void slzPutLength(std::vector<unsigned char> &out, size_t len)
+{
+	// Called with the part above the nibble's 15
+	while (len >= 255) { out.push_back(255); len -= 255; }
+	out.push_back((unsigned char)len);
+}
+
+static void slzPutSequence(std::vector<unsigned char> &out, const unsigned char *lit, size_t litLen,
+	size_t offset, size_t matchLen)
+{
+	const size_t ml = matchLen ? matchLen - kSlzMinMatch : 0;
+	out.push_back((unsigned char)((litLen < 15 ? litLen : 15) << 4 | (ml < 15 ? ml : 15)));
+	if (litLen >= 15) slzPutLength(out, litLen - 15);
+	out.insert(out.end(), lit, lit + litLen);
+	if (!matchLen) return;
+	out.push_back((unsigned char)(offset >> 8));
+	out.push_back((unsigned char)(offset & 0xff));
+	if (ml >= 15) slzPutLength(out, ml - 15);
+}
+
+std::vector<unsigned char> slzCompress(const unsigned char *src, size_t n)
+{
+	std::vector<unsigned char> out;
+	std::vector<int> head((size_t)1 << kSlzHashBits, -1);
+	std::vector<int> prev(n, -1);
+	auto hash = [&](size_t i) {
+		std::uint32_t v = (std::uint32_t)src[i] << 16 | (std::uint32_t)src[i + 1] << 8 | src[i + 2];
+		return (size_t)((v * 2654435761u) >> (32 - kSlzHashBits));
+	};
+	auto insert = [&](size_t i) {
+		if (i + kSlzMinMatch > n) return;
+		const size_t h = hash(i);
+		prev[i] = head[h];
+		head[h] = (int)i;
+	};
+	size_t anchor = 0, i = 0;
+	while (i + kSlzMinMatch <= n) {
+		size_t bestLen = 0, bestOff = 0;
+		int cand = head[hash(i)];
+		for (int chain = 0; cand >= 0 && i - (size_t)cand <= kSlzWindow && chain < kSlzMaxChain;
+			chain++, cand = prev[(size_t)cand]) {
+			size_t len = 0;
+			while (i + len < n && src[(size_t)cand + len] == src[i + len]) len++;
+			if (len > bestLen) { bestLen = len; bestOff = i - (size_t)cand; }
+		}
+		if (bestLen >= kSlzMinMatch) {
+			slzPutSequence(out, src + anchor, i - anchor, bestOff, bestLen);
+			for (size_t k = 0; k < bestLen; k++) insert(i + k);
+			i += bestLen;
+			anchor = i;
+		} else {
+			insert(i);
+			i++;
+		}
+	}
+	// The stream ends on literals; none are needed if the last match reached the end
+	if (anchor < n)
+		slzPutSequence(out, src + anchor, n - anchor, 0, 0);
+	return out;
+}
+
+static bool slzGetLength(const unsigned char *src, size_t n, size_t &ip, size_t &len)
+{
+	if (len != 15) return true;
+	unsigned char b;
+	do {
+		if (ip >= n) return false;
+		b = src[ip++];
+		len += b;
+	} while (b == 255);
+	return true;
+}
+
+bool slzDecompress(const unsigned char *src, size_t n, unsigned char *dst, size_t rawSize)
+{
+	size_t ip = 0, op = 0;
+	while (op < rawSize) {
+		if (ip >= n) return false;
+		const unsigned char token = src[ip++];
+		size_t lit = token >> 4;
+		if (!slzGetLength(src, n, ip, lit) || lit > rawSize - op || lit > n - ip) return false;
+		std::memcpy(dst + op, src + ip, lit);
+		op += lit;
+		ip += lit;
+		if (op == rawSize) break;
+		if (ip + 2 > n) return false;
+		const size_t offset = (size_t)src[ip] << 8 | src[ip + 1];
+		ip += 2;
+		size_t len = token & 15;
+		if (!slzGetLength(src, n, ip, len)) return false;
+		len += kSlzMinMatch;
+		if (offset == 0 || offset > op || len > rawSize - op) return false;
+		for (size_t k = 0; k < len; k++, op++) dst[op] = dst[op - offset];
+	}
+	return ip == n;
+}
+
+std::vector<unsigned char> packSlzFile(const std::vector<unsigned char> &raw)
+{
+	const std::vector<unsigned char> stream = slzCompress(raw.data(), raw.size());
+	std::vector<unsigned char> out;
+	out.insert(out.end(), {'S','L','Z','1'});
+	writeBe32(out, (std::uint32_t)raw.size());
+	writeBe32(out, (std::uint32_t)stream.size());
+	out.insert(out.end(), stream.begin(), stream.end());
+	return out;
+}
+
+bool unpackSlzFile(std::vector<unsigned char> &data, std::string &err)
+{
+	if (data.size() < 12 || std::memcmp(data.data(), "SLZ1", 4) != 0) return true;
+	const size_t rawSize = readBe32(data.data() + 4);
+	const size_t packed = readBe32(data.data() + 8);
+	if (packed > data.size() - 12) { err = "SLZ1 truncated"; return false; }
+	std::vector<unsigned char> raw(rawSize);
+	if (!slzDecompress(data.data() + 12, packed, raw.data(), rawSize)) { err = "SLZ1 corrupt"; return false; }
+	data.swap(raw);
+	return true;
+}
+
+bool packBitmapFile(const std::vector<unsigned char> &raw, std::vector<unsigned char> &out, std::string &err)
+{
+	if (raw.size() < 8) { err = "bm small"; return false; }
+	const int w = readBe16(raw.data()), h = readBe16(raw.data() + 2), depth = raw[4];
+	const size_t fileBpr = (size_t)(w + 7) / 8;
+	// The game decodes each plane straight into the bitmap, so file rows must match its word-aligned rows
+	if (fileBpr != (size_t)((w + 15) / 16) * 2) { err = "bitmap width must fill whole words to pack"; return false; }
+	if (raw[6] & (1 | kSlzBitmapFlag)) { err = "bitmap is interleaved or already packed"; return false; }
+	const size_t planeSize = fileBpr * (size_t)h;
+	if (8 + planeSize * (size_t)depth > raw.size()) { err = "bm planes"; return false; }
+	out.assign(raw.begin(), raw.begin() + 8);
+	out[6] |= kSlzBitmapFlag;
+	for (int p = 0; p < depth; p++) {
+		const std::vector<unsigned char> stream = slzCompress(raw.data() + 8 + planeSize * (size_t)p, planeSize);
+		writeBe32(out, (std::uint32_t)stream.size());
+		out.insert(out.end(), stream.begin(), stream.end());
+	}
+	return true;
+}
+
+bool unpackBitmapFile(std::vector<unsigned char> &data, std::string &err)
+{
+	if (data.size() < 8 || !(data[6] & kSlzBitmapFlag)) return true;
+	const int w = readBe16(data.data()), h = readBe16(data.data() + 2), depth = data[4];
+	const size_t planeSize = (size_t)(w + 7) / 8 * (size_t)h;
+	std::vector<unsigned char> raw(data.begin(), data.begin() + 8);
+	raw[6] &= (unsigned char)~kSlzBitmapFlag;
+	raw.resize(8 + planeSize * (size_t)depth);
+	size_t off = 8;
+	for (int p = 0; p < depth; p++) {
+		if (off + 4 > data.size()) { err = "packed plane header"; return false; }
+		const size_t packed = readBe32(data.data() + off);
+		off += 4;
+		if (packed > data.size() - off
+			|| !slzDecompress(data.data() + off, packed, raw.data() + 8 + planeSize * (size_t)p, planeSize)) {
+			err = "packed plane corrupt";
+			return false;
+		}
+		off += packed;
+	}
+	data.swap(raw);
+	return true;
+}
+
+static const int kPakVersion = 1;
+static const size_t kPakHeaderSize = 16;
+static const size_t kPakTocEntrySize = 16;
+static const size_t kPakChunkAlign = 4;
+
+bool savePak(const std::string &path, const std::vector<PakChunk> &chunks, std::string &err)
+{
+	if (chunks.size() > 0xffff) { err = "too many chunks"; return false; }
+	// Lay out the chunks first so the TOC can carry final offsets
+	std::vector<std::uint32_t> offsets;
+	size_t off = kPakHeaderSize + kPakTocEntrySize * chunks.size();
+	for (const auto &c : chunks) {
+		off = (off + kPakChunkAlign - 1) & ~(kPakChunkAlign - 1);
+		offsets.push_back((std::uint32_t)off);
+		off += c.data.size();
+	}
+	const size_t total = (off + kPakChunkAlign - 1) & ~(kPakChunkAlign - 1);
+
+	std::vector<unsigned char> o;
+	o.reserve(total);
+	o.insert(o.end(), {'S','P','A','K'});
+	writeBe16(o, (std::uint16_t)kPakVersion);
+	writeBe16(o, (std::uint16_t)chunks.size());
+	writeBe32(o, (std::uint32_t)total);
+	writeBe32(o, 0);
+	for (size_t i = 0; i < chunks.size(); i++) {
+		o.insert(o.end(), chunks[i].tag, chunks[i].tag + 4);
+		writeBe16(o, chunks[i].index);
+		writeBe16(o, 0);
+		writeBe32(o, offsets[i]);
+		writeBe32(o, (std::uint32_t)chunks[i].data.size());
+	}
+	for (size_t i = 0; i < chunks.size(); i++) {
+		o.resize(offsets[i], 0);
+		o.insert(o.end(), chunks[i].data.begin(), chunks[i].data.end());
+	}
+	o.resize(total, 0);
+	return writeFile(path, o, err);
+}
+
+bool loadPak(const std::string &path, std::vector<PakChunk> &out, std::string &err)
+{
+	std::vector<unsigned char> d;
+	if (!readFile(path, d, err)) return false;
+	if (d.size() < kPakHeaderSize || std::memcmp(d.data(), "SPAK", 4) != 0) { err = "bad SPAK magic"; return false; }
+	if (readBe16(d.data() + 4) != kPakVersion) { err = "pak version"; return false; }
+	const size_t count = readBe16(d.data() + 6);
+	if (kPakHeaderSize + count * kPakTocEntrySize > d.size()) { err = "truncated TOC"; return false; }
+	out.clear();
+	for (size_t i = 0; i < count; i++) {
+		const unsigned char *e = d.data() + kPakHeaderSize + i * kPakTocEntrySize;
+		std::uint32_t offset = readBe32(e + 8), size = readBe32(e + 12);
+		if (offset > d.size() || size > d.size() - offset) { err = "chunk out of range"; return false; }
+		PakChunk c;
+		std::memcpy(c.tag, e, 4);
+		c.index = readBe16(e + 4);
+		c.data.assign(d.begin() + offset, d.begin() + offset + size);
+		out.push_back(std::move(c));
+	}
+	return true;
+}
+
+static bool addPakChunk(std::vector<PakChunk> &chunks, const char *tag, int index, const std::string &path,
+	std::string &err)
+{
+	PakChunk c;
+	std::memcpy(c.tag, tag, 4);
+	c.index = (std::uint16_t)index;
+	if (!readFile(path, c.data, err)) return false;
+	chunks.push_back(std::move(c));
+	return true;
+}
+
+// Bitmaps that can't be packed (odd widths, interleaved) go in plain; the game reads both
+static void packBitmapChunk(PakChunk &c)
+{
+	std::vector<unsigned char> packed;
+	std::string ignored;
+	if (packBitmapFile(c.data, packed, ignored) && packed.size() < c.data.size())
+		c.data.swap(packed);
+}
+
+bool packLevel(const std::string &mazePath, const std::string &wallsetPath, const std::string &entitiesPath,
+	const std::string &outPath, std::string &err, bool compress)
+{
+	WallsetFile ws;
+	if (!loadWallsetMain(wallsetPath, ws, err)) return false;
+	std::vector<PakChunk> chunks;
+	if (!addPakChunk(chunks, "MAZE", 0, mazePath, err)) return false;
+	if (compress) chunks.back().data = packSlzFile(chunks.back().data);
+	if (!addPakChunk(chunks, "WALL", 0, wallsetPath, err)) return false;
+	// Same naming wallsetLoad() uses: <base>_N.pln / <base>_N.msk
+	const size_t dot = wallsetPath.find_last_of('.');
+	const std::string base = dot == std::string::npos ? wallsetPath : wallsetPath.substr(0, dot);
+	for (int i = 0; i < ws.gfxCount; i++) {
+		if (!addPakChunk(chunks, "PLN ", i, base + "_" + std::to_string(i) + ".pln", err)) return false;
+		if (compress) packBitmapChunk(chunks.back());
+		if (!addPakChunk(chunks, "MSK ", i, base + "_" + std::to_string(i) + ".msk", err)) return false;
+		if (compress) packBitmapChunk(chunks.back());
+	}
+	if (!entitiesPath.empty() && !addPakChunk(chunks, "LVLE", 0, entitiesPath, err)) return false;
+	return savePak(outPath, chunks, err);
+}
@@ -73,12 +73,14 @@ struct LvlEntities {
 	struct Pl { int x,y,evt,dsz; unsigned char d[8]; };
 	struct GI { int x,y,item,qty; };
 	struct MS { int type,x,y; };
+	struct Enc { int id; std::vector<MS> members; };
 	std::vector<WB> wallBtns;
 	std::vector<DB> doorBtns;
 	std::vector<Lk> locks;
 	std::vector<Pl> plates;
 	std::vector<GI> ground;
 	std::vector<MS> monsters;
+	std::vector<Enc> encounters; // Version 2 and later
 };
 
 bool loadLvl(const std::string &path, LvlEntities &out, std::string &err);
@@ -101,6 +103,37 @@ struct WallsetFile {
 
 bool loadWallsetMain(const std::string &path, WallsetFile &out, std::string &err);
 
-/** Decode ACE bitmap (.pln/.bm): non-interleaved, version 0. Returns RGBA 8bpp. */
+/** SLZ1 stream (format in include/slz.h): greedy hash-chain matcher, 64 KB window. */
+std::vector<unsigned char> slzCompress(const unsigned char *src, size_t n);
+bool slzDecompress(const unsigned char *src, size_t n, unsigned char *dst, size_t rawSize);
+
+/** Whole-file SLZ1 container ("SLZ1", raw size, packed size, stream), e.g. for .maze. */
+std::vector<unsigned char> packSlzFile(const std::vector<unsigned char> &raw);
+/** Unpacks data in place if it is an SLZ1 container; anything else is left as is. */
+bool unpackSlzFile(std::vector<unsigned char> &data, std::string &err);
+
+/** ACE bitmap with each plane packed (flag 0x80). Needs a non-interleaved file whose rows fill whole words. */
+bool packBitmapFile(const std::vector<unsigned char> &raw, std::vector<unsigned char> &out, std::string &err);
+/** Unpacks a packed bitmap in place; plain bitmaps are left as is. */
+bool unpackBitmapFile(std::vector<unsigned char> &data, std::string &err);
+
+/** Decode ACE bitmap (.pln/.bm): non-interleaved, version 0, plain or plane-packed. Returns RGBA 8bpp. */
 bool decodeAcePlanar(const std::vector<unsigned char> &fileData, const unsigned char *palRgb, int palColors,
 	std::vector<unsigned char> &rgbaOut, int &outW, int &outH, std::string &err);
+
+/** One .pak chunk: tag is four ASCII chars (see include/pak.h), data is the loose file's bytes. */
+struct PakChunk {
+	char tag[4]{};
+	std::uint16_t index = 0;
+	std::vector<unsigned char> data;
+};
+
+bool savePak(const std::string &path, const std::vector<PakChunk> &chunks, std::string &err);
+bool loadPak(const std::string &path, std::vector<PakChunk> &out, std::string &err);
+
+/**
+ * Bundle a level's .maze, .wll with its _N.pln/_N.msk bitmaps, and optional .lvl into one .pak.
+ * With compress, the maze and bitmaps are stored SLZ1-packed.
+ */
+bool packLevel(const std::string &mazePath, const std::string &wallsetPath, const std::string &entitiesPath,
+	const std::string &outPath, std::string &err, bool compress = false);
@@ -386,9 +386,9 @@ int main(int, char **)
 				std::string er;
 				saveLvl(joinPath(s_root, lvlPath), gLvl, er);
 			}
-			ImGui::Text("Wall btns %zu | Door %zu | Plates %zu | Ground %zu | Mon %zu",
+			ImGui::Text("Wall btns %zu | Door %zu | Plates %zu | Ground %zu | Mon %zu | Enc %zu",
 				gLvl.wallBtns.size(), gLvl.doorBtns.size(), gLvl.plates.size(),
-				gLvl.ground.size(), gLvl.monsters.size());
+				gLvl.ground.size(), gLvl.monsters.size(), gLvl.encounters.size());
 			if (ImGui::Button("+Wall btn")) {
 				LvlEntities::WB w{};
 				gLvl.wallBtns.push_back(w);
@@ -0,0 +1,116 @@
+// smite_pack: bundle level files into .pak containers (see docs/formats/pak.md)
+// and SLZ1-compress single assets (docs/formats/slz.md).
+//
+//   smite_pack [-z] <out.pak> <maze> <wallset.wll> [entities.lvl]
+//   smite_pack [-z] --manifest <in.smt> <out.smt>
+//   smite_pack --slz <in> <out>
+//
+// -z stores the maze and wallset bitmaps SLZ1-packed inside the pack.
+// Manifest mode packs every level next to its maze as <maze base>.pak and writes
+// a manifest whose maze paths point at the packs.
+// --slz packs one file: .pln/.msk/.bm plane by plane, anything else (.maze) whole.
+#include "formats.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static std::string pakPathFor(const std::string &mazePath)
+{
+	const size_t dot = mazePath.find_last_of('.');
+	const size_t slash = mazePath.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return mazePath + ".pak";
+	return mazePath.substr(0, dot) + ".pak";
+}
+
+static int packManifest(const std::string &inPath, const std::string &outPath, bool compress)
+{
+	GameManifest m;
+	std::string err;
+	if (!loadGameManifest(inPath, m, err)) {
+		std::fprintf(stderr, "%s: %s\n", inPath.c_str(), err.c_str());
+		return 1;
+	}
+	for (auto &lv : m.levels) {
+		if (lv.mazePath.empty() || lv.wallsetPath.empty()) {
+			std::fprintf(stderr, "skipping level without maze or wallset path\n");
+			continue;
+		}
+		const std::string pak = pakPathFor(lv.mazePath);
+		if (pak.size() > 63) {
+			std::fprintf(stderr, "%s: path longer than the manifest's 64 bytes\n", pak.c_str());
+			return 1;
+		}
+		if (!packLevel(lv.mazePath, lv.wallsetPath, lv.entitiesPath, pak, err, compress)) {
+			std::fprintf(stderr, "%s: %s\n", pak.c_str(), err.c_str());
+			return 1;
+		}
+		std::printf("%s\n", pak.c_str());
+		lv.mazePath = pak;
+		lv.wallsetPath.clear();
+		lv.entitiesPath.clear();
+	}
+	if (!saveGameManifest(outPath, m, err)) {
+		std::fprintf(stderr, "%s: %s\n", outPath.c_str(), err.c_str());
+		return 1;
+	}
+	return 0;
+}
+
+static bool hasExt(const std::string &path, const char *ext)
+{
+	const size_t n = std::strlen(ext);
+	return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+}
+
+static int packOne(const std::string &inPath, const std::string &outPath)
+{
+	std::vector<unsigned char> raw, packed;
+	std::string err;
+	if (!readRawFile(inPath, raw, err)) {
+		std::fprintf(stderr, "%s\n", err.c_str());
+		return 1;
+	}
+	if (hasExt(inPath, ".pln") || hasExt(inPath, ".msk") || hasExt(inPath, ".bm")) {
+		if (!packBitmapFile(raw, packed, err)) {
+			std::fprintf(stderr, "%s: %s\n", inPath.c_str(), err.c_str());
+			return 1;
+		}
+	} else {
+		packed = packSlzFile(raw);
+	}
+	std::ofstream f(outPath, std::ios::binary);
+	if (!f) {
+		std::fprintf(stderr, "Cannot write: %s\n", outPath.c_str());
+		return 1;
+	}
+	f.write(reinterpret_cast<const char *>(packed.data()), (std::streamsize)packed.size());
+	std::printf("%s: %zu -> %zu bytes\n", inPath.c_str(), raw.size(), packed.size());
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 4 && std::strcmp(argv[1], "--slz") == 0)
+		return packOne(argv[2], argv[3]);
+	bool compress = argc > 1 && std::strcmp(argv[1], "-z") == 0;
+	if (compress) {
+		argc--;
+		argv++;
+	}
+	if (argc == 4 && std::strcmp(argv[1], "--manifest") == 0)
+		return packManifest(argv[2], argv[3], compress);
+	if (argc != 4 && argc != 5) {
+		std::fprintf(stderr,
+			"usage: smite_pack [-z] <out.pak> <maze> <wallset.wll> [entities.lvl]\n"
+			"       smite_pack [-z] --manifest <in.smt> <out.smt>\n"
+			"       smite_pack --slz <in> <out>\n");
+		return 2;
+	}
+	std::string err;
+	if (!packLevel(argv[2], argv[3], argc == 5 ? argv[4] : "", argv[1], err, compress)) {
+		std::fprintf(stderr, "%s: %s\n", argv[1], err.c_str());
+		return 1;
+	}
+	return 0;
+}